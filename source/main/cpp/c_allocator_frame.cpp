@@ -0,0 +1,117 @@
+#include "ccore/c_target.h"
+#include "ccore/c_debug.h"
+#include "ccore/c_arena.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_frame.h"
+#include "cbase/c_integer.h"
+
+namespace ncore
+{
+    const int_t c_frame_commit_granularity = 64 * cKB;
+
+    frame_alloc_t::frame_alloc_t()
+        : m_current(nullptr)
+        , m_num_frames(0)
+        , m_frame(0)
+    {
+        for (s32 i = 0; i < c_max_frames; ++i)
+            m_regions[i].m_arena = nullptr;
+    }
+
+    frame_alloc_t::~frame_alloc_t() { exit(); }
+
+    void frame_alloc_t::init(s32 num_frames, int_t frame_size)
+    {
+        ASSERT(num_frames >= 1 && num_frames <= c_max_frames);
+        ASSERT(m_num_frames == 0);
+
+        m_num_frames = num_frames;
+        m_frame      = 0;
+        for (s32 i = 0; i < m_num_frames; ++i)
+        {
+            region_t& r    = m_regions[i];
+            r.m_arena      = narena::new_arena(frame_size, 0);
+            r.m_base       = math::alignUp((s32)sizeof(arena_t), 64);
+            r.m_top        = r.m_base;
+            r.m_committed  = 0;
+            r.m_reserved   = frame_size;
+            r.m_used       = 0;
+            r.m_high_water = 0;
+            r.m_frame      = 0;
+        }
+        m_current = &m_regions[0];
+    }
+
+    void frame_alloc_t::exit()
+    {
+        for (s32 i = 0; i < m_num_frames; ++i)
+        {
+            if (m_regions[i].m_arena != nullptr)
+            {
+                narena::destroy(m_regions[i].m_arena);
+                m_regions[i].m_arena = nullptr;
+            }
+        }
+        m_num_frames = 0;
+        m_current    = nullptr;
+    }
+
+    u32 frame_alloc_t::begin_frame()
+    {
+        m_frame += 1;
+        m_current = &m_regions[m_frame % m_num_frames];
+
+        // Resetting a region is O(1), committed pages are kept
+        region_t& r = *m_current;
+        narena::reset(r.m_arena);
+        r.m_top   = r.m_base;
+        r.m_used  = 0;
+        r.m_frame = m_frame;
+        return m_frame;
+    }
+
+    void frame_alloc_t::end_frame()
+    {
+        region_t& r = *m_current;
+        if (r.m_used > r.m_high_water)
+            r.m_high_water = r.m_used;
+    }
+
+    void frame_alloc_t::stats(s32 frame_index, stats_t& stats) const
+    {
+        ASSERT(frame_index >= 0 && frame_index < m_num_frames);
+        region_t const& r  = m_regions[frame_index];
+        stats.m_used       = r.m_used;
+        stats.m_high_water = r.m_used > r.m_high_water ? r.m_used : r.m_high_water;
+        stats.m_frame      = r.m_frame;
+    }
+
+    void* frame_alloc_t::v_allocate(u32 size, u32 alignment)
+    {
+        region_t& r = *m_current;
+
+        int_t const needed = r.m_top + size + alignment;
+        if (needed > r.m_reserved)
+            return nullptr;
+        if (needed > r.m_committed)
+        {
+            int_t const commit = math::alignUp(needed, (u32)c_frame_commit_granularity);
+            r.m_committed      = commit < r.m_reserved ? commit : r.m_reserved;
+            narena::commit(r.m_arena, r.m_committed);
+        }
+
+        void* ptr = narena::alloc(r.m_arena, size, alignment);
+        if (ptr != nullptr)
+        {
+            r.m_top = (int_t)(((byte*)ptr + size) - (byte*)r.m_arena);
+            r.m_used += size;
+        }
+        return ptr;
+    }
+
+    void frame_alloc_t::v_deallocate(void*)
+    {
+        // Frame memory is released in bulk by 'begin_frame'
+    }
+
+}  // namespace ncore
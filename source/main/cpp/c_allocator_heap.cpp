@@ -0,0 +1,457 @@
+#include "ccore/c_target.h"
+#include "ccore/c_debug.h"
+#include "ccore/c_arena.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_heap.h"
+#include "cbase/c_integer.h"
+
+#include <atomic>
+
+namespace ncore
+{
+    namespace nheap
+    {
+        const u32 c_slab_shift       = 16;
+        const u32 c_slab_size        = 1 << c_slab_shift;  // 64 KB
+        const u32 c_slab_mask        = c_slab_size - 1;
+        const u32 c_num_classes      = 32;
+        const u32 c_max_small_size   = 8192;
+        const u32 c_max_small_align  = 4096;
+        const u32 c_min_align        = 16;
+        const u32 c_large_class      = 0xFFFFFFFF;
+        const u32 c_slab_header_size = 128;
+
+        // Size classes, 16 byte steps up to 128 and then 4 classes per power of two
+        static const u32 s_class_size[c_num_classes] = {
+          16,   32,   48,   64,   80,   96,   112,  128,   //
+          160,  192,  224,  256,  320,  384,  448,  512,   //
+          640,  768,  896,  1024, 1280, 1536, 1792, 2048,  //
+          2560, 3072, 3584, 4096, 5120, 6144, 7168, 8192,  //
+        };
+
+        static inline u32 s_size_to_class(u32 size)
+        {
+            if (size <= 128)
+                return size == 0 ? 0 : ((size + 15) >> 4) - 1;
+            s32 const msb   = math::mostSignificantBit(size - 1);  // >= 7
+            s32 const shift = msb - 2;
+            return 8 + ((msb - 7) << 2) + (((size - 1) >> shift) & 3);
+        }
+
+        // Blocks in a slab are aligned to the lowest set bit of their size (capped), so a
+        // power-of-two size class gives power-of-two aligned blocks.
+        static inline u32 s_class_data_offset(u32 size)
+        {
+            u32 const lowbit = size & (~size + 1);
+            u32 const align  = lowbit < c_max_small_align ? lowbit : c_max_small_align;
+            return align < c_slab_header_size ? c_slab_header_size : align;
+        }
+
+        struct block_t
+        {
+            block_t* m_next;
+        };
+
+        struct slab_t
+        {
+            heap_t*  m_heap;        // The owning heap
+            slab_t*  m_next;        // Partial list, empty list or large list
+            slab_t*  m_prev;        //
+            block_t* m_free;        // Free blocks that have been handed out before
+            arena_t* m_arena;       // Large allocations own an arena
+            u32      m_class;       // Size class, or c_large_class
+            u32      m_block_size;  //
+            u32      m_offset;      // Offset of the first block
+            u32      m_capacity;    // Number of blocks in this slab
+            u32      m_bump;        // Number of blocks carved so far
+            u32      m_used;        // Number of blocks in use
+            bool     m_listed;      // Is this slab in the partial list of its class
+        };
+
+        // Blocks in a slab never start at the slab itself (there is the header), so a pointer on a 64 KB
+        // boundary can only be a large allocation with an alignment of 64 KB or more. Its header is in
+        // the 64 KB right before it, hence the '- 1'.
+        static inline slab_t* s_slab_of(void const* ptr) { return (slab_t*)(((ptr_t)ptr - 1) & ~(ptr_t)c_slab_mask); }
+    }  // namespace nheap
+
+    using namespace nheap;
+
+    struct heap_t
+    {
+        arena_t*              m_arena;
+        int_t                 m_reserve;                  // Size of the arena
+        heap_alloc_t*         m_alloc;                    // The allocator object, it lives in the arena
+        heap_t*               m_orphan;                   // Next heap in the orphan list
+        int_t                 m_live;                     // Blocks handed out and not yet returned to a slab
+        int_t                 m_top;                      // Offset of the end of the last carved slab
+        slab_t*               m_partial[c_num_classes];   // Slabs that have free blocks
+        slab_t*               m_empty;                    // Cached empty slabs, can be reused for any class
+        slab_t*               m_large;                    // Live large allocations
+        std::atomic<block_t*> m_remote;                   // Blocks freed by other threads
+    };
+
+    static void s_list_insert(slab_t*& head, slab_t* slab)
+    {
+        slab->m_prev = nullptr;
+        slab->m_next = head;
+        if (head != nullptr)
+            head->m_prev = slab;
+        head = slab;
+    }
+
+    static void s_list_remove(slab_t*& head, slab_t* slab)
+    {
+        if (slab->m_prev != nullptr)
+            slab->m_prev->m_next = slab->m_next;
+        else
+            head = slab->m_next;
+        if (slab->m_next != nullptr)
+            slab->m_next->m_prev = slab->m_prev;
+        slab->m_next = nullptr;
+        slab->m_prev = nullptr;
+    }
+
+    static slab_t* s_new_slab(heap_t* heap, u32 cls)
+    {
+        slab_t* slab = heap->m_empty;
+        if (slab != nullptr)
+        {
+            heap->m_empty = slab->m_next;
+        }
+        else
+        {
+            // Make sure the next (aligned) slab is committed before carving it
+            narena::commit(heap->m_arena, heap->m_top + 2 * c_slab_size);
+            slab = (slab_t*)narena::alloc(heap->m_arena, c_slab_size, c_slab_size);
+            if (slab == nullptr)
+                return nullptr;
+            heap->m_top = (int_t)(((byte*)slab + c_slab_size) - (byte*)heap->m_arena);
+        }
+
+        u32 const size     = s_class_size[cls];
+        u32 const offset   = s_class_data_offset(size);
+        slab->m_heap       = heap;
+        slab->m_next       = nullptr;
+        slab->m_prev       = nullptr;
+        slab->m_free       = nullptr;
+        slab->m_arena      = nullptr;
+        slab->m_class      = cls;
+        slab->m_block_size = size;
+        slab->m_offset     = offset;
+        slab->m_capacity   = (c_slab_size - offset) / size;
+        slab->m_bump       = 0;
+        slab->m_used       = 0;
+        slab->m_listed     = true;
+        s_list_insert(heap->m_partial[cls], slab);
+        return slab;
+    }
+
+    // The header is at the start of the (64 KB aligned) allocation and the returned pointer is within
+    // the first 64 KB after it. With an alignment of 64 KB or more the pointer itself is on a 64 KB
+    // boundary and the header is placed 64 KB before it, see s_slab_of.
+    static void* s_allocate_large(heap_t* heap, u32 size, u32 alignment)
+    {
+        u32 const   offset  = alignment > c_slab_header_size ? alignment : c_slab_header_size;
+        int_t const reserve = (int_t)size + offset + 2 * c_slab_size;
+        arena_t*    arena   = narena::new_arena(reserve, 0);
+        if (arena == nullptr)
+            return nullptr;
+        narena::commit(arena, reserve);
+
+        byte* base = (byte*)narena::alloc(arena, (int_t)size + offset, c_slab_size);
+        if (base == nullptr)
+        {
+            narena::destroy(arena);
+            return nullptr;
+        }
+
+        byte* ptr = base + offset;
+        if (alignment >= c_slab_size)
+            ptr = (byte*)(((ptr_t)base + alignment) & ~(ptr_t)(alignment - 1));
+        slab_t* slab = s_slab_of(ptr);
+        ASSERT((byte*)slab >= base);
+
+        slab->m_heap       = heap;
+        slab->m_free       = nullptr;
+        slab->m_arena      = arena;
+        slab->m_class      = c_large_class;
+        slab->m_block_size = size;
+        slab->m_offset     = (u32)(ptr - (byte*)slab);
+        slab->m_capacity   = 1;
+        slab->m_bump       = 1;
+        slab->m_used       = 1;
+        slab->m_listed     = false;
+        s_list_insert(heap->m_large, slab);
+        heap->m_live += 1;
+        return ptr;
+    }
+
+    static void s_deallocate_local(heap_t* heap, void* ptr)
+    {
+        slab_t* slab = s_slab_of(ptr);
+        ASSERT(slab->m_heap == heap);
+        heap->m_live -= 1;
+
+        if (slab->m_class == c_large_class)
+        {
+            s_list_remove(heap->m_large, slab);
+            narena::destroy(slab->m_arena);
+            return;
+        }
+
+        block_t* block = (block_t*)ptr;
+        block->m_next  = slab->m_free;
+        slab->m_free   = block;
+        slab->m_used -= 1;
+
+        slab_t*& partial = heap->m_partial[slab->m_class];
+        if (!slab->m_listed)
+        {
+            slab->m_listed = true;
+            s_list_insert(partial, slab);
+        }
+        else if (slab->m_used == 0 && (slab->m_prev != nullptr || slab->m_next != nullptr))
+        {
+            // Keep the last slab of a class around, otherwise hand the slab to the empty list
+            s_list_remove(partial, slab);
+            slab->m_listed = false;
+            slab->m_next   = heap->m_empty;
+            heap->m_empty  = slab;
+        }
+    }
+
+    static bool s_collect(heap_t* heap)
+    {
+        block_t* block = heap->m_remote.exchange(nullptr, std::memory_order_acquire);
+        if (block == nullptr)
+            return false;
+        while (block != nullptr)
+        {
+            block_t* next = block->m_next;
+            s_deallocate_local(heap, block);
+            block = next;
+        }
+        return true;
+    }
+
+    static void* s_allocate_small(heap_t* heap, u32 cls)
+    {
+        slab_t* slab = heap->m_partial[cls];
+        if (slab == nullptr)
+        {
+            // Blocks that other threads have freed might give us a partial slab
+            if (!s_collect(heap) || (slab = heap->m_partial[cls]) == nullptr)
+            {
+                slab = s_new_slab(heap, cls);
+                if (slab == nullptr)
+                    return nullptr;
+            }
+        }
+
+        void* ptr;
+        if (slab->m_free != nullptr)
+        {
+            ptr          = slab->m_free;
+            slab->m_free = slab->m_free->m_next;
+        }
+        else
+        {
+            ptr = (byte*)slab + slab->m_offset + slab->m_bump * slab->m_block_size;
+            slab->m_bump += 1;
+        }
+        slab->m_used += 1;
+        heap->m_live += 1;
+
+        if (slab->m_free == nullptr && slab->m_bump == slab->m_capacity)
+        {
+            s_list_remove(heap->m_partial[cls], slab);
+            slab->m_listed = false;
+        }
+        return ptr;
+    }
+
+    void* heap_alloc_t::v_allocate(u32 size, u32 alignment)
+    {
+        heap_t* heap = m_heap;
+        if (alignment > c_min_align)
+        {
+            ASSERT((alignment & (alignment - 1)) == 0);
+            if (alignment <= c_max_small_align && size <= c_max_small_size)
+            {
+                // A power-of-two size class is naturally aligned to its size
+                u32 po2 = size < alignment ? alignment : size;
+                po2     = (u32)1 << math::mostSignificantBit(po2 * 2 - 1);
+                if (po2 <= c_max_small_size)
+                    return s_allocate_small(heap, s_size_to_class(po2));
+            }
+            return s_allocate_large(heap, size, alignment);
+        }
+        if (size <= c_max_small_size)
+            return s_allocate_small(heap, s_size_to_class(size));
+        return s_allocate_large(heap, size, c_min_align);
+    }
+
+    void heap_alloc_t::v_deallocate(void* ptr)
+    {
+        if (ptr == nullptr)
+            return;
+
+        heap_t*       heap  = m_heap;
+        slab_t* const slab  = s_slab_of(ptr);
+        heap_t* const owner = slab->m_heap;
+        if (owner == heap)
+        {
+            s_deallocate_local(heap, ptr);
+            return;
+        }
+
+        // Freed by a thread that does not own the memory, push it on the remote-free queue
+        block_t* block = (block_t*)ptr;
+        block_t* head  = owner->m_remote.load(std::memory_order_relaxed);
+        do
+        {
+            block->m_next = head;
+        } while (!owner->m_remote.compare_exchange_weak(head, block, std::memory_order_release, std::memory_order_relaxed));
+    }
+
+    void heap_alloc_t::collect() { s_collect(m_heap); }
+
+    // ----------------------------------------------------------------------------------------
+    // Orphan heaps
+    // ----------------------------------------------------------------------------------------
+    // A heap that is destroyed while some of its blocks are still in use (e.g. handed to another
+    // thread) cannot be unmapped, those blocks are still going to be freed and pushed on its
+    // remote-free queue. Such a heap is put on the orphan list instead. Orphans are collected when
+    // a heap is created or destroyed, an orphan is released once all its blocks have come back and
+    // the next g_create_heap_alloc adopts an orphan (with its slabs) instead of making a new heap.
+
+    static std::atomic_flag s_orphans_lock = ATOMIC_FLAG_INIT;
+    static heap_t*          s_orphans      = nullptr;
+
+    static void s_lock_orphans()
+    {
+        while (s_orphans_lock.test_and_set(std::memory_order_acquire)) {}
+    }
+    static void s_unlock_orphans() { s_orphans_lock.clear(std::memory_order_release); }
+
+    static void s_release_heap(heap_t* heap)
+    {
+        // Large allocations live in their own arena
+        while (heap->m_large != nullptr)
+        {
+            slab_t* slab  = heap->m_large;
+            heap->m_large = slab->m_next;
+            narena::destroy(slab->m_arena);
+        }
+        narena::destroy(heap->m_arena);
+    }
+
+    // Takes the orphan list, releases the orphans that have no live blocks left and, when 'adopt_reserve'
+    // is not 0, takes out an orphan with an arena of at least that size. Returns the number of orphans
+    // that are left on the list.
+    static s32 s_collect_orphans(int_t adopt_reserve, heap_t*& adopted)
+    {
+        s_lock_orphans();
+        heap_t* list = s_orphans;
+        s_orphans    = nullptr;
+        s_unlock_orphans();
+
+        adopted       = nullptr;
+        heap_t* keep  = nullptr;
+        heap_t* tail  = nullptr;
+        s32     count = 0;
+        while (list != nullptr)
+        {
+            heap_t* heap = list;
+            list         = heap->m_orphan;
+            s_collect(heap);
+            if (heap->m_live == 0)
+            {
+                s_release_heap(heap);
+            }
+            else if (adopted == nullptr && adopt_reserve > 0 && heap->m_reserve >= adopt_reserve)
+            {
+                adopted = heap;
+            }
+            else
+            {
+                heap->m_orphan = keep;
+                keep           = heap;
+                tail           = tail == nullptr ? heap : tail;
+                count += 1;
+            }
+        }
+
+        if (keep != nullptr)
+        {
+            s_lock_orphans();
+            tail->m_orphan = s_orphans;
+            s_orphans      = keep;
+            s_unlock_orphans();
+        }
+        return count;
+    }
+
+    s32 g_collect_orphan_heaps()
+    {
+        heap_t* adopted;
+        return s_collect_orphans(0, adopted);
+    }
+
+    heap_alloc_t* g_create_heap_alloc(int_t reserve_size)
+    {
+        heap_t* heap;
+        s_collect_orphans(reserve_size, heap);
+        if (heap != nullptr)
+        {
+            heap->m_orphan = nullptr;
+            return heap->m_alloc;
+        }
+
+        arena_t* arena = narena::new_arena(reserve_size, 0);
+        if (arena == nullptr)
+            return nullptr;
+
+        const u32 alignment = 64;
+        int_t     commit    = 0;
+        commit += math::alignUp((s32)sizeof(arena_t), alignment);
+        commit += math::alignUp((s32)sizeof(heap_alloc_t), alignment);
+        commit += math::alignUp((s32)sizeof(heap_t), alignment);
+        narena::commit(arena, commit);
+
+        heap_alloc_t* alloc = new (narena::alloc_and_zero(arena, sizeof(heap_alloc_t), alignment)) heap_alloc_t();
+        heap                = (heap_t*)narena::alloc_and_zero(arena, sizeof(heap_t), alignment);
+        heap->m_arena       = arena;
+        heap->m_reserve     = reserve_size;
+        heap->m_alloc       = alloc;
+        heap->m_top         = (int_t)(((byte*)heap + sizeof(heap_t)) - (byte*)arena);
+        new (&heap->m_remote) std::atomic<block_t*>(nullptr);
+
+        alloc->m_heap = heap;
+        return alloc;
+    }
+
+    void g_destroy_heap_alloc(heap_alloc_t*& alloc)
+    {
+        if (alloc == nullptr)
+            return;
+
+        heap_t* heap = alloc->m_heap;
+        alloc        = nullptr;
+
+        s_collect(heap);
+        if (heap->m_live == 0)
+        {
+            s_release_heap(heap);
+        }
+        else
+        {
+            s_lock_orphans();
+            heap->m_orphan = s_orphans;
+            s_orphans      = heap;
+            s_unlock_orphans();
+        }
+        g_collect_orphan_heaps();
+    }
+
+}  // namespace ncore
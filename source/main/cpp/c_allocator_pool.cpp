@@ -0,0 +1,66 @@
+#include "ccore/c_target.h"
+#include "ccore/c_debug.h"
+#include "ccore/c_arena.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_pool.h"
+#include "cbase/c_integer.h"
+
+namespace ncore
+{
+    namespace npool
+    {
+        // Committing is done in steps of at least this many bytes
+        const int_t c_commit_granularity = 64 * cKB;
+
+        static inline int_t s_items_offset(arena_t* arena, void* items) { return (int_t)((byte*)items - (byte*)arena); }
+
+        arena_t* g_alloc_vmem_arena(s32 reserved, s32 capacity, s32 item_size, s32 item_alignment, void*& items)
+        {
+            ASSERT(item_alignment > 0 && (item_alignment & (item_alignment - 1)) == 0);  // Ensure alignment is a power of two
+
+            // The items follow the arena header, the whole range is owned by the pool so the items
+            // are not allocated from the arena, we only commit the part that is in use.
+            int_t const offset = math::alignUp((int_t)sizeof(arena_t), (u32)item_alignment);
+            arena_t*    arena  = narena::new_arena(offset + (int_t)reserved * item_size, 0);
+            if (arena == nullptr)
+            {
+                items = nullptr;
+                return nullptr;
+            }
+            if (capacity > 0)
+                narena::commit(arena, offset + (int_t)capacity * item_size);
+            items = (byte*)arena + offset;
+            return arena;
+        }
+
+        void g_free_vmem_arena(arena_t*& arena)
+        {
+            if (arena != nullptr)
+            {
+                narena::destroy(arena);
+                arena = nullptr;
+            }
+        }
+
+        s32 g_grow_capacity(arena_t* arena, void* items, s32 capacity, s32 reserved, s32 item_size)
+        {
+            ASSERT(capacity < reserved);
+
+            // Grow by 50%, but at least by the commit granularity, and fill up the last committed page
+            int_t const offset    = s_items_offset(arena, items);
+            int_t       new_bytes = offset + (int_t)(capacity + (capacity >> 1)) * item_size;
+            if (new_bytes < (offset + (int_t)capacity * item_size + c_commit_granularity))
+                new_bytes = offset + (int_t)capacity * item_size + c_commit_granularity;
+            new_bytes = math::alignUp(new_bytes, (u32)c_commit_granularity);
+
+            s32 new_capacity = (s32)((new_bytes - offset) / item_size);
+            if (new_capacity > reserved)
+                new_capacity = reserved;
+            if (!narena::commit(arena, offset + (int_t)new_capacity * item_size))
+                return capacity;
+            return new_capacity;
+        }
+
+    }  // namespace npool
+
+};  // namespace ncore
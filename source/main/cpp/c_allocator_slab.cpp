@@ -0,0 +1,130 @@
+#include "ccore/c_target.h"
+#include "ccore/c_debug.h"
+#include "ccore/c_arena.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_slab.h"
+#include "cbase/c_integer.h"
+
+namespace ncore
+{
+    // The slots are aligned to their size (power of two part), up to this alignment
+    const u32 c_slab_max_alignment = 64;
+
+    slab_alloc_t::slab_alloc_t()
+        : m_allocator(nullptr)
+        , m_arena(nullptr)
+        , m_base(nullptr)
+        , m_slot_size(0)
+        , m_slot_align(0)
+        , m_slab_slots(0)
+        , m_slab_size(0)
+        , m_max_slabs(0)
+        , m_num_slabs(0)
+        , m_num_used(0)
+        , m_slab_used(nullptr)
+        , m_slab_slots_bm(nullptr)
+    {
+        m_slabs.reset();
+    }
+
+    slab_alloc_t::~slab_alloc_t() { teardown(); }
+
+    void slab_alloc_t::setup(alloc_t* allocator, u32 slot_size, u32 slots_per_slab, u32 max_slabs)
+    {
+        ASSERT(m_arena == nullptr);
+        ASSERT(slot_size > 0 && slots_per_slab > 0 && max_slabs > 0);
+        ASSERT(slots_per_slab <= 1 * 1024 * 1024 && max_slabs <= 1 * 1024 * 1024);  // binmap/duomap limits
+
+        slot_size = math::alignUp(slot_size, (u32)sizeof(void*));
+
+        m_allocator  = allocator;
+        m_slot_size  = slot_size;
+        m_slot_align = slot_size & (~slot_size + 1);  // lowest set bit
+        if (m_slot_align > c_slab_max_alignment)
+            m_slot_align = c_slab_max_alignment;
+        m_slab_slots = slots_per_slab;
+        m_slab_size  = slot_size * slots_per_slab;
+        m_max_slabs  = max_slabs;
+        m_num_slabs  = 0;
+        m_num_used   = 0;
+
+        int_t const offset = math::alignUp((int_t)sizeof(arena_t), c_slab_max_alignment);
+        m_arena            = narena::new_arena(offset + (int_t)m_slab_size * max_slabs, 0);
+        m_base             = (byte*)m_arena + offset;
+
+        m_slab_used     = g_allocate_array_and_clear<u32>(allocator, max_slabs);
+        m_slab_slots_bm = g_allocate_array_and_clear<binmap_t>(allocator, max_slabs);
+        m_slabs.init_all_free(duomap_t::compute(max_slabs), allocator);
+    }
+
+    void slab_alloc_t::teardown()
+    {
+        if (m_arena == nullptr)
+            return;
+
+        for (u32 i = 0; i < m_num_slabs; ++i)
+            m_slab_slots_bm[i].release(m_allocator);
+        m_slabs.release(m_allocator);
+        g_deallocate_array(m_allocator, m_slab_slots_bm);
+        g_deallocate_array(m_allocator, m_slab_used);
+        narena::destroy(m_arena);
+
+        m_arena         = nullptr;
+        m_base          = nullptr;
+        m_slab_used     = nullptr;
+        m_slab_slots_bm = nullptr;
+        m_num_slabs     = 0;
+        m_num_used      = 0;
+    }
+
+    void* slab_alloc_t::v_allocate(u32 size, u32 alignment)
+    {
+        if (size > m_slot_size || alignment > m_slot_align)
+            return nullptr;
+
+        // The lowest slab that is not full
+        s32 const slab = m_slabs.find_free();
+        if (slab < 0)
+            return nullptr;
+
+        if ((u32)slab == m_num_slabs)
+        {
+            // First use of this slab, commit it and initialize its slot map
+            int_t const end = (int_t)((m_base + (int_t)(slab + 1) * m_slab_size) - (byte*)m_arena);
+            if (!narena::commit(m_arena, end))
+                return nullptr;
+            m_slab_slots_bm[slab].init_all_free(binmap_t::config_t::compute(m_slab_slots), m_allocator);
+            m_slab_used[slab] = 0;
+            m_num_slabs += 1;
+        }
+
+        s32 const slot = m_slab_slots_bm[slab].find_and_set();
+        ASSERT(slot >= 0);
+
+        m_slab_used[slab] += 1;
+        if (m_slab_used[slab] == m_slab_slots)
+            m_slabs.set_used(slab);
+        m_num_used += 1;
+
+        return m_base + (int_t)slab * m_slab_size + (int_t)slot * m_slot_size;
+    }
+
+    void slab_alloc_t::v_deallocate(void* ptr)
+    {
+        if (ptr == nullptr)
+            return;
+
+        int_t const offset = (int_t)((byte*)ptr - m_base);
+        ASSERT(offset >= 0 && offset < ((int_t)m_num_slabs * m_slab_size));
+        u32 const slab = (u32)(offset / m_slab_size);
+        u32 const slot = (u32)((offset - (int_t)slab * m_slab_size) / m_slot_size);
+        ASSERT(m_slab_slots_bm[slab].is_used(slot));
+
+        if (m_slab_used[slab] == m_slab_slots)
+            m_slabs.set_free(slab);
+        m_slab_used[slab] -= 1;
+        m_slab_slots_bm[slab].set_free(slot);
+        m_num_used -= 1;
+    }
+
+}  // namespace ncore
@@ -0,0 +1,140 @@
+#include "ccore/c_target.h"
+#include "ccore/c_debug.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_stack.h"
+#include "cbase/c_integer.h"
+
+namespace ncore
+{
+    // Header in front of every fallback allocation
+    struct stack_fallback_t
+    {
+        stack_fallback_t* m_next;
+        stack_fallback_t* m_prev;
+        void*             m_mem;  // the pointer returned by the fallback allocator
+    };
+
+    // Header in front of every stack allocation, so that the last allocation can be popped
+    struct stack_block_t
+    {
+        int_t m_prev_top;
+        int_t m_end;
+    };
+
+    stack_alloc_t::stack_alloc_t()
+        : m_buffer(nullptr)
+        , m_size(0)
+        , m_top(0)
+        , m_high_water(0)
+        , m_fallback_alloc(nullptr)
+        , m_fallback(nullptr)
+    {
+    }
+
+    void stack_alloc_t::setup(void* buffer, int_t size, alloc_t* fallback)
+    {
+        m_buffer         = (byte*)buffer;
+        m_size           = size;
+        m_top            = 0;
+        m_high_water     = 0;
+        m_fallback_alloc = fallback;
+        m_fallback       = nullptr;
+    }
+
+    void stack_alloc_t::teardown()
+    {
+        marker_t empty = {0, nullptr};
+        restore(empty);
+        m_buffer = nullptr;
+        m_size   = 0;
+    }
+
+    stack_alloc_t::marker_t stack_alloc_t::save() const
+    {
+        marker_t marker;
+        marker.m_top      = m_top;
+        marker.m_fallback = m_fallback;
+        return marker;
+    }
+
+    void stack_alloc_t::restore(marker_t const& marker)
+    {
+        ASSERT(marker.m_top <= m_top);
+        m_top = marker.m_top;
+
+        stack_fallback_t* node = (stack_fallback_t*)m_fallback;
+        while (node != (stack_fallback_t*)marker.m_fallback)
+        {
+            ASSERT(node != nullptr);
+            stack_fallback_t* next = node->m_next;
+            m_fallback_alloc->deallocate(node->m_mem);
+            node = next;
+        }
+        if (node != nullptr)
+            node->m_prev = nullptr;
+        m_fallback = node;
+    }
+
+    void* stack_alloc_t::v_allocate(u32 size, u32 alignment)
+    {
+        if (alignment < sizeof(void*))
+            alignment = sizeof(void*);
+
+        int_t const header = (int_t)sizeof(stack_block_t);
+        int_t const offset = math::alignUp((int_t)(ptr_t)(m_buffer + m_top + header), alignment) - (int_t)(ptr_t)m_buffer;
+        if ((offset + (int_t)size) <= m_size)
+        {
+            stack_block_t* block = (stack_block_t*)(m_buffer + offset - header);
+            block->m_prev_top    = m_top;
+            block->m_end         = offset + size;
+            m_top                = block->m_end;
+            if (m_top > m_high_water)
+                m_high_water = m_top;
+            return m_buffer + offset;
+        }
+
+        if (m_fallback_alloc == nullptr)
+            return nullptr;
+
+        // Oversized, allocate from the fallback allocator and track it
+        u32 const hdr = math::alignUp((u32)sizeof(stack_fallback_t), alignment);
+        byte*     mem = (byte*)m_fallback_alloc->allocate(hdr + size, alignment);
+        if (mem == nullptr)
+            return nullptr;
+
+        stack_fallback_t* node = (stack_fallback_t*)(mem + hdr - sizeof(stack_fallback_t));
+        node->m_mem            = mem;
+        node->m_prev           = nullptr;
+        node->m_next           = (stack_fallback_t*)m_fallback;
+        if (node->m_next != nullptr)
+            node->m_next->m_prev = node;
+        m_fallback = node;
+        return mem + hdr;
+    }
+
+    void stack_alloc_t::v_deallocate(void* ptr)
+    {
+        if (ptr == nullptr)
+            return;
+
+        byte* p = (byte*)ptr;
+        if (p >= m_buffer && p < (m_buffer + m_size))
+        {
+            // Only the last allocation can actually be released, the rest is released by 'restore'
+            stack_block_t const* block = (stack_block_t const*)(p - sizeof(stack_block_t));
+            if (block->m_end == m_top)
+                m_top = block->m_prev_top;
+            return;
+        }
+
+        stack_fallback_t* node = (stack_fallback_t*)(p - sizeof(stack_fallback_t));
+        if (node->m_prev != nullptr)
+            node->m_prev->m_next = node->m_next;
+        else
+            m_fallback = node->m_next;
+        if (node->m_next != nullptr)
+            node->m_next->m_prev = node->m_prev;
+        m_fallback_alloc->deallocate(node->m_mem);
+    }
+
+}  // namespace ncore
@@ -3,15 +3,29 @@
 #include "cbase/c_allocator.h"
 #include "ccore/c_arena.h"
 
+#ifdef TARGET_LINUX
+#    include <sys/mman.h>
+#    include <stdio.h>
+#endif
+
+#include <atomic>
+
 namespace ncore
 {
     arena_t*      sSystemArena = nullptr;
     arena_alloc_t sSystemAllocator;
 
+    const int_t c_huge_page_size = 2 * cMB;
+
+    static bool               s_huge_pages         = false;
+    static std::atomic<int_t> s_huge_pages_advised(0);
+
     void g_init_system_alloc()
     {
         sSystemArena             = narena::new_arena(1 * cGB, 8 * cMB);
         sSystemAllocator.m_arena = sSystemArena;
+        if (s_huge_pages)
+            g_advise_huge_pages(sSystemArena);
     }
 
     void g_exit_system_alloc()
@@ -23,4 +37,76 @@ namespace ncore
 
     alloc_t* g_get_system_alloc() { return &sSystemAllocator; }
 
+    void g_set_huge_pages(bool enable) { s_huge_pages = enable; }
+    bool g_get_huge_pages() { return s_huge_pages; }
+
+    int_t g_huge_pages_advised() { return s_huge_pages_advised.load(std::memory_order_relaxed); }
+
+    // The reserved address range of an arena, the arena header is at the start of the reservation
+    static void s_arena_range(arena_t* arena, ptr_t& begin, ptr_t& end)
+    {
+        begin = (ptr_t)arena;
+        end   = begin + ((ptr_t)arena->m_reserved_pages << arena->m_page_size_shift);
+    }
+
+#ifdef TARGET_LINUX
+
+    bool g_advise_huge_pages(arena_t* arena)
+    {
+        if (arena == nullptr)
+            return false;
+
+        // Only the 2 MB aligned interior of the reservation can be backed by huge pages
+        ptr_t begin, end;
+        s_arena_range(arena, begin, end);
+        begin = (begin + (c_huge_page_size - 1)) & ~(ptr_t)(c_huge_page_size - 1);
+        end   = end & ~(ptr_t)(c_huge_page_size - 1);
+        if (begin >= end)
+            return false;
+
+#    ifdef MADV_HUGEPAGE
+        if (::madvise((void*)begin, (size_t)(end - begin), MADV_HUGEPAGE) == 0)
+        {
+            s_huge_pages_advised.fetch_add((int_t)(end - begin), std::memory_order_relaxed);
+            return true;
+        }
+#    endif
+        return false;
+    }
+
+    int_t g_huge_pages_resident(arena_t* arena)
+    {
+        if (arena == nullptr)
+            return 0;
+
+        ptr_t begin, end;
+        s_arena_range(arena, begin, end);
+
+        // Sum 'AnonHugePages' of the mappings that overlap with the arena
+        FILE* file = ::fopen("/proc/self/smaps", "r");
+        if (file == nullptr)
+            return 0;
+
+        int_t resident = 0;
+        bool  overlaps = false;
+        char  line[512];
+        while (::fgets(line, sizeof(line), file) != nullptr)
+        {
+            unsigned long long lo, hi, kb;
+            if (::sscanf(line, "%llx-%llx ", &lo, &hi) == 2)
+                overlaps = (ptr_t)lo < end && (ptr_t)hi > begin;
+            else if (overlaps && ::sscanf(line, "AnonHugePages: %llu kB", &kb) == 1)
+                resident += (int_t)kb * cKB;
+        }
+        ::fclose(file);
+        return resident;
+    }
+
+#else
+
+    bool  g_advise_huge_pages(arena_t*) { return false; }
+    int_t g_huge_pages_resident(arena_t*) { return 0; }
+
+#endif
+
 };  // namespace ncore
@@ -0,0 +1,369 @@
+#include "ccore/c_target.h"
+#include "ccore/c_debug.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_tracking.h"
+#include "cbase/c_console.h"
+#include "cbase/c_integer.h"
+#include "cbase/c_memory.h"
+#include "cbase/c_tblfmt.h"
+
+namespace ncore
+{
+    // Header in front of every tracked allocation
+    struct tracking_header_t
+    {
+        u32 m_size;
+        u32 m_offset;  // distance from the pointer returned by the source allocator to the user pointer
+        u16 m_tag;
+        u16 m_pad;
+        u32 m_magic;
+    };
+
+    static const u32 c_tracking_magic = 0x7A6B0C11;
+
+    // Live bytes of a thread are moved to the shared counter of a tag once they differ this much
+    static const s64 c_tracking_flush = 64 * 1024;
+
+    // Shared per tag, only touched when a thread flushes its live bytes (once per 64 KB)
+    struct alignas(64) tracking_alloc_t::counters_t
+    {
+        std::atomic<s64> m_live;  // flushed live bytes
+        std::atomic<s64> m_peak;  // peak of the flushed live bytes
+        const char*      m_name;
+    };
+
+    // The counters of one thread, only that thread writes them (plain load + store, no atomic RMW),
+    // 'stats' sums them over all threads.
+    struct tracking_alloc_t::thread_counters_t
+    {
+        struct tag_t
+        {
+            std::atomic<u64> m_allocs;
+            std::atomic<u64> m_deallocs;
+            std::atomic<u64> m_bytes;
+            std::atomic<s64> m_live;  // live bytes of this thread that have not been flushed yet
+            std::atomic<s64> m_base;  // the shared live bytes when this thread last flushed
+            std::atomic<s64> m_peak;  // highest 'm_base + m_live' this thread has seen
+            std::atomic<u64> m_histogram[c_num_bins];
+        };
+
+        tag_t              m_tags[c_max_tags];
+        ptr_t              m_thread;
+        thread_counters_t* m_next;
+    };
+
+    // Every thread remembers the counters it used last, 'm_serial' tells trackers at the same address apart
+    struct tracking_tls_t
+    {
+        tracking_alloc_t const*              m_tracker;
+        u32                                  m_serial;
+        tracking_alloc_t::thread_counters_t* m_counters;
+    };
+
+    thread_local tracking_tls_t sTrackingTls = {nullptr, 0, nullptr};
+    static std::atomic<u32>     s_tracking_serial(0);
+
+    template <typename T>
+    static inline void s_add(std::atomic<T>& a, T v)
+    {
+        a.store(a.load(std::memory_order_relaxed) + v, std::memory_order_relaxed);
+    }
+
+    class tracking_alloc_t::tag_alloc_t : public alloc_t
+    {
+    public:
+        tracking_alloc_t* m_owner;
+        s32               m_index;
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment) { return m_owner->tracked_allocate(m_index, size, alignment); }
+        virtual void  v_deallocate(void* ptr) { m_owner->tracked_deallocate(ptr); }
+    };
+
+    static inline s32 s_size_to_bin(u32 size)
+    {
+        s32 bin   = 0;
+        u32 limit = 16;
+        while (size > limit && bin < (tracking_alloc_t::c_num_bins - 1))
+        {
+            limit <<= 2;
+            bin += 1;
+        }
+        return bin;
+    }
+
+    static bool s_same_name(const char* a, const char* b)
+    {
+        if (a == b)
+            return true;
+        while (*a != 0 && *a == *b)
+        {
+            a++;
+            b++;
+        }
+        return *a == *b;
+    }
+
+    static void s_reset(tracking_alloc_t::counters_t& c, const char* name)
+    {
+        c.m_live.store(0, std::memory_order_relaxed);
+        c.m_peak.store(0, std::memory_order_relaxed);
+        c.m_name = name;
+    }
+
+    tracking_alloc_t::tracking_alloc_t()
+        : m_source(nullptr)
+        , m_counters(nullptr)
+        , m_tags(nullptr)
+        , m_threads(nullptr)
+        , m_num_tags(0)
+        , m_serial(0)
+    {
+    }
+
+    tracking_alloc_t::~tracking_alloc_t() { teardown(); }
+
+    void tracking_alloc_t::setup(alloc_t* source)
+    {
+        ASSERT(m_source == nullptr && source != nullptr);
+        m_source   = source;
+        m_counters = (counters_t*)source->allocate(sizeof(counters_t) * c_max_tags, alignof(counters_t));
+        m_tags     = (tag_alloc_t*)source->allocate(sizeof(tag_alloc_t) * c_max_tags, alignof(tag_alloc_t));
+        m_threads.store(nullptr, std::memory_order_relaxed);
+        m_num_tags = 1;
+        m_serial   = s_tracking_serial.fetch_add(1, std::memory_order_relaxed) + 1;
+        s_reset(m_counters[0], "default");
+    }
+
+    void tracking_alloc_t::teardown()
+    {
+        if (m_source == nullptr)
+            return;
+        thread_counters_t* t = m_threads.exchange(nullptr, std::memory_order_acquire);
+        while (t != nullptr)
+        {
+            thread_counters_t* next = t->m_next;
+            m_source->deallocate(t);
+            t = next;
+        }
+        for (s32 i = 1; i < m_num_tags; ++i)
+            m_tags[i].~tag_alloc_t();
+        m_source->deallocate(m_tags);
+        m_source->deallocate(m_counters);
+        m_source   = nullptr;
+        m_counters = nullptr;
+        m_tags     = nullptr;
+        m_num_tags = 0;
+    }
+
+    alloc_t* tracking_alloc_t::tag(const char* name)
+    {
+        // Tags are registered up-front (not on the hot path), a tag that already exists is shared
+        for (s32 i = 1; i < m_num_tags; ++i)
+        {
+            if (s_same_name(m_counters[i].m_name, name))
+                return &m_tags[i];
+        }
+        if (m_num_tags == c_max_tags)
+            return this;
+
+        s32 const index = m_num_tags++;
+        s_reset(m_counters[index], name);
+        tag_alloc_t* tag = new (&m_tags[index]) tag_alloc_t();
+        tag->m_owner     = this;
+        tag->m_index     = index;
+        return tag;
+    }
+
+    // The counters of the calling thread, registered on the first allocation or deallocation of a thread.
+    // A thread is identified by the address of its thread-local cache, a new thread that gets the address
+    // of a thread that has exited continues with its counters.
+    tracking_alloc_t::thread_counters_t* tracking_alloc_t::thread_counters()
+    {
+        tracking_tls_t& tls = sTrackingTls;
+        if (tls.m_tracker == this && tls.m_serial == m_serial)
+            return tls.m_counters;
+
+        ptr_t const        thread = (ptr_t)&tls;
+        thread_counters_t* t      = m_threads.load(std::memory_order_acquire);
+        while (t != nullptr && t->m_thread != thread)
+            t = t->m_next;
+        if (t == nullptr)
+        {
+            t = (thread_counters_t*)m_source->allocate(sizeof(thread_counters_t), alignof(thread_counters_t));
+            if (t == nullptr)
+                return nullptr;
+            g_memclr(t, sizeof(thread_counters_t));
+            t->m_thread = thread;
+            t->m_next   = m_threads.load(std::memory_order_relaxed);
+            while (!m_threads.compare_exchange_weak(t->m_next, t, std::memory_order_release, std::memory_order_relaxed))
+            {
+            }
+        }
+        tls.m_tracker  = this;
+        tls.m_serial   = m_serial;
+        tls.m_counters = t;
+        return t;
+    }
+
+    // Moves the unflushed live bytes of a thread to the shared counter and updates the shared peak
+    static void s_flush(tracking_alloc_t::counters_t& c, tracking_alloc_t::thread_counters_t::tag_t& t)
+    {
+        s64 const delta = t.m_live.load(std::memory_order_relaxed);
+        s64 const live  = c.m_live.fetch_add(delta, std::memory_order_relaxed) + delta;
+        s64       peak  = c.m_peak.load(std::memory_order_relaxed);
+        while (live > peak && !c.m_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        {
+        }
+        t.m_live.store(0, std::memory_order_relaxed);
+        t.m_base.store(live, std::memory_order_relaxed);
+    }
+
+    void* tracking_alloc_t::tracked_allocate(s32 tag_index, u32 size, u32 alignment)
+    {
+        if (alignment < sizeof(tracking_header_t))
+            alignment = sizeof(tracking_header_t);
+
+        u32 const offset = alignment;
+        byte*     mem    = (byte*)m_source->allocate(offset + size, alignment);
+        if (mem == nullptr)
+            return nullptr;
+
+        byte*              ptr    = mem + offset;
+        tracking_header_t* header = (tracking_header_t*)(ptr - sizeof(tracking_header_t));
+        header->m_size            = size;
+        header->m_offset          = offset;
+        header->m_tag             = (u16)tag_index;
+        header->m_magic           = c_tracking_magic;
+
+        thread_counters_t* tc = thread_counters();
+        if (tc != nullptr)
+        {
+            thread_counters_t::tag_t& t = tc->m_tags[tag_index];
+            s_add<u64>(t.m_allocs, 1);
+            s_add<u64>(t.m_bytes, size);
+            s_add<u64>(t.m_histogram[s_size_to_bin(size)], 1);
+            s64 const live = t.m_live.load(std::memory_order_relaxed) + size;
+            t.m_live.store(live, std::memory_order_relaxed);
+            if ((t.m_base.load(std::memory_order_relaxed) + live) > t.m_peak.load(std::memory_order_relaxed))
+                t.m_peak.store(t.m_base.load(std::memory_order_relaxed) + live, std::memory_order_relaxed);
+            if (live >= c_tracking_flush)
+                s_flush(m_counters[tag_index], t);
+        }
+        return ptr;
+    }
+
+    void tracking_alloc_t::tracked_deallocate(void* ptr)
+    {
+        if (ptr == nullptr)
+            return;
+
+        tracking_header_t* header = (tracking_header_t*)((byte*)ptr - sizeof(tracking_header_t));
+        ASSERT(header->m_magic == c_tracking_magic);  // not allocated by this tracker
+        header->m_magic = 0;
+
+        thread_counters_t* tc = thread_counters();
+        if (tc != nullptr)
+        {
+            thread_counters_t::tag_t& t = tc->m_tags[header->m_tag];
+            s_add<u64>(t.m_deallocs, 1);
+            s64 const live = t.m_live.load(std::memory_order_relaxed) - header->m_size;
+            t.m_live.store(live, std::memory_order_relaxed);
+            if (live <= -c_tracking_flush)
+                s_flush(m_counters[header->m_tag], t);
+        }
+
+        m_source->deallocate((byte*)ptr - header->m_offset);
+    }
+
+    void* tracking_alloc_t::v_allocate(u32 size, u32 alignment) { return tracked_allocate(0, size, alignment); }
+    void  tracking_alloc_t::v_deallocate(void* ptr) { tracked_deallocate(ptr); }
+
+    // Sums the counters of all threads. The live bytes are exact (when no thread is allocating), the
+    // peak is exact for a tag used by one thread and can otherwise miss up to 64 KB per thread.
+    void tracking_alloc_t::stats(s32 tag_index, stats_t& stats) const
+    {
+        ASSERT(tag_index >= 0 && tag_index < m_num_tags);
+        counters_t const& c = m_counters[tag_index];
+        stats.m_name        = c.m_name;
+        stats.m_allocs      = 0;
+        stats.m_deallocs    = 0;
+        stats.m_bytes       = 0;
+        stats.m_live        = c.m_live.load(std::memory_order_relaxed);
+        stats.m_peak        = c.m_peak.load(std::memory_order_relaxed);
+        for (s32 i = 0; i < c_num_bins; ++i)
+            stats.m_histogram[i] = 0;
+
+        for (thread_counters_t const* tc = m_threads.load(std::memory_order_acquire); tc != nullptr; tc = tc->m_next)
+        {
+            thread_counters_t::tag_t const& t = tc->m_tags[tag_index];
+            stats.m_allocs += t.m_allocs.load(std::memory_order_relaxed);
+            stats.m_deallocs += t.m_deallocs.load(std::memory_order_relaxed);
+            stats.m_bytes += t.m_bytes.load(std::memory_order_relaxed);
+            stats.m_live += t.m_live.load(std::memory_order_relaxed);
+            s64 const peak = t.m_peak.load(std::memory_order_relaxed);
+            stats.m_peak   = peak > stats.m_peak ? peak : stats.m_peak;
+            for (s32 i = 0; i < c_num_bins; ++i)
+                stats.m_histogram[i] += t.m_histogram[i].load(std::memory_order_relaxed);
+        }
+        if (stats.m_live > stats.m_peak)
+            stats.m_peak = stats.m_live;
+    }
+
+    bool tracking_alloc_t::has_leaks() const
+    {
+        for (s32 i = 0; i < m_num_tags; ++i)
+        {
+            stats_t s;
+            stats(i, s);
+            if (s.m_live != 0)
+                return true;
+        }
+        return false;
+    }
+
+    void tracking_alloc_t::report(console_t* out) const
+    {
+        fmt::table_t<7, 128> table;
+
+        table.widths(16, 10, 10, 12, 12, 12, 5);
+        table.flags(fmt::Flags::AlignLeft, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight);
+        table.top();
+        out->writeLine(table.str_utf8());
+        table.row("tag", "allocs", "frees", "bytes", "live", "peak", "leak");
+        out->writeLine(table.str_utf8());
+        table.line();
+        out->writeLine(table.str_utf8());
+        for (s32 i = 0; i < m_num_tags; ++i)
+        {
+            stats_t s;
+            stats(i, s);
+            table.row(s.m_name, s.m_allocs, s.m_deallocs, s.m_bytes, s.m_live, s.m_peak, s.m_live != 0 ? "yes" : "");
+            out->writeLine(table.str_utf8());
+        }
+        table.bottom();
+        out->writeLine(table.str_utf8());
+
+        // Size histogram per tag
+        fmt::table_t<9, 128> histogram;
+        histogram.widths(16, 8, 8, 8, 8, 8, 8, 8, 8);
+        histogram.flags(fmt::Flags::AlignLeft, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight, fmt::Flags::AlignRight);
+        histogram.top();
+        out->writeLine(histogram.str_utf8());
+        histogram.row("tag", "<=16", "<=64", "<=256", "<=1K", "<=4K", "<=16K", "<=64K", ">64K");
+        out->writeLine(histogram.str_utf8());
+        histogram.line();
+        out->writeLine(histogram.str_utf8());
+        for (s32 i = 0; i < m_num_tags; ++i)
+        {
+            stats_t s;
+            stats(i, s);
+            u64 const* h = s.m_histogram;
+            histogram.row(s.m_name, h[0], h[1], h[2], h[3], h[4], h[5], h[6], h[7]);
+            out->writeLine(histogram.str_utf8());
+        }
+        histogram.bottom();
+        out->writeLine(histogram.str_utf8());
+    }
+
+}  // namespace ncore
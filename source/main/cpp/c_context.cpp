@@ -1,10 +1,15 @@
 #include "cbase/c_allocator.h"
+#include "cbase/c_allocator_frame.h"
+#include "cbase/c_allocator_heap.h"
+#include "cbase/c_allocator_stack.h"
 #include "cbase/c_context.h"
 
 #include "ccore/c_math.h"
 #include "ccore/c_random.h"
 #include "ccore/c_arena.h"
 
+#include <atomic>
+
 namespace ncore
 {
     // context data is a global context that holds thread data.
@@ -17,40 +22,127 @@ namespace ncore
         stack_alloc_t*   m_stack_alloc;      // function/temporary life-time allocations
         random_t*        m_random;           //
         arena_t*         m_arena;            //
+        heap_alloc_t*    m_heap;             // the heap owned by this context
+        frame_alloc_t*   m_frame;            // the frame allocator owned by this context
+        stack_alloc_t*   m_stack;            // the stack allocator owned by this context
+        arena_alloc_t*   m_system;           // the system allocator owned by this context
+        rand_t*          m_rand;             // the random generator owned by this context
         void*            m_slot0;            //
     };
 
     thread_local context_data_t* sThreadLocalContext = nullptr;
 
+    const int_t c_stack_alloc_size  = 256 * cKB;
+    const int_t c_system_arena_size = 4 * cMB;
+    const s32   c_context_pool_size = 64;
+
+    // Prepared contexts that are waiting for a thread, a slot is claimed with an exchange so there is
+    // no ABA problem and no lock.
+    static std::atomic<context_data_t*> s_context_pool[c_context_pool_size];
+
+    static context_data_t* s_create_context_data()
+    {
+        const u32 alignment = 8;
+        int_t     commit    = 0;
+        commit += math::alignUp((s32)sizeof(arena_t), alignment);
+        commit += math::alignUp((s32)sizeof(context_data_t), alignment);
+        commit += math::alignUp((s32)sizeof(arena_alloc_t), alignment);
+        commit += math::alignUp((s32)sizeof(rand_t), alignment);
+        commit += math::alignUp((s32)sizeof(frame_alloc_t), alignment);
+        commit += math::alignUp((s32)sizeof(stack_alloc_t), alignment);
+        commit += c_stack_alloc_size + 16;
+
+        // The context blocks are in their own arena, the system allocator has its own arena so that
+        // it can be reset when the context is recycled.
+        arena_t* arena        = narena::new_arena(commit, commit);
+        arena_t* system_arena = narena::new_arena(c_system_arena_size, 0);
+
+        context_data_t* context_data = (context_data_t*)narena::alloc_and_zero(arena, sizeof(context_data_t), alignment);
+        arena_alloc_t*  system_alloc = new (narena::alloc_and_zero(arena, sizeof(arena_alloc_t), alignment)) arena_alloc_t();
+        rand_t*         rnd          = new (narena::alloc_and_zero(arena, sizeof(rand_t), alignment)) rand_t();
+        rnd->reset((u64)arena);
+
+        frame_alloc_t* frame_alloc = new (narena::alloc_and_zero(arena, sizeof(frame_alloc_t), alignment)) frame_alloc_t();
+        frame_alloc->init(2, 32 * cMB);
+
+        heap_alloc_t*  heap_alloc  = g_create_heap_alloc();
+        stack_alloc_t* stack_alloc = new (narena::alloc_and_zero(arena, sizeof(stack_alloc_t), alignment)) stack_alloc_t();
+        stack_alloc->setup(narena::alloc(arena, c_stack_alloc_size, 16), c_stack_alloc_size, heap_alloc);
+
+        system_alloc->m_arena           = system_arena;
+        context_data->m_arena           = arena;
+        context_data->m_system          = system_alloc;
+        context_data->m_system_alloc    = system_alloc;
+        context_data->m_heap            = heap_alloc;
+        context_data->m_heap_alloc      = heap_alloc;
+        context_data->m_frame           = frame_alloc;
+        context_data->m_frame_allocator = frame_alloc;
+        context_data->m_stack           = stack_alloc;
+        context_data->m_stack_alloc     = stack_alloc;
+        context_data->m_rand            = rnd;
+        context_data->m_random          = rnd;
+        return context_data;
+    }
+
+    static void s_destroy_context_data(context_data_t* context_data)
+    {
+        context_data->m_stack->teardown();
+        context_data->m_frame->~frame_alloc_t();
+        g_destroy_heap_alloc(context_data->m_heap);
+        narena::destroy(context_data->m_system->m_arena);
+        narena::destroy(context_data->m_arena);
+    }
+
+    // Puts the context back in the state it was in after creation, the memory that the heap and the
+    // frame allocator have committed is kept.
+    static void s_recycle_context_data(context_data_t* context_data)
+    {
+        stack_alloc_t::marker_t const empty = {0, nullptr};
+        context_data->m_stack->restore(empty);
+        context_data->m_heap->collect();
+        narena::reset(context_data->m_system->m_arena);
+
+        context_data->m_assert_handler  = nullptr;
+        context_data->m_system_alloc    = context_data->m_system;
+        context_data->m_heap_alloc      = context_data->m_heap;
+        context_data->m_frame_allocator = context_data->m_frame;
+        context_data->m_stack_alloc     = context_data->m_stack;
+        context_data->m_random          = context_data->m_rand;
+        context_data->m_slot0           = nullptr;
+    }
+
+    static bool s_push_context_data(context_data_t* context_data)
+    {
+        for (s32 i = 0; i < c_context_pool_size; ++i)
+        {
+            context_data_t* expected = nullptr;
+            if (s_context_pool[i].load(std::memory_order_relaxed) == nullptr && s_context_pool[i].compare_exchange_strong(expected, context_data, std::memory_order_release, std::memory_order_relaxed))
+                return true;
+        }
+        return false;
+    }
+
+    static context_data_t* s_pop_context_data()
+    {
+        for (s32 i = 0; i < c_context_pool_size; ++i)
+        {
+            if (s_context_pool[i].load(std::memory_order_relaxed) != nullptr)
+            {
+                context_data_t* context_data = s_context_pool[i].exchange(nullptr, std::memory_order_acquire);
+                if (context_data != nullptr)
+                    return context_data;
+            }
+        }
+        return nullptr;
+    }
+
     static context_t s_get_context()
     {
         if (sThreadLocalContext == nullptr)
         {
-            arena_t* arena = narena::new_arena(4 * cMB, 0);
-
-            const u32 alignment = 8;
-            int_t     commit    = 0;
-            commit += math::alignUp((s32)sizeof(arena_t), alignment);
-            commit += math::alignUp((s32)sizeof(context_data_t), alignment);
-            commit += math::alignUp((s32)sizeof(arena_alloc_t), alignment);
-            commit += math::alignUp((s32)sizeof(rand_t), alignment);
-            narena::commit(arena, commit);
-
-            context_data_t* context_data = (context_data_t*)narena::alloc_and_zero(arena, sizeof(context_data_t), alignment);
-            arena_alloc_t*  system_alloc = new (narena::alloc_and_zero(arena, sizeof(arena_alloc_t), alignment)) arena_alloc_t();
-            rand_t*         rnd          = new (narena::alloc_and_zero(arena, sizeof(rand_t), alignment)) rand_t();
-            rnd->reset((u64)arena);
-
-            // TODO
-            // - heap allocator
-            // - frame allocator
-            // - stack allocator
-
-            system_alloc->m_arena        = arena;
-            context_data->m_arena        = arena;
-            context_data->m_system_alloc = system_alloc;
-            context_data->m_random       = rnd;
-
+            context_data_t* context_data = s_pop_context_data();
+            if (context_data == nullptr)
+                context_data = s_create_context_data();
             sThreadLocalContext = context_data;
         }
         return context_t{sThreadLocalContext};
@@ -60,9 +152,38 @@ namespace ncore
     {
         if (sThreadLocalContext != nullptr)
         {
-            arena_t* arena = sThreadLocalContext->m_arena;
-            narena::destroy(arena);
-            sThreadLocalContext = nullptr;
+            context_data_t* context_data = sThreadLocalContext;
+            sThreadLocalContext          = nullptr;
+
+            s_recycle_context_data(context_data);
+            if (!s_push_context_data(context_data))
+                s_destroy_context_data(context_data);
+        }
+    }
+
+    s32 g_prewarm_contexts(s32 count)
+    {
+        s32 n = 0;
+        while (n < count)
+        {
+            context_data_t* context_data = s_create_context_data();
+            if (!s_push_context_data(context_data))
+            {
+                s_destroy_context_data(context_data);
+                break;
+            }
+            n += 1;
+        }
+        return n;
+    }
+
+    void g_release_context_pool()
+    {
+        for (s32 i = 0; i < c_context_pool_size; ++i)
+        {
+            context_data_t* context_data = s_context_pool[i].exchange(nullptr, std::memory_order_acquire);
+            if (context_data != nullptr)
+                s_destroy_context_data(context_data);
         }
     }
 
@@ -0,0 +1,493 @@
+#include "ccore/c_target.h"
+#include "ccore/c_debug.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_buffer.h"
+#include "cbase/c_memory.h"
+#include "cbase/c_filter.h"
+#include "cbase/c_wyhash.h"
+
+#if defined(__AVX2__)
+#    include <immintrin.h>
+#endif
+
+namespace ncore
+{
+    namespace nfilter
+    {
+        const u32 c_bloom_magic  = 0x31464C42;  // 'BLF1'
+        const u32 c_cuckoo_magic = 0x31464B43;  // 'CKF1'
+        const s32 c_header_size  = 64;
+
+        // Header: magic, extra, secret[4], count, table size, extra2 (56 bytes), padded to 64 bytes
+        struct header_t
+        {
+            u32 m_magic;
+            u32 m_extra;
+            u64 m_secret[4];
+            u64 m_count;
+            u32 m_table_size;
+            u32 m_extra2;
+        };
+
+        static bool s_write_header(binary_writer_t& writer, header_t const& h)
+        {
+            if (!writer.can_write(c_header_size))
+                return false;
+            int_t const start = writer.pos();
+            writer.write(h.m_magic);
+            writer.write(h.m_extra);
+            for (s32 i = 0; i < 4; ++i)
+                writer.write(h.m_secret[i]);
+            writer.write(h.m_count);
+            writer.write(h.m_table_size);
+            writer.write(h.m_extra2);
+            writer.skip(c_header_size - (writer.pos() - start));
+            return true;
+        }
+
+        static bool s_read_header(binary_reader_t& reader, u32 magic, header_t& h)
+        {
+            if (!reader.can_read(c_header_size))
+                return false;
+            h.m_magic = reader.read_u32();
+            h.m_extra = reader.read_u32();
+            for (s32 i = 0; i < 4; ++i)
+                h.m_secret[i] = reader.read_u64();
+            h.m_count      = reader.read_u64();
+            h.m_table_size = reader.read_u32();
+            h.m_extra2     = reader.read_u32();
+            reader.seek(c_header_size);
+            return h.m_magic == magic;
+        }
+    }  // namespace nfilter
+
+    // ----------------------------------------------------------------------------------------
+    // bloom_filter_t
+    // ----------------------------------------------------------------------------------------
+
+    namespace nbloom
+    {
+        // One bit in every word of a block, the bit is the top 6 bits of the key hash times the word salt
+        static const u32 c_salt[8] = {0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU, 0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U};
+
+        static inline u64* s_block(u64* blocks, u32 num_blocks, u64 hash) { return blocks + ((((hash >> 32) * (u64)num_blocks) >> 32) << 3); }
+
+#if !defined(__AVX2__)
+        static inline void s_masks(u64 hash, u64* masks)
+        {
+            u32 const h = (u32)hash;
+            for (s32 i = 0; i < 8; ++i)
+                masks[i] = (u64)1 << ((h * c_salt[i]) >> 26);
+        }
+#else
+        // The 8 bit masks as two vectors of 4 words
+        static inline void s_masks(u64 hash, __m256i& lo, __m256i& hi)
+        {
+            __m256i const salt = _mm256_setr_epi32((s32)c_salt[0], (s32)c_salt[1], (s32)c_salt[2], (s32)c_salt[3], (s32)c_salt[4], (s32)c_salt[5], (s32)c_salt[6], (s32)c_salt[7]);
+            __m256i const bits = _mm256_srli_epi32(_mm256_mullo_epi32(_mm256_set1_epi32((s32)(u32)hash), salt), 26);
+            __m256i const one  = _mm256_set1_epi64x(1);
+            lo                 = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_castsi256_si128(bits)));
+            hi                 = _mm256_sllv_epi64(one, _mm256_cvtepu32_epi64(_mm256_extracti128_si256(bits, 1)));
+        }
+#endif
+    }  // namespace nbloom
+
+    bloom_filter_t::bloom_filter_t()
+        : m_allocator(nullptr)
+        , m_blocks(nullptr)
+        , m_num_blocks(0)
+        , m_count(0)
+    {
+        m_secret[0] = m_secret[1] = m_secret[2] = m_secret[3] = 0;
+    }
+
+    bloom_filter_t::~bloom_filter_t() { release(); }
+
+    bool bloom_filter_t::init(alloc_t* allocator, s32 capacity, s32 bits_per_key, u64 seed)
+    {
+        release();
+        u64 const bits   = (u64)(capacity > 0 ? capacity : 1) * (u64)(bits_per_key > 0 ? bits_per_key : 1);
+        u64 const blocks = (bits + 511) >> 9;
+        if ((blocks << 6) > 0xFFFFFFFF)
+            return false;
+        m_blocks = (u64*)allocator->allocate((u32)(blocks << 6), 64);
+        if (m_blocks == nullptr)
+            return false;
+        m_allocator  = allocator;
+        m_num_blocks = (u32)blocks;
+        nhash::wymake_secret(seed, m_secret);
+        clear();
+        return true;
+    }
+
+    void bloom_filter_t::release()
+    {
+        if (m_allocator != nullptr)
+            m_allocator->deallocate(m_blocks);
+        m_allocator  = nullptr;
+        m_blocks     = nullptr;
+        m_num_blocks = 0;
+        m_count      = 0;
+    }
+
+    void bloom_filter_t::clear()
+    {
+        ASSERT(m_allocator != nullptr);  // a view is read-only
+        g_memset(m_blocks, 0, (int_t)m_num_blocks << 6);
+        m_count = 0;
+    }
+
+    u64 bloom_filter_t::hash(void const* key, s32 size) const { return nhash::wyhash_bytes(key, size, 0, m_secret); }
+
+    void bloom_filter_t::insert_hash(u64 hash)
+    {
+        ASSERT(m_allocator != nullptr);
+        u64* block = nbloom::s_block(m_blocks, m_num_blocks, hash);
+#if defined(__AVX2__)
+        __m256i lo, hi;
+        nbloom::s_masks(hash, lo, hi);
+        _mm256_storeu_si256((__m256i*)block, _mm256_or_si256(_mm256_loadu_si256((__m256i const*)block), lo));
+        _mm256_storeu_si256((__m256i*)(block + 4), _mm256_or_si256(_mm256_loadu_si256((__m256i const*)(block + 4)), hi));
+#else
+        u64 masks[8];
+        nbloom::s_masks(hash, masks);
+        for (s32 i = 0; i < 8; ++i)
+            block[i] |= masks[i];
+#endif
+        m_count += 1;
+    }
+
+    bool bloom_filter_t::contains_hash(u64 hash) const
+    {
+        u64 const* block = nbloom::s_block(m_blocks, m_num_blocks, hash);
+#if defined(__AVX2__)
+        __m256i lo, hi;
+        nbloom::s_masks(hash, lo, hi);
+        // testc is true when every bit of the mask is set in the block
+        return (_mm256_testc_si256(_mm256_loadu_si256((__m256i const*)block), lo) & _mm256_testc_si256(_mm256_loadu_si256((__m256i const*)(block + 4)), hi)) != 0;
+#else
+        u64 masks[8];
+        nbloom::s_masks(hash, masks);
+        u64 missing = 0;
+        for (s32 i = 0; i < 8; ++i)
+            missing |= masks[i] & ~block[i];
+        return missing == 0;
+#endif
+    }
+
+    int_t bloom_filter_t::serialized_size() const { return nfilter::c_header_size + size(); }
+
+    bool bloom_filter_t::serialize(buffer_t& buffer) const
+    {
+        nfilter::header_t header;
+        header.m_magic = nfilter::c_bloom_magic;
+        header.m_extra = 8;  // bits set per key
+        for (s32 i = 0; i < 4; ++i)
+            header.m_secret[i] = m_secret[i];
+        header.m_count      = m_count;
+        header.m_table_size = m_num_blocks;
+        header.m_extra2     = 0;
+
+        binary_writer_t writer = buffer.writer();
+        if (buffer.size() < serialized_size() || !nfilter::s_write_header(writer, header))
+            return false;
+        writer.write_data(cbuffer_t((u8 const*)m_blocks, (u8 const*)m_blocks + size()));
+        return true;
+    }
+
+    bool bloom_filter_t::view(cbuffer_t const& data)
+    {
+        release();
+        binary_reader_t   reader = data.reader();
+        nfilter::header_t header;
+        if (!nfilter::s_read_header(reader, nfilter::c_bloom_magic, header) || header.m_extra != 8 || header.m_table_size == 0)
+            return false;
+        if (data.size() < nfilter::c_header_size + ((int_t)header.m_table_size << 6))
+            return false;
+        m_blocks     = (u64*)(data.m_begin + nfilter::c_header_size);
+        m_num_blocks = header.m_table_size;
+        m_count      = header.m_count;
+        for (s32 i = 0; i < 4; ++i)
+            m_secret[i] = header.m_secret[i];
+        return true;
+    }
+
+    bool bloom_filter_t::deserialize(alloc_t* allocator, cbuffer_t const& data)
+    {
+        if (!view(data))
+            return false;
+        if ((u64)size() > 0xFFFFFFFF)
+        {
+            release();
+            return false;
+        }
+        u64* blocks = (u64*)allocator->allocate((u32)size(), 64);
+        if (blocks == nullptr)
+        {
+            release();
+            return false;
+        }
+        g_memcpy(blocks, m_blocks, size());
+        m_blocks    = blocks;
+        m_allocator = allocator;
+        return true;
+    }
+
+    // ----------------------------------------------------------------------------------------
+    // cuckoo_filter_t
+    // ----------------------------------------------------------------------------------------
+
+    namespace ncuckoo
+    {
+        const u32 c_slots     = 4;    // fingerprints per bucket
+        const s32 c_max_kicks = 500;  // relocations before an insert gives up
+        const u64 c_lsbs      = 0x0001000100010001ull;
+        const u64 c_msbs      = 0x8000800080008000ull;
+
+        static inline u16 s_fingerprint(u64 hash)
+        {
+            u16 const fp = (u16)(hash >> 48);
+            return fp != 0 ? fp : 1;
+        }
+
+        // The other bucket of a fingerprint, applying it twice gives the original bucket
+        static inline u32 s_alt(u32 bucket, u16 fp, u32 mask) { return (bucket ^ ((u32)fp * 0x5bd1e995U)) & mask; }
+
+        // True when one of the 4 lanes of 'bucket' holds 'fp' (the 'has zero lane' test)
+        static inline bool s_has(u64 bucket, u16 fp)
+        {
+            u64 const x = bucket ^ (c_lsbs * fp);
+            return ((x - c_lsbs) & ~x & c_msbs) != 0;
+        }
+
+        static inline u16 s_get(u64 bucket, u32 slot) { return (u16)(bucket >> (slot << 4)); }
+        static inline void s_set(u64& bucket, u32 slot, u16 fp) { bucket = (bucket & ~((u64)0xFFFF << (slot << 4))) | ((u64)fp << (slot << 4)); }
+    }  // namespace ncuckoo
+
+    cuckoo_filter_t::cuckoo_filter_t()
+        : m_allocator(nullptr)
+        , m_buckets(nullptr)
+        , m_mask(0)
+        , m_victim_bucket(0)
+        , m_victim(0)
+        , m_count(0)
+        , m_rng(0)
+    {
+        m_secret[0] = m_secret[1] = m_secret[2] = m_secret[3] = 0;
+    }
+
+    cuckoo_filter_t::~cuckoo_filter_t() { release(); }
+
+    bool cuckoo_filter_t::init(alloc_t* allocator, s32 capacity, u64 seed)
+    {
+        release();
+        // A power of two number of buckets that holds 'capacity' at 95% load
+        u64 const needed  = ((u64)(capacity > 0 ? capacity : 1) * 100) / (95 * ncuckoo::c_slots) + 1;
+        u64       buckets = 1;
+        while (buckets < needed)
+            buckets <<= 1;
+        if ((buckets << 3) > 0xFFFFFFFF)
+            return false;
+        m_buckets = (u64*)allocator->allocate((u32)(buckets << 3), 64);
+        if (m_buckets == nullptr)
+            return false;
+        m_allocator = allocator;
+        m_mask      = (u32)buckets - 1;
+        nhash::wymake_secret(seed, m_secret);
+        m_rng = m_secret[2];
+        clear();
+        return true;
+    }
+
+    void cuckoo_filter_t::release()
+    {
+        if (m_allocator != nullptr)
+            m_allocator->deallocate(m_buckets);
+        m_allocator     = nullptr;
+        m_buckets       = nullptr;
+        m_mask          = 0;
+        m_victim        = 0;
+        m_victim_bucket = 0;
+        m_count         = 0;
+    }
+
+    void cuckoo_filter_t::clear()
+    {
+        ASSERT(m_allocator != nullptr);  // a view is read-only
+        g_memset(m_buckets, 0, (int_t)(m_mask + 1) << 3);
+        m_victim        = 0;
+        m_victim_bucket = 0;
+        m_count         = 0;
+    }
+
+    u64 cuckoo_filter_t::hash(void const* key, s32 size) const { return nhash::wyhash_bytes(key, size, 0, m_secret); }
+
+    // Puts 'fp' in a free slot of 'bucket'
+    bool cuckoo_filter_t::place(u32 bucket, u16 fp)
+    {
+        u64& b = m_buckets[bucket];
+        for (u32 slot = 0; slot < ncuckoo::c_slots; ++slot)
+        {
+            if (ncuckoo::s_get(b, slot) == 0)
+            {
+                ncuckoo::s_set(b, slot, fp);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Adds 'fp' to 'bucket' or its alternate, kicking out fingerprints to their other bucket when both
+    // are full. The fingerprint that is left over when that does not end becomes the victim.
+    bool cuckoo_filter_t::add(u32 bucket, u16 fp)
+    {
+        u32 const alt = ncuckoo::s_alt(bucket, fp, m_mask);
+        if (place(bucket, fp) || place(alt, fp))
+            return true;
+
+        m_rng ^= m_rng << 13;
+        m_rng ^= m_rng >> 7;
+        m_rng ^= m_rng << 17;
+        bucket = (m_rng & 1) != 0 ? alt : bucket;
+        for (s32 kick = 0; kick < ncuckoo::c_max_kicks; ++kick)
+        {
+            m_rng ^= m_rng << 13;
+            m_rng ^= m_rng >> 7;
+            m_rng ^= m_rng << 17;
+            u32 const slot    = (u32)(m_rng >> 32) & (ncuckoo::c_slots - 1);
+            u16 const evicted = ncuckoo::s_get(m_buckets[bucket], slot);
+            ncuckoo::s_set(m_buckets[bucket], slot, fp);
+            fp     = evicted;
+            bucket = ncuckoo::s_alt(bucket, fp, m_mask);
+            if (place(bucket, fp))
+                return true;
+        }
+        m_victim        = fp;
+        m_victim_bucket = bucket;
+        return true;
+    }
+
+    bool cuckoo_filter_t::insert_hash(u64 hash)
+    {
+        ASSERT(m_allocator != nullptr);
+        if (m_victim != 0)
+            return false;  // full
+        add((u32)hash & m_mask, ncuckoo::s_fingerprint(hash));
+        m_count += 1;
+        return true;
+    }
+
+    bool cuckoo_filter_t::contains_hash(u64 hash) const
+    {
+        u16 const fp = ncuckoo::s_fingerprint(hash);
+        u32 const b1 = (u32)hash & m_mask;
+        u32 const b2 = ncuckoo::s_alt(b1, fp, m_mask);
+        if (ncuckoo::s_has(m_buckets[b1], fp) || ncuckoo::s_has(m_buckets[b2], fp))
+            return true;
+        return m_victim == fp && (m_victim_bucket == b1 || m_victim_bucket == b2);
+    }
+
+    bool cuckoo_filter_t::remove_hash(u64 hash)
+    {
+        ASSERT(m_allocator != nullptr);
+        u16 const fp = ncuckoo::s_fingerprint(hash);
+        u32 const b1 = (u32)hash & m_mask;
+        u32 const b2 = ncuckoo::s_alt(b1, fp, m_mask);
+
+        bool removed = false;
+        for (u32 b = 0; b < 2 && !removed; ++b)
+        {
+            u64& bucket = m_buckets[b == 0 ? b1 : b2];
+            for (u32 slot = 0; slot < ncuckoo::c_slots; ++slot)
+            {
+                if (ncuckoo::s_get(bucket, slot) == fp)
+                {
+                    ncuckoo::s_set(bucket, slot, 0);
+                    removed = true;
+                    break;
+                }
+            }
+        }
+        if (!removed)
+        {
+            if (m_victim != fp || (m_victim_bucket != b1 && m_victim_bucket != b2))
+                return false;
+            m_victim = 0;
+        }
+        m_count -= 1;
+
+        // There is room again, try to move the victim back into the table
+        if (m_victim != 0)
+        {
+            u16 const victim = m_victim;
+            m_victim         = 0;
+            add(m_victim_bucket, victim);
+        }
+        return true;
+    }
+
+    int_t cuckoo_filter_t::serialized_size() const { return nfilter::c_header_size + size(); }
+
+    bool cuckoo_filter_t::serialize(buffer_t& buffer) const
+    {
+        nfilter::header_t header;
+        header.m_magic = nfilter::c_cuckoo_magic;
+        header.m_extra = m_victim;
+        for (s32 i = 0; i < 4; ++i)
+            header.m_secret[i] = m_secret[i];
+        header.m_count      = m_count;
+        header.m_table_size = m_mask + 1;
+        header.m_extra2     = m_victim_bucket;
+
+        binary_writer_t writer = buffer.writer();
+        if (buffer.size() < serialized_size() || !nfilter::s_write_header(writer, header))
+            return false;
+        writer.write_data(cbuffer_t((u8 const*)m_buckets, (u8 const*)m_buckets + size()));
+        return true;
+    }
+
+    bool cuckoo_filter_t::view(cbuffer_t const& data)
+    {
+        release();
+        binary_reader_t   reader = data.reader();
+        nfilter::header_t header;
+        if (!nfilter::s_read_header(reader, nfilter::c_cuckoo_magic, header))
+            return false;
+        u32 const buckets = header.m_table_size;
+        if (buckets == 0 || (buckets & (buckets - 1)) != 0 || header.m_extra > 0xFFFF || header.m_extra2 >= buckets)
+            return false;
+        if (data.size() < nfilter::c_header_size + ((int_t)buckets << 3))
+            return false;
+        m_buckets       = (u64*)(data.m_begin + nfilter::c_header_size);
+        m_mask          = buckets - 1;
+        m_victim        = (u16)header.m_extra;
+        m_victim_bucket = header.m_extra2;
+        m_count         = header.m_count;
+        for (s32 i = 0; i < 4; ++i)
+            m_secret[i] = header.m_secret[i];
+        m_rng = m_secret[2];
+        return true;
+    }
+
+    bool cuckoo_filter_t::deserialize(alloc_t* allocator, cbuffer_t const& data)
+    {
+        if (!view(data))
+            return false;
+        if ((u64)size() > 0xFFFFFFFF)
+        {
+            release();
+            return false;
+        }
+        u64* buckets = (u64*)allocator->allocate((u32)size(), 64);
+        if (buckets == nullptr)
+        {
+            release();
+            return false;
+        }
+        g_memcpy(buckets, m_buckets, size());
+        m_buckets   = buckets;
+        m_allocator = allocator;
+        return true;
+    }
+
+}  // namespace ncore
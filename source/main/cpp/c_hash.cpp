@@ -1,75 +1,661 @@
 #include "ccore/c_target.h"
 #include "ccore/c_debug.h"
+#include "ccore/c_math.h"
 #include "cbase/c_hash.h"
 #include "cbase/c_memory.h"
 #include "cbase/c_runes.h"
+#include "cbase/c_buffer.h"
+#include "cbase/c_wyhash.h"
+#include "cbase/private/c_wyhash_inline.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define D_STRHASH_SSE2
+#    include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#    define D_CRC32C_X64
+#    include <nmmintrin.h>
+#    ifdef __SSE4_2__
+#        define D_CRC32C_TARGET
+#    else
+#        define D_CRC32C_TARGET __attribute__((target("sse4.2")))
+#    endif
+#elif defined(_MSC_VER) && defined(_M_X64)
+#    define D_CRC32C_X64
+#    define D_CRC32C_TARGET
+#    include <intrin.h>
+#    include <nmmintrin.h>
+#elif defined(__ARM_FEATURE_CRC32)
+#    define D_CRC32C_ARM
+#    include <arm_acle.h>
+#endif
 
 namespace ncore
 {
     namespace nhash
     {
-        // calculate the hash of a string, this string can be ascii, utf-8, utf-16 or utf-32.
-        // so use an intermediate buffer to convert the string into utf-32 and feed that to
-        // the hash algorithm.
-        u64 strhash(crunes_t const& strdata, u64 seed)
+#ifdef D_LITTLE_ENDIAN
+        static inline u64 _hashr8(const u8* p)
+        {
+            u64 v;
+            g_memcpy(&v, p, 8);
+            return v;
+        }
+#else
+        static inline u64 _hashr8(const u8* p)
+        {
+            u64 v;
+            g_memcpy(&v, p, 8);
+            return (((v >> 56) & 0xff) | ((v >> 40) & 0xff00) | ((v >> 24) & 0xff0000) | ((v >> 8) & 0xff000000) | ((v << 8) & 0xff00000000) | ((v << 24) & 0xff0000000000) | ((v << 40) & 0xff000000000000) | ((v << 56) & 0xff00000000000000));
+        }
+#endif
+
+        // ----------------------------------------------------------------------------------------
+        // xxh3_hasher_t
+        // ----------------------------------------------------------------------------------------
+
+        static const u64 c_xxprime32_1 = 0x9E3779B1ull;
+        static const u64 c_xxprime32_2 = 0x85EBCA77ull;
+        static const u64 c_xxprime32_3 = 0xC2B2AE3Dull;
+        static const u64 c_xxprime64_1 = 0x9E3779B185EBCA87ull;
+        static const u64 c_xxprime64_2 = 0xC2B2AE3D27D4EB4Full;
+        static const u64 c_xxprime64_3 = 0x165667B19E3779F9ull;
+        static const u64 c_xxprime64_4 = 0x85EBCA77C2B2AE63ull;
+        static const u64 c_xxprime64_5 = 0x27D4EB2F165667C5ull;
+
+        static inline u64 _xxsplitmix(u64& state)
+        {
+            u64 z = (state += 0x9E3779B97F4A7C15ull);
+            z     = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+            z     = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+            return z ^ (z >> 31);
+        }
+
+        static inline u64 _xxavalanche(u64 h)
+        {
+            h ^= h >> 37;
+            h *= 0x165667919E3779F9ull;
+            return h ^ (h >> 32);
+        }
+
+        // the 8 lanes are independent, the compiler can vectorize this loop
+        static inline void _xxstripe(u64* acc, const u8* p, const u64* secret)
+        {
+            for (s32 i = 0; i < 8; ++i)
+            {
+                u64 const d = _hashr8(p + i * 8);
+                u64 const k = d ^ secret[i];
+                acc[i ^ 1] += d;
+                acc[i] += (k & 0xFFFFFFFF) * (k >> 32);
+            }
+        }
+
+        static inline void _xxscramble(u64* acc, const u64* scramble)
+        {
+            for (s32 i = 0; i < 8; ++i)
+            {
+                u64 a = acc[i];
+                a ^= a >> 47;
+                a ^= scramble[i];
+                acc[i] = a * c_xxprime32_1;
+            }
+        }
+
+        static inline u64 _xxmerge(const u64* acc, const u64* secret, u64 start)
+        {
+            u64 h = start;
+            for (s32 i = 0; i < 4; ++i)
+                h += _wymix(acc[2 * i] ^ secret[2 * i], acc[2 * i + 1] ^ secret[2 * i + 1]);
+            return _xxavalanche(h);
+        }
+
+        xxh3_hasher_t::xxh3_hasher_t(s32 bits, u64 seed)
+            : m_bits(bits == 128 ? 128 : 64)
+            , m_seed(seed)
+        {
+            u64 state = seed ^ c_xxprime64_3;
+            for (s32 i = 0; i < 24; ++i)
+                m_secret[i] = _xxsplitmix(state);
+            for (s32 i = 0; i < 8; ++i)
+                m_scramble[i] = _xxsplitmix(state);
+            begin();
+        }
+
+        void xxh3_hasher_t::reset() { begin(); }
+
+        void xxh3_hasher_t::begin()
+        {
+            m_acc[0]  = c_xxprime32_3;
+            m_acc[1]  = c_xxprime64_1;
+            m_acc[2]  = c_xxprime64_2;
+            m_acc[3]  = c_xxprime64_3;
+            m_acc[4]  = c_xxprime64_4;
+            m_acc[5]  = c_xxprime32_2;
+            m_acc[6]  = c_xxprime64_5;
+            m_acc[7]  = c_xxprime32_1;
+            m_stripe  = 0;
+            m_length  = 0;
+            m_pending = 0;
+        }
+
+        // A stripe is only consumed when more bytes follow it, so the last stripe (1 to 64 bytes)
+        // is always in 'm_buffer' when the hash is finished.
+        void xxh3_hasher_t::hash(const u8* begin, const u8* end)
+        {
+            uint_t n = (uint_t)(end - begin);
+            m_length += n;
+            if ((m_pending + n) <= 64)
+            {
+                g_memcpy(m_buffer + m_pending, begin, (int_t)n);
+                m_pending += n;
+                return;
+            }
+
+            const u8* p = begin;
+            if (m_pending > 0)
+            {
+                uint_t const take = 64 - (uint_t)m_pending;
+                g_memcpy(m_buffer + m_pending, p, (int_t)take);
+                p += take;
+                n -= take;
+                _xxstripe(m_acc, m_buffer, m_secret + m_stripe);
+                if (++m_stripe == 16)
+                {
+                    _xxscramble(m_acc, m_scramble);
+                    m_stripe = 0;
+                }
+            }
+            while (n > 64)
+            {
+                _xxstripe(m_acc, p, m_secret + m_stripe);
+                if (++m_stripe == 16)
+                {
+                    _xxscramble(m_acc, m_scramble);
+                    m_stripe = 0;
+                }
+                p += 64;
+                n -= 64;
+            }
+            g_memcpy(m_buffer, p, (int_t)n);
+            m_pending = n;
+        }
+
+        void xxh3_hasher_t::finish(u64* acc) const
+        {
+            for (s32 i = 0; i < 8; ++i)
+                acc[i] = m_acc[i];
+            u8 last[64];
+            g_memcpy(last, m_buffer, (int_t)m_pending);
+            g_memset(last + m_pending, 0, (int_t)(64 - m_pending));
+            _xxstripe(acc, last, m_secret + m_stripe);
+        }
+
+        u64 xxh3_hasher_t::digest() const
+        {
+            u64 acc[8];
+            finish(acc);
+            return _xxmerge(acc, m_secret + 16, m_length * c_xxprime64_1);
+        }
+
+        void xxh3_hasher_t::digest128(u64& lo, u64& hi) const
+        {
+            u64 acc[8];
+            finish(acc);
+            lo = _xxmerge(acc, m_secret + 16, m_length * c_xxprime64_1);
+            hi = _xxmerge(acc, m_secret + 8, ~(m_length * c_xxprime64_2));
+        }
+
+        void xxh3_hasher_t::end(u8* out_hash, s32 size)
+        {
+            u64 h[2];
+            if (m_bits == 128)
+                digest128(h[0], h[1]);
+            else
+                h[0] = digest();
+            for (s32 i = 0; i < size && i < m_bits / 8; ++i)
+                out_hash[i] = (u8)(h[i >> 3] >> ((i & 7) * 8));
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // crc32c
+        // ----------------------------------------------------------------------------------------
+        // The crc is kept inverted while bytes are added, crc32c() inverts at the start and the end.
+
+        struct crc32c_tables_t
+        {
+            crc32c_tables_t()
+            {
+                for (u32 i = 0; i < 256; ++i)
+                {
+                    u32 c = i;
+                    for (s32 k = 0; k < 8; ++k)
+                        c = (c >> 1) ^ (0x82F63B78 & (0 - (c & 1)));
+                    m_table[0][i] = c;
+                }
+                for (u32 i = 0; i < 256; ++i)
+                    for (s32 t = 1; t < 8; ++t)
+                        m_table[t][i] = (m_table[t - 1][i] >> 8) ^ m_table[0][m_table[t - 1][i] & 0xFF];
+            }
+            u32 m_table[8][256];
+        };
+
+        // slicing-by-8, 8 bytes per step with 8 table lookups
+        static u32 _crc32c_sw(u32 crc, const u8* p, uint_t n)
+        {
+            static const crc32c_tables_t s_tables;
+            u32 const(*t)[256] = s_tables.m_table;
+            for (; n > 0 && ((uint_t)p & 7) != 0; --n)
+                crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+            for (; n >= 8; n -= 8, p += 8)
+            {
+                u64 const v = _hashr8(p) ^ crc;
+                crc         = t[7][v & 0xFF] ^ t[6][(v >> 8) & 0xFF] ^ t[5][(v >> 16) & 0xFF] ^ t[4][(v >> 24) & 0xFF] ^ t[3][(v >> 32) & 0xFF] ^ t[2][(v >> 40) & 0xFF] ^ t[1][(v >> 48) & 0xFF] ^ t[0][v >> 56];
+            }
+            for (; n > 0; --n)
+                crc = t[0][(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+            return crc;
+        }
+
+#if defined(D_CRC32C_X64)
+        static bool _crc32c_has_instruction()
+        {
+#    if defined(__SSE4_2__)
+            return true;
+#    elif defined(_MSC_VER)
+            s32 info[4];
+            __cpuid(info, 1);
+            return (info[2] & (1 << 20)) != 0;
+#    else
+            return __builtin_cpu_supports("sse4.2") != 0;
+#    endif
+        }
+
+        D_CRC32C_TARGET static inline u32 _crc32c_u64(u32 crc, const u8* p) { return (u32)_mm_crc32_u64(crc, _hashr8(p)); }
+        D_CRC32C_TARGET static inline u32 _crc32c_u8(u32 crc, u8 b) { return _mm_crc32_u8(crc, b); }
+#elif defined(D_CRC32C_ARM)
+        static bool _crc32c_has_instruction() { return true; }
+        static inline u32 _crc32c_u64(u32 crc, const u8* p) { return __crc32cd(crc, _hashr8(p)); }
+        static inline u32 _crc32c_u8(u32 crc, u8 b) { return __crc32cb(crc, b); }
+#endif
+
+#if defined(D_CRC32C_X64) || defined(D_CRC32C_ARM)
+#    ifndef D_CRC32C_TARGET
+#        define D_CRC32C_TARGET
+#    endif
+        static const bool s_crc32c_hw = _crc32c_has_instruction();
+
+        D_CRC32C_TARGET static u32 _crc32c_hw(u32 crc, const u8* p, uint_t n)
         {
-            if ((strdata.m_type) == ascii::TYPE)
+            for (; n >= 8; n -= 8, p += 8)
+                crc = _crc32c_u64(crc, p);
+            for (; n > 0; --n)
+                crc = _crc32c_u8(crc, *p++);
+            return crc;
+        }
+
+        // The crc32 instruction has a latency of 3 cycles and a throughput of 1 per cycle, so 3
+        // independent buffers are done in the same loop.
+        static const s32 c_crc32c_lanes = 3;
+
+        D_CRC32C_TARGET static void _crc32c_hw_many(cbuffer_t const* buffers, s32 n, u32* out)
+        {
+            s32 i = 0;
+            for (; (i + c_crc32c_lanes) <= n; i += c_crc32c_lanes)
             {
-                const char* begin = &strdata.m_ascii[strdata.m_str];
-                const char* end   = &strdata.m_ascii[strdata.m_str];
-                return strhash64(begin, end, seed);
+                const u8* p[c_crc32c_lanes];
+                uint_t    rem[c_crc32c_lanes];
+                u32       crc[c_crc32c_lanes];
+                uint_t    common = ~(uint_t)0;
+                for (s32 l = 0; l < c_crc32c_lanes; ++l)
+                {
+                    p[l]   = buffers[i + l].m_begin;
+                    rem[l] = (uint_t)buffers[i + l].size();
+                    crc[l] = 0xFFFFFFFF;
+                    common = rem[l] < common ? rem[l] : common;
+                }
+                for (uint_t k = 0; (k + 8) <= common; k += 8)
+                {
+                    crc[0] = _crc32c_u64(crc[0], p[0] + k);
+                    crc[1] = _crc32c_u64(crc[1], p[1] + k);
+                    crc[2] = _crc32c_u64(crc[2], p[2] + k);
+                }
+                common &= ~(uint_t)7;
+                for (s32 l = 0; l < c_crc32c_lanes; ++l)
+                    out[i + l] = ~_crc32c_hw(crc[l], p[l] + common, rem[l] - common);
             }
+            for (; i < n; ++i)
+                out[i] = ~_crc32c_hw(0xFFFFFFFF, buffers[i].m_begin, (uint_t)buffers[i].size());
+        }
+#endif
+
+        u32 crc32c(void const* data, int_t size, u32 crc)
+        {
+#if defined(D_CRC32C_X64) || defined(D_CRC32C_ARM)
+            if (s_crc32c_hw)
+                return ~_crc32c_hw(~crc, (const u8*)data, (uint_t)size);
+#endif
+            return ~_crc32c_sw(~crc, (const u8*)data, (uint_t)size);
+        }
 
-            // We could extend it to support utf-32 and utf-16, but we don't need it for now.
+        u32 crc32c_sw(void const* data, int_t size, u32 crc) { return ~_crc32c_sw(~crc, (const u8*)data, (uint_t)size); }
 
-            ASSERT(false);
-            return 0;
+        void crc32c_many(cbuffer_t const* buffers, s32 n, u32* out)
+        {
+#if defined(D_CRC32C_X64) || defined(D_CRC32C_ARM)
+            if (s_crc32c_hw)
+            {
+                _crc32c_hw_many(buffers, n, out);
+                return;
+            }
+#endif
+            for (s32 i = 0; i < n; ++i)
+                out[i] = ~_crc32c_sw(0xFFFFFFFF, buffers[i].m_begin, (uint_t)buffers[i].size());
         }
 
-        u64 strhash_lowercase(crunes_t const& strdata, u64 seed)
+        void crc32c_hasher_t::end(u8* out_hash, s32 size)
+        {
+            for (s32 i = 0; i < size && i < 4; ++i)
+                out_hash[i] = (u8)(m_crc >> (i * 8));
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // strhash
+        // ----------------------------------------------------------------------------------------
+        // A string is hashed as its UTF-8 form, so the same text gives the same hash in any encoding
+        // (an ascii string is read as Latin-1, bytes above 0x7F are the code points U+0080..U+00FF).
+        // The runes are decoded, folded to lowercase (A-Z only, like nrunes::to_lower) and encoded
+        // into a small chunk that is fed to a wyhasher_t, there is no conversion of the whole string.
+        // Runs of ASCII characters are copied (and folded) 16 bytes (8 utf-16, 4 utf-32 runes) at a time.
+
+        static const u32 c_strhash_chunk = 256;
+
+        static inline bool _str_is_ascii8(const u8* p)
         {
-            if ((strdata.m_type) == ascii::TYPE)
+            u64 v;
+            g_memcpy(&v, p, 8);
+            return (v & 0x8080808080808080ull) == 0;
+        }
+
+        // 'A'-'Z' to 'a'-'z' of 8 bytes, bytes above 0x7F are left alone so this also works on UTF-8
+        static inline u64 _str_lower8(u64 x)
+        {
+            u64 const heptets = x & 0x7F7F7F7F7F7F7F7Full;
+            u64 const ge_A    = heptets + 0x3F3F3F3F3F3F3F3Full;  // high bit set when >= 'A'
+            u64 const gt_Z    = heptets + 0x2525252525252525ull;  // high bit set when > 'Z'
+            u64 const upper   = ge_A & ~gt_Z & ~x & 0x8080808080808080ull;
+            return x | (upper >> 2);
+        }
+
+        static inline u8 _str_lower(u8 c) { return (c >= 'A' && c <= 'Z') ? (u8)(c + ('a' - 'A')) : c; }
+
+        // the number of bytes at the start of [p, end) that are below 0x80
+        static uint_t _str_ascii_prefix(const u8* p, const u8* end)
+        {
+            const u8* const begin = p;
+#ifdef D_STRHASH_SSE2
+            for (; (end - p) >= 16; p += 16)
             {
-                const char* begin = &strdata.m_ascii[strdata.m_str];
-                const char* end   = &strdata.m_ascii[strdata.m_str];
-                return strhash64_lowercase(begin, end, seed);
+                s32 const mask = _mm_movemask_epi8(_mm_loadu_si128((__m128i const*)p));
+                if (mask != 0)
+                    return (uint_t)(p - begin) + (uint_t)math::findFirstBit((u32)mask);
             }
+#endif
+            for (; (end - p) >= 8 && _str_is_ascii8(p); p += 8) {}
+            while (p < end && *p < 0x80)
+                ++p;
+            return (uint_t)(p - begin);
+        }
 
-            // We could extend it to support utf-32 and utf-16, but we don't need it for now.
+        static void _str_lower_copy(u8* dst, const u8* src, uint_t n)
+        {
+            uint_t i = 0;
+#ifdef D_STRHASH_SSE2
+            __m128i const A = _mm_set1_epi8('A' - 1);
+            __m128i const Z = _mm_set1_epi8('Z' + 1);
+            __m128i const d = _mm_set1_epi8('a' - 'A');
+            for (; (i + 16) <= n; i += 16)
+            {
+                __m128i const x     = _mm_loadu_si128((__m128i const*)(src + i));
+                __m128i const upper = _mm_and_si128(_mm_cmpgt_epi8(x, A), _mm_cmplt_epi8(x, Z));  // bytes above 0x7F are negative
+                _mm_storeu_si128((__m128i*)(dst + i), _mm_add_epi8(x, _mm_and_si128(upper, d)));
+            }
+#endif
+            for (; (i + 8) <= n; i += 8)
+            {
+                u64 x;
+                g_memcpy(&x, src + i, 8);
+                x = _str_lower8(x);
+                g_memcpy(dst + i, &x, 8);
+            }
+            for (; i < n; ++i)
+                dst[i] = _str_lower(src[i]);
+        }
+
+        // 8 utf-16 runes that are all below 0x80 to 8 bytes
+        static inline bool _str_pack_ascii16(const u16* src, u8* dst)
+        {
+#ifdef D_STRHASH_SSE2
+            __m128i const x = _mm_loadu_si128((__m128i const*)src);
+            if (_mm_movemask_epi8(_mm_cmpeq_epi16(_mm_and_si128(x, _mm_set1_epi16((s16)0xFF80)), _mm_setzero_si128())) != 0xFFFF)
+                return false;
+            _mm_storel_epi64((__m128i*)dst, _mm_packus_epi16(x, x));
+            return true;
+#else
+            u16 any = 0;
+            for (s32 i = 0; i < 8; ++i)
+                any |= src[i];
+            if (any & 0xFF80)
+                return false;
+            for (s32 i = 0; i < 8; ++i)
+                dst[i] = (u8)src[i];
+            return true;
+#endif
+        }
 
-            ASSERT(false);
-            return 0;
+        // 4 utf-32 runes that are all below 0x80 to 4 bytes
+        static inline bool _str_pack_ascii32(const u32* src, u8* dst)
+        {
+            u32 const any = src[0] | src[1] | src[2] | src[3];
+            if (any & 0xFFFFFF80)
+                return false;
+            dst[0] = (u8)src[0];
+            dst[1] = (u8)src[1];
+            dst[2] = (u8)src[2];
+            dst[3] = (u8)src[3];
+            return true;
         }
 
-        u32 strhash32(crunes_t const& str, u32 seed)
+        class strhasher_t
         {
-            if ((str.m_type) == ascii::TYPE)
+        public:
+            strhasher_t(u64 seed, bool lowercase)
+                : m_hasher(seed)
+                , m_lowercase(lowercase)
+                , m_size(0)
+            {
+            }
+
+            // bytes that are already UTF-8
+            void write(const u8* p, const u8* end)
+            {
+                if (!m_lowercase)
+                {
+                    flush();
+                    m_hasher.hash(p, end);
+                    return;
+                }
+                while (p < end)
+                {
+                    uint_t const space = c_strhash_chunk - m_size;
+                    uint_t const n     = (uint_t)(end - p) < space ? (uint_t)(end - p) : space;
+                    _str_lower_copy(m_chunk + m_size, p, n);
+                    m_size += (u32)n;
+                    p += n;
+                    if (m_size == c_strhash_chunk)
+                        flush();
+                }
+            }
+
+            void write_rune(uchar32 c)
+            {
+                if (m_size > (c_strhash_chunk - 4))
+                    flush();
+                u8* d = m_chunk + m_size;
+                if (c < 0x80)
+                {
+                    d[0] = m_lowercase ? _str_lower((u8)c) : (u8)c;
+                    m_size += 1;
+                }
+                else if (c < 0x800)
+                {
+                    d[0] = (u8)(0xC0 | (c >> 6));
+                    d[1] = (u8)(0x80 | (c & 0x3F));
+                    m_size += 2;
+                }
+                else if (c < 0x10000)
+                {
+                    d[0] = (u8)(0xE0 | (c >> 12));
+                    d[1] = (u8)(0x80 | ((c >> 6) & 0x3F));
+                    d[2] = (u8)(0x80 | (c & 0x3F));
+                    m_size += 3;
+                }
+                else
+                {
+                    d[0] = (u8)(0xF0 | ((c >> 18) & 0x07));
+                    d[1] = (u8)(0x80 | ((c >> 12) & 0x3F));
+                    d[2] = (u8)(0x80 | ((c >> 6) & 0x3F));
+                    d[3] = (u8)(0x80 | (c & 0x3F));
+                    m_size += 4;
+                }
+            }
+
+            // room for 'n' (at most 16) ASCII bytes, call 'commit' after writing them
+            u8* reserve(u32 n)
             {
-                const char* begin = &str.m_ascii[str.m_str];
-                const char* end   = &str.m_ascii[str.m_str];
-                return strhash32(begin, end, seed);
+                if (m_size > (c_strhash_chunk - n))
+                    flush();
+                return m_chunk + m_size;
             }
 
-            // We could extend it to support utf-32 and utf-16, but we don't need it for now.
+            void commit(u32 n)
+            {
+                if (m_lowercase)
+                    _str_lower_copy(m_chunk + m_size, m_chunk + m_size, n);
+                m_size += n;
+            }
+
+            u64 digest()
+            {
+                flush();
+                return m_hasher.digest();
+            }
+
+        private:
+            void flush()
+            {
+                m_hasher.hash(m_chunk, m_chunk + m_size);
+                m_size = 0;
+            }
 
-            ASSERT(false);
-            return 0;
+            wyhasher_t m_hasher;
+            bool       m_lowercase;
+            u32        m_size;
+            u8         m_chunk[c_strhash_chunk];
+        };
+
+        static void _strhash_ascii(strhasher_t& h, const u8* p, const u8* end)
+        {
+            while (p < end)
+            {
+                const u8* run = p + _str_ascii_prefix(p, end);
+                h.write(p, run);
+                if (run < end)
+                    h.write_rune(*run++);  // Latin-1, becomes 2 bytes
+                p = run;
+            }
         }
 
-        u32 strhash32_lowercase(crunes_t const& str, u32 seed)
+        // Decode one UTF-16 code point, an unpaired surrogate becomes U+FFFD
+        static inline uchar32 _str_read_utf16(const u16* str, u32& cursor, u32 end)
         {
-            if ((str.m_type) == ascii::TYPE)
+            uchar32 const high = str[cursor++];
+            if ((high & utf::UTF16_GENERIC_SURROGATE_MASK) != utf::UTF16_GENERIC_SURROGATE_VALUE)
+                return high;
+            if ((high & utf::UTF16_SURROGATE_MASK) != utf::UTF16_HIGH_SURROGATE_VALUE || cursor >= end)
+                return utf::UTF16_INVALID_CODEPOINT;
+            uchar32 const low = str[cursor];
+            if ((low & utf::UTF16_SURROGATE_MASK) != utf::UTF16_LOW_SURROGATE_VALUE)
+                return utf::UTF16_INVALID_CODEPOINT;
+            cursor++;
+            return (((high & utf::UTF16_SURROGATE_CODEPOINT_MASK) << utf::UTF16_SURROGATE_CODEPOINT_BITS) | (low & utf::UTF16_SURROGATE_CODEPOINT_MASK)) + utf::UTF16_SURROGATE_CODEPOINT_OFFSET;
+        }
+
+        static void _strhash_utf16(strhasher_t& h, crunes_t const& str)
+        {
+            bool const is_ucs2 = str.m_type == ucs2::TYPE;
+            const u16* units   = (const u16*)str.m_utf16;
+            u32        cursor  = str.m_str;
+            while (cursor < str.m_end)
             {
-                const char* begin = &str.m_ascii[str.m_str];
-                const char* end   = &str.m_ascii[str.m_str];
-                return strhash32_lowercase(begin, end, seed);
+                if ((cursor + 8) <= str.m_end)
+                {
+                    u8* d = h.reserve(8);
+                    if (_str_pack_ascii16(&units[cursor], d))
+                    {
+                        h.commit(8);
+                        cursor += 8;
+                        continue;
+                    }
+                }
+                // UCS-2 has no surrogate pairs, every code unit is a code point
+                h.write_rune(is_ucs2 ? (uchar32)units[cursor++] : _str_read_utf16(units, cursor, str.m_end));
             }
+        }
 
-            // We could extend it to support utf-32 and utf-16, but we don't need it for now.
+        static void _strhash_utf32(strhasher_t& h, crunes_t const& str)
+        {
+            u32 cursor = str.m_str;
+            while (cursor < str.m_end)
+            {
+                if ((cursor + 4) <= str.m_end)
+                {
+                    u8* d = h.reserve(4);
+                    if (_str_pack_ascii32((const u32*)&str.m_utf32[cursor], d))
+                    {
+                        h.commit(4);
+                        cursor += 4;
+                        continue;
+                    }
+                }
+                h.write_rune(str.m_utf32[cursor++]);
+            }
+        }
 
-            ASSERT(false);
-            return 0;
+        static u64 _strhash(crunes_t const& str, u64 seed, bool lowercase)
+        {
+            strhasher_t h(seed, lowercase);
+            if (str.m_ascii != nullptr && str.m_str < str.m_end)
+            {
+                switch (str.m_type)
+                {
+                    case ascii::TYPE: _strhash_ascii(h, (const u8*)&str.m_ascii[str.m_str], (const u8*)&str.m_ascii[str.m_end]); break;
+                    case utf8::TYPE: h.write((const u8*)&str.m_utf8[str.m_str], (const u8*)&str.m_utf8[str.m_end]); break;
+                    case ucs2::TYPE:
+                    case utf16::TYPE: _strhash_utf16(h, str); break;
+                    case utf32::TYPE: _strhash_utf32(h, str); break;
+                    default: ASSERT(false); break;
+                }
+            }
+            return h.digest();
         }
 
+        static inline u32 _strhash_fold32(u64 h) { return (u32)(h ^ (h >> 32)); }
+
+        u64 strhash(crunes_t const& str, u64 seed) { return _strhash(str, seed, false); }
+        u64 strhash_lowercase(crunes_t const& str, u64 seed) { return _strhash(str, seed, true); }
+        u32 strhash32(crunes_t const& str, u32 seed) { return _strhash_fold32(_strhash(str, seed, false)); }
+        u32 strhash32_lowercase(crunes_t const& str, u32 seed) { return _strhash_fold32(_strhash(str, seed, true)); }
+
     }  // namespace nhash
 };  // namespace ncore
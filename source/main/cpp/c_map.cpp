@@ -1,8 +1,89 @@
 #include "ccore/c_target.h"
+#include "ccore/c_debug.h"
 #include "cbase/c_allocator.h"
+#include "cbase/c_integer.h"
 #include "cbase/c_map.h"
 
 namespace ncore
 {
+    namespace nmap
+    {
+        // Header in front of every chunk
+        struct chunk_t
+        {
+            chunk_t* m_next;
+        };
 
-};
+        struct free_node_t
+        {
+            free_node_t* m_next;
+        };
+
+        void node_pool_t::setup(alloc_t* allocator, u32 node_size, u32 node_align, u32 chunk_nodes)
+        {
+            ASSERT(chunk_nodes > 0);
+            if (node_align < sizeof(void*))
+                node_align = sizeof(void*);
+            m_allocator   = allocator;
+            m_chunks      = nullptr;
+            m_free        = nullptr;
+            m_cursor      = nullptr;
+            m_end         = nullptr;
+            m_node_size   = math::alignUp(node_size < sizeof(free_node_t) ? (u32)sizeof(free_node_t) : node_size, node_align);
+            m_node_align  = node_align;
+            m_chunk_nodes = chunk_nodes;
+        }
+
+        void* node_pool_t::allocate()
+        {
+            if (m_free != nullptr)
+            {
+                free_node_t* node = (free_node_t*)m_free;
+                m_free            = node->m_next;
+                return node;
+            }
+
+            if (m_cursor == m_end)
+            {
+                u32 const header = math::alignUp((u32)sizeof(chunk_t), m_node_align);
+                byte*     mem    = (byte*)m_allocator->allocate(header + m_node_size * m_chunk_nodes, m_node_align);
+                if (mem == nullptr)
+                    return nullptr;
+
+                chunk_t* chunk = (chunk_t*)mem;
+                chunk->m_next  = (chunk_t*)m_chunks;
+                m_chunks       = chunk;
+                m_cursor       = mem + header;
+                m_end          = m_cursor + m_node_size * m_chunk_nodes;
+            }
+
+            void* node = m_cursor;
+            m_cursor += m_node_size;
+            return node;
+        }
+
+        void node_pool_t::deallocate(void* node)
+        {
+            free_node_t* free = (free_node_t*)node;
+            free->m_next      = (free_node_t*)m_free;
+            m_free            = free;
+        }
+
+        void node_pool_t::release()
+        {
+            chunk_t* chunk = (chunk_t*)m_chunks;
+            while (chunk != nullptr)
+            {
+                chunk_t* next = chunk->m_next;
+                m_allocator->deallocate(chunk);
+                chunk = next;
+            }
+            m_chunks = nullptr;
+            m_free   = nullptr;
+            m_cursor = nullptr;
+            m_end    = nullptr;
+        }
+
+    }  // namespace nmap
+
+};  // namespace ncore
@@ -0,0 +1,83 @@
+#include "ccore/c_target.h"
+#include "ccore/c_debug.h"
+#include "ccore/c_arena.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_pool.h"
+#include "cbase/c_integer.h"
+#include "cbase/c_map32.h"
+
+namespace ncore
+{
+    namespace nmap32
+    {
+        // Growing commits at least this many nodes
+        const u32 c_min_grow = (64 * cKB) / sizeof(ntree32::nnode_t);
+
+        bool arrays_t::setup(s32 num_arrays, s32 const* item_sizes, s32 const* item_alignments, u32 capacity, u32 reserved)
+        {
+            ASSERT(num_arrays > 0 && num_arrays <= c_max_arrays);
+            if (reserved > c_max_slots)
+                reserved = c_max_slots;
+            if (capacity > reserved)
+                return false;
+
+            m_num_arrays = num_arrays;
+            m_capacity   = capacity;
+            m_reserved   = reserved;
+            for (s32 i = 0; i < num_arrays; ++i)
+            {
+                m_item_size[i] = item_sizes[i];
+                m_arena[i]     = npool::g_alloc_vmem_arena((s32)reserved, (s32)capacity, item_sizes[i], item_alignments[i], m_array[i]);
+                if (m_arena[i] == nullptr)
+                {
+                    teardown();
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        void arrays_t::teardown()
+        {
+            for (s32 i = 0; i < m_num_arrays; ++i)
+            {
+                npool::g_free_vmem_arena(m_arena[i]);
+                m_array[i] = nullptr;
+            }
+            m_num_arrays = 0;
+            m_capacity   = 0;
+            m_reserved   = 0;
+        }
+
+        bool arrays_t::set_capacity(u32 capacity)
+        {
+            if (capacity <= m_capacity)
+                return true;
+            if (capacity > m_reserved)
+                return false;
+
+            // The items follow the arena header, commit up to the end of the last item
+            for (s32 i = 0; i < m_num_arrays; ++i)
+            {
+                int_t const offset = (int_t)((byte*)m_array[i] - (byte*)m_arena[i]);
+                if (!narena::commit(m_arena[i], offset + (int_t)capacity * m_item_size[i]))
+                    return false;
+            }
+            m_capacity = capacity;
+            return true;
+        }
+
+        bool arrays_t::grow()
+        {
+            if (m_capacity >= m_reserved)
+                return false;
+            u32 grow = m_capacity >> 1;
+            if (grow < c_min_grow)
+                grow = c_min_grow;
+            u32 const capacity = (m_reserved - m_capacity) > grow ? m_capacity + grow : m_reserved;
+            return set_capacity(capacity);
+        }
+
+    }  // namespace nmap32
+
+};  // namespace ncore
@@ -148,8 +148,9 @@ namespace ncore
                 root = head->get_child(RIGHT);
             }
 
-            // Make the root black for simplified logic
-            root->set_color(BLACK);
+            // Make the root black for simplified logic (there is no root when the first node could not be created)
+            if (root != nullptr)
+                root->set_color(BLACK);
 
             return _inserted != nullptr;
         }
@@ -229,6 +230,44 @@ namespace ncore
             return false;
         }
 
+        // Finds the node nearest to 'key' in direction 'dir' (RIGHT = the first node after, LEFT = the last
+        // node before), an equal node is accepted when 'inclusive' is true
+        static bool s_bound(node_t* root, void const* key, compare_key_and_node_fn comparer, s32 dir, bool inclusive, node_t*& found)
+        {
+            node_t* best = nullptr;
+            node_t* node = root;
+            while (node != nullptr)
+            {
+                s8 c = comparer(key, node);
+                if (c == 0)
+                {
+                    if (inclusive)
+                    {
+                        found = node;
+                        return true;
+                    }
+                    c = (dir == RIGHT) ? 1 : -1;
+                }
+                // 'node' lies in direction 'dir' of the key, it is a candidate and a closer one can only be on the other side
+                if (iterator_t::getdir(c) != dir)
+                {
+                    best = node;
+                    node = node->get_child(1 - dir);
+                }
+                else
+                {
+                    node = node->get_child(dir);
+                }
+            }
+            found = best;
+            return best != nullptr;
+        }
+
+        bool lower_bound(node_t* root, void const* key, compare_key_and_node_fn comparer, node_t*& found) { return s_bound(root, key, comparer, RIGHT, true, found); }
+        bool upper_bound(node_t* root, void const* key, compare_key_and_node_fn comparer, node_t*& found) { return s_bound(root, key, comparer, RIGHT, false, found); }
+        bool floor(node_t* root, void const* key, compare_key_and_node_fn comparer, node_t*& found) { return s_bound(root, key, comparer, LEFT, true, found); }
+        bool ceil(node_t* root, void const* key, compare_key_and_node_fn comparer, node_t*& found) { return s_bound(root, key, comparer, RIGHT, true, found); }
+
         // validate the tree (return violation description in 'result'), also returns black height
         static s32 rb_validate(node_t const* root, const char*& result, compare_node_and_node_fn comparer)
         {
@@ -277,6 +316,7 @@ namespace ncore
 
         bool remove(node_t*& root, node_t* temp, void const* key, compare_key_and_node_fn comparer, node_t*& out_removed)
         {
+            out_removed = nullptr;
             if (root == nullptr)
                 return false;
 
@@ -415,7 +455,7 @@ namespace ncore
             if (root != nullptr)
                 root->set_color(BLACK);
 
-            return true;
+            return fn != nullptr;
         }
 
         bool validate(node_t const* root, const char*& error_str, compare_node_and_node_fn comparer)
@@ -424,6 +464,41 @@ namespace ncore
             return error_str == nullptr;
         }
 
+        // Returns the depth of the (incomplete) lowest level of a tree of 'count' nodes that is built by
+        // splitting at the middle, floor(log2(count + 1)).
+        static s32 s_red_depth(s32 count)
+        {
+            s32 depth = 0;
+            while ((((u64)count + 1) >> (depth + 1)) != 0)
+                depth++;
+            return depth;
+        }
+
+        // The nodes are created in-order, every level is complete except the lowest one, the nodes on
+        // that level are colored red and all others black, this gives equal black heights.
+        static node_t* s_build_from_sorted(s32 count, s32 depth, s32 red_depth, new_node_fn new_node, void* user_data)
+        {
+            if (count <= 0)
+                return nullptr;
+
+            s32 const left_count = (count - 1) >> 1;
+            node_t*   left       = s_build_from_sorted(left_count, depth + 1, red_depth, new_node, user_data);
+            node_t*   node       = new_node(user_data);
+            if (node == nullptr)
+                return left;  // out of memory, the nodes created so far stay reachable for the caller to free
+            node_t* right = s_build_from_sorted(count - 1 - left_count, depth + 1, red_depth, new_node, user_data);
+
+            node->set_child(LEFT, left);
+            node->set_child(RIGHT, right);
+            node->set_color(depth == red_depth ? RED : BLACK);
+            return node;
+        }
+
+        node_t* build_from_sorted(s32 count, new_node_fn new_node, void* user_data)
+        {
+            return s_build_from_sorted(count, 0, s_red_depth(count), new_node, user_data);
+        }
+
         bool iterator_t::traverse(node_t const* root, s32 d, node_t const*& out_node)
         {
             if (m_it == nullptr)
@@ -495,6 +570,31 @@ namespace ncore
             return true;
         }
 
+        void iterator_t::seek(node_t const* root, void const* key, compare_key_and_node_fn comparer, s32 dir, bool inclusive)
+        {
+            // Push the nodes on the search path that 'sortorder' still has to visit, the top of the stack
+            // is the bound and the rest are its successors along the path (at most the height of the tree).
+            m_stack = 0;
+            m_it    = nullptr;
+
+            node_t const* node = root;
+            while (node != nullptr)
+            {
+                s8 c = comparer(key, node);
+                if (c == 0)
+                    c = (inclusive == (dir == LEFT)) ? -1 : 1;
+                if (getdir(c) == dir)
+                {
+                    m_stack_array[m_stack++] = node;
+                    node                     = node->get_child(dir);
+                }
+                else
+                {
+                    node = node->get_child(1 - dir);
+                }
+            }
+        }
+
         bool iterator_t::postorder(node_t const* root, s32 dir, node_t const*& out_node)
         {
             if (m_stack == -1)
@@ -54,6 +54,21 @@ namespace ncore
 
         static inline bool is_red(tree_t& tree, node_t n) { return n != c_invalid_node && tree.get_color(n) == RED; }
 
+        // Recomputes the dirty subtree sizes. Insert and remove mark the nodes on the search path and
+        // every node whose children change (rotations), these are the only nodes with a changed size
+        // and each of them is reachable from the root through dirty nodes, O(log n).
+        static u32 s_fix_sizes(tree_t& tree, node_t node)
+        {
+            if (node == c_invalid_node)
+                return 0;
+            u32 size = tree.m_sizes[node];
+            if ((size & c_size_dirty) == 0)
+                return size;
+            size               = s_fix_sizes(tree, tree.get_node(node, LEFT)) + s_fix_sizes(tree, tree.get_node(node, RIGHT)) + 1;
+            tree.m_sizes[node] = size;
+            return size;
+        }
+
         bool insert(tree_t& tree, node_t& root, node_t temp, index_t key, compare_fn comparer, void const* user_data, node_t& inserted_or_found)
         {
             node_t inserted = c_invalid_node;
@@ -81,6 +96,7 @@ namespace ncore
 
                 g = p = c_invalid_node;
                 n     = root;
+                tree.mark(n);
 
                 // Search down the tree for a place to insert
                 for (;;)
@@ -142,6 +158,7 @@ namespace ncore
                     g = p;
                     p = n;
                     n = tree.get_node(n, dir);
+                    tree.mark(n);
                 }
 
                 // Update the root (it may be different)
@@ -152,6 +169,9 @@ namespace ncore
             // Make the root black for simplified logic
             tree.set_color(root, BLACK);
 
+            if (tree.m_sizes != nullptr)
+                s_fix_sizes(tree, root);
+
             inserted_or_found = (inserted == c_invalid_node) ? found : inserted;
             return inserted != c_invalid_node;
         }
@@ -234,6 +254,60 @@ namespace ncore
             return false;
         }
 
+        struct compare_fn_t
+        {
+            index_t const* m_keys;
+            compare_fn     m_comparer;
+            void const*    m_user_data;
+
+            inline s8   operator()(u32 i, node_t node) const { return m_comparer(m_keys[i], node, m_user_data); }
+            inline void prefetch(node_t) const {}
+        };
+
+        u32 find_many(tree_t const& tree, node_t root, index_t const* keys, u32 count, compare_fn comparer, void const* user_data, node_t* found)
+        {
+            compare_fn_t const cmp = {keys, comparer, user_data};
+            return find_many(tree, root, count, cmp, found);
+        }
+
+        // Finds the node nearest to 'key' in direction 'dir' (RIGHT = the first node after, LEFT = the last
+        // node before), an equal node is accepted when 'inclusive' is true
+        static bool s_bound(tree_t const& tree, node_t root, index_t key, compare_fn comparer, void const* user_data, s32 dir, bool inclusive, node_t& found)
+        {
+            node_t best = c_invalid_node;
+            node_t node = root;
+            while (node != c_invalid_node)
+            {
+                s8 c = comparer(key, node, user_data);
+                if (c == 0)
+                {
+                    if (inclusive)
+                    {
+                        found = node;
+                        return true;
+                    }
+                    c = (dir == RIGHT) ? 1 : -1;
+                }
+                // 'node' lies in direction 'dir' of the key, it is a candidate and a closer one can only be on the other side
+                if (tree_t::getdir(c) != dir)
+                {
+                    best = node;
+                    node = tree.get_node(node, 1 - dir);
+                }
+                else
+                {
+                    node = tree.get_node(node, dir);
+                }
+            }
+            found = best;
+            return best != c_invalid_node;
+        }
+
+        bool lower_bound(tree_t const& tree, node_t root, index_t key, compare_fn comparer, void const* user_data, node_t& found) { return s_bound(tree, root, key, comparer, user_data, RIGHT, true, found); }
+        bool upper_bound(tree_t const& tree, node_t root, index_t key, compare_fn comparer, void const* user_data, node_t& found) { return s_bound(tree, root, key, comparer, user_data, RIGHT, false, found); }
+        bool floor(tree_t const& tree, node_t root, index_t key, compare_fn comparer, void const* user_data, node_t& found) { return s_bound(tree, root, key, comparer, user_data, LEFT, true, found); }
+        bool ceil(tree_t const& tree, node_t root, index_t key, compare_fn comparer, void const* user_data, node_t& found) { return s_bound(tree, root, key, comparer, user_data, RIGHT, true, found); }
+
         // validate the tree (return violation description in 'result'), also returns black height
         static s32 rb_validate(tree_t& tree, node_t root, const char*& result, compare_fn comparer, void const* user_data)
         {
@@ -310,6 +384,7 @@ namespace ncore
                 p   = n;
                 n   = tree.get_node(n, dir);
                 dir = comparer(key, n, user_data);
+                tree.mark(n);
 
                 // Save the node with matching data and keep
                 // going; we'll do removal tasks at the end
@@ -409,12 +484,19 @@ namespace ncore
                 // tree.v_del_node(fn); // User must delete the node
                 out_removed = fn;
             }
+            else
+            {
+                out_removed = c_invalid_node;
+            }
 
             // Make the root black for simplified logic
             if (root != c_invalid_node)
                 tree.set_color(root, BLACK);
 
-            return true;
+            if (tree.m_sizes != nullptr)
+                s_fix_sizes(tree, root);
+
+            return fn != c_invalid_node;
         }
 
         bool validate(tree_t& tree, node_t root, const char*& error_str, compare_fn comparer, void const* user_data)
@@ -423,6 +505,83 @@ namespace ncore
             return error_str == nullptr;
         }
 
+        // floor(log2(count + 1)), the depth of the (incomplete) lowest level of a tree that is built by
+        // splitting at the middle.
+        static s32 s_red_depth(u32 count)
+        {
+            s32 depth = 0;
+            while ((((u64)count + 1) >> (depth + 1)) != 0)
+                depth++;
+            return depth;
+        }
+
+        // Every level is complete except the lowest one, the nodes on that level are colored red and all
+        // others black, this gives equal black heights.
+        static node_t s_build_from_sorted(tree_t& tree, node_t first, u32 count, s32 depth, s32 red_depth)
+        {
+            if (count == 0)
+                return c_invalid_node;
+
+            u32 const    left_count = (count - 1) >> 1;
+            node_t const node       = first + left_count;
+            tree.set_node(node, LEFT, s_build_from_sorted(tree, first, left_count, depth + 1, red_depth));
+            tree.set_node(node, RIGHT, s_build_from_sorted(tree, node + 1, count - 1 - left_count, depth + 1, red_depth));
+            tree.set_color(node, depth == red_depth ? RED : BLACK);
+            if (tree.m_sizes != nullptr)
+                tree.m_sizes[node] = count;
+            return node;
+        }
+
+        node_t build_from_sorted(tree_t& tree, node_t first, u32 count) { return s_build_from_sorted(tree, first, count, 0, s_red_depth(count)); }
+
+        u32 size(tree_t const& tree, node_t root) { return tree.get_size(root); }
+
+        u32 rank(tree_t const& tree, node_t root, index_t key, compare_fn comparer, void const* user_data)
+        {
+            ASSERT(tree.m_sizes != nullptr);
+            u32    rank = 0;
+            node_t node = root;
+            while (node != c_invalid_node)
+            {
+                if (comparer(key, node, user_data) <= 0)
+                {
+                    node = tree.get_node(node, LEFT);
+                }
+                else
+                {
+                    rank += tree.get_size(tree.get_node(node, LEFT)) + 1;
+                    node = tree.get_node(node, RIGHT);
+                }
+            }
+            return rank;
+        }
+
+        bool select(tree_t const& tree, node_t root, u32 index, node_t& found)
+        {
+            ASSERT(tree.m_sizes != nullptr);
+            node_t node = root;
+            while (node != c_invalid_node)
+            {
+                u32 const left = tree.get_size(tree.get_node(node, LEFT));
+                if (index < left)
+                {
+                    node = tree.get_node(node, LEFT);
+                }
+                else if (index == left)
+                {
+                    found = node;
+                    return true;
+                }
+                else
+                {
+                    index -= left + 1;
+                    node = tree.get_node(node, RIGHT);
+                }
+            }
+            found = c_invalid_node;
+            return false;
+        }
+
         iterator_t iterate(tree_t& tree, node_t root)
         {
             iterator_t iter(tree, root);
@@ -504,6 +663,31 @@ namespace ncore
             return true;
         }
 
+        void iterator_t::seek(tree_t const& tree, index_t key, compare_fn comparer, void const* user_data, s32 dir, bool inclusive)
+        {
+            // Push the nodes on the search path that 'sortorder' still has to visit, the top of the stack
+            // is the bound and the rest are its successors along the path (at most the height of the tree).
+            m_stack = 0;
+            m_it    = c_invalid_node;
+
+            node_t node = m_root;
+            while (node != c_invalid_node)
+            {
+                s8 c = comparer(key, node, user_data);
+                if (c == 0)
+                    c = (inclusive == (dir == LEFT)) ? -1 : 1;
+                if (tree_t::getdir(c) == dir)
+                {
+                    m_stack_array[m_stack++] = node;
+                    node                     = tree.get_node(node, dir);
+                }
+                else
+                {
+                    node = tree.get_node(node, 1 - dir);
+                }
+            }
+        }
+
         bool iterator_t::postorder(tree_t& tree, s32 dir, node_t& out_node)
         {
             if (m_stack == -1)
@@ -542,11 +726,12 @@ namespace ncore
             return true;
         }
 
-        void setup_tree(tree_t& c, nnode_t* nodes)
+        void setup_tree(tree_t& c, nnode_t* nodes, u32* sizes)
         {
             c.m_free_index = 0;
             c.m_free_head  = c_invalid_index;
             c.m_nodes      = nodes;
+            c.m_sizes      = sizes;
         }
 
         void teardown_tree(tree_t& c)
@@ -554,6 +739,7 @@ namespace ncore
             c.m_free_index = 0;
             c.m_free_head  = c_invalid_index;
             c.m_nodes      = nullptr;
+            c.m_sizes      = nullptr;
         }
 
     }  // namespace ntree32
@@ -4,6 +4,7 @@
 #include "ccore/c_limits.h"
 #include "cbase/c_context.h"
 #include "ccore/c_arena.h"
+#include "cbase/c_integer.h"
 
 namespace ncore
 {
@@ -11,7 +12,14 @@ namespace ncore
     {
         arena_t* g_alloc_vmem_arena(s32 reserved, s32 committed, s32 item_size)
         {
-            arena_t* a = narena::new_arena((int_t)reserved * item_size, (int_t)committed * item_size);
+            int_t reserve = (int_t)reserved * item_size;
+            bool  huge    = g_get_huge_pages() && reserve >= (2 * cMB);
+            if (huge)
+                reserve = math::alignUp(reserve, (u32)(2 * cMB)) + (2 * cMB);  // the 2 MB aligned part covers 'reserved' items
+
+            arena_t* a = narena::new_arena(reserve, (int_t)committed * item_size);
+            if (huge)
+                g_advise_huge_pages(a);
             return a;
         }
 
@@ -1,46 +1,17 @@
 #include "ccore/c_target.h"
 #include "cbase/c_allocator.h"
 #include "ccore/c_debug.h"
+#include "cbase/c_buffer.h"
 #include "cbase/c_hash.h"
 #include "cbase/c_memory.h"
 #include "ccore/c_random.h"
 #include "cbase/c_wyhash.h"
+#include "cbase/private/c_wyhash_inline.h"
 
 namespace ncore
 {
     namespace nhash
     {
-// protections that produce different results:
-// 1: normal valid behavior
-// 2: extra protection against entropy loss (probability=2^-63), aka. "blind multiplication"
-#define WYHASH_PROTECTION 1
-
-        // 128bit multiply function
-        static inline u64 _wyrot(u64 x) { return (x >> 32) | (x << 32); }
-
-        static inline void _wymum(u64* A, u64* B)
-        {
-            u64 ha = *A >> 32, hb = *B >> 32, la = (u32)*A, lb = (u32)*B, hi, lo;
-            u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
-            lo = t + (rm1 << 32);
-            c += lo < t;
-            hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
-#    if (WYHASH_PROTECTION > 1)
-            *A ^= lo;
-            *B ^= hi;
-#    else
-            *A = lo;
-            *B = hi;
-#    endif
-        }
-
-        // multiply and xor mix function, aka MUM
-        static inline u64 _wymix(u64 A, u64 B)
-        {
-            _wymum(&A, &B);
-            return A ^ B;
-        }
-
 // read functions
 #ifdef D_LITTLE_ENDIAN
         static inline u64 _wyr8(const u8* p)
@@ -74,43 +45,42 @@ namespace ncore
 #define _likely_(a)   (a)
 #define _unlikely_(a) (a)
 
-        // wyhash main function
-        static inline u64 wyhash(const void* key, uint_t len, u64 seed, const u64* secret)
+        // the two words that wyhash reads from a key of at most 16 bytes
+        static inline void _wyread16(const u8* p, uint_t len, u64& a, u64& b)
+        {
+            if (_likely_(len >= 4))
+            {
+                a = (_wyr4(p) << 32) | _wyr4(p + ((len >> 3) << 2));
+                b = (_wyr4(p + len - 4) << 32) | _wyr4(p + len - 4 - ((len >> 3) << 2));
+            }
+            else if (_likely_(len > 0))
+            {
+                a = _wyr3(p, len);
+                b = 0;
+            }
+            else
+                a = b = 0;
+        }
+
+        // one 48 byte block of the loop over long keys
+        static inline void _wyblock(const u8* p, u64& seed, u64& see1, u64& see2, const u64* secret)
+        {
+            seed = _wymix(_wyr8(p) ^ secret[1], _wyr8(p + 8) ^ seed);
+            see1 = _wymix(_wyr8(p + 16) ^ secret[2], _wyr8(p + 24) ^ see1);
+            see2 = _wymix(_wyr8(p + 32) ^ secret[3], _wyr8(p + 40) ^ see2);
+        }
+
+        // the last 'i' (at most 48) bytes at 'p' of a key of 'len' bytes, when len > 16 the 16 bytes before
+        // 'p' are read as well when i < 16 (they are the end of the last block)
+        static inline u64 _wytail(const u8* p, uint_t i, uint_t len, u64 seed, const u64* secret)
         {
-            const u8* p = (const u8*)key;
-            seed ^= *secret;
             u64 a, b;
             if (_likely_(len <= 16))
             {
-                if (_likely_(len >= 4))
-                {
-                    a = (_wyr4(p) << 32) | _wyr4(p + ((len >> 3) << 2));
-                    b = (_wyr4(p + len - 4) << 32) | _wyr4(p + len - 4 - ((len >> 3) << 2));
-                }
-                else if (_likely_(len > 0))
-                {
-                    a = _wyr3(p, len);
-                    b = 0;
-                }
-                else
-                    a = b = 0;
+                _wyread16(p, len, a, b);
             }
             else
             {
-                uint_t i = len;
-                if (_unlikely_(i > 48))
-                {
-                    u64 see1 = seed, see2 = seed;
-                    do
-                    {
-                        seed = _wymix(_wyr8(p) ^ secret[1], _wyr8(p + 8) ^ seed);
-                        see1 = _wymix(_wyr8(p + 16) ^ secret[2], _wyr8(p + 24) ^ see1);
-                        see2 = _wymix(_wyr8(p + 32) ^ secret[3], _wyr8(p + 40) ^ see2);
-                        p += 48;
-                        i -= 48;
-                    } while (_likely_(i > 48));
-                    seed ^= see1 ^ see2;
-                }
                 while (_unlikely_(i > 16))
                 {
                     seed = _wymix(_wyr8(p) ^ secret[1], _wyr8(p + 8) ^ seed);
@@ -123,8 +93,28 @@ namespace ncore
             return _wymix(secret[1] ^ len, _wymix(a ^ secret[1], b ^ seed));
         }
 
+        // wyhash main function
+        static inline u64 wyhash(const void* key, uint_t len, u64 seed, const u64* secret)
+        {
+            const u8* p = (const u8*)key;
+            seed ^= *secret;
+            uint_t i = len;
+            if (_unlikely_(i > 48))
+            {
+                u64 see1 = seed, see2 = seed;
+                do
+                {
+                    _wyblock(p, seed, see1, see2, secret);
+                    p += 48;
+                    i -= 48;
+                } while (_likely_(i > 48));
+                seed ^= see1 ^ see2;
+            }
+            return _wytail(p, i, len, seed, secret);
+        }
+
         // the default secret parameters
-        // static const u64 _wyp[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
+        const u64 g_wysecret[4] = {0xa0761d6478bd642full, 0xe7037ed1a0b428dbull, 0x8ebc6af09c88c6e3ull, 0x589965cc75374cc3ull};
 
         // a useful 64bit-64bit mix function to produce deterministic pseudo random numbers that can pass BigCrush and PractRand
         //         static inline u64 wyhash64(u64 A, u64 B)
@@ -181,7 +171,7 @@ namespace ncore
         }
 
         // make your own secret
-        static inline void wymake_secret(u64 seed, u64* secret)
+        void wymake_secret(u64 seed, u64* secret)
         {
             u8 c[] = {15,  23,  27,  29,  30,  39,  43,  45,  46,  51,  53,  54,  57,  58,  60,  71,  75,  77,  78,  83,  85,  86,  89,  90,  92,  99,  101, 102, 105, 106, 108, 113, 114, 116, 120,
                       135, 139, 141, 142, 147, 149, 150, 153, 154, 156, 163, 165, 166, 169, 170, 172, 177, 178, 180, 184, 195, 197, 198, 201, 202, 204, 209, 210, 212, 216, 225, 226, 228, 232, 240};
@@ -270,6 +260,30 @@ namespace ncore
         }
         */
 
+        // Looks for signature 'sig' from slot 'i0' on, inserts it in the first free slot when 'insert' is set.
+        // Returns the slot or 'idx_size' when the signature is not there (or the index is full).
+        static inline s32 wyprobe(u64* idx, s32 idx_size, u64 sig, u64 i0, u8 insert)
+        {
+            u64 i;
+            for (i = i0; i < (u64)idx_size && idx[i] && idx[i] != sig; i++) {}
+
+            if (_unlikely_(i == (u64)idx_size))
+            {
+                for (i = 0; i < i0 && idx[i] && idx[i] != sig; i++)
+                    ;
+                if (i == i0)
+                    return idx_size;
+            }
+            if (!idx[i])
+            {
+                if (insert)
+                    idx[i] = sig;
+                else
+                    return idx_size;
+            }
+            return (s32)i;
+        }
+
         static inline s32 wyhashmap(u64* idx, s32 idx_size, const void* key, s32 key_size, u8 insert, u64 const* secret)
         {
             u64 i = 1;
@@ -286,23 +300,21 @@ namespace ncore
 #else
             u64 i0 = wy2u0k(wyhash(key, (u32)key_size, 0, secret), (u64)idx_size);
 #endif
-            for (i = i0; i < (u64)idx_size && idx[i] && idx[i] != sig; i++) {}
+            return wyprobe(idx, idx_size, sig, i0, insert);
+        }
 
-            if (_unlikely_(i == (u64)idx_size))
-            {
-                for (i = 0; i < i0 && idx[i] && idx[i] != sig; i++)
-                    ;
-                if (i == i0)
-                    return idx_size;
-            }
-            if (!idx[i])
+        // The signatures and home slots of 'n' keys, the home slots are prefetched
+        static void s_wyhashmap_many(u64 const* idx, s32 idx_size, void const* const* keys, s32 const* key_sizes, s32 n, u64 const* secret, u64* sig, u64* home)
+        {
+            wyhash_batch(keys, key_sizes, n, 1, secret, sig);
+            wyhash_batch(keys, key_sizes, n, 0, secret, home);
+            for (s32 j = 0; j < n; ++j)
             {
-                if (insert)
-                    idx[i] = sig;
-                else
-                    return idx_size;
+                for (u64 seed = 2; _unlikely_(sig[j] == 0); ++seed)
+                    sig[j] = wyhash(keys[j], (uint_t)key_sizes[j], seed, secret);
+                home[j] = wy2u0k(home[j], (u64)idx_size);
+                nmem::prefetch(idx + home[j]);
             }
-            return (s32)i;
         }
 
         registry_t::registry_t()
@@ -353,6 +365,44 @@ namespace ncore
             return pos < m_size;
         }
 
+        s32 registry_t::insert_many(void const* const* keys, s32 const* keysizes, s32 count, s32* pos)
+        {
+            u64 sig[c_batch_size], home[c_batch_size];
+            s32 num = 0;
+            for (s32 i = 0; i < count; i += c_batch_size)
+            {
+                s32 const n = (count - i) < c_batch_size ? (count - i) : c_batch_size;
+                s_wyhashmap_many(m_index, m_size, keys + i, keysizes + i, n, m_secret, sig, home);
+                for (s32 j = 0; j < n; ++j)
+                {
+                    pos[i + j] = wyprobe(m_index, m_size, sig[j], home[j], 1);
+                    if (pos[i + j] < m_size)
+                    {
+                        m_count++;
+                        num++;
+                    }
+                }
+            }
+            return num;
+        }
+
+        s32 registry_t::find_many(void const* const* keys, s32 const* keysizes, s32 count, s32* pos) const
+        {
+            u64 sig[c_batch_size], home[c_batch_size];
+            s32 num = 0;
+            for (s32 i = 0; i < count; i += c_batch_size)
+            {
+                s32 const n = (count - i) < c_batch_size ? (count - i) : c_batch_size;
+                s_wyhashmap_many(m_index, m_size, keys + i, keysizes + i, n, m_secret, sig, home);
+                for (s32 j = 0; j < n; ++j)
+                {
+                    pos[i + j] = wyprobe(m_index, m_size, sig[j], home[j], 0);
+                    num += (pos[i + j] < m_size) ? 1 : 0;
+                }
+            }
+            return num;
+        }
+
         bool registry_t::remove(void* key, s32 keysize, s32& pos)
         {
             pos = wyhashmap(m_index, m_size, key, keysize, 0, m_secret);
@@ -367,5 +417,467 @@ namespace ncore
             }
             return false;
         }
+
+        u64 wyhash_bytes(void const* key, s32 size, u64 seed, u64 const* secret) { return wyhash(key, (uint_t)size, seed, secret); }
+
+        // ----------------------------------------------------------------------------------------
+        // wyhash_batch
+        // ----------------------------------------------------------------------------------------
+        // The hash of a short key is two dependent 64x64->128 multiplies, the keys of a batch are
+        // independent so the multiplies of 'c_wylanes' keys are issued together and overlap in the
+        // pipeline. Keys longer than 16 bytes are hashed one by one, their loop dominates anyway.
+
+        const s32 c_wylanes = 4;
+
+        void wyhash_batch(void const* const* keys, s32 const* lens, s32 n, u64 seed, u64 const* secret, u64* out)
+        {
+            u64 const s = seed ^ secret[0];
+            s32       i = 0;
+            while (i < n)
+            {
+                u64 a[c_wylanes], b[c_wylanes];
+                s32 lane[c_wylanes];
+                s32 lanes = 0;
+                for (; i < n && lanes < c_wylanes; ++i)
+                {
+                    if (lens[i] > 16)
+                    {
+                        out[i] = wyhash(keys[i], (uint_t)lens[i], seed, secret);
+                        continue;
+                    }
+                    _wyread16((const u8*)keys[i], (uint_t)lens[i], a[lanes], b[lanes]);
+                    lane[lanes++] = i;
+                }
+                for (s32 l = 0; l < lanes; ++l)
+                    a[l] = _wymix(a[l] ^ secret[1], b[l] ^ s);
+                for (s32 l = 0; l < lanes; ++l)
+                    out[lane[l]] = _wymix(secret[1] ^ (u64)lens[lane[l]], a[l]);
+            }
+        }
+
+        template <uint_t N>
+        static void s_wyhash_batch_fixed(const u8* p, s32 n, u64 seed, u64 const* secret, u64* out)
+        {
+            u64 const s = seed ^ secret[0];
+            s32       i = 0;
+            for (; (i + c_wylanes) <= n; i += c_wylanes, p += c_wylanes * N)
+            {
+                u64 a[c_wylanes], b[c_wylanes];
+                for (s32 l = 0; l < c_wylanes; ++l)
+                    _wyread16(p + l * N, N, a[l], b[l]);
+                for (s32 l = 0; l < c_wylanes; ++l)
+                    a[l] = _wymix(a[l] ^ secret[1], b[l] ^ s);
+                for (s32 l = 0; l < c_wylanes; ++l)
+                    out[i + l] = _wymix(secret[1] ^ N, a[l]);
+            }
+            for (; i < n; ++i, p += N)
+                out[i] = wyhash(p, N, seed, secret);
+        }
+
+        void wyhash_batch(void const* keys, s32 key_size, s32 n, u64 seed, u64 const* secret, u64* out)
+        {
+            u8 const* p = (u8 const*)keys;
+            switch (key_size)
+            {
+                case 4: s_wyhash_batch_fixed<4>(p, n, seed, secret, out); return;
+                case 8: s_wyhash_batch_fixed<8>(p, n, seed, secret, out); return;
+                case 16: s_wyhash_batch_fixed<16>(p, n, seed, secret, out); return;
+            }
+
+            if (key_size > 16)
+            {
+                for (s32 i = 0; i < n; ++i)
+                    out[i] = wyhash(p + (uint_t)i * (uint_t)key_size, (uint_t)key_size, seed, secret);
+                return;
+            }
+
+            u64 const s = seed ^ secret[0];
+            s32       i = 0;
+            for (; (i + c_wylanes) <= n; i += c_wylanes, p += c_wylanes * key_size)
+            {
+                u64 a[c_wylanes], b[c_wylanes];
+                for (s32 l = 0; l < c_wylanes; ++l)
+                    _wyread16(p + l * key_size, (uint_t)key_size, a[l], b[l]);
+                for (s32 l = 0; l < c_wylanes; ++l)
+                    a[l] = _wymix(a[l] ^ secret[1], b[l] ^ s);
+                for (s32 l = 0; l < c_wylanes; ++l)
+                    out[i + l] = _wymix(secret[1] ^ (u64)key_size, a[l]);
+            }
+            for (; i < n; ++i, p += key_size)
+                out[i] = wyhash(p, (uint_t)key_size, seed, secret);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // wyhasher_t, hash_many
+        // ----------------------------------------------------------------------------------------
+        // The stream is cut in the same 48 byte blocks as the one-shot wyhash, a block is only
+        // consumed when more bytes follow it. 'm_buffer' holds the last 16 bytes of the previous
+        // block followed by the (at most 48) pending bytes.
+
+        wyhasher_t::wyhasher_t(u64 seed)
+            : m_seed(seed)
+        {
+            begin();
+        }
+
+        void wyhasher_t::reset() { begin(); }
+
+        void wyhasher_t::begin()
+        {
+            m_state[0] = m_state[1] = m_state[2] = m_seed ^ g_wysecret[0];
+            m_length                             = 0;
+            m_pending                            = 0;
+        }
+
+        void wyhasher_t::hash(const u8* begin, const u8* end)
+        {
+            uint_t n = (uint_t)(end - begin);
+            m_length += n;
+            if ((m_pending + n) <= 48)
+            {
+                g_memcpy(m_buffer + 16 + m_pending, begin, (int_t)n);
+                m_pending += n;
+                return;
+            }
+
+            // There are more than 48 bytes, complete and consume the pending block first
+            const u8* p = begin;
+            if (m_pending > 0)
+            {
+                uint_t const take = 48 - m_pending;
+                g_memcpy(m_buffer + 16 + m_pending, p, (int_t)take);
+                p += take;
+                n -= take;
+                _wyblock(m_buffer + 16, m_state[0], m_state[1], m_state[2], g_wysecret);
+                g_memcpy(m_buffer, m_buffer + 48, 16);
+            }
+            if (n > 48)
+            {
+                do
+                {
+                    _wyblock(p, m_state[0], m_state[1], m_state[2], g_wysecret);
+                    p += 48;
+                    n -= 48;
+                } while (n > 48);
+                g_memcpy(m_buffer, p - 16, 16);
+            }
+            g_memcpy(m_buffer + 16, p, (int_t)n);
+            m_pending = n;
+        }
+
+        u64 wyhasher_t::digest() const
+        {
+            u64 seed = m_state[0];
+            if (m_length > 48)
+                seed ^= m_state[1] ^ m_state[2];
+            return _wytail(m_buffer + 16, (uint_t)m_pending, (uint_t)m_length, seed, g_wysecret);
+        }
+
+        void wyhasher_t::end(u8* out_hash, s32 size)
+        {
+            u64 const h = digest();
+            for (s32 i = 0; i < size && i < 8; ++i)
+                out_hash[i] = (u8)(h >> (i * 8));
+        }
+
+        // The block loops of two buffers run in lockstep while both have blocks left, the state of
+        // both lanes stays in registers (more lanes spill on x64 and end up slower).
+        void hash_many(cbuffer_t const* buffers, s32 n, u64* out, u64 seed)
+        {
+            u64 const* secret = g_wysecret;
+            s32        i      = 0;
+            for (; (i + 2) <= n; i += 2)
+            {
+                const u8*    pa = buffers[i].m_begin;
+                const u8*    pb = buffers[i + 1].m_begin;
+                uint_t const la = (uint_t)buffers[i].size();
+                uint_t const lb = (uint_t)buffers[i + 1].size();
+                uint_t       ra = la;
+                uint_t       rb = lb;
+                u64          a0 = seed ^ secret[0], a1 = a0, a2 = a0;
+                u64          b0 = a0, b1 = a0, b2 = a0;
+                while (ra > 48 && rb > 48)
+                {
+                    _wyblock(pa, a0, a1, a2, secret);
+                    _wyblock(pb, b0, b1, b2, secret);
+                    pa += 48;
+                    pb += 48;
+                    ra -= 48;
+                    rb -= 48;
+                }
+                for (; ra > 48; pa += 48, ra -= 48)
+                    _wyblock(pa, a0, a1, a2, secret);
+                for (; rb > 48; pb += 48, rb -= 48)
+                    _wyblock(pb, b0, b1, b2, secret);
+                out[i]     = _wytail(pa, ra, la, la > 48 ? a0 ^ a1 ^ a2 : a0, secret);
+                out[i + 1] = _wytail(pb, rb, lb, lb > 48 ? b0 ^ b1 ^ b2 : b0, secret);
+            }
+            for (; i < n; ++i)
+                out[i] = wyhash(buffers[i].m_begin, (uint_t)buffers[i].size(), seed, secret);
+        }
+
+        // ----------------------------------------------------------------------------------------
+        // table_t
+        // ----------------------------------------------------------------------------------------
+
+        const u64 c_slot_empty   = 0;
+        const u64 c_slot_removed = 1;
+        const u32 c_min_slots    = 16;
+        const u32 c_migrate_step = 32;  // old slots moved per insert/remove, a rehash ends long before the new table fills up
+
+        static inline u8*  s_item(table_t::array_t const& a, u32 slot, s32 item_size) { return a.m_items + (uint_t)slot * (uint_t)item_size; }
+        static inline bool s_max_load(u32 slots, s32 count) { return (u32)count > ((slots >> 2) * 3); }
+
+        static inline bool s_same_key(u8 const* a, u8 const* b, s32 size)
+        {
+            for (s32 i = 0; i < size; ++i)
+            {
+                if (a[i] != b[i])
+                    return false;
+            }
+            return true;
+        }
+
+        // Returns the slot holding 'key' or -1, there is always an empty slot to end the probe sequence
+        static s32 s_find_slot(table_t::array_t const& a, u64 hash, void const* key, s32 key_size, s32 item_size)
+        {
+            u32 slot = (u32)hash & a.m_mask;
+            while (true)
+            {
+                u64 const h = a.m_hashes[slot];
+                if (h == c_slot_empty)
+                    return -1;
+                if (h == hash && s_same_key(s_item(a, slot, item_size), (u8 const*)key, key_size))
+                    return (s32)slot;
+                slot = (slot + 1) & a.m_mask;
+            }
+        }
+
+        static u32 s_empty_slot(table_t::array_t const& a, u64 hash)
+        {
+            u32 slot = (u32)hash & a.m_mask;
+            while (a.m_hashes[slot] != c_slot_empty)
+                slot = (slot + 1) & a.m_mask;
+            return slot;
+        }
+
+        table_t::table_t()
+            : m_allocator(nullptr)
+            , m_cursor(0)
+            , m_item_size(0)
+            , m_item_align(0)
+            , m_key_size(0)
+        {
+            m_cur.m_hashes = m_old.m_hashes = nullptr;
+            m_cur.m_items = m_old.m_items = nullptr;
+            m_cur.m_mask = m_old.m_mask = 0;
+            m_cur.m_count = m_old.m_count = 0;
+            m_secret[0] = m_secret[1] = m_secret[2] = m_secret[3] = 0;
+        }
+
+        table_t::~table_t() { release(); }
+
+        void table_t::init(alloc_t* allocator, s32 item_size, s32 item_align, s32 key_size, s32 capacity, u64 seed)
+        {
+            ASSERT(key_size > 0 && key_size <= item_size);
+            release();
+            m_allocator  = allocator;
+            m_item_size  = item_size;
+            m_item_align = item_align;
+            m_key_size   = key_size;
+            wymake_secret(seed, m_secret);
+
+            // Enough slots for 'capacity' items at the maximum load
+            u32 slots = c_min_slots;
+            while (s_max_load(slots, capacity))
+                slots <<= 1;
+            alloc_array(m_cur, slots);
+        }
+
+        void table_t::release()
+        {
+            free_array(m_cur);
+            free_array(m_old);
+            m_cursor = 0;
+        }
+
+        u64 table_t::hash(void const* key) const
+        {
+            u64 const h = wyhash(key, (uint_t)m_key_size, 0, m_secret);
+            return h > c_slot_removed ? h : h + 2;
+        }
+
+        bool table_t::alloc_array(array_t& a, u32 slots)
+        {
+            a.m_hashes = (u64*)m_allocator->allocate((u32)sizeof(u64) * slots);
+            a.m_items  = (u8*)m_allocator->allocate((u32)m_item_size * slots, (u32)m_item_align);
+            a.m_mask   = slots - 1;
+            a.m_count  = 0;
+            if (a.m_hashes == nullptr || a.m_items == nullptr)
+            {
+                free_array(a);
+                return false;
+            }
+            g_memset(a.m_hashes, 0, (int_t)sizeof(u64) * slots);
+            return true;
+        }
+
+        void table_t::free_array(array_t& a)
+        {
+            if (a.m_hashes != nullptr)
+                m_allocator->deallocate(a.m_hashes);
+            if (a.m_items != nullptr)
+                m_allocator->deallocate(a.m_items);
+            a.m_hashes = nullptr;
+            a.m_items  = nullptr;
+            a.m_mask   = 0;
+            a.m_count  = 0;
+        }
+
+        // Moves the items of the next 'slots' slots of the old table, the moved items stay in the old
+        // table to keep its probe sequences intact, lookups ignore the slots below the cursor.
+        void table_t::migrate(u32 slots)
+        {
+            if (m_old.m_hashes == nullptr)
+                return;
+            u32 const end = (m_old.m_mask - m_cursor) < slots ? m_old.m_mask + 1 : m_cursor + slots;
+            for (; m_cursor < end; ++m_cursor)
+            {
+                u64 const h = m_old.m_hashes[m_cursor];
+                if (h <= c_slot_removed)
+                    continue;
+                u32 const slot       = s_empty_slot(m_cur, h);
+                m_cur.m_hashes[slot] = h;
+                g_memcpy(s_item(m_cur, slot, m_item_size), s_item(m_old, m_cursor, m_item_size), m_item_size);
+                m_cur.m_count += 1;
+                m_old.m_count -= 1;
+            }
+            if (m_cursor > m_old.m_mask)
+            {
+                free_array(m_old);
+                m_cursor = 0;
+            }
+        }
+
+        void table_t::grow()
+        {
+            // A rehash that is still running is finished first, this only happens with a very high remove rate
+            migrate(m_old.m_mask + 1);
+
+            array_t larger;
+            if (!alloc_array(larger, (m_cur.m_mask + 1) << 1))
+                return;
+            m_old    = m_cur;
+            m_cur    = larger;
+            m_cursor = 0;
+        }
+
+        void table_t::hash_many(void const* keys, s32 count, u64* hashes) const
+        {
+            wyhash_batch(keys, m_key_size, count, 0, m_secret, hashes);
+            for (s32 i = 0; i < count; ++i)
+                hashes[i] = hashes[i] > c_slot_removed ? hashes[i] : hashes[i] + 2;
+        }
+
+        void table_t::prefetch(u64 hash) const
+        {
+            u32 const slot = (u32)hash & m_cur.m_mask;
+            nmem::prefetch(m_cur.m_hashes + slot);
+            nmem::prefetch(s_item(m_cur, slot, m_item_size));
+        }
+
+        void* table_t::insert(void const* key, bool& inserted) { return insert(key, hash(key), inserted); }
+
+        void* table_t::insert(void const* key, u64 h, bool& inserted)
+        {
+            inserted = false;
+            migrate(c_migrate_step);
+
+            s32 slot = s_find_slot(m_cur, h, key, m_key_size, m_item_size);
+            if (slot >= 0)
+                return s_item(m_cur, (u32)slot, m_item_size);
+            if (m_old.m_hashes != nullptr)
+            {
+                slot = s_find_slot(m_old, h, key, m_key_size, m_item_size);
+                if (slot >= (s32)m_cursor)
+                    return s_item(m_old, (u32)slot, m_item_size);
+            }
+
+            if (s_max_load(m_cur.m_mask + 1, count() + 1))
+            {
+                grow();
+                if (s_max_load(m_cur.m_mask + 1, count() + 1))
+                    return nullptr;  // out of memory
+            }
+
+            u32 const empty       = s_empty_slot(m_cur, h);
+            m_cur.m_hashes[empty] = h;
+            u8* item              = s_item(m_cur, empty, m_item_size);
+            g_memcpy(item, key, m_key_size);
+            m_cur.m_count += 1;
+            inserted = true;
+            return item;
+        }
+
+        void* table_t::find(void const* key) const { return find(key, hash(key)); }
+
+        void* table_t::find(void const* key, u64 h) const
+        {
+            s32 slot = s_find_slot(m_cur, h, key, m_key_size, m_item_size);
+            if (slot >= 0)
+                return s_item(m_cur, (u32)slot, m_item_size);
+            if (m_old.m_hashes != nullptr)
+            {
+                slot = s_find_slot(m_old, h, key, m_key_size, m_item_size);
+                if (slot >= (s32)m_cursor)
+                    return s_item(m_old, (u32)slot, m_item_size);
+            }
+            return nullptr;
+        }
+
+        bool table_t::remove(void const* key) { return remove(key, hash(key)); }
+
+        bool table_t::remove(void const* key, u64 h)
+        {
+            migrate(c_migrate_step);
+
+            s32 slot = s_find_slot(m_cur, h, key, m_key_size, m_item_size);
+            if (slot >= 0)
+            {
+                // Backward shift deletion, pull back the items that can move closer to their home slot
+                u32 hole = (u32)slot;
+                u32 next = hole;
+                while (true)
+                {
+                    next         = (next + 1) & m_cur.m_mask;
+                    u64 const nh = m_cur.m_hashes[next];
+                    if (nh == c_slot_empty)
+                        break;
+                    u32 const home = (u32)nh & m_cur.m_mask;
+                    if (((next - home) & m_cur.m_mask) >= ((next - hole) & m_cur.m_mask))
+                    {
+                        m_cur.m_hashes[hole] = nh;
+                        g_memcpy(s_item(m_cur, hole, m_item_size), s_item(m_cur, next, m_item_size), m_item_size);
+                        hole = next;
+                    }
+                }
+                m_cur.m_hashes[hole] = c_slot_empty;
+                m_cur.m_count -= 1;
+                return true;
+            }
+
+            if (m_old.m_hashes != nullptr)
+            {
+                // The old table is never shifted (the cursor would miss items), mark the slot as removed
+                slot = s_find_slot(m_old, h, key, m_key_size, m_item_size);
+                if (slot >= (s32)m_cursor)
+                {
+                    m_old.m_hashes[slot] = c_slot_removed;
+                    m_old.m_count -= 1;
+                    return true;
+                }
+            }
+            return false;
+        }
     }  // namespace nhash
 }  // namespace ncore
@@ -10,11 +10,22 @@
 namespace ncore
 {
     class alloc_t;
+    struct arena_t;
 
     void     g_init_system_alloc();
     void     g_exit_system_alloc();
     alloc_t* g_get_system_alloc();
 
+    // Transparent huge pages (Linux only, opt-in, default off)
+    // When enabled, the system arena and vector_t arenas (reservations of at least 2 MB) are rounded
+    // up to 2 MB and the 2 MB aligned part of the reservation is advised to be backed by huge pages.
+    // Enable it before 'g_init_system_alloc' to include the system arena.
+    void  g_set_huge_pages(bool enable);
+    bool  g_get_huge_pages();
+    bool  g_advise_huge_pages(arena_t* arena);     // returns true when the kernel accepted the advice
+    int_t g_huge_pages_resident(arena_t* arena);  // number of bytes of the arena that are backed by huge pages
+    int_t g_huge_pages_advised();                 // total number of bytes that have been advised
+
     void* g_malloc(u32 size, u32 align = sizeof(void*));
     void  g_free(void* ptr);
 
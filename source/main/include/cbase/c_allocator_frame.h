@@ -0,0 +1,73 @@
+#ifndef __CBASE_ALLOCATOR_FRAME_H__
+#define __CBASE_ALLOCATOR_FRAME_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+
+namespace ncore
+{
+    struct arena_t;
+
+    // Frame allocator, N rotating bump regions (double/triple buffering).
+    // Every call to 'begin_frame' moves to the next region and resets it in O(1), memory
+    // allocated in a frame stays valid until the same region is used again, that is for
+    // 'num_frames - 1' more frames. Deallocate is a no-op.
+    // Each region tracks the high-water mark of the frames it has served, so that the
+    // regions can be sized.
+    class frame_alloc_t : public alloc_t
+    {
+    public:
+        enum
+        {
+            c_max_frames = 4
+        };
+
+        struct stats_t
+        {
+            int_t m_used;        // bytes allocated in the frame that this region is serving (or served last)
+            int_t m_high_water;  // the largest number of bytes allocated in any frame served by this region
+            u32   m_frame;       // the frame number this region is serving (or served last)
+        };
+
+        frame_alloc_t();
+        ~frame_alloc_t();
+
+        void init(s32 num_frames, int_t frame_size);
+        void exit();
+
+        u32  begin_frame();  // Rotates to the next region, returns the frame number (lifetime tag)
+        void end_frame();    // Records the high-water mark of the current frame
+        u32  frame() const { return m_frame; }
+        s32  num_frames() const { return m_num_frames; }
+        bool is_alive(u32 frame_tag) const { return (m_frame - frame_tag) < (u32)m_num_frames; }
+
+        void stats(s32 frame_index, stats_t& stats) const;
+
+        struct region_t
+        {
+            arena_t* m_arena;
+            int_t    m_base;        // offset of the first allocation
+            int_t    m_top;         // offset of the end of the last allocation
+            int_t    m_committed;   //
+            int_t    m_reserved;    //
+            int_t    m_used;        //
+            int_t    m_high_water;  //
+            u32      m_frame;       //
+        };
+
+        region_t  m_regions[c_max_frames];
+        region_t* m_current;
+        s32       m_num_frames;
+        u32       m_frame;
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual void  v_deallocate(void* ptr);
+    };
+
+};  // namespace ncore
+
+#endif  // __CBASE_ALLOCATOR_FRAME_H__
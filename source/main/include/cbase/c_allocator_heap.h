@@ -0,0 +1,48 @@
+#ifndef __CBASE_ALLOCATOR_HEAP_H__
+#define __CBASE_ALLOCATOR_HEAP_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+
+namespace ncore
+{
+    struct heap_t;
+
+    // General purpose heap allocator.
+    // Allocations are served from size-class segregated slabs (64 KB) that are carved from a
+    // virtual memory arena owned by the heap. A heap is owned by a single thread, so the
+    // allocation and local deallocation paths do not take any lock.
+    // Memory that is freed by another thread is pushed (lock-free) onto a remote-free queue
+    // of the owning heap, the owner returns those blocks to their slabs when it runs out
+    // of free blocks in a size class or when 'collect()' is called.
+    // Allocations larger than the biggest size class get their own arena.
+    // Destroying a heap while some of its blocks are still in use (e.g. by another thread) does not
+    // unmap it, the heap becomes an orphan that is released when all its blocks have been freed or
+    // that is adopted by the next g_create_heap_alloc.
+    class heap_alloc_t : public alloc_t
+    {
+    public:
+        heap_alloc_t()
+            : m_heap(nullptr)
+        {
+        }
+
+        void collect();  // Return blocks freed by other threads to their slabs
+
+        heap_t* m_heap;
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual void  v_deallocate(void* ptr);
+    };
+
+    heap_alloc_t* g_create_heap_alloc(int_t reserve_size = 1 * cGB);
+    void          g_destroy_heap_alloc(heap_alloc_t*& heap);
+    s32           g_collect_orphan_heaps();  // Releases orphans without live blocks, returns the number of orphans left
+
+};  // namespace ncore
+
+#endif  // __CBASE_ALLOCATOR_HEAP_H__
@@ -9,9 +9,59 @@
 #include "cbase/c_context.h"
 #include "ccore/c_debug.h"
 
+#include <atomic>
+
 namespace ncore
 {
-    template <typename T>
+    struct arena_t;
+
+    namespace npool
+    {
+        // Reserves virtual memory for 'reserved' items and commits 'capacity' items, 'items' receives the
+        // (stable) address of the first item.
+        arena_t* g_alloc_vmem_arena(s32 reserved, s32 capacity, s32 item_size, s32 item_alignment, void*& items);
+        void     g_free_vmem_arena(arena_t*& arena);
+        s32      g_grow_capacity(arena_t* arena, void* items, s32 capacity, s32 reserved, s32 item_size);  // returns the new capacity
+
+        // Zeroing policy of an allocated object
+        enum
+        {
+            c_zero_none = 0,  // the caller fully initializes the object
+            c_zero_wide = 1,  // the object is cleared using the widest store that its size and alignment allow
+        };
+
+        template <typename T, s32 ZeroMode>
+        inline void zero_object(T* object)
+        {
+            if (ZeroMode == c_zero_none)
+                return;
+
+            // Size and alignment are compile-time constants, only one of these loops survives
+            if ((alignof(T) % sizeof(u64)) == 0 && (sizeof(T) % sizeof(u64)) == 0)
+            {
+                u64* dst = (u64*)object;
+                for (u32 i = 0; i < (sizeof(T) / sizeof(u64)); i++)
+                    dst[i] = 0;
+            }
+            else if ((alignof(T) % sizeof(u32)) == 0 && (sizeof(T) % sizeof(u32)) == 0)
+            {
+                u32* dst = (u32*)object;
+                for (u32 i = 0; i < (sizeof(T) / sizeof(u32)); i++)
+                    dst[i] = 0;
+            }
+            else
+            {
+                byte* dst = (byte*)object;
+                for (u32 i = 0; i < sizeof(T); i++)
+                    dst[i] = 0;
+            }
+        }
+    }  // namespace npool
+
+    // Pool of objects of type T in a fixed size array, free objects are linked by index through their
+    // first 4 bytes. 'ZeroMode' (npool::c_zero_wide or npool::c_zero_none) controls if allocated
+    // objects are cleared.
+    template <typename T, s32 ZeroMode = npool::c_zero_wide>
     class fixed_pool_t
     {
     public:
@@ -29,11 +79,7 @@ namespace ncore
             m_free_head  = -1;
         }
 
-        inline void setup(alloc_t* allocator, s32 capacity)
-        {
-            m_data     = g_allocate_array_and_clear<T>(allocator, capacity);
-            m_capacity = capacity;
-        }
+        inline void setup(alloc_t* allocator, s32 capacity) { setup(g_allocate_array_and_clear<T>(allocator, capacity), capacity); }
 
         inline void teardown()
         {
@@ -75,20 +121,145 @@ namespace ncore
 
                 s32* node   = (s32*)object;
                 m_free_head = *node;  // Get the next free index
-
-                byte* byte_object = (byte*)object;
-                for (s32 i = 0; i < sizeof(T); i++)
-                    byte_object[i] = 0;
             }
             else if (m_free_index < m_capacity)
             {
                 const s32 index = m_free_index++;
                 object          = &m_data[index];
+            }
+            else
+            {
+                return nullptr;
+            }
+            npool::zero_object<T, ZeroMode>(object);
+            return object;
+        }
 
-                byte* byte_object = (byte*)object;
-                for (s32 i = 0; i < sizeof(T); i++)
-                    byte_object[i] = 0;
+        inline void deallocate(T* object)
+        {
+            ASSERT(object != nullptr);
+            s32* node   = (s32*)object;
+            *node       = m_free_head;             // Set the next free index
+            m_free_head = (s32)(object - m_data);  // Update the head to this object
+        }
+
+        // Allocates up to 'n' objects, first from the free list and then from the never used range,
+        // returns the number of objects written to 'out'.
+        s32 allocate_n(T** out, s32 n)
+        {
+            s32 count = 0;
+            while (count < n && m_free_head >= 0)
+            {
+                T* object    = &m_data[m_free_head];
+                m_free_head  = *((s32*)object);
+                out[count++] = object;
+            }
+            while (count < n && m_free_index < m_capacity)
+                out[count++] = &m_data[m_free_index++];
+
+            if (ZeroMode != npool::c_zero_none)
+            {
+                for (s32 i = 0; i < count; ++i)
+                    npool::zero_object<T, ZeroMode>(out[i]);
             }
+            return count;
+        }
+
+        // Links the objects into one segment and splices it onto the front of the free list
+        void deallocate_n(T* const* objects, s32 n)
+        {
+            if (n <= 0)
+                return;
+            for (s32 i = 0; i < (n - 1); ++i)
+                *((s32*)objects[i]) = (s32)(objects[i + 1] - m_data);
+            *((s32*)objects[n - 1]) = m_free_head;
+            m_free_head             = (s32)(objects[0] - m_data);
+        }
+    };
+
+    // Growable variant of fixed_pool_t, the objects live in a reserved virtual memory range and pages
+    // are committed on demand as the pool grows. Objects never move, so pointers and indices are stable.
+    // Size 'reserved' for the peak, only the used part is resident.
+    template <typename T, s32 ZeroMode = npool::c_zero_wide>
+    class growable_pool_t
+    {
+    public:
+        T*       m_data;
+        s32      m_capacity;  // number of committed objects
+        s32      m_reserved;  // maximum number of objects
+        s32      m_free_index;
+        s32      m_free_head;
+        arena_t* m_arena;
+
+        inline growable_pool_t()
+            : m_data(nullptr)
+            , m_capacity(0)
+            , m_reserved(0)
+            , m_free_index(0)
+            , m_free_head(-1)
+            , m_arena(nullptr)
+        {
+        }
+        inline ~growable_pool_t() { teardown(); }
+
+        inline void setup(s32 reserved, s32 capacity = 0)
+        {
+            ASSERT(m_arena == nullptr && reserved > 0 && capacity <= reserved);
+            void* items  = nullptr;
+            m_arena      = npool::g_alloc_vmem_arena(reserved, capacity, (s32)sizeof(T), (s32)alignof(T), items);
+            m_data       = (T*)items;
+            m_capacity   = capacity;
+            m_reserved   = reserved;
+            m_free_index = 0;
+            m_free_head  = -1;
+        }
+
+        inline void teardown()
+        {
+            npool::g_free_vmem_arena(m_arena);
+            m_data       = nullptr;
+            m_capacity   = 0;
+            m_reserved   = 0;
+            m_free_index = 0;
+            m_free_head  = -1;
+        }
+
+        inline s32 capacity() const { return m_capacity; }
+        inline s32 reserved() const { return m_reserved; }
+
+        inline u32 obj2idx(T const* object) const
+        {
+            ASSERT(object != nullptr);
+            return (u32)(object - m_data);
+        }
+
+        inline T* idx2obj(u32 idx) const
+        {
+            ASSERT(idx < (u32)m_free_index);
+            return &m_data[idx];
+        }
+
+        inline T* allocate()
+        {
+            T* object = nullptr;
+            if (m_free_head >= 0)
+            {
+                object      = &m_data[m_free_head];
+                m_free_head = *((s32*)object);  // Get the next free index
+            }
+            else
+            {
+                if (m_free_index == m_capacity)
+                {
+                    if (m_capacity == m_reserved)
+                        return nullptr;
+                    m_capacity = npool::g_grow_capacity(m_arena, m_data, m_capacity, m_reserved, (s32)sizeof(T));
+                    if (m_free_index == m_capacity)
+                        return nullptr;  // failed to commit
+                }
+                object = &m_data[m_free_index++];
+            }
+            npool::zero_object<T, ZeroMode>(object);
             return object;
         }
 
@@ -99,6 +270,169 @@ namespace ncore
             *node       = m_free_head;             // Set the next free index
             m_free_head = (s32)(object - m_data);  // Update the head to this object
         }
+
+        // Allocates up to 'n' objects, growing the pool when necessary, returns the number of objects
+        // written to 'out'.
+        s32 allocate_n(T** out, s32 n)
+        {
+            s32 count = 0;
+            while (count < n && m_free_head >= 0)
+            {
+                T* object    = &m_data[m_free_head];
+                m_free_head  = *((s32*)object);
+                out[count++] = object;
+            }
+            while (count < n)
+            {
+                if (m_free_index == m_capacity)
+                {
+                    if (m_capacity == m_reserved)
+                        break;
+                    m_capacity = npool::g_grow_capacity(m_arena, m_data, m_capacity, m_reserved, (s32)sizeof(T));
+                    if (m_free_index == m_capacity)
+                        break;  // failed to commit
+                }
+                while (count < n && m_free_index < m_capacity)
+                    out[count++] = &m_data[m_free_index++];
+            }
+
+            if (ZeroMode != npool::c_zero_none)
+            {
+                for (s32 i = 0; i < count; ++i)
+                    npool::zero_object<T, ZeroMode>(out[i]);
+            }
+            return count;
+        }
+
+        // Links the objects into one segment and splices it onto the front of the free list
+        void deallocate_n(T* const* objects, s32 n)
+        {
+            if (n <= 0)
+                return;
+            for (s32 i = 0; i < (n - 1); ++i)
+                *((s32*)objects[i]) = (s32)(objects[i + 1] - m_data);
+            *((s32*)objects[n - 1]) = m_free_head;
+            m_free_head             = (s32)(objects[0] - m_data);
+        }
+    };
+
+    // Lock-free variant of fixed_pool_t, multiple threads can allocate and deallocate objects
+    // concurrently. It uses the same index semantics (obj2idx/idx2obj), the free list is linked
+    // through the first 4 bytes of a free object and its head is tagged (ABA-safe).
+    template <typename T>
+    class concurrent_fixed_pool_t
+    {
+    public:
+        enum
+        {
+            c_null = 0xFFFFFFFF
+        };
+
+        T*               m_data;
+        s32              m_capacity;
+        std::atomic<s32> m_free_index;
+        std::atomic<u64> m_free_head;  // [ tag:32 | index:32 ]
+
+        concurrent_fixed_pool_t()
+            : m_data(nullptr)
+            , m_capacity(0)
+            , m_free_index(0)
+            , m_free_head(c_null)
+        {
+            static_assert(sizeof(T) >= sizeof(s32) && alignof(T) >= alignof(s32), "T must be able to hold a 32-bit link");
+        }
+
+        inline void setup(T* data, s32 capacity)
+        {
+            ASSERT(data != nullptr && capacity > 0);
+            m_data     = data;
+            m_capacity = capacity;
+            m_free_index.store(0, std::memory_order_relaxed);
+            m_free_head.store(c_null, std::memory_order_release);
+        }
+
+        inline void setup(alloc_t* allocator, s32 capacity) { setup(g_allocate_array_and_clear<T>(allocator, capacity), capacity); }
+
+        inline void teardown()
+        {
+            m_data     = nullptr;
+            m_capacity = 0;
+            m_free_index.store(0, std::memory_order_relaxed);
+            m_free_head.store(c_null, std::memory_order_release);
+        }
+
+        inline void teardown(alloc_t* allocator)
+        {
+            ASSERT(m_data != nullptr);
+            allocator->deallocate(m_data);
+            teardown();
+        }
+
+        inline u32 obj2idx(T const* object) const
+        {
+            ASSERT(object != nullptr);
+            return (u32)(object - m_data);
+        }
+
+        inline T* idx2obj(u32 idx) const
+        {
+            ASSERT(idx < (u32)m_capacity);
+            return &m_data[idx];
+        }
+
+        T* allocate()
+        {
+            T*  object = nullptr;
+            u64 head   = m_free_head.load(std::memory_order_acquire);
+            while ((u32)head != (u32)c_null)
+            {
+                // The object might be popped and reused by another thread while we read the
+                // link, in which case the tag has changed and the exchange fails.
+                u32 const index   = (u32)head;
+                u32 const next    = (u32)s_link(&m_data[index])->load(std::memory_order_relaxed);
+                u64 const newhead = (((head >> 32) + 1) << 32) | next;
+                if (m_free_head.compare_exchange_weak(head, newhead, std::memory_order_acquire, std::memory_order_acquire))
+                {
+                    object = &m_data[index];
+                    break;
+                }
+            }
+
+            if (object == nullptr)
+            {
+                s32 index = m_free_index.load(std::memory_order_relaxed);
+                while (index < m_capacity)
+                {
+                    if (m_free_index.compare_exchange_weak(index, index + 1, std::memory_order_relaxed, std::memory_order_relaxed))
+                    {
+                        object = &m_data[index];
+                        break;
+                    }
+                }
+                if (object == nullptr)
+                    return nullptr;
+            }
+
+            npool::zero_object<T, npool::c_zero_wide>(object);
+            return object;
+        }
+
+        void deallocate(T* object)
+        {
+            ASSERT(object != nullptr);
+            u32 const         index = (u32)(object - m_data);
+            std::atomic<s32>* link  = s_link(object);
+            u64               head  = m_free_head.load(std::memory_order_relaxed);
+            u64               newhead;
+            do
+            {
+                link->store((s32)(u32)head, std::memory_order_relaxed);
+                newhead = (((head >> 32) + 1) << 32) | index;
+            } while (!m_free_head.compare_exchange_weak(head, newhead, std::memory_order_release, std::memory_order_relaxed));
+        }
+
+    private:
+        static inline std::atomic<s32>* s_link(T* object) { return (std::atomic<s32>*)object; }
     };
 
 };  // namespace ncore
@@ -0,0 +1,59 @@
+#ifndef __CBASE_ALLOCATOR_SLAB_H__
+#define __CBASE_ALLOCATOR_SLAB_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+#include "cbase/c_binmap.h"
+#include "cbase/c_duomap.h"
+
+namespace ncore
+{
+    struct arena_t;
+
+    // Slab allocator for objects of a single (medium) size.
+    // The slabs live in a reserved virtual memory range and are committed when they are first used.
+    // Every slab tracks its free slots with a binmap_t, a duomap_t across the slabs tracks which slabs
+    // are full, so finding a slot is a first-free-bit search of a few levels in both. The lowest
+    // non-full slab is always used, this keeps memory compact.
+    // Unlike fixed_pool_t objects can be freed in any order without a free list running through them,
+    // unlike an arena memory is reused.
+    class slab_alloc_t : public alloc_t
+    {
+    public:
+        slab_alloc_t();
+        ~slab_alloc_t();
+
+        // 'allocator' is used for the bookkeeping (binmap levels), the slots are in virtual memory
+        void setup(alloc_t* allocator, u32 slot_size, u32 slots_per_slab, u32 max_slabs);
+        void teardown();
+
+        u32 slot_size() const { return m_slot_size; }
+        u32 slot_alignment() const { return m_slot_align; }
+        u32 num_slabs() const { return m_num_slabs; }  // number of slabs that have been committed
+        u32 num_used() const { return m_num_used; }    // number of allocated slots
+
+        alloc_t*  m_allocator;
+        arena_t*  m_arena;
+        byte*     m_base;          // address of the first slab
+        u32       m_slot_size;     //
+        u32       m_slot_align;    // the largest alignment that every slot satisfies
+        u32       m_slab_slots;    // number of slots per slab
+        u32       m_slab_size;     // size of a slab in bytes
+        u32       m_max_slabs;     //
+        u32       m_num_slabs;     // slabs [0, m_num_slabs) are committed and initialized
+        u32       m_num_used;      //
+        u32*      m_slab_used;     // number of used slots per slab
+        binmap_t* m_slab_slots_bm; // free slots per slab
+        duomap_t  m_slabs;         // a slab is 'used' when it is full
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual void  v_deallocate(void* ptr);
+    };
+
+};  // namespace ncore
+
+#endif  // __CBASE_ALLOCATOR_SLAB_H__
@@ -0,0 +1,75 @@
+#ifndef __CBASE_ALLOCATOR_STACK_H__
+#define __CBASE_ALLOCATOR_STACK_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+
+namespace ncore
+{
+    // Stack allocator, LIFO scratch memory for function/temporary life-time allocations.
+    // Memory is bumped from a fixed buffer (carved from the thread arena), a marker can be
+    // saved and restored to release everything allocated after it.
+    // Requests that do not fit in the buffer fall back to the 'fallback' allocator (heap),
+    // these are tracked and released when the marker they were allocated after is restored.
+    //
+    // Usage:
+    //     stack_alloc_t::scope_t scope(context.stack_alloc());
+    //     char* scratch = (char*)scope->allocate(1024);
+    //     ...
+    //     // everything allocated in the scope is released here
+    //
+    // Note: Memory allocated before a scope was opened should not be deallocated inside it.
+    class stack_alloc_t : public alloc_t
+    {
+    public:
+        struct marker_t
+        {
+            int_t m_top;
+            void* m_fallback;
+        };
+
+        stack_alloc_t();
+
+        void setup(void* buffer, int_t size, alloc_t* fallback);
+        void teardown();
+
+        marker_t save() const;
+        void     restore(marker_t const& marker);
+
+        int_t size() const { return m_size; }
+        int_t used() const { return m_top; }
+        int_t high_water() const { return m_high_water; }
+
+        struct scope_t
+        {
+            inline scope_t(stack_alloc_t* stack)
+                : m_stack(stack)
+                , m_marker(stack->save())
+            {
+            }
+            inline ~scope_t() { m_stack->restore(m_marker); }
+
+            inline stack_alloc_t* operator->() const { return m_stack; }
+
+            stack_alloc_t* m_stack;
+            marker_t       m_marker;
+        };
+
+        byte*    m_buffer;
+        int_t    m_size;
+        int_t    m_top;
+        int_t    m_high_water;
+        alloc_t* m_fallback_alloc;
+        void*    m_fallback;  // linked list of live fallback allocations (most recent first)
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual void  v_deallocate(void* ptr);
+    };
+
+};  // namespace ncore
+
+#endif  // __CBASE_ALLOCATOR_STACK_H__
@@ -0,0 +1,93 @@
+#ifndef __CBASE_ALLOCATOR_TRACKING_H__
+#define __CBASE_ALLOCATOR_TRACKING_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_allocator.h"
+
+#include <atomic>
+
+namespace ncore
+{
+    class console_t;
+
+    // Tracking allocator, a decorator that wraps any allocator (system, arena, heap, pool) and records
+    // per tag: the number of allocations and deallocations, allocated bytes, live bytes, peak live bytes
+    // and a size histogram. Give every instance that you want to track (a map_t, slice_t, registry_t, ..)
+    // its own tag allocator to see who is responsible for memory growth.
+    //
+    // Usage:
+    //     tracking_alloc_t tracker;
+    //     tracker.setup(context.heap_alloc());
+    //     alloc_t* names_alloc = tracker.tag("names");
+    //     ...
+    //     tracker.report(console);
+    //
+    // The counters are kept per thread (a thread only writes its own, without atomic read-modify-write)
+    // and summed by 'stats'. Live bytes of a thread are moved to a shared counter per tag once they
+    // differ by 64 KB, which is where the peak is maintained; the peak is exact for a tag that is used
+    // by one thread and can be up to 64 KB per thread too low otherwise.
+    //
+    // Note: Every allocation has a small header (16 bytes, or the alignment when it is larger), memory
+    //       must be returned to the tracker (or any of its tag allocators) and not to the source.
+    class tracking_alloc_t : public alloc_t
+    {
+    public:
+        enum
+        {
+            c_max_tags = 32,
+            c_num_bins = 8,  // <=16, <=64, <=256, <=1K, <=4K, <=16K, <=64K, >64K
+        };
+
+        struct stats_t
+        {
+            const char* m_name;
+            u64         m_allocs;
+            u64         m_deallocs;
+            u64         m_bytes;  // total number of bytes allocated
+            s64         m_live;   // number of bytes currently allocated
+            s64         m_peak;   // high-water mark of live bytes
+            u64         m_histogram[c_num_bins];
+        };
+
+        tracking_alloc_t();
+        ~tracking_alloc_t();
+
+        void setup(alloc_t* source);
+        void teardown();
+
+        // Returns the allocator for 'name', allocations done through the tracker itself use tag 0 ("default")
+        alloc_t* tag(const char* name);
+
+        s32  num_tags() const { return m_num_tags; }
+        void stats(s32 tag_index, stats_t& stats) const;
+        bool has_leaks() const;  // true when any tag has live allocations
+        void report(console_t* out) const;
+
+        alloc_t* source() const { return m_source; }
+
+        struct counters_t;
+        struct thread_counters_t;
+        class tag_alloc_t;
+
+        void*              tracked_allocate(s32 tag_index, u32 size, u32 alignment);
+        void               tracked_deallocate(void* ptr);
+        thread_counters_t* thread_counters();
+
+        alloc_t*                        m_source;
+        counters_t*                     m_counters;  // [c_max_tags]
+        tag_alloc_t*                    m_tags;      // [c_max_tags]
+        std::atomic<thread_counters_t*> m_threads;   // the counters of every thread that used the tracker
+        s32                             m_num_tags;
+        u32                             m_serial;
+
+    protected:
+        virtual void* v_allocate(u32 size, u32 alignment);
+        virtual void  v_deallocate(void* ptr);
+    };
+
+};  // namespace ncore
+
+#endif  // __CBASE_ALLOCATOR_TRACKING_H__
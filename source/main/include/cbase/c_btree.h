@@ -0,0 +1,577 @@
+#ifndef __CBASE_BTREE_H__
+#define __CBASE_BTREE_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_pool.h"
+
+namespace ncore
+{
+    // -----------------------------------------------------------------------------------
+    // -----------------------------------------------------------------------------------
+    // B+tree ordered map, an alternative to map_t/map32_t for large working sets.
+    // A node holds up to N keys in a contiguous array (keys and values are separate arrays),
+    // so a lookup touches ~log_N(n) nodes instead of log_2(n) tree nodes. Searching inside a
+    // node is a branch-free count over the key array which the compiler can vectorize.
+    // All items are in the leaves, the leaves are linked for range scans.
+    // Leaf and inner nodes come from two growable (virtual memory) pools, so node addresses
+    // are stable and 'clear' releases everything in O(1).
+    // The pools reserve enough nodes for 'max_items' (constructor) items with every leaf only half
+    // full, 'insert' returns false when a pool is exhausted and leaves the tree unchanged. At least
+    // 'max_items' items always fit, more do when the leaves are fuller.
+    //
+    // Same note of caution as map_t: K and V are simple POD types, K needs '<' and '=='.
+    // -----------------------------------------------------------------------------------
+
+    template <typename K, typename V, s32 N = 32>
+    class btree_map_t
+    {
+        static_assert(N >= 4, "btree_map_t needs at least 4 keys per node");
+
+        enum
+        {
+            c_min_leaf   = N / 2,        // minimum number of items in a leaf (except the root)
+            c_min_inner  = (N - 1) / 2,  // minimum number of keys in an inner node (except the root)
+            c_max_height = 24,
+        };
+
+        struct leaf_t
+        {
+            K       m_keys[N];
+            V       m_values[N];
+            leaf_t* m_prev;
+            leaf_t* m_next;
+            s32     m_count;
+        };
+
+        // Child 'i' holds the keys < m_keys[i], child 'i + 1' the keys >= m_keys[i]
+        struct inner_t
+        {
+            K     m_keys[N];
+            void* m_child[N + 1];
+            s32   m_count;  // number of keys, there are 'm_count + 1' children
+        };
+
+        // number of keys in 'keys' that are less than 'key'
+        static inline s32 s_lower(K const* keys, s32 count, K const& key)
+        {
+            s32 pos = 0;
+            for (s32 i = 0; i < count; ++i)
+                pos += (keys[i] < key) ? 1 : 0;
+            return pos;
+        }
+
+        // number of keys in 'keys' that are less than or equal to 'key'
+        static inline s32 s_upper(K const* keys, s32 count, K const& key)
+        {
+            s32 pos = 0;
+            for (s32 i = 0; i < count; ++i)
+                pos += (key < keys[i]) ? 0 : 1;
+            return pos;
+        }
+
+        growable_pool_t<leaf_t, npool::c_zero_none>  m_leaves;
+        growable_pool_t<inner_t, npool::c_zero_none> m_inners;
+        void*                                        m_root;
+        leaf_t*                                      m_first;
+        s32                                          m_height;  // number of inner levels above the leaves
+        s32                                          m_size;
+        s32                                          m_max_leaves;
+        s32                                          m_max_inners;
+
+    public:
+        // 'max_items' determines how much virtual memory is reserved (and so the size limit of the tree),
+        // memory is committed on demand. The default is meant for small maps, size it for large ones.
+        inline btree_map_t(s32 max_items = 1 << 16)
+            : m_root(nullptr)
+            , m_first(nullptr)
+            , m_height(0)
+            , m_size(0)
+        {
+            m_max_leaves = (max_items / c_min_leaf) + 2;
+            m_max_inners = (m_max_leaves / c_min_inner) + c_max_height;
+            m_leaves.setup(m_max_leaves);
+            m_inners.setup(m_max_inners);
+        }
+
+        inline ~btree_map_t()
+        {
+            m_leaves.teardown();
+            m_inners.teardown();
+        }
+
+        inline s32  size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+        inline s32  height() const { return m_height; }
+
+        // Releases all the nodes in O(1), the memory is given back to the system
+        void clear()
+        {
+            m_leaves.teardown();
+            m_inners.teardown();
+            m_leaves.setup(m_max_leaves);
+            m_inners.setup(m_max_inners);
+            m_root   = nullptr;
+            m_first  = nullptr;
+            m_height = 0;
+            m_size   = 0;
+        }
+
+        bool find(K const& key, V& value) const
+        {
+            leaf_t const* leaf = find_leaf(key);
+            if (leaf == nullptr)
+                return false;
+            s32 const pos = s_lower(leaf->m_keys, leaf->m_count, key);
+            if (pos < leaf->m_count && leaf->m_keys[pos] == key)
+            {
+                value = leaf->m_values[pos];
+                return true;
+            }
+            return false;
+        }
+
+        inline bool contains(K const& key) const
+        {
+            V value;
+            return find(key, value);
+        }
+
+        bool insert(K const& key, V const& value);
+        bool remove(K const& key);
+
+        struct iterator_t
+        {
+            inline bool order()
+            {
+                if (m_leaf == nullptr)
+                    return false;
+                if (m_started)
+                    m_index += 1;
+                m_started = true;
+                while (m_index >= m_leaf->m_count)
+                {
+                    m_leaf  = m_leaf->m_next;
+                    m_index = 0;
+                    if (m_leaf == nullptr)
+                        return false;
+                }
+                if (m_bounded && m_to < m_leaf->m_keys[m_index])
+                {
+                    m_leaf = nullptr;
+                    return false;
+                }
+                return true;
+            }
+
+            inline K const& key() const { return m_leaf->m_keys[m_index]; }
+            inline V const& value() const { return m_leaf->m_values[m_index]; }
+
+        protected:
+            friend class btree_map_t;
+            iterator_t(leaf_t const* leaf, s32 index)
+                : m_leaf(leaf)
+                , m_index(index)
+                , m_started(false)
+                , m_to()
+                , m_bounded(false)
+            {
+            }
+
+        private:
+            leaf_t const* m_leaf;
+            s32           m_index;
+            bool          m_started;
+            K             m_to;
+            bool          m_bounded;
+        };
+
+        inline iterator_t iterate() const { return iterator_t(m_first, 0); }
+
+        // Iterates, using 'order()', the items with 'from' <= key <= 'to' in ascending order in O(log n + k)
+        iterator_t range(K const& from, K const& to) const
+        {
+            leaf_t const* leaf = find_leaf(from);
+            iterator_t    iter(leaf, leaf != nullptr ? s_lower(leaf->m_keys, leaf->m_count, from) : 0);
+            iter.m_to      = to;
+            iter.m_bounded = true;
+            return iter;
+        }
+
+    private:
+        leaf_t const* find_leaf(K const& key) const
+        {
+            void const* node = m_root;
+            for (s32 level = 0; level < m_height; ++level)
+            {
+                inner_t const* inner = (inner_t const*)node;
+                node                 = inner->m_child[s_upper(inner->m_keys, inner->m_count, key)];
+            }
+            return (leaf_t const*)node;
+        }
+
+        void insert_into_parents(inner_t** path, s32* path_index, s32 level, K sep, void* right, inner_t** spare);
+        void rebalance_leaf(inner_t* parent, s32 index, leaf_t* leaf);
+        bool rebalance_inner(inner_t* parent, s32 index, inner_t* inner);
+    };
+
+    template <typename K, typename V, s32 N>
+    bool btree_map_t<K, V, N>::insert(K const& key, V const& value)
+    {
+        if (m_root == nullptr)
+        {
+            leaf_t* leaf = m_leaves.allocate();
+            if (leaf == nullptr)
+                return false;
+            leaf->m_prev  = nullptr;
+            leaf->m_next  = nullptr;
+            leaf->m_count = 0;
+            m_root        = leaf;
+            m_first       = leaf;
+            m_height      = 0;
+        }
+
+        inner_t* path[c_max_height];
+        s32      path_index[c_max_height];
+        void*    node = m_root;
+        for (s32 level = 0; level < m_height; ++level)
+        {
+            inner_t* inner    = (inner_t*)node;
+            s32 const idx     = s_upper(inner->m_keys, inner->m_count, key);
+            path[level]       = inner;
+            path_index[level] = idx;
+            node              = inner->m_child[idx];
+        }
+
+        leaf_t*   leaf = (leaf_t*)node;
+        s32 const pos  = s_lower(leaf->m_keys, leaf->m_count, key);
+        if (pos < leaf->m_count && leaf->m_keys[pos] == key)
+            return false;
+
+        if (leaf->m_count < N)
+        {
+            for (s32 i = leaf->m_count; i > pos; --i)
+            {
+                leaf->m_keys[i]   = leaf->m_keys[i - 1];
+                leaf->m_values[i] = leaf->m_values[i - 1];
+            }
+            leaf->m_keys[pos]   = key;
+            leaf->m_values[pos] = value;
+            leaf->m_count += 1;
+            m_size += 1;
+            return true;
+        }
+
+        // Every full inner node on the path splits as well, and the root when all of them are full.
+        // Allocate all the nodes the split needs before the tree is modified.
+        s32 num_spare = 0;
+        s32 level     = m_height - 1;
+        while (level >= 0 && path[level]->m_count == N)
+            level -= 1;
+        s32 const num_inners = (m_height - 1 - level) + (level < 0 ? 1 : 0);
+        if (level < 0 && m_height == c_max_height)
+            return false;
+
+        inner_t* spare[c_max_height + 1];
+        leaf_t*  right = m_leaves.allocate();
+        while (right != nullptr && num_spare < num_inners)
+        {
+            spare[num_spare] = m_inners.allocate();
+            if (spare[num_spare] == nullptr)
+                break;
+            num_spare += 1;
+        }
+        if (right == nullptr || num_spare < num_inners)
+        {
+            while (num_spare > 0)
+                m_inners.deallocate(spare[--num_spare]);
+            if (right != nullptr)
+                m_leaves.deallocate(right);
+            return false;
+        }
+
+        // Split the full leaf, the upper half moves to a new leaf on the right
+
+        s32 const left_count = (N + 1) / 2;
+        right->m_count       = N - left_count;
+        for (s32 i = 0; i < right->m_count; ++i)
+        {
+            right->m_keys[i]   = leaf->m_keys[left_count + i];
+            right->m_values[i] = leaf->m_values[left_count + i];
+        }
+        leaf->m_count = left_count;
+        right->m_prev = leaf;
+        right->m_next = leaf->m_next;
+        if (leaf->m_next != nullptr)
+            leaf->m_next->m_prev = right;
+        leaf->m_next = right;
+
+        leaf_t* target = (pos <= left_count) ? leaf : right;
+        s32     tpos   = (pos <= left_count) ? pos : pos - left_count;
+        for (s32 i = target->m_count; i > tpos; --i)
+        {
+            target->m_keys[i]   = target->m_keys[i - 1];
+            target->m_values[i] = target->m_values[i - 1];
+        }
+        target->m_keys[tpos]   = key;
+        target->m_values[tpos] = value;
+        target->m_count += 1;
+        m_size += 1;
+
+        insert_into_parents(path, path_index, m_height - 1, right->m_keys[0], right, spare);
+        return true;
+    }
+
+    // 'spare' holds the inner nodes needed for the splits, allocated up front by 'insert'
+    template <typename K, typename V, s32 N>
+    void btree_map_t<K, V, N>::insert_into_parents(inner_t** path, s32* path_index, s32 level, K sep, void* right, inner_t** spare)
+    {
+        while (level >= 0)
+        {
+            inner_t*  inner = path[level];
+            s32 const idx   = path_index[level];
+            if (inner->m_count < N)
+            {
+                for (s32 i = inner->m_count; i > idx; --i)
+                {
+                    inner->m_keys[i]      = inner->m_keys[i - 1];
+                    inner->m_child[i + 1] = inner->m_child[i];
+                }
+                inner->m_keys[idx]      = sep;
+                inner->m_child[idx + 1] = right;
+                inner->m_count += 1;
+                return;
+            }
+
+            // Split the full inner node, the middle key moves up
+            K     keys[N + 1];
+            void* child[N + 2];
+            for (s32 i = 0, j = 0; i <= N; ++i)
+                keys[i] = (i == idx) ? sep : inner->m_keys[j++];
+            for (s32 i = 0, j = 0; i <= N + 1; ++i)
+                child[i] = (i == idx + 1) ? right : inner->m_child[j++];
+
+            inner_t* split = *spare++;
+
+            s32 const left_count = (N + 1) / 2;
+            inner->m_count       = left_count;
+            for (s32 i = 0; i < left_count; ++i)
+                inner->m_keys[i] = keys[i];
+            for (s32 i = 0; i <= left_count; ++i)
+                inner->m_child[i] = child[i];
+
+            split->m_count = N - left_count;
+            for (s32 i = 0; i < split->m_count; ++i)
+                split->m_keys[i] = keys[left_count + 1 + i];
+            for (s32 i = 0; i <= split->m_count; ++i)
+                split->m_child[i] = child[left_count + 1 + i];
+
+            sep   = keys[left_count];
+            right = split;
+            level -= 1;
+        }
+
+        // The root was split, grow the tree by one level
+        inner_t* root = *spare;
+        root->m_count    = 1;
+        root->m_keys[0]  = sep;
+        root->m_child[0] = m_root;
+        root->m_child[1] = right;
+        m_root           = root;
+        m_height += 1;
+    }
+
+    template <typename K, typename V, s32 N>
+    bool btree_map_t<K, V, N>::remove(K const& key)
+    {
+        if (m_root == nullptr)
+            return false;
+
+        inner_t* path[c_max_height];
+        s32      path_index[c_max_height];
+        void*    node = m_root;
+        for (s32 level = 0; level < m_height; ++level)
+        {
+            inner_t* inner    = (inner_t*)node;
+            s32 const idx     = s_upper(inner->m_keys, inner->m_count, key);
+            path[level]       = inner;
+            path_index[level] = idx;
+            node              = inner->m_child[idx];
+        }
+
+        leaf_t*   leaf = (leaf_t*)node;
+        s32 const pos  = s_lower(leaf->m_keys, leaf->m_count, key);
+        if (pos >= leaf->m_count || !(leaf->m_keys[pos] == key))
+            return false;
+
+        leaf->m_count -= 1;
+        for (s32 i = pos; i < leaf->m_count; ++i)
+        {
+            leaf->m_keys[i]   = leaf->m_keys[i + 1];
+            leaf->m_values[i] = leaf->m_values[i + 1];
+        }
+        m_size -= 1;
+
+        if (m_height == 0)
+        {
+            if (leaf->m_count == 0)
+            {
+                m_leaves.deallocate(leaf);
+                m_root  = nullptr;
+                m_first = nullptr;
+            }
+            return true;
+        }
+
+        if (leaf->m_count >= c_min_leaf)
+            return true;
+
+        rebalance_leaf(path[m_height - 1], path_index[m_height - 1], leaf);
+
+        // Walk up as long as inner nodes underflow
+        s32 level = m_height - 1;
+        while (level > 0 && path[level]->m_count < c_min_inner)
+        {
+            if (!rebalance_inner(path[level - 1], path_index[level - 1], path[level]))
+                break;
+            level -= 1;
+        }
+
+        // Shrink the tree when the root has a single child left
+        if (m_height > 0 && ((inner_t*)m_root)->m_count == 0)
+        {
+            inner_t* root = (inner_t*)m_root;
+            m_root        = root->m_child[0];
+            m_inners.deallocate(root);
+            m_height -= 1;
+        }
+        return true;
+    }
+
+    // Borrows an item from a sibling or merges with it, 'leaf' is child 'index' of 'parent'
+    template <typename K, typename V, s32 N>
+    void btree_map_t<K, V, N>::rebalance_leaf(inner_t* parent, s32 index, leaf_t* leaf)
+    {
+        leaf_t* left  = index > 0 ? (leaf_t*)parent->m_child[index - 1] : nullptr;
+        leaf_t* right = index < parent->m_count ? (leaf_t*)parent->m_child[index + 1] : nullptr;
+
+        if (left != nullptr && left->m_count > c_min_leaf)
+        {
+            for (s32 i = leaf->m_count; i > 0; --i)
+            {
+                leaf->m_keys[i]   = leaf->m_keys[i - 1];
+                leaf->m_values[i] = leaf->m_values[i - 1];
+            }
+            left->m_count -= 1;
+            leaf->m_keys[0]   = left->m_keys[left->m_count];
+            leaf->m_values[0] = left->m_values[left->m_count];
+            leaf->m_count += 1;
+            parent->m_keys[index - 1] = leaf->m_keys[0];
+            return;
+        }
+
+        if (right != nullptr && right->m_count > c_min_leaf)
+        {
+            leaf->m_keys[leaf->m_count]   = right->m_keys[0];
+            leaf->m_values[leaf->m_count] = right->m_values[0];
+            leaf->m_count += 1;
+            right->m_count -= 1;
+            for (s32 i = 0; i < right->m_count; ++i)
+            {
+                right->m_keys[i]   = right->m_keys[i + 1];
+                right->m_values[i] = right->m_values[i + 1];
+            }
+            parent->m_keys[index] = right->m_keys[0];
+            return;
+        }
+
+        // Merge 'src' into 'dst' (its left neighbour) and remove separator 'sep' from the parent
+        leaf_t* dst = left != nullptr ? left : leaf;
+        leaf_t* src = left != nullptr ? leaf : right;
+        s32     sep = left != nullptr ? index - 1 : index;
+        for (s32 i = 0; i < src->m_count; ++i)
+        {
+            dst->m_keys[dst->m_count + i]   = src->m_keys[i];
+            dst->m_values[dst->m_count + i] = src->m_values[i];
+        }
+        dst->m_count += src->m_count;
+        dst->m_next = src->m_next;
+        if (src->m_next != nullptr)
+            src->m_next->m_prev = dst;
+        m_leaves.deallocate(src);
+
+        parent->m_count -= 1;
+        for (s32 i = sep; i < parent->m_count; ++i)
+        {
+            parent->m_keys[i]      = parent->m_keys[i + 1];
+            parent->m_child[i + 1] = parent->m_child[i + 2];
+        }
+    }
+
+    // Borrows a key from a sibling or merges with it, returns true when the parent lost a key
+    template <typename K, typename V, s32 N>
+    bool btree_map_t<K, V, N>::rebalance_inner(inner_t* parent, s32 index, inner_t* inner)
+    {
+        inner_t* left  = index > 0 ? (inner_t*)parent->m_child[index - 1] : nullptr;
+        inner_t* right = index < parent->m_count ? (inner_t*)parent->m_child[index + 1] : nullptr;
+
+        if (left != nullptr && left->m_count > c_min_inner)
+        {
+            inner->m_child[inner->m_count + 1] = inner->m_child[inner->m_count];
+            for (s32 i = inner->m_count; i > 0; --i)
+            {
+                inner->m_keys[i]  = inner->m_keys[i - 1];
+                inner->m_child[i] = inner->m_child[i - 1];
+            }
+            inner->m_keys[0]  = parent->m_keys[index - 1];
+            inner->m_child[0] = left->m_child[left->m_count];
+            inner->m_count += 1;
+            parent->m_keys[index - 1] = left->m_keys[left->m_count - 1];
+            left->m_count -= 1;
+            return false;
+        }
+
+        if (right != nullptr && right->m_count > c_min_inner)
+        {
+            inner->m_keys[inner->m_count]      = parent->m_keys[index];
+            inner->m_child[inner->m_count + 1] = right->m_child[0];
+            inner->m_count += 1;
+            parent->m_keys[index] = right->m_keys[0];
+            for (s32 i = 0; i < right->m_count - 1; ++i)
+            {
+                right->m_keys[i]  = right->m_keys[i + 1];
+                right->m_child[i] = right->m_child[i + 1];
+            }
+            right->m_child[right->m_count - 1] = right->m_child[right->m_count];
+            right->m_count -= 1;
+            return false;
+        }
+
+        // Merge 'src' into 'dst' (its left neighbour), the separator moves down from the parent
+        inner_t* dst = left != nullptr ? left : inner;
+        inner_t* src = left != nullptr ? inner : right;
+        s32      sep = left != nullptr ? index - 1 : index;
+
+        dst->m_keys[dst->m_count] = parent->m_keys[sep];
+        for (s32 i = 0; i < src->m_count; ++i)
+            dst->m_keys[dst->m_count + 1 + i] = src->m_keys[i];
+        for (s32 i = 0; i <= src->m_count; ++i)
+            dst->m_child[dst->m_count + 1 + i] = src->m_child[i];
+        dst->m_count += src->m_count + 1;
+        m_inners.deallocate(src);
+
+        parent->m_count -= 1;
+        for (s32 i = sep; i < parent->m_count; ++i)
+        {
+            parent->m_keys[i]      = parent->m_keys[i + 1];
+            parent->m_child[i + 1] = parent->m_child[i + 2];
+        }
+        return true;
+    }
+
+};  // namespace ncore
+
+#endif  // __CBASE_BTREE_H__
@@ -0,0 +1,512 @@
+#ifndef __CBASE_CONCURRENT_HASH_MAP_H__
+#define __CBASE_CONCURRENT_HASH_MAP_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+#include "ccore/c_memory.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_wyhash.h"
+
+#include <atomic>
+#include <thread>
+
+namespace ncore
+{
+    // -----------------------------------------------------------------------------------
+    // -----------------------------------------------------------------------------------
+    // Concurrent (wyhash based) hash map, any number of threads can find, insert, assign
+    // and remove at the same time.
+    //
+    // The map is split into segments (a power of two), the top bits of the hash select the
+    // segment. Every segment is a linear probing table (like nhash::table_t) with a writer
+    // lock and a sequence counter:
+    // - Writers take the segment lock (a spin lock), writers on different segments do not
+    //   contend. The sequence counter is only odd while a writer changes slots of the live
+    //   table in place (insert, overwrite and the backward shift of remove), which is short.
+    // - Readers are optimistic (seqlock readers), they take no lock and never write. A reader
+    //   reads the counter, probes the table and retries when the counter changed in the
+    //   meantime. Slots are stored as atomic 64-bit words so that a torn read is harmless, it
+    //   is simply thrown away. Readers are not lock-free: a reader that finds the counter odd
+    //   waits (yields) until that in-place change is done, and keeps retrying while writers
+    //   keep changing the segment.
+    //
+    // A segment grows on its own, under its own lock, there is no global lock or stop. The
+    // items are copied into a new table that readers cannot see yet, so readers continue on
+    // the old table during the copy and switch when the new table is published. The old
+    // table can still be read by a reader that loaded it before the switch, and readers do
+    // not announce themselves, so a retired table is only freed by 'reclaim' (which must not
+    // run concurrently with other threads) or the destructor.
+    // Segments grow (allocate) at the same time on different threads, so the allocator that
+    // is given to the map must be thread-safe.
+    // Memory bound: tables double in size, so the retired tables of a segment (16 + 32 + ..
+    // up to half the current size) always take less memory than its live table; the map
+    // never holds more than twice the memory of its live tables ('memory' reports both).
+    //
+    // Same note of caution as map_t: K and V are simple POD types, K needs '=='. Keys that
+    // are 8 bytes or smaller are hashed as an integer, so they should not contain padding.
+    // -----------------------------------------------------------------------------------
+
+    namespace nchmap
+    {
+        const u64 c_slot_empty  = 0;
+        const u32 c_min_slots   = 16;
+        const s32 c_spin_count  = 64;  // spins on a locked segment before yielding
+        const s32 c_segments    = 64;  // default number of segments
+
+        static inline bool s_max_load(u32 slots, s32 count) { return (u32)count > ((slots >> 2) * 3); }
+
+        // Copies between words and memory, the words are read/written one at a time
+        inline void s_load(std::atomic<u64> const* words, void* dst, s32 size)
+        {
+            u64 buffer[8];
+            u8* d = (u8*)dst;
+            while (size > 0)
+            {
+                s32 const n = size < (s32)sizeof(buffer) ? size : (s32)sizeof(buffer);
+                for (s32 i = 0; i < ((n + 7) >> 3); ++i)
+                    buffer[i] = words[i].load(std::memory_order_relaxed);
+                g_memcpy(d, buffer, n);
+                words += sizeof(buffer) / sizeof(u64);
+                d += n;
+                size -= n;
+            }
+        }
+
+        inline void s_store(std::atomic<u64>* words, void const* src, s32 size)
+        {
+            u64       buffer[8];
+            u8 const* s = (u8 const*)src;
+            while (size > 0)
+            {
+                s32 const n = size < (s32)sizeof(buffer) ? size : (s32)sizeof(buffer);
+                buffer[(n - 1) >> 3] = 0;
+                g_memcpy(buffer, s, n);
+                for (s32 i = 0; i < ((n + 7) >> 3); ++i)
+                    words[i].store(buffer[i], std::memory_order_relaxed);
+                words += sizeof(buffer) / sizeof(u64);
+                s += n;
+                size -= n;
+            }
+        }
+    }  // namespace nchmap
+
+    template <typename K, typename V>
+    class concurrent_hash_map_t
+    {
+    public:
+        concurrent_hash_map_t(alloc_t* allocator, s32 capacity = 0, s32 segments = nchmap::c_segments, u64 seed = 0);
+        ~concurrent_hash_map_t();
+
+        bool insert(K const& key, V const& value);  // false when the key already exists (or out of memory)
+        bool assign(K const& key, V const& value);  // inserts or overwrites, true when the key was inserted
+        bool find(K const& key, V& value) const;
+        bool contains(K const& key) const;
+        bool remove(K const& key);
+
+        s32  size() const;  // exact when there are no writers
+        s32  segments() const { return (s32)m_segment_mask + 1; }
+        void reclaim();  // frees the retired tables, only call this when no other thread uses the map
+
+        // Bytes held by the live tables and by the retired tables (retired < live), exact when there are no writers
+        void memory(int_t& live, int_t& retired) const;
+
+    private:
+        // A slot is a hash word (0 = empty) followed by the key and the value words
+        static const s32 c_key_words  = (s32)((sizeof(K) + 7) >> 3);
+        static const s32 c_slot_words = 1 + c_key_words + (s32)((sizeof(V) + 7) >> 3);
+
+        struct table_t
+        {
+            std::atomic<u64>* m_words;
+            u32               m_mask;
+            table_t*          m_retired;  // next older table of the segment
+        };
+
+        // one cache-line per segment, so that writers on different segments do not contend
+        struct alignas(64) segment_t
+        {
+            std::atomic<u32>      m_lock;      // writer lock, 1 while a writer owns the segment
+            std::atomic<u32>      m_sequence;  // odd while a writer changes slots of the live table
+            s32                   m_count;
+            std::atomic<table_t*> m_table;
+            table_t*              m_retired;
+        };
+        static_assert(sizeof(segment_t) == 64, "segment_t should be exactly one cache line");
+
+        inline u64 hash(K const& key) const
+        {
+            u64 h;
+            if (sizeof(K) <= 8)
+            {
+                u64 v = 0;
+                g_memcpy(&v, &key, sizeof(K));
+                h = nhash::wyhash64(v, sizeof(K), m_secret);
+            }
+            else
+            {
+                h = nhash::wyhash_bytes(&key, (s32)sizeof(K), 0, m_secret);
+            }
+            return h != nchmap::c_slot_empty ? h : 1;
+        }
+
+        inline segment_t& segment(u64 h) const { return m_segments[(u32)(h >> 32) & m_segment_mask]; }
+        static inline std::atomic<u64>* s_slot(table_t const* t, u32 slot) { return t->m_words + (uint_t)slot * c_slot_words; }
+
+        static s32  s_find(table_t const* t, u64 h, K const& key);
+        static u32  s_begin_change(segment_t& s);
+        static void s_end_change(segment_t& s, u32 sequence);
+        void        lock(segment_t& s) const;
+        void        unlock(segment_t& s) const;
+        table_t*    new_table(u32 slots);
+        void        free_table(table_t* t);
+        bool        grow(segment_t& s);
+        bool        write(K const& key, V const& value, bool overwrite, bool& inserted);
+
+        alloc_t*   m_allocator;
+        segment_t* m_segments;
+        u32        m_segment_mask;
+        u64        m_secret[4];
+    };
+
+    template <typename K, typename V>
+    concurrent_hash_map_t<K, V>::concurrent_hash_map_t(alloc_t* allocator, s32 capacity, s32 segments, u64 seed)
+        : m_allocator(allocator)
+    {
+        ASSERT(segments > 0 && (segments & (segments - 1)) == 0);
+        nhash::wymake_secret(seed, m_secret);
+        m_segment_mask = (u32)segments - 1;
+        m_segments     = (segment_t*)allocator->allocate((u32)sizeof(segment_t) * segments, 64);
+
+        // Enough slots per segment for an even share of 'capacity' items at the maximum load
+        s32 const share = (capacity + segments - 1) / segments;
+        u32       slots = nchmap::c_min_slots;
+        while (nchmap::s_max_load(slots, share))
+            slots <<= 1;
+        for (s32 i = 0; i < segments; ++i)
+        {
+            m_segments[i].m_lock.store(0, std::memory_order_relaxed);
+            m_segments[i].m_sequence.store(0, std::memory_order_relaxed);
+            m_segments[i].m_table.store(new_table(slots), std::memory_order_relaxed);
+            m_segments[i].m_count   = 0;
+            m_segments[i].m_retired = nullptr;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    template <typename K, typename V>
+    concurrent_hash_map_t<K, V>::~concurrent_hash_map_t()
+    {
+        reclaim();
+        for (u32 i = 0; i <= m_segment_mask; ++i)
+            free_table(m_segments[i].m_table.load(std::memory_order_relaxed));
+        m_allocator->deallocate(m_segments);
+    }
+
+    template <typename K, typename V>
+    typename concurrent_hash_map_t<K, V>::table_t* concurrent_hash_map_t<K, V>::new_table(u32 slots)
+    {
+        table_t* t = (table_t*)m_allocator->allocate((u32)sizeof(table_t), (u32)alignof(table_t));
+        if (t == nullptr)
+            return nullptr;
+        t->m_words = (std::atomic<u64>*)m_allocator->allocate((u32)sizeof(std::atomic<u64>) * slots * c_slot_words, 64);
+        if (t->m_words == nullptr)
+        {
+            m_allocator->deallocate(t);
+            return nullptr;
+        }
+        t->m_mask    = slots - 1;
+        t->m_retired = nullptr;
+        for (u32 i = 0; i < slots; ++i)
+            s_slot(t, i)->store(nchmap::c_slot_empty, std::memory_order_relaxed);
+        return t;
+    }
+
+    template <typename K, typename V>
+    void concurrent_hash_map_t<K, V>::free_table(table_t* t)
+    {
+        if (t == nullptr)
+            return;
+        m_allocator->deallocate(t->m_words);
+        m_allocator->deallocate(t);
+    }
+
+    template <typename K, typename V>
+    void concurrent_hash_map_t<K, V>::reclaim()
+    {
+        for (u32 i = 0; i <= m_segment_mask; ++i)
+        {
+            segment_t& s = m_segments[i];
+            while (s.m_retired != nullptr)
+            {
+                table_t* t  = s.m_retired;
+                s.m_retired = t->m_retired;
+                free_table(t);
+            }
+        }
+    }
+
+    template <typename K, typename V>
+    void concurrent_hash_map_t<K, V>::memory(int_t& live, int_t& retired) const
+    {
+        live    = 0;
+        retired = 0;
+        for (u32 i = 0; i <= m_segment_mask; ++i)
+        {
+            segment_t& s = m_segments[i];
+            lock(s);
+            table_t const* t = s.m_table.load(std::memory_order_relaxed);
+            live += (int_t)(t->m_mask + 1) * c_slot_words * (int_t)sizeof(u64);
+            for (t = s.m_retired; t != nullptr; t = t->m_retired)
+                retired += (int_t)(t->m_mask + 1) * c_slot_words * (int_t)sizeof(u64);
+            unlock(s);
+        }
+    }
+
+    // Returns the slot holding 'key' or -1, also used by readers on a table that may be changing,
+    // so the probe is bounded and a key is only compared when the hash matches.
+    template <typename K, typename V>
+    s32 concurrent_hash_map_t<K, V>::s_find(table_t const* t, u64 h, K const& key)
+    {
+        u32 slot = (u32)h & t->m_mask;
+        for (u32 n = 0; n <= t->m_mask; ++n)
+        {
+            std::atomic<u64> const* words = s_slot(t, slot);
+            u64 const               sh    = words[0].load(std::memory_order_relaxed);
+            if (sh == nchmap::c_slot_empty)
+                return -1;
+            if (sh == h)
+            {
+                K k;
+                nchmap::s_load(words + 1, &k, (s32)sizeof(K));
+                if (k == key)
+                    return (s32)slot;
+            }
+            slot = (slot + 1) & t->m_mask;
+        }
+        return -1;
+    }
+
+    template <typename K, typename V>
+    void concurrent_hash_map_t<K, V>::lock(segment_t& s) const
+    {
+        s32 spins = 0;
+        while (true)
+        {
+            u32 unlocked = 0;
+            if (s.m_lock.load(std::memory_order_relaxed) == 0 && s.m_lock.compare_exchange_weak(unlocked, 1, std::memory_order_acquire, std::memory_order_relaxed))
+                break;
+            if (++spins >= nchmap::c_spin_count)
+            {
+                std::this_thread::yield();
+                spins = 0;
+            }
+        }
+    }
+
+    template <typename K, typename V>
+    void concurrent_hash_map_t<K, V>::unlock(segment_t& s) const
+    {
+        s.m_lock.store(0, std::memory_order_release);
+    }
+
+    // Makes the sequence odd around an in-place change of the live table, only called by the
+    // writer that holds the segment lock, so the sequence has no other writers.
+    template <typename K, typename V>
+    u32 concurrent_hash_map_t<K, V>::s_begin_change(segment_t& s)
+    {
+        u32 const seq = s.m_sequence.load(std::memory_order_relaxed) + 1;
+        s.m_sequence.store(seq, std::memory_order_relaxed);
+        // The slot changes that follow must not become visible before the odd sequence
+        std::atomic_thread_fence(std::memory_order_release);
+        return seq;
+    }
+
+    template <typename K, typename V>
+    void concurrent_hash_map_t<K, V>::s_end_change(segment_t& s, u32 sequence)
+    {
+        s.m_sequence.store(sequence + 1, std::memory_order_release);
+    }
+
+    // Optimistic read, retried until no writer changed the segment during the probe
+    template <typename K, typename V>
+    bool concurrent_hash_map_t<K, V>::find(K const& key, V& value) const
+    {
+        u64 const        h = hash(key);
+        segment_t const& s = segment(h);
+        while (true)
+        {
+            u32 const seq = s.m_sequence.load(std::memory_order_acquire);
+            if ((seq & 1) != 0)
+            {
+                std::this_thread::yield();
+                continue;
+            }
+            table_t const* t    = s.m_table.load(std::memory_order_acquire);
+            s32 const      slot = s_find(t, h, key);
+            if (slot >= 0)
+                nchmap::s_load(s_slot(t, (u32)slot) + 1 + c_key_words, &value, (s32)sizeof(V));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (s.m_sequence.load(std::memory_order_relaxed) == seq)
+                return slot >= 0;
+        }
+    }
+
+    template <typename K, typename V>
+    bool concurrent_hash_map_t<K, V>::contains(K const& key) const
+    {
+        V value;
+        return find(key, value);
+    }
+
+    // Moves the items into a table twice the size, called with the segment locked. The old
+    // table is not changed and the new table is not visible to readers until it is published,
+    // so the sequence stays even and readers do not wait for the copy.
+    template <typename K, typename V>
+    bool concurrent_hash_map_t<K, V>::grow(segment_t& s)
+    {
+        table_t* const old = s.m_table.load(std::memory_order_relaxed);
+        table_t* const t   = new_table((old->m_mask + 1) << 1);
+        if (t == nullptr)
+            return false;
+        for (u32 i = 0; i <= old->m_mask; ++i)
+        {
+            std::atomic<u64> const* src = s_slot(old, i);
+            u64 const               h   = src[0].load(std::memory_order_relaxed);
+            if (h == nchmap::c_slot_empty)
+                continue;
+            u32 slot = (u32)h & t->m_mask;
+            while (s_slot(t, slot)->load(std::memory_order_relaxed) != nchmap::c_slot_empty)
+                slot = (slot + 1) & t->m_mask;
+            std::atomic<u64>* dst = s_slot(t, slot);
+            for (s32 w = 0; w < c_slot_words; ++w)
+                dst[w].store(src[w].load(std::memory_order_relaxed), std::memory_order_relaxed);
+        }
+        old->m_retired = s.m_retired;
+        s.m_retired    = old;
+        s.m_table.store(t, std::memory_order_release);
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool concurrent_hash_map_t<K, V>::write(K const& key, V const& value, bool overwrite, bool& inserted)
+    {
+        inserted         = false;
+        u64 const  h = hash(key);
+        segment_t& s = segment(h);
+        lock(s);
+        table_t* t     = s.m_table.load(std::memory_order_relaxed);
+        s32      found = s_find(t, h, key);
+        if (found >= 0)
+        {
+            if (overwrite)
+            {
+                u32 const seq = s_begin_change(s);
+                nchmap::s_store(s_slot(t, (u32)found) + 1 + c_key_words, &value, (s32)sizeof(V));
+                s_end_change(s, seq);
+            }
+            unlock(s);
+            return overwrite;
+        }
+
+        if (nchmap::s_max_load(t->m_mask + 1, s.m_count + 1))
+        {
+            if (!grow(s))
+            {
+                unlock(s);
+                return false;
+            }
+            t = s.m_table.load(std::memory_order_relaxed);
+        }
+
+        u32 slot = (u32)h & t->m_mask;
+        while (s_slot(t, slot)->load(std::memory_order_relaxed) != nchmap::c_slot_empty)
+            slot = (slot + 1) & t->m_mask;
+        std::atomic<u64>* words = s_slot(t, slot);
+        u32 const         seq   = s_begin_change(s);
+        nchmap::s_store(words + 1, &key, (s32)sizeof(K));
+        nchmap::s_store(words + 1 + c_key_words, &value, (s32)sizeof(V));
+        words[0].store(h, std::memory_order_relaxed);
+        s_end_change(s, seq);
+        s.m_count += 1;
+        unlock(s);
+        inserted = true;
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool concurrent_hash_map_t<K, V>::insert(K const& key, V const& value)
+    {
+        bool inserted;
+        write(key, value, false, inserted);
+        return inserted;
+    }
+
+    template <typename K, typename V>
+    bool concurrent_hash_map_t<K, V>::assign(K const& key, V const& value)
+    {
+        bool inserted;
+        write(key, value, true, inserted);
+        return inserted;
+    }
+
+    template <typename K, typename V>
+    bool concurrent_hash_map_t<K, V>::remove(K const& key)
+    {
+        u64 const  h = hash(key);
+        segment_t& s = segment(h);
+        lock(s);
+        table_t*  t    = s.m_table.load(std::memory_order_relaxed);
+        s32 const slot = s_find(t, h, key);
+        if (slot < 0)
+        {
+            unlock(s);
+            return false;
+        }
+
+        // Backward shift deletion, readers retry anyway so items can be moved freely
+        u32 const seq  = s_begin_change(s);
+        u32       hole = (u32)slot;
+        u32 next = hole;
+        while (true)
+        {
+            next                          = (next + 1) & t->m_mask;
+            std::atomic<u64> const* nwords = s_slot(t, next);
+            u64 const               nh     = nwords[0].load(std::memory_order_relaxed);
+            if (nh == nchmap::c_slot_empty)
+                break;
+            u32 const home = (u32)nh & t->m_mask;
+            if (((next - home) & t->m_mask) >= ((next - hole) & t->m_mask))
+            {
+                std::atomic<u64>* hwords = s_slot(t, hole);
+                for (s32 w = 0; w < c_slot_words; ++w)
+                    hwords[w].store(nwords[w].load(std::memory_order_relaxed), std::memory_order_relaxed);
+                hole = next;
+            }
+        }
+        s_slot(t, hole)->store(nchmap::c_slot_empty, std::memory_order_relaxed);
+        s_end_change(s, seq);
+        s.m_count -= 1;
+        unlock(s);
+        return true;
+    }
+
+    template <typename K, typename V>
+    s32 concurrent_hash_map_t<K, V>::size() const
+    {
+        s32 count = 0;
+        for (u32 i = 0; i <= m_segment_mask; ++i)
+        {
+            segment_t& s = m_segments[i];
+            lock(s);
+            count += s.m_count;
+            unlock(s);
+        }
+        return count;
+    }
+
+};  // namespace ncore
+
+#endif  // __CBASE_CONCURRENT_HASH_MAP_H__
@@ -36,7 +36,13 @@ namespace ncore
     };
 
     context_t g_current_context();  // returns the current thread context
-    void      g_release_context();  // releases the current thread context
+    void      g_release_context();  // releases the current thread context, it is recycled for another thread
+
+    // Contexts are recycled, a released context is reset and kept in a global pool so that a new thread
+    // does not have to reserve and commit memory. Call 'g_prewarm_contexts' at startup to prepare
+    // contexts for the threads that you are about to create, it returns the number of contexts added.
+    s32  g_prewarm_contexts(s32 count);
+    void g_release_context_pool();  // destroys all the contexts in the pool
 
 }  // namespace ncore
 
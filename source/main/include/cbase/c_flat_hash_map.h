@@ -0,0 +1,341 @@
+#ifndef __CBASE_FLAT_HASH_MAP_H__
+#define __CBASE_FLAT_HASH_MAP_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+#include "ccore/c_math.h"
+#include "ccore/c_memory.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_wyhash.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || defined(_M_AMD64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#    define CBASE_FLAT_HASH_SSE2
+#    include <emmintrin.h>
+#endif
+
+namespace ncore
+{
+    // -----------------------------------------------------------------------------------
+    // -----------------------------------------------------------------------------------
+    // Open addressing hash map with group probing (Swiss table layout).
+    // Every slot has a control byte, a full slot holds the low 7 bits of the (wyhash) hash,
+    // the other states are 'empty' and 'deleted'. A lookup compares the control bytes of a
+    // whole group of slots in one step (16 with SSE2, 8 with the portable SWAR fallback)
+    // and only compares the keys of the slots whose 7 bits match. Keys and values are
+    // stored inline in the slot array. Groups are probed quadratically.
+    //
+    // A remove only leaves a 'deleted' marker when the group of the slot is full, a probe
+    // sequence never continues past a group that has an empty slot, so in that case the
+    // slot simply becomes empty again.
+    //
+    // Same note of caution as map_t: K and V are simple POD types, K needs '=='. Keys that
+    // are 8 bytes or smaller are hashed as an integer, so they should not contain padding.
+    // -----------------------------------------------------------------------------------
+
+    namespace nflat
+    {
+        const u8  c_empty     = 0x80;
+        const u8  c_deleted   = 0xFE;
+        const u32 c_min_slots = 16;
+
+#ifdef CBASE_FLAT_HASH_SSE2
+        const u32 c_group_width = 16;
+        const s32 c_mask_shift  = 0;
+        typedef u32 mask_t;  // one bit per slot
+
+        struct group_t
+        {
+            inline group_t(u8 const* ctrl)
+                : m_ctrl(_mm_load_si128((__m128i const*)ctrl))
+            {
+            }
+
+            inline mask_t match(u8 h2) const { return (mask_t)_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_set1_epi8((char)h2), m_ctrl)); }
+            inline mask_t match_empty() const { return match(c_empty); }
+            inline mask_t match_free() const { return (mask_t)_mm_movemask_epi8(m_ctrl); }  // empty or deleted
+
+            __m128i m_ctrl;
+        };
+#else
+        const u32 c_group_width = 8;
+        const s32 c_mask_shift  = 3;
+        typedef u64 mask_t;  // bit 7 of every byte (little endian)
+
+        struct group_t
+        {
+            inline group_t(u8 const* ctrl) { g_memcpy(&m_ctrl, ctrl, 8); }
+
+            // A byte above a real match can give a false positive, that is fine since the key is compared
+            inline mask_t match(u8 h2) const
+            {
+                u64 const x = m_ctrl ^ (c_lsbs * h2);
+                return (x - c_lsbs) & ~x & c_msbs;
+            }
+            inline mask_t match_empty() const { return m_ctrl & ~(m_ctrl << 6) & c_msbs; }
+            inline mask_t match_free() const { return m_ctrl & c_msbs; }  // empty or deleted
+
+            static const u64 c_lsbs = 0x0101010101010101ull;
+            static const u64 c_msbs = 0x8080808080808080ull;
+
+            u64 m_ctrl;
+        };
+#endif
+        // index of the lowest slot in 'mask'
+        inline u32 s_first(mask_t mask) { return (u32)math::findFirstBit(mask) >> c_mask_shift; }
+
+        // The control bytes of a map without slots (initial allocation failed), one group of empty slots
+        // that is never written, so lookups need no check and the first insert allocates.
+        inline u8* s_empty_group()
+        {
+            alignas(16) static u8 s_group[16] = {c_empty, c_empty, c_empty, c_empty, c_empty, c_empty, c_empty, c_empty,
+                                                 c_empty, c_empty, c_empty, c_empty, c_empty, c_empty, c_empty, c_empty};
+            return s_group;
+        }
+    }  // namespace nflat
+
+    template <typename K, typename V>
+    class flat_hash_map_t
+    {
+    public:
+        struct slot_t
+        {
+            K m_key;
+            V m_value;
+        };
+
+        // When the slots cannot be allocated the map is empty without slots (capacity() == 0), the
+        // first insert then tries to allocate again.
+        flat_hash_map_t(alloc_t* allocator, s32 capacity = 0, u64 seed = 0);
+        ~flat_hash_map_t();
+
+        inline s32  size() const { return m_size; }
+        inline bool empty() const { return m_size == 0; }
+        inline s32  capacity() const { return m_slots != nullptr ? (s32)m_mask + 1 : 0; }  // number of slots
+
+        bool insert(K const& key, V const& value);  // false when the key already exists
+        bool find(K const& key, V& value) const;
+        bool contains(K const& key) const { return find_slot(key, hash(key)) >= 0; }
+        bool remove(K const& key);
+        bool reserve(s32 count);  // makes room for 'count' items without rehashing
+        void clear();
+
+    private:
+        inline u64 hash(K const& key) const
+        {
+            if (sizeof(K) <= 8)
+            {
+                u64 v = 0;
+                g_memcpy(&v, &key, sizeof(K));
+                return nhash::wyhash64(v, sizeof(K), m_secret);
+            }
+            return nhash::wyhash_bytes(&key, (s32)sizeof(K), 0, m_secret);
+        }
+
+        s32  find_slot(K const& key, u64 h) const;
+        u32  find_free(u64 h) const;
+        bool rehash(u32 slots);
+
+        static inline u32 s_max_load(u32 slots) { return slots - (slots >> 3); }  // 7/8
+
+        alloc_t* m_allocator;
+        u8*      m_ctrl;
+        slot_t*  m_slots;
+        u32      m_mask;
+        s32      m_size;
+        s32      m_growth_left;  // number of empty slots that can be filled before a rehash
+        u64      m_secret[4];
+    };
+
+    template <typename K, typename V>
+    flat_hash_map_t<K, V>::flat_hash_map_t(alloc_t* allocator, s32 capacity, u64 seed)
+        : m_allocator(allocator)
+        , m_ctrl(nflat::s_empty_group())
+        , m_slots(nullptr)
+        , m_mask(nflat::c_group_width - 1)
+        , m_size(0)
+        , m_growth_left(0)
+    {
+        nhash::wymake_secret(seed, m_secret);
+        u32 slots = nflat::c_min_slots;
+        while (s_max_load(slots) < (u32)capacity)
+            slots <<= 1;
+        if (!rehash(slots))
+        {
+            // Stay on the empty group, nothing is found and the first insert tries to allocate again
+            m_mask = nflat::c_group_width - 1;
+        }
+    }
+
+    template <typename K, typename V>
+    flat_hash_map_t<K, V>::~flat_hash_map_t()
+    {
+        if (m_slots != nullptr)
+        {
+            m_allocator->deallocate(m_ctrl);
+            m_allocator->deallocate(m_slots);
+        }
+    }
+
+    template <typename K, typename V>
+    s32 flat_hash_map_t<K, V>::find_slot(K const& key, u64 h) const
+    {
+        u8 const  h2    = (u8)(h & 0x7F);
+        u32 const gmask = m_mask / nflat::c_group_width;
+        u32       group = (u32)(h >> 7) & gmask;
+        for (u32 i = 1;; ++i)
+        {
+            u32 const            first = group * nflat::c_group_width;
+            nflat::group_t const g(m_ctrl + first);
+            for (nflat::mask_t m = g.match(h2); m != 0; m &= m - 1)
+            {
+                u32 const slot = first + nflat::s_first(m);
+                if (m_slots[slot].m_key == key)
+                    return (s32)slot;
+            }
+            if (g.match_empty() != 0)
+                return -1;
+            group = (group + i) & gmask;
+        }
+    }
+
+    // The first empty or deleted slot in the probe sequence of 'h'
+    template <typename K, typename V>
+    u32 flat_hash_map_t<K, V>::find_free(u64 h) const
+    {
+        u32 const gmask = m_mask / nflat::c_group_width;
+        u32       group = (u32)(h >> 7) & gmask;
+        for (u32 i = 1;; ++i)
+        {
+            u32 const            first = group * nflat::c_group_width;
+            nflat::group_t const g(m_ctrl + first);
+            nflat::mask_t const  m = g.match_free();
+            if (m != 0)
+                return first + nflat::s_first(m);
+            group = (group + i) & gmask;
+        }
+    }
+
+    template <typename K, typename V>
+    bool flat_hash_map_t<K, V>::insert(K const& key, V const& value)
+    {
+        u64 const h = hash(key);
+        if (find_slot(key, h) >= 0)
+            return false;
+
+        u32 slot = find_free(h);
+        if (m_growth_left == 0 && m_ctrl[slot] == nflat::c_empty)
+        {
+            // Full, when less than half of the used slots hold items (the rest are deleted markers) rehash
+            // into new arrays of the same size, which drops the markers, grow otherwise. Without slots yet
+            // (the empty group) this allocates the minimum size.
+            u32 const slots = m_slots == nullptr ? nflat::c_min_slots : (u32)m_size < (s_max_load(m_mask + 1) >> 1) ? m_mask + 1 : (m_mask + 1) << 1;
+            if (!rehash(slots))
+                return false;
+            slot = find_free(h);
+        }
+
+        m_growth_left -= (m_ctrl[slot] == nflat::c_empty) ? 1 : 0;
+        m_ctrl[slot]          = (u8)(h & 0x7F);
+        m_slots[slot].m_key   = key;
+        m_slots[slot].m_value = value;
+        m_size += 1;
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool flat_hash_map_t<K, V>::find(K const& key, V& value) const
+    {
+        s32 const slot = find_slot(key, hash(key));
+        if (slot < 0)
+            return false;
+        value = m_slots[slot].m_value;
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool flat_hash_map_t<K, V>::remove(K const& key)
+    {
+        s32 const slot = find_slot(key, hash(key));
+        if (slot < 0)
+            return false;
+
+        // No probe sequence went past a group that still has an empty slot, no marker needed
+        nflat::group_t const g(m_ctrl + ((u32)slot & ~(nflat::c_group_width - 1)));
+        if (g.match_empty() != 0)
+        {
+            m_ctrl[slot] = nflat::c_empty;
+            m_growth_left += 1;
+        }
+        else
+        {
+            m_ctrl[slot] = nflat::c_deleted;
+        }
+        m_size -= 1;
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool flat_hash_map_t<K, V>::reserve(s32 count)
+    {
+        u32 slots = m_slots != nullptr ? m_mask + 1 : nflat::c_min_slots;
+        while (s_max_load(slots) < (u32)count)
+            slots <<= 1;
+        return (m_slots != nullptr && slots == (m_mask + 1)) || rehash(slots);
+    }
+
+    template <typename K, typename V>
+    void flat_hash_map_t<K, V>::clear()
+    {
+        if (m_slots == nullptr)
+            return;
+        g_memset(m_ctrl, nflat::c_empty, (int_t)m_mask + 1);
+        m_size        = 0;
+        m_growth_left = (s32)s_max_load(m_mask + 1);
+    }
+
+    // Moves all the items into newly allocated arrays with 'slots' slots, this also drops the deleted markers
+    template <typename K, typename V>
+    bool flat_hash_map_t<K, V>::rehash(u32 slots)
+    {
+        u8*     ctrl  = (u8*)m_allocator->allocate(slots, 16);
+        slot_t* items = (slot_t*)m_allocator->allocate((u32)sizeof(slot_t) * slots, (u32)alignof(slot_t));
+        if (ctrl == nullptr || items == nullptr)
+        {
+            m_allocator->deallocate(ctrl);
+            m_allocator->deallocate(items);
+            return false;
+        }
+        g_memset(ctrl, nflat::c_empty, (int_t)slots);
+
+        u8* const     old_ctrl  = m_ctrl;
+        slot_t* const old_slots = m_slots;
+        u32 const     old_count = (old_slots != nullptr) ? m_mask + 1 : 0;
+
+        m_ctrl        = ctrl;
+        m_slots       = items;
+        m_mask        = slots - 1;
+        m_growth_left = (s32)s_max_load(slots) - m_size;
+        for (u32 i = 0; i < old_count; ++i)
+        {
+            if ((old_ctrl[i] & 0x80) != 0)
+                continue;
+            u64 const h = hash(old_slots[i].m_key);
+            u32 const s = find_free(h);
+            m_ctrl[s]   = (u8)(h & 0x7F);
+            m_slots[s]  = old_slots[i];
+        }
+
+        if (old_slots != nullptr)
+        {
+            m_allocator->deallocate(old_ctrl);
+            m_allocator->deallocate(old_slots);
+        }
+        return true;
+    }
+
+};  // namespace ncore
+
+#endif  // __CBASE_FLAT_HASH_MAP_H__
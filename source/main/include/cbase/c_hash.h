@@ -23,8 +23,72 @@ namespace ncore
         virtual void end(u8* out_hash, s32 size)          = 0;
     };
 
+    class cbuffer_t;
+
     namespace nhash
     {
+        // xxh3 style hasher, 64 or 128 bit. Eight 64-bit accumulators take 64 byte stripes, every 16
+        // stripes the accumulators are scrambled, the last (partial, zero padded) stripe and the
+        // length are folded in at the end. Note: This follows the structure of XXH3 but is not bit
+        // compatible with it, use it for hashing within this library, not for exchanging hashes.
+        class xxh3_hasher_t final : public hasher_t
+        {
+        public:
+            xxh3_hasher_t(s32 bits = 64, u64 seed = 0);  // 'bits' is 64 or 128
+
+            s32  size() const override { return m_bits / 8; }
+            void reset() override;
+            void begin() override;
+            void hash(const u8* begin, const u8* end) override;
+            void end(u8* out_hash, s32 size) override;  // little-endian, the low 64 bits first
+            u64  digest() const;                        // the 64-bit hash (also the low 64 bits of the 128-bit hash)
+            void digest128(u64& lo, u64& hi) const;
+
+        private:
+            void finish(u64* acc) const;
+
+            s32 m_bits;
+            s32 m_stripe;  // stripes since the last scramble
+            u64 m_seed;
+            u64 m_length;
+            u64 m_pending;
+            u64 m_acc[8];
+            u64 m_secret[24];  // stripe i (of 16) uses m_secret[i .. i+7]
+            u64 m_scramble[8];
+            u8  m_buffer[64];
+        };
+
+        // CRC-32C (Castagnoli, the polynomial of iSCSI/ext4/SSE4.2), uses the crc32 instruction when
+        // the CPU has it (checked at runtime on x86), otherwise slicing-by-8 tables.
+        // crc32c("123456789") == 0xE3069283
+        u32 crc32c(void const* data, int_t size, u32 crc = 0);     // 'crc' is a previous result to continue from
+        u32 crc32c_sw(void const* data, int_t size, u32 crc = 0);  // always the tables, to test the fallback on hosts with the instruction
+
+        // CRC-32C of 'n' buffers into 'out', with the crc32 instruction several buffers are done at
+        // the same time to hide its latency.
+        void crc32c_many(cbuffer_t const* buffers, s32 n, u32* out);
+
+        class crc32c_hasher_t final : public hasher_t
+        {
+        public:
+            crc32c_hasher_t()
+                : m_crc(0)
+            {
+            }
+
+            s32  size() const override { return 4; }
+            void reset() override { m_crc = 0; }
+            void begin() override { m_crc = 0; }
+            void hash(const u8* begin, const u8* end) override { m_crc = crc32c(begin, end - begin, m_crc); }
+            void end(u8* out_hash, s32 size) override;  // little-endian
+            u32  digest() const { return m_crc; }
+
+        private:
+            u32 m_crc;
+        };
+
+        // String hashes that do not depend on the encoding, the same text as ascii (Latin-1), utf-8,
+        // ucs-2, utf-16 or utf-32 gives the same hash. The '_lowercase' versions fold A-Z to a-z.
         u64 strhash(crunes_t const& str, u64 seed = 0);
         u64 strhash_lowercase(crunes_t const& str, u64 seed = 0);
 
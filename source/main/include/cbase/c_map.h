@@ -18,6 +18,42 @@ namespace ncore
     // NO hashing done on the key.
     // -----------------------------------------------------------------------------------
 
+    namespace nmap
+    {
+        // Chunked node pool, nodes are carved from contiguous chunks and recycled through a free list.
+        // Releasing the pool frees all the chunks in O(chunks) without visiting the nodes.
+        struct node_pool_t
+        {
+            inline node_pool_t()
+                : m_allocator(nullptr)
+                , m_chunks(nullptr)
+                , m_free(nullptr)
+                , m_cursor(nullptr)
+                , m_end(nullptr)
+                , m_node_size(0)
+                , m_node_align(0)
+                , m_chunk_nodes(0)
+            {
+            }
+
+            void  setup(alloc_t* allocator, u32 node_size, u32 node_align, u32 chunk_nodes);
+            void* allocate();
+            void  deallocate(void* node);
+            void  release();  // frees all the chunks, every node allocated from the pool is gone
+
+            inline bool enabled() const { return m_chunk_nodes > 0; }
+
+            alloc_t* m_allocator;
+            void*    m_chunks;  // linked list of chunks
+            void*    m_free;    // linked list of free nodes
+            byte*    m_cursor;  // the next never used node in the current chunk
+            byte*    m_end;     // the end of the current chunk
+            u32      m_node_size;
+            u32      m_node_align;
+            u32      m_chunk_nodes;
+        };
+    }  // namespace nmap
+
     template <typename K, typename V>
     class map_t
     {
@@ -29,21 +65,58 @@ namespace ncore
                 , m_size(0)
             {
             }
-            alloc_t*       m_allocator;
-            ntree::node_t* m_root;
-            s32            m_size;
+            alloc_t*          m_allocator;
+            ntree::node_t*    m_root;
+            s32               m_size;
+            nmap::node_pool_t m_pool;
         };
         data_t m_data;
 
         static inline ntree::node_t* s_new_node(void* user_data)
         {
             data_t* data = (data_t*)user_data;
-            item_t* item = g_construct<item_t>(data->m_allocator);
+            void*   mem  = data->m_pool.enabled() ? data->m_pool.allocate() : data->m_allocator->allocate(sizeof(item_t), alignof(item_t));
+            if (mem == nullptr)
+                return nullptr;
+            item_t* item = new (mem) item_t();
             item->set_child(ntree::LEFT, nullptr);
             item->set_child(ntree::RIGHT, nullptr);
             return (ntree::node_t*)item;
         }
 
+        struct build_t
+        {
+            data_t*  m_data;
+            K const* m_keys;
+            V const* m_values;
+            s32      m_index;
+            bool     m_failed;
+        };
+
+        static ntree::node_t* s_build_node(void* user_data)
+        {
+            build_t*       build = (build_t*)user_data;
+            ntree::node_t* node  = build->m_failed ? nullptr : s_new_node(build->m_data);
+            if (node == nullptr)
+            {
+                build->m_failed = true;
+                return nullptr;
+            }
+            item_t* item = (item_t*)node;
+            item->key            = build->m_keys[build->m_index];
+            item->value          = build->m_values[build->m_index];
+            build->m_index += 1;
+            return node;
+        }
+
+        static inline void s_delete_node(data_t* data, ntree::node_t* node)
+        {
+            if (data->m_pool.enabled())
+                data->m_pool.deallocate(node);
+            else
+                g_destruct(data->m_allocator, (item_t*)node);
+        }
+
         static inline s8 compare_key_with_node(const void* _key, const ntree::node_t* _node)
         {
             K const*      key  = (K*)_key;
@@ -67,9 +140,13 @@ namespace ncore
         }
 
     public:
-        inline map_t(alloc_t* a)
+        // When 'nodes_per_chunk' is not 0 the nodes come from an embedded pool of chunks holding that many
+        // nodes, destroying or clearing the map then releases the chunks without walking the tree.
+        inline map_t(alloc_t* a, s32 nodes_per_chunk = 0)
             : m_data(a)
         {
+            if (nodes_per_chunk > 0)
+                m_data.m_pool.setup(a, sizeof(item_t), alignof(item_t), nodes_per_chunk);
         }
 
         struct item_t : public ntree::node_t
@@ -80,14 +157,25 @@ namespace ncore
             DCORE_CLASS_PLACEMENT_NEW_DELETE
         };
 
-        inline ~map_t()
+        inline ~map_t() { clear(); }
+
+        inline void clear()
         {
-            ntree::node_t* n;
-            while (!ntree::clear(m_data.m_root, n))
+            if (m_data.m_pool.enabled())
+            {
+                m_data.m_pool.release();
+                m_data.m_root = nullptr;
+            }
+            else
             {
-                item_t* item = (item_t*)n;
-                g_destruct(m_data.m_allocator, item);
+                ntree::node_t* n;
+                while (!ntree::clear(m_data.m_root, n))
+                {
+                    item_t* item = (item_t*)n;
+                    g_destruct(m_data.m_allocator, item);
+                }
             }
+            m_data.m_size = 0;
         }
 
         inline int_t size() const { return m_data.m_size; }
@@ -108,6 +196,23 @@ namespace ncore
             return true;
         }
 
+        // Builds the map in O(n) from keys that are sorted in ascending order and unique, the map must be empty.
+        // Returns false when the map is not empty or a node could not be allocated (the map is then empty).
+        bool build_from_sorted(K const* keys, V const* values, s32 count)
+        {
+            if (m_data.m_root != nullptr)
+                return false;
+            build_t build = {&m_data, keys, values, 0, false};
+            m_data.m_root = ntree::build_from_sorted(count, s_build_node, &build);
+            m_data.m_size = count;
+            if (build.m_failed)
+            {
+                clear();
+                return false;
+            }
+            return true;
+        }
+
         inline bool find(K const& _key, V& _value) const
         {
             ntree::node_t* found;
@@ -126,14 +231,19 @@ namespace ncore
             ntree::node_t* removed;
             if (ntree::remove(m_data.m_root, &temp, (void const*)&key, compare_key_with_node, removed))
             {
-                item_t* item = (item_t*)removed;
-                g_destruct(m_data.m_allocator, item);
+                s_delete_node(&m_data, removed);
                 m_data.m_size--;
                 return true;
             }
             return false;
         }
 
+        // Ordered queries, O(log n), return nullptr when there is no such item
+        inline item_t const* lower_bound(K const& key) const { return s_bound(m_data.m_root, ntree::lower_bound, key); }  // first item with key >= 'key'
+        inline item_t const* upper_bound(K const& key) const { return s_bound(m_data.m_root, ntree::upper_bound, key); }  // first item with key > 'key'
+        inline item_t const* floor(K const& key) const { return s_bound(m_data.m_root, ntree::floor, key); }              // last item with key <= 'key'
+        inline item_t const* ceil(K const& key) const { return s_bound(m_data.m_root, ntree::ceil, key); }                // first item with key >= 'key'
+
         struct iterator_t
         {
             inline bool          traverse(s32 d = ntree::LEFT) { return m_iter.traverse(m_root, d, m_item); }
@@ -141,15 +251,29 @@ namespace ncore
             inline bool          sortorder(s32 d = ntree::LEFT) { return m_iter.sortorder(m_root, d, m_item); }
             inline bool          postorder(s32 d = ntree::LEFT) { return m_iter.postorder(m_root, d, m_item); }
             inline bool          next() { return traverse(); }
-            inline bool          order() { return sortorder(); }
             inline item_t const* item() const { return (item_t const*)m_item; }
 
+            inline bool order()
+            {
+                if (!sortorder())
+                    return false;
+                if (m_bounded && item()->key > m_to)
+                {
+                    m_iter.m_stack = 0;
+                    m_iter.m_it    = nullptr;
+                    return false;
+                }
+                return true;
+            }
+
         protected:
             friend class map_t;
             iterator_t(ntree::node_t const* root)
                 : m_root(root)
                 , m_item(nullptr)
                 , m_iter()
+                , m_to()
+                , m_bounded(false)
             {
             }
 
@@ -157,9 +281,31 @@ namespace ncore
             ntree::node_t const* m_root;
             ntree::node_t const* m_item;
             ntree::iterator_t    m_iter;
+            K                    m_to;
+            bool                 m_bounded;
         };
 
         inline iterator_t iterate() const { return iterator_t(m_data.m_root); }
+
+        // Iterates, using 'order()', the items with 'from' <= key <= 'to' in ascending order in O(log n + k)
+        inline iterator_t range(K const& from, K const& to) const
+        {
+            iterator_t iter(m_data.m_root);
+            iter.m_iter.seek(m_data.m_root, (void const*)&from, compare_key_with_node, ntree::LEFT);
+            iter.m_to      = to;
+            iter.m_bounded = true;
+            return iter;
+        }
+
+    private:
+        typedef bool (*bound_fn)(ntree::node_t* root, void const* key, ntree::compare_key_and_node_fn comparer, ntree::node_t*& found);
+
+        static inline item_t const* s_bound(ntree::node_t* root, bound_fn bound, K const& key)
+        {
+            ntree::node_t* found;
+            bound(root, (void const*)&key, compare_key_with_node, found);
+            return (item_t const*)found;
+        }
     };
 
     template <typename K>
@@ -173,9 +319,10 @@ namespace ncore
                 , m_size(0)
             {
             }
-            alloc_t*       m_allocator;
-            ntree::node_t* m_root;
-            s32            m_size;
+            alloc_t*          m_allocator;
+            ntree::node_t*    m_root;
+            s32               m_size;
+            nmap::node_pool_t m_pool;
         };
 
         data_t m_data;
@@ -183,12 +330,46 @@ namespace ncore
         static inline ntree::node_t* s_new_node(void* user_data)
         {
             data_t* data = (data_t*)user_data;
-            item_t* item = g_construct<item_t>(data->m_allocator);
+            void*   mem  = data->m_pool.enabled() ? data->m_pool.allocate() : data->m_allocator->allocate(sizeof(item_t), alignof(item_t));
+            if (mem == nullptr)
+                return nullptr;
+            item_t* item = new (mem) item_t();
             item->set_child(ntree::LEFT, nullptr);
             item->set_child(ntree::RIGHT, nullptr);
             return (ntree::node_t*)item;
         }
 
+        struct build_t
+        {
+            data_t*  m_data;
+            K const* m_keys;
+            s32      m_index;
+            bool     m_failed;
+        };
+
+        static ntree::node_t* s_build_node(void* user_data)
+        {
+            build_t*       build = (build_t*)user_data;
+            ntree::node_t* node  = build->m_failed ? nullptr : s_new_node(build->m_data);
+            if (node == nullptr)
+            {
+                build->m_failed = true;
+                return nullptr;
+            }
+            item_t* item = (item_t*)node;
+            item->key            = build->m_keys[build->m_index];
+            build->m_index += 1;
+            return node;
+        }
+
+        static inline void s_delete_node(data_t* data, ntree::node_t* node)
+        {
+            if (data->m_pool.enabled())
+                data->m_pool.deallocate(node);
+            else
+                g_destruct(data->m_allocator, (item_t*)node);
+        }
+
         static inline s8 compare_key_with_node(const void* _key, const ntree::node_t* _node)
         {
             K const*      key  = (K*)_key;
@@ -212,9 +393,13 @@ namespace ncore
         }
 
     public:
-        inline set_t(alloc_t* a)
+        // When 'nodes_per_chunk' is not 0 the nodes come from an embedded pool of chunks holding that many
+        // nodes, destroying or clearing the set then releases the chunks without walking the tree.
+        inline set_t(alloc_t* a, s32 nodes_per_chunk = 0)
             : m_data(a)
         {
+            if (nodes_per_chunk > 0)
+                m_data.m_pool.setup(a, sizeof(item_t), alignof(item_t), nodes_per_chunk);
         }
 
         struct item_t : public ntree::node_t
@@ -224,14 +409,25 @@ namespace ncore
             DCORE_CLASS_PLACEMENT_NEW_DELETE
         };
 
-        ~set_t()
+        inline ~set_t() { clear(); }
+
+        inline void clear()
         {
-            ntree::node_t* n;
-            while (!ntree::clear(m_data.m_root, n))
+            if (m_data.m_pool.enabled())
+            {
+                m_data.m_pool.release();
+                m_data.m_root = nullptr;
+            }
+            else
             {
-                item_t* item = (item_t*)n;
-                g_destruct(m_data.m_allocator, item);
+                ntree::node_t* n;
+                while (!ntree::clear(m_data.m_root, n))
+                {
+                    item_t* item = (item_t*)n;
+                    g_destruct(m_data.m_allocator, item);
+                }
             }
+            m_data.m_size = 0;
         }
 
         inline int_t size() const { return m_data.m_size; }
@@ -251,6 +447,23 @@ namespace ncore
             return true;
         }
 
+        // Builds the set in O(n) from keys that are sorted in ascending order and unique, the set must be empty.
+        // Returns false when the set is not empty or a node could not be allocated (the set is then empty).
+        bool build_from_sorted(K const* keys, s32 count)
+        {
+            if (m_data.m_root != nullptr)
+                return false;
+            build_t build = {&m_data, keys, 0, false};
+            m_data.m_root = ntree::build_from_sorted(count, s_build_node, &build);
+            m_data.m_size = count;
+            if (build.m_failed)
+            {
+                clear();
+                return false;
+            }
+            return true;
+        }
+
         inline bool contains(K const& _key) const
         {
             ntree::node_t* found;
@@ -263,8 +476,8 @@ namespace ncore
             ntree::node_t* removed;
             if (ntree::remove(m_data.m_root, &temp, (void const*)&key, compare_key_with_node, removed))
             {
-                item_t* item = (item_t*)removed;
-                g_destruct(m_data.m_allocator, item);
+                s_delete_node(&m_data, removed);
+                m_data.m_size--;
                 return true;
             }
             return false;
@@ -5,6 +5,7 @@
 #    pragma once
 #endif
 
+#include "ccore/c_debug.h"
 #include "cbase/c_allocator.h"
 #include "cbase/c_tree32.h"
 
@@ -21,31 +22,149 @@ namespace ncore
     // can find the key/value and the node index.
     // -----------------------------------------------------------------------------------
 
+    struct arena_t;
+
+    namespace nmap32
+    {
+        // Slot 0 and 1 of the arrays are the 'find' and 'temp' slot used by the tree functions,
+        // items start at slot 2. Node index 0x7FFFFFFF is reserved for c_invalid_node (colour bit).
+        enum
+        {
+            c_find_slot = 0,
+            c_temp_slot = 1,
+            c_first_item = 2,
+        };
+        const u32 c_max_slots           = 0x7FFFFFFF;
+        const u32 c_reserve_factor      = 16;       // 'reserved' = 0 reserves address space for 16 x 'capacity' items,
+        const u32 c_min_default_reserve = 1 << 16;  // but for at least 64K items
+
+        // The reservation used when the constructor is given 'reserved' = 0
+        inline u32 default_reserved(u32 capacity)
+        {
+            u64 const reserved = (u64)capacity * c_reserve_factor;
+            return reserved < c_min_default_reserve ? c_min_default_reserve : (reserved > c_max_slots ? c_max_slots : (u32)reserved);
+        }
+
+        // Parallel arrays (nodes, keys, values and optional subtree sizes) that each live in their own virtual memory arena,
+        // they grow in place so node indices and item addresses stay valid.
+        struct arrays_t
+        {
+            enum
+            {
+                c_max_arrays = 4
+            };
+
+            inline arrays_t()
+                : m_num_arrays(0)
+                , m_capacity(0)
+                , m_reserved(0)
+            {
+                for (s32 i = 0; i < c_max_arrays; ++i)
+                {
+                    m_arena[i]     = nullptr;
+                    m_array[i]     = nullptr;
+                    m_item_size[i] = 0;
+                }
+            }
+
+            // 'capacity' slots are committed and 'reserved' slots of address space are reserved
+            bool setup(s32 num_arrays, s32 const* item_sizes, s32 const* item_alignments, u32 capacity, u32 reserved);
+            void teardown();
+            bool set_capacity(u32 capacity);  // commits up to 'capacity' slots, never shrinks
+            bool grow();                      // grows the capacity by 50% (at least 64 KB worth of nodes)
+
+            arena_t* m_arena[c_max_arrays];
+            void*    m_array[c_max_arrays];
+            s32      m_item_size[c_max_arrays];
+            s32      m_num_arrays;
+            u32      m_capacity;  // number of committed slots
+            u32      m_reserved;  // maximum number of slots
+        };
+
+        // Compares 'm_key' with the key of a node, inlined by the templated ntree32 searches
+        template <typename K>
+        struct key_compare_t
+        {
+            K const& m_key;
+            K const* m_keys;
+
+            inline s8 operator()(ntree32::node_t node) const { return (m_key < m_keys[node]) ? -1 : ((m_key > m_keys[node]) ? 1 : 0); }
+        };
+
+        // Compares key 'i' of a batch with the key of a node, for ntree32::find_many
+        template <typename K>
+        struct batch_compare_t
+        {
+            K const* m_batch;
+            K const* m_keys;
+
+            inline s8   operator()(u32 i, ntree32::node_t node) const { return (m_batch[i] < m_keys[node]) ? -1 : ((m_batch[i] > m_keys[node]) ? 1 : 0); }
+            inline void prefetch(ntree32::node_t node) const { nmem::prefetch(&m_keys[node]); }
+        };
+
+        // Number of keys resolved per ntree32::find_many call (the found nodes live on the stack)
+        const u32 c_batch_size = 64;
+    }  // namespace nmap32
+
     template <typename K, typename V>
     class map32_t
     {
         struct data_t
         {
-            data_t(alloc_t* a, u32 capacity)
+            data_t(alloc_t* a)
                 : m_allocator(a)
                 , m_tree()
                 , m_root(ntree32::c_invalid_node)
-                , m_capacity(capacity)
+                , m_size(0)
                 , m_nodes(nullptr)
                 , m_keys(nullptr)
                 , m_values(nullptr)
+                , m_sizes(nullptr)
+                , m_order_statistics(false)
             {
             }
             alloc_t*          m_allocator;
             ntree32::tree_t   m_tree;
             ntree32::node_t   m_root;
-            u32               m_capacity;
+            u32               m_size;
+            nmap32::arrays_t  m_arrays;
             ntree32::nnode_t* m_nodes;
             K*                m_keys;
             V*                m_values;
+            u32*              m_sizes;  // subtree sizes, only when 'm_order_statistics' is true
+            bool              m_order_statistics;
 
-            inline u32 find_slot() const { return m_capacity; }
-            inline u32 temp_slot() const { return m_capacity + 1; }
+            inline u32 find_slot() const { return nmap32::c_find_slot; }
+            inline u32 temp_slot() const { return nmap32::c_temp_slot; }
+
+            bool setup(nmap32::arrays_t& arrays, u32 capacity, u32 reserved)
+            {
+                s32 const sizes[]  = {(s32)sizeof(ntree32::nnode_t), (s32)sizeof(K), (s32)sizeof(V), (s32)sizeof(u32)};
+                s32 const aligns[] = {(s32)alignof(ntree32::nnode_t), (s32)alignof(K), (s32)alignof(V), (s32)alignof(u32)};
+                return arrays.setup(m_order_statistics ? 4 : 3, sizes, aligns, capacity + nmap32::c_first_item, reserved + nmap32::c_first_item);
+            }
+
+            void attach(nmap32::arrays_t& arrays)
+            {
+                m_arrays.teardown();
+                m_arrays = arrays;
+                m_nodes  = (ntree32::nnode_t*)m_arrays.m_array[0];
+                m_keys   = (K*)m_arrays.m_array[1];
+                m_values = (V*)m_arrays.m_array[2];
+                m_sizes  = m_order_statistics ? (u32*)m_arrays.m_array[3] : nullptr;
+                ntree32::setup_tree(m_tree, m_nodes, m_sizes);
+                m_tree.m_free_index = nmap32::c_first_item;
+                m_root              = ntree32::c_invalid_node;
+                m_size              = 0;
+            }
+
+            // makes sure the tree can take one more node, grows the arrays in place when necessary
+            inline bool ensure_free_node()
+            {
+                if (m_tree.m_free_head != ntree32::c_invalid_node || m_tree.m_free_index < m_arrays.m_capacity)
+                    return true;
+                return m_arrays.grow();
+            }
         };
 
         data_t m_data;
@@ -63,48 +182,104 @@ namespace ncore
         }
 
     public:
-        inline map32_t(alloc_t* a, u32 capacity = 65535 - 2)
-            : m_data(a, capacity)
+        // The arrays live in virtual memory, 'capacity' items are committed up front and the map grows
+        // in place up to 'reserved' items (0 = nmap32::default_reserved(capacity), 16 x 'capacity' and at
+        // least 64K items). When the memory cannot be reserved 'valid()' is false and every insert fails.
+        // With 'order_statistics' the tree also maintains subtree sizes (4 bytes per item) to support 'rank' and 'select'.
+        inline map32_t(alloc_t* a, u32 capacity = 65535 - 2, u32 reserved = 0, bool order_statistics = false)
+            : m_data(a)
         {
-            m_data.m_nodes  = g_allocate_array<ntree32::nnode_t>(m_data.m_allocator, capacity + 2);
-            m_data.m_keys   = g_allocate_array<K>(m_data.m_allocator, capacity + 2);
-            m_data.m_values = g_allocate_array<V>(m_data.m_allocator, capacity + 2);
-            ntree32::setup_tree(m_data.m_tree, m_data.m_nodes);
+            m_data.m_order_statistics = order_statistics;
+            if (reserved == 0)
+                reserved = nmap32::default_reserved(capacity);
+            nmap32::arrays_t arrays;
+            m_data.setup(arrays, capacity, reserved);
+            m_data.attach(arrays);
         }
 
         inline ~map32_t()
         {
-            ntree32::node_t n;
-            while (!ntree32::clear(m_data.m_tree, m_data.m_root, n))
+            ntree32::teardown_tree(m_data.m_tree);
+            m_data.m_arrays.teardown();
+        }
+
+        inline bool valid() const { return m_data.m_keys != nullptr; }
+        inline u32  size() const { return m_data.m_size; }
+        inline u32 capacity() const { return m_data.m_arrays.m_capacity - nmap32::c_first_item; }
+        inline u32 reserved() const { return m_data.m_arrays.m_reserved - nmap32::c_first_item; }
+
+        // Commits memory for at least 'capacity' items, fails when that exceeds the reservation
+        inline bool reserve(u32 capacity) { return m_data.m_arrays.set_capacity(capacity + nmap32::c_first_item); }
+
+        // Moves the items into new arrays that are committed for exactly 'size()' items and rebuilds the tree
+        // in O(n), this invalidates iterators. Returns false when the new arrays could not be created.
+        bool shrink_to_fit()
+        {
+            nmap32::arrays_t arrays;
+            if (!m_data.setup(arrays, m_data.m_size, reserved()))
+                return false;
+
+            K*                keys   = (K*)arrays.m_array[1];
+            V*                values = (V*)arrays.m_array[2];
+            u32               count  = 0;
+            iterator_t        iter   = iterate();
+            while (iter.order())
             {
-                m_data.m_tree.del_node(n);
+                keys[nmap32::c_first_item + count]   = iter.key();
+                values[nmap32::c_first_item + count] = iter.value();
+                count += 1;
             }
-            ntree32::teardown_tree(m_data.m_tree);
-            g_deallocate_array(m_data.m_allocator, m_data.m_keys);
-            g_deallocate_array(m_data.m_allocator, m_data.m_values);
-            g_deallocate_array(m_data.m_allocator, m_data.m_nodes);
+
+            m_data.attach(arrays);
+            m_data.m_tree.m_free_index = nmap32::c_first_item + count;
+            m_data.m_root              = ntree32::build_from_sorted(m_data.m_tree, nmap32::c_first_item, count);
+            m_data.m_size              = count;
+            return true;
         }
 
         bool insert(K const& _key, V const& _value)
         {
+            if (!m_data.ensure_free_node())
+                return false;
             m_data.m_keys[m_data.find_slot()] = _key;
             ntree32::node_t inserted;
             if (ntree32::insert(m_data.m_tree, m_data.m_root, m_data.temp_slot(), m_data.find_slot(), s_compare, &m_data, inserted))
             {
                 m_data.m_keys[inserted]   = _key;
                 m_data.m_values[inserted] = _value;
+                m_data.m_size += 1;
                 return true;
             }
             return false;
         }
 
+        // Builds the map in O(n) from keys that are sorted in ascending order and unique, the map must be empty
+        bool build_from_sorted(K const* keys, V const* values, u32 count)
+        {
+            if (m_data.m_root != ntree32::c_invalid_node || !reserve(count))
+                return false;
+            for (u32 i = 0; i < count; ++i)
+            {
+                m_data.m_keys[nmap32::c_first_item + i]   = keys[i];
+                m_data.m_values[nmap32::c_first_item + i] = values[i];
+            }
+            m_data.m_tree.reset();
+            m_data.m_tree.m_free_index = nmap32::c_first_item + count;
+            m_data.m_root              = ntree32::build_from_sorted(m_data.m_tree, nmap32::c_first_item, count);
+            m_data.m_size              = count;
+            return true;
+        }
+
         bool remove(K const& key)
         {
+            if (m_data.m_root == ntree32::c_invalid_node)
+                return false;
             m_data.m_keys[m_data.find_slot()] = key;
             ntree32::node_t removed;
             if (ntree32::remove(m_data.m_tree, m_data.m_root, m_data.temp_slot(), m_data.find_slot(), s_compare, &m_data, removed))
             {
                 m_data.m_tree.del_node(removed);
+                m_data.m_size -= 1;
                 return true;
             }
             return false;
@@ -112,15 +287,138 @@ namespace ncore
 
         bool find(K const& _key, V& _value) const
         {
-            m_data.m_keys[m_data.find_slot()] = _key;
-            ntree32::node_t found;
-            if (ntree32::find(m_data.m_tree, m_data.m_root, m_data.find_slot(), s_compare, &m_data, found))
+            nmap32::key_compare_t<K> const cmp = {_key, m_data.m_keys};
+            ntree32::node_t                found;
+            if (ntree32::find(m_data.m_tree, m_data.m_root, cmp, found))
             {
                 _value = m_data.m_values[found];
                 return true;
             }
             return false;
         }
+
+        // Looks up 'count' keys in one go, the searches are interleaved so that their memory loads overlap.
+        // 'values[i]' is only written when keys[i] is present, 'found' (optional) receives whether it is.
+        // Returns the number of keys that were found.
+        u32 find_many(K const* keys, u32 count, V* values, bool* found = nullptr) const
+        {
+            ntree32::node_t nodes[nmap32::c_batch_size];
+            u32             num_found = 0;
+            for (u32 i = 0; i < count; i += nmap32::c_batch_size)
+            {
+                u32 const                        n   = (count - i) < nmap32::c_batch_size ? (count - i) : nmap32::c_batch_size;
+                nmap32::batch_compare_t<K> const cmp = {keys + i, m_data.m_keys};
+                num_found += ntree32::find_many(m_data.m_tree, m_data.m_root, n, cmp, nodes);
+                for (u32 j = 0; j < n; ++j)
+                {
+                    if (nodes[j] != ntree32::c_invalid_node)
+                        values[i + j] = m_data.m_values[nodes[j]];
+                    if (found != nullptr)
+                        found[i + j] = nodes[j] != ntree32::c_invalid_node;
+                }
+            }
+            return num_found;
+        }
+
+        // Order statistics, O(log n), only available when constructed with 'order_statistics'
+        u32 rank(K const& key) const  // number of items with a key less than 'key'
+        {
+            ASSERT(m_data.m_order_statistics);
+            if (m_data.m_root == ntree32::c_invalid_node)
+                return 0;
+            m_data.m_keys[m_data.find_slot()] = key;
+            return ntree32::rank(m_data.m_tree, m_data.m_root, m_data.find_slot(), s_compare, &m_data);
+        }
+
+        bool select(u32 index, K& found_key, V& found_value) const  // the item at 'index' in sorted order (0-based)
+        {
+            ASSERT(m_data.m_order_statistics);
+            ntree32::node_t found;
+            if (ntree32::select(m_data.m_tree, m_data.m_root, index, found))
+            {
+                found_key   = m_data.m_keys[found];
+                found_value = m_data.m_values[found];
+                return true;
+            }
+            return false;
+        }
+
+        // Ordered queries, O(log n), return false when there is no such item
+        bool lower_bound(K const& key, K& found_key, V& found_value) const { return bound(ntree32::lower_bound, key, found_key, found_value); }  // first item with key >= 'key'
+        bool upper_bound(K const& key, K& found_key, V& found_value) const { return bound(ntree32::upper_bound, key, found_key, found_value); }  // first item with key > 'key'
+        bool floor(K const& key, K& found_key, V& found_value) const { return bound(ntree32::floor, key, found_key, found_value); }              // last item with key <= 'key'
+        bool ceil(K const& key, K& found_key, V& found_value) const { return bound(ntree32::ceil, key, found_key, found_value); }                // first item with key >= 'key'
+
+        struct iterator_t
+        {
+            inline bool sortorder(s32 d = ntree32::LEFT) { return m_iter.sortorder(m_data->m_tree, d, m_node); }
+            inline K const& key() const { return m_data->m_keys[m_node]; }
+            inline V const& value() const { return m_data->m_values[m_node]; }
+
+            inline bool order()
+            {
+                if (!sortorder())
+                    return false;
+                if (m_bounded && key() > m_to)
+                {
+                    m_iter.m_stack = 0;
+                    m_iter.m_it    = ntree32::c_invalid_node;
+                    return false;
+                }
+                return true;
+            }
+
+        protected:
+            friend class map32_t;
+            iterator_t(data_t* data)
+                : m_data(data)
+                , m_node(ntree32::c_invalid_node)
+                , m_iter(ntree32::iterate(data->m_tree, data->m_root))
+                , m_to()
+                , m_bounded(false)
+            {
+            }
+
+        private:
+            data_t*             m_data;
+            ntree32::node_t     m_node;
+            ntree32::iterator_t m_iter;
+            K                   m_to;
+            bool                m_bounded;
+        };
+
+        inline iterator_t iterate() const { return iterator_t((data_t*)&m_data); }
+
+        // Iterates, using 'order()', the items with 'from' <= key <= 'to' in ascending order in O(log n + k)
+        inline iterator_t range(K const& from, K const& to) const
+        {
+            iterator_t iter((data_t*)&m_data);
+            if (m_data.m_root == ntree32::c_invalid_node)
+                return iter;
+            m_data.m_keys[m_data.find_slot()] = from;
+            iter.m_iter.seek(m_data.m_tree, m_data.find_slot(), s_compare, &m_data, ntree32::LEFT);
+            iter.m_to      = to;
+            iter.m_bounded = true;
+            return iter;
+        }
+
+    private:
+        typedef bool (*bound_fn)(ntree32::tree_t const& c, ntree32::node_t root, ntree32::index_t key, ntree32::compare_fn comparer, void const* user_data, ntree32::node_t& found);
+
+        bool bound(bound_fn fn, K const& key, K& found_key, V& found_value) const
+        {
+            if (m_data.m_root == ntree32::c_invalid_node)
+                return false;
+            m_data.m_keys[m_data.find_slot()] = key;
+            ntree32::node_t found;
+            if (fn(m_data.m_tree, m_data.m_root, m_data.find_slot(), s_compare, &m_data, found))
+            {
+                found_key   = m_data.m_keys[found];
+                found_value = m_data.m_values[found];
+                return true;
+            }
+            return false;
+        }
     };
 
     template <typename K>
@@ -128,24 +426,57 @@ namespace ncore
     {
         struct data_t
         {
-            data_t(alloc_t* a, u32 capacity)
+            data_t(alloc_t* a)
                 : m_allocator(a)
                 , m_tree()
                 , m_root(ntree32::c_invalid_node)
-                , m_capacity(capacity)
+                , m_size(0)
                 , m_nodes(nullptr)
                 , m_keys(nullptr)
+                , m_sizes(nullptr)
+                , m_order_statistics(false)
             {
             }
             alloc_t*          m_allocator;
             ntree32::tree_t   m_tree;
             ntree32::node_t   m_root;
-            u32               m_capacity;
+            u32               m_size;
+            nmap32::arrays_t  m_arrays;
             ntree32::nnode_t* m_nodes;
             K*                m_keys;
+            u32*              m_sizes;  // subtree sizes, only when 'm_order_statistics' is true
+            bool              m_order_statistics;
+
+            inline u32 find_slot() const { return nmap32::c_find_slot; }
+            inline u32 temp_slot() const { return nmap32::c_temp_slot; }
+
+            bool setup(nmap32::arrays_t& arrays, u32 capacity, u32 reserved)
+            {
+                s32 const sizes[]  = {(s32)sizeof(ntree32::nnode_t), (s32)sizeof(K), (s32)sizeof(u32)};
+                s32 const aligns[] = {(s32)alignof(ntree32::nnode_t), (s32)alignof(K), (s32)alignof(u32)};
+                return arrays.setup(m_order_statistics ? 3 : 2, sizes, aligns, capacity + nmap32::c_first_item, reserved + nmap32::c_first_item);
+            }
+
+            void attach(nmap32::arrays_t& arrays)
+            {
+                m_arrays.teardown();
+                m_arrays = arrays;
+                m_nodes  = (ntree32::nnode_t*)m_arrays.m_array[0];
+                m_keys   = (K*)m_arrays.m_array[1];
+                m_sizes  = m_order_statistics ? (u32*)m_arrays.m_array[2] : nullptr;
+                ntree32::setup_tree(m_tree, m_nodes, m_sizes);
+                m_tree.m_free_index = nmap32::c_first_item;
+                m_root              = ntree32::c_invalid_node;
+                m_size              = 0;
+            }
 
-            inline u32 find_slot() const { return m_capacity; }
-            inline u32 temp_slot() const { return m_capacity + 1; }
+            // makes sure the tree can take one more node, grows the arrays in place when necessary
+            inline bool ensure_free_node()
+            {
+                if (m_tree.m_free_head != ntree32::c_invalid_node || m_tree.m_free_index < m_arrays.m_capacity)
+                    return true;
+                return m_arrays.grow();
+            }
         };
         data_t m_data;
 
@@ -162,52 +493,145 @@ namespace ncore
         }
 
     public:
-        inline set32_t(alloc_t* a, u32 capacity = 65535 - 2)
-            : m_data(a, capacity)
+        // The arrays live in virtual memory, 'capacity' items are committed up front and the set grows
+        // in place up to 'reserved' items (0 = nmap32::default_reserved(capacity), 16 x 'capacity' and at
+        // least 64K items). When the memory cannot be reserved 'valid()' is false and every insert fails.
+        // With 'order_statistics' the tree also maintains subtree sizes (4 bytes per item) to support 'rank' and 'select'.
+        inline set32_t(alloc_t* a, u32 capacity = 65535 - 2, u32 reserved = 0, bool order_statistics = false)
+            : m_data(a)
         {
-            m_data.m_nodes = g_allocate_array<ntree32::nnode_t>(m_data.m_allocator, capacity + 2);
-            m_data.m_keys  = g_allocate_array<K>(m_data.m_allocator, capacity + 2);
-            ntree32::setup_tree(m_data.m_tree, m_data.m_nodes);
+            m_data.m_order_statistics = order_statistics;
+            if (reserved == 0)
+                reserved = nmap32::default_reserved(capacity);
+            nmap32::arrays_t arrays;
+            m_data.setup(arrays, capacity, reserved);
+            m_data.attach(arrays);
         }
 
         ~set32_t()
         {
-            ntree32::node_t n;
-            while (!ntree32::clear(m_data.m_tree, m_data.m_root, n))
-            {
-                m_data.m_tree.del_node(n);
-            }
             ntree32::teardown_tree(m_data.m_tree);
-            g_deallocate_array(m_data.m_allocator, m_data.m_keys);
-            g_deallocate_array(m_data.m_allocator, m_data.m_nodes);
+            m_data.m_arrays.teardown();
+        }
+
+        inline bool valid() const { return m_data.m_keys != nullptr; }
+        inline u32  size() const { return m_data.m_size; }
+        inline u32 capacity() const { return m_data.m_arrays.m_capacity - nmap32::c_first_item; }
+        inline u32 reserved() const { return m_data.m_arrays.m_reserved - nmap32::c_first_item; }
+
+        // Commits memory for at least 'capacity' items, fails when that exceeds the reservation
+        inline bool reserve(u32 capacity) { return m_data.m_arrays.set_capacity(capacity + nmap32::c_first_item); }
+
+        // Moves the items into new arrays that are committed for exactly 'size()' items and rebuilds the tree
+        // in O(n). Returns false when the new arrays could not be created.
+        bool shrink_to_fit()
+        {
+            nmap32::arrays_t arrays;
+            if (!m_data.setup(arrays, m_data.m_size, reserved()))
+                return false;
+
+            K*                  keys  = (K*)arrays.m_array[1];
+            u32                 count = 0;
+            ntree32::iterator_t iter  = ntree32::iterate(m_data.m_tree, m_data.m_root);
+            ntree32::node_t     node;
+            while (iter.sortorder(m_data.m_tree, ntree32::LEFT, node))
+                keys[nmap32::c_first_item + count++] = m_data.m_keys[node];
+
+            m_data.attach(arrays);
+            m_data.m_tree.m_free_index = nmap32::c_first_item + count;
+            m_data.m_root              = ntree32::build_from_sorted(m_data.m_tree, nmap32::c_first_item, count);
+            m_data.m_size              = count;
+            return true;
         }
 
         bool insert(K const& _key)
         {
+            if (!m_data.ensure_free_node())
+                return false;
             m_data.m_keys[m_data.find_slot()] = _key;
             ntree32::node_t inserted;
             if (ntree32::insert(m_data.m_tree, m_data.m_root, m_data.temp_slot(), m_data.find_slot(), s_compare, &m_data, inserted))
             {
                 m_data.m_keys[inserted] = _key;
+                m_data.m_size += 1;
                 return true;
             }
             return false;
         }
 
-        bool contains(K const& key) const
+        // Builds the set in O(n) from keys that are sorted in ascending order and unique, the set must be empty
+        bool build_from_sorted(K const* keys, u32 count)
         {
+            if (m_data.m_root != ntree32::c_invalid_node || !reserve(count))
+                return false;
+            for (u32 i = 0; i < count; ++i)
+                m_data.m_keys[nmap32::c_first_item + i] = keys[i];
+            m_data.m_tree.reset();
+            m_data.m_tree.m_free_index = nmap32::c_first_item + count;
+            m_data.m_root              = ntree32::build_from_sorted(m_data.m_tree, nmap32::c_first_item, count);
+            m_data.m_size              = count;
+            return true;
+        }
+
+        // Order statistics, O(log n), only available when constructed with 'order_statistics'
+        u32 rank(K const& key) const  // number of keys less than 'key'
+        {
+            ASSERT(m_data.m_order_statistics);
+            if (m_data.m_root == ntree32::c_invalid_node)
+                return 0;
             m_data.m_keys[m_data.find_slot()] = key;
-            ntree32::node_t found             = ntree32::c_invalid_node;
-            return ntree32::find(m_data.m_tree, m_data.m_root, m_data.find_slot(), s_compare, &m_data, found);
+            return ntree32::rank(m_data.m_tree, m_data.m_root, m_data.find_slot(), s_compare, &m_data);
+        }
+
+        bool select(u32 index, K& found_key) const  // the key at 'index' in sorted order (0-based)
+        {
+            ASSERT(m_data.m_order_statistics);
+            ntree32::node_t found;
+            if (ntree32::select(m_data.m_tree, m_data.m_root, index, found))
+            {
+                found_key = m_data.m_keys[found];
+                return true;
+            }
+            return false;
+        }
+
+        bool contains(K const& key) const
+        {
+            nmap32::key_compare_t<K> const cmp   = {key, m_data.m_keys};
+            ntree32::node_t                found = ntree32::c_invalid_node;
+            return ntree32::find(m_data.m_tree, m_data.m_root, cmp, found);
+        }
+
+        // Looks up 'count' keys in one go, the searches are interleaved so that their memory loads overlap.
+        // 'found' (optional) receives whether each key is present, returns the number of keys that are present.
+        u32 contains_many(K const* keys, u32 count, bool* found = nullptr) const
+        {
+            ntree32::node_t nodes[nmap32::c_batch_size];
+            u32             num_found = 0;
+            for (u32 i = 0; i < count; i += nmap32::c_batch_size)
+            {
+                u32 const                        n   = (count - i) < nmap32::c_batch_size ? (count - i) : nmap32::c_batch_size;
+                nmap32::batch_compare_t<K> const cmp = {keys + i, m_data.m_keys};
+                num_found += ntree32::find_many(m_data.m_tree, m_data.m_root, n, cmp, nodes);
+                if (found != nullptr)
+                {
+                    for (u32 j = 0; j < n; ++j)
+                        found[i + j] = nodes[j] != ntree32::c_invalid_node;
+                }
+            }
+            return num_found;
         }
 
         bool remove(K const& key)
         {
+            if (m_data.m_root == ntree32::c_invalid_node)
+                return false;
             m_data.m_keys[m_data.find_slot()] = key;
             ntree32::node_t removed;
             if (ntree32::remove(m_data.m_tree, m_data.m_root, m_data.temp_slot(), m_data.find_slot(), s_compare, &m_data, removed))
             {
                 m_data.m_tree.del_node(removed);
+                m_data.m_size -= 1;
                 return true;
             }
             return false;
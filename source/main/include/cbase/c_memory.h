@@ -8,6 +8,10 @@
 #include "ccore/c_debug.h"
 #include "ccore/c_memory.h"
 
+#if defined(_MSC_VER)
+#    include <xmmintrin.h>
+#endif
+
 namespace ncore
 {
     template <typename T, s32 N>
@@ -52,6 +56,18 @@ namespace ncore
         u32* writenative32(u32* inDest, u32 inData);
         u64* writenative64(u64* inDest, u64 inData);
 
+        ///@name Cache hint, starts loading the cache line holding 'inAddress' (read access)
+        inline void prefetch(void const* inAddress)
+        {
+#if defined(_MSC_VER)
+            _mm_prefetch((char const*)inAddress, _MM_HINT_T0);
+#elif defined(__GNUC__) || defined(__clang__)
+            __builtin_prefetch(inAddress, 0, 3);
+#else
+            (void)inAddress;
+#endif
+        }
+
         /**
          *	Small binary mathematical functions
          *  u8, u16, u32, u64 element access
@@ -0,0 +1,478 @@
+#ifndef __CBASE_PMAP_H__
+#define __CBASE_PMAP_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "ccore/c_debug.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_pool.h"
+
+#include <atomic>
+
+namespace ncore
+{
+    // -----------------------------------------------------------------------------------
+    // -----------------------------------------------------------------------------------
+    // Persistent ordered map, readers work on an immutable snapshot without taking a lock.
+    //
+    // The map is a height balanced (AVL) tree whose nodes are never modified once they are
+    // published. A write copies the path from the root to the changed node (and the nodes
+    // touched by the rotations), all the other nodes are shared with the previous version.
+    // A new version is published with a single atomic store of its root.
+    //
+    // Readers pin the current version in their own reader slot (an epoch), lookups and
+    // iteration on the snapshot never block and are never blocked by the writer.
+    // The writer retires the old version and frees it as soon as no pinned epoch can still
+    // see it, nodes are reference counted so that only the nodes that are not shared with
+    // a newer version are released.
+    //
+    // - There is one writer at a time, the map does not lock: callers that write from more than
+    //   one thread must serialize insert/remove/reclaim themselves (e.g. with a mutex).
+    // - Every reader thread uses its own slot in [0, max_readers), a slot pins one snapshot at a time.
+    // - Nodes come from a growable (virtual memory) pool, node addresses are stable.
+    //
+    // Same note of caution as map_t: K and V are simple POD types, K needs '<'.
+    // -----------------------------------------------------------------------------------
+
+    namespace npmap
+    {
+        const s32 c_max_height = 48;                // AVL height for 2^31 items is < 46
+        const s32 c_max_path   = 4 * c_max_height;  // upper bound of the number of nodes created by one write
+        const u64 c_unpinned   = 0;
+    }  // namespace npmap
+
+    template <typename K, typename V>
+    class pmap_t
+    {
+    public:
+        struct node_t
+        {
+            node_t* m_child[2];
+            u32     m_refs;    // parents and versions referencing this node, only touched by the writer
+            s32     m_height;  // height of the subtree, a leaf has height 1
+            K       m_key;
+            V       m_value;
+        };
+
+        struct iterator_t
+        {
+            inline iterator_t(node_t const* root)
+                : m_node(nullptr)
+                , m_stack(0)
+            {
+                push_left(root);
+            }
+
+            inline K const& key() const { return m_node->m_key; }
+            inline V const& value() const { return m_node->m_value; }
+
+            bool order()
+            {
+                if (m_stack == 0)
+                {
+                    m_node = nullptr;
+                    return false;
+                }
+                m_node = m_stack_array[--m_stack];
+                push_left(m_node->m_child[1]);
+                return true;
+            }
+
+        private:
+            inline void push_left(node_t const* node)
+            {
+                while (node != nullptr)
+                {
+                    ASSERT(m_stack < npmap::c_max_height);
+                    m_stack_array[m_stack++] = node;
+                    node                     = node->m_child[0];
+                }
+            }
+
+            node_t const* m_node;
+            node_t const* m_stack_array[npmap::c_max_height];
+            s32           m_stack;
+        };
+
+        // An immutable version of the map, valid while it is pinned
+        struct snapshot_t
+        {
+            node_t const* m_root;
+            u32           m_size;
+
+            inline u32  size() const { return m_size; }
+            inline bool empty() const { return m_size == 0; }
+
+            bool find(K const& key, V& value) const
+            {
+                node_t const* node = s_find(m_root, key);
+                if (node == nullptr)
+                    return false;
+                value = node->m_value;
+                return true;
+            }
+
+            inline bool contains(K const& key) const { return s_find(m_root, key) != nullptr; }
+
+            // Iterates the items in ascending order using 'order()'
+            inline iterator_t iterate() const { return iterator_t(m_root); }
+        };
+
+        // 'max_nodes' determines how much virtual memory is reserved for nodes, it needs to hold the
+        // items of the current version plus the nodes that are only referenced by pinned versions.
+        pmap_t(alloc_t* allocator, s32 max_readers = 64, s32 max_nodes = 1 << 22);
+        ~pmap_t();
+
+        // Reader, pins the current version in 'slot' and returns it, the snapshot stays valid until 'unpin'
+        snapshot_t pin(s32 slot);
+        void       unpin(s32 slot);
+
+        // Writer (one thread at a time, externally synchronized), every successful call publishes a new version
+        bool insert(K const& key, V const& value);  // false when the key exists or the node pool is full
+        bool remove(K const& key);                  // false when the key does not exist
+        bool find(K const& key, V& value) const;    // lookup in the latest version
+        u32  size() const { return m_current.load(std::memory_order_relaxed)->m_size; }
+
+        // Frees the retired versions that are no longer pinned, also done after every write
+        void reclaim();
+
+        s32 nodes_in_use() const { return m_num_nodes; }  // nodes of the current version plus the retired ones
+
+    private:
+        struct version_t
+        {
+            node_t*    m_root;
+            u32        m_size;
+            u64        m_retired;  // epoch at which the version was replaced
+            version_t* m_next;
+        };
+
+        // one cache-line per reader so that readers do not contend
+        struct slot_t
+        {
+            std::atomic<u64> m_epoch;  // epoch that is pinned, npmap::c_unpinned when not reading
+            u8               m_pad[64 - sizeof(std::atomic<u64>)];
+        };
+
+        static inline s32 s_height(node_t const* node) { return node != nullptr ? node->m_height : 0; }
+        static node_t const* s_find(node_t const* node, K const& key);
+
+        static inline node_t* s_retain(node_t* node)
+        {
+            if (node != nullptr)
+                node->m_refs++;
+            return node;
+        }
+
+        node_t* make(K const& key, V const& value, node_t* left, node_t* right);  // takes over the references of 'left' and 'right'
+        void    release(node_t* node);
+        node_t* balance(K const& key, V const& value, node_t* left, node_t* right);
+        node_t* insert(node_t const* node, K const& key, V const& value);
+        node_t* remove(node_t const* node, K const& key);
+        node_t* remove_min(node_t const* node);
+        void    publish(node_t* root, u32 size);
+
+        alloc_t*                                       m_allocator;
+        growable_pool_t<node_t, npool::c_zero_none>    m_nodes;
+        growable_pool_t<version_t, npool::c_zero_none> m_versions;
+        std::atomic<version_t*>                        m_current;
+        std::atomic<u64>                               m_epoch;
+        version_t*                                     m_retired_head;  // oldest retired version
+        version_t*                                     m_retired_tail;
+        slot_t*                                        m_slots;
+        s32                                            m_max_readers;
+        s32                                            m_max_nodes;
+        s32                                            m_num_nodes;
+    };
+
+    template <typename K, typename V>
+    pmap_t<K, V>::pmap_t(alloc_t* allocator, s32 max_readers, s32 max_nodes)
+        : m_allocator(allocator)
+        , m_current(nullptr)
+        , m_epoch(1)
+        , m_retired_head(nullptr)
+        , m_retired_tail(nullptr)
+        , m_max_readers(max_readers)
+        , m_max_nodes(max_nodes)
+        , m_num_nodes(0)
+    {
+        m_nodes.setup(max_nodes);
+        m_versions.setup(max_nodes);
+        m_slots = g_allocate_array<slot_t>(allocator, max_readers);
+        for (s32 i = 0; i < max_readers; ++i)
+            m_slots[i].m_epoch.store(npmap::c_unpinned, std::memory_order_relaxed);
+
+        version_t* version = m_versions.allocate();
+        version->m_root    = nullptr;
+        version->m_size    = 0;
+        version->m_retired = 0;
+        version->m_next    = nullptr;
+        m_current.store(version, std::memory_order_release);
+    }
+
+    template <typename K, typename V>
+    pmap_t<K, V>::~pmap_t()
+    {
+        // All readers are gone, the nodes and versions are released with their pools
+        g_deallocate_array(m_allocator, m_slots);
+        m_versions.teardown();
+        m_nodes.teardown();
+    }
+
+    template <typename K, typename V>
+    typename pmap_t<K, V>::snapshot_t pmap_t<K, V>::pin(s32 slot)
+    {
+        ASSERT(slot >= 0 && slot < m_max_readers);
+        ASSERT(m_slots[slot].m_epoch.load(std::memory_order_relaxed) == npmap::c_unpinned);
+
+        // Announce the epoch before loading the version, a version retired before this epoch was
+        // unpublished before it and cannot be observed anymore, later ones are kept alive.
+        m_slots[slot].m_epoch.store(m_epoch.load(std::memory_order_seq_cst), std::memory_order_seq_cst);
+        version_t const* version = m_current.load(std::memory_order_seq_cst);
+
+        snapshot_t snapshot;
+        snapshot.m_root = version->m_root;
+        snapshot.m_size = version->m_size;
+        return snapshot;
+    }
+
+    template <typename K, typename V>
+    void pmap_t<K, V>::unpin(s32 slot)
+    {
+        ASSERT(slot >= 0 && slot < m_max_readers);
+        m_slots[slot].m_epoch.store(npmap::c_unpinned, std::memory_order_release);
+    }
+
+    template <typename K, typename V>
+    bool pmap_t<K, V>::insert(K const& key, V const& value)
+    {
+        version_t const* current = m_current.load(std::memory_order_relaxed);
+        if (s_find(current->m_root, key) != nullptr)
+            return false;
+
+        // Make sure the whole path can be copied, so that the write cannot fail halfway
+        if ((m_num_nodes + npmap::c_max_path) > m_max_nodes)
+        {
+            reclaim();
+            if ((m_num_nodes + npmap::c_max_path) > m_max_nodes)
+                return false;
+        }
+
+        publish(insert(current->m_root, key, value), current->m_size + 1);
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool pmap_t<K, V>::remove(K const& key)
+    {
+        version_t const* current = m_current.load(std::memory_order_relaxed);
+        if (s_find(current->m_root, key) == nullptr)
+            return false;
+
+        // A remove also copies the path, it needs room for it even though the map shrinks
+        if ((m_num_nodes + npmap::c_max_path) > m_max_nodes)
+        {
+            reclaim();
+            if ((m_num_nodes + npmap::c_max_path) > m_max_nodes)
+                return false;
+        }
+
+        publish(remove(current->m_root, key), current->m_size - 1);
+        return true;
+    }
+
+    template <typename K, typename V>
+    bool pmap_t<K, V>::find(K const& key, V& value) const
+    {
+        node_t const* node = s_find(m_current.load(std::memory_order_relaxed)->m_root, key);
+        if (node == nullptr)
+            return false;
+        value = node->m_value;
+        return true;
+    }
+
+    template <typename K, typename V>
+    void pmap_t<K, V>::reclaim()
+    {
+        // The oldest epoch that is still pinned, versions retired before it are invisible to all readers
+        u64 oldest = ~(u64)0;
+        for (s32 i = 0; i < m_max_readers; ++i)
+        {
+            u64 const epoch = m_slots[i].m_epoch.load(std::memory_order_seq_cst);
+            if (epoch != npmap::c_unpinned && epoch < oldest)
+                oldest = epoch;
+        }
+
+        while (m_retired_head != nullptr && m_retired_head->m_retired < oldest)
+        {
+            version_t* version = m_retired_head;
+            m_retired_head     = version->m_next;
+            release(version->m_root);
+            m_versions.deallocate(version);
+        }
+        if (m_retired_head == nullptr)
+            m_retired_tail = nullptr;
+    }
+
+    template <typename K, typename V>
+    void pmap_t<K, V>::publish(node_t* root, u32 size)
+    {
+        version_t* version = m_versions.allocate();
+        ASSERT(version != nullptr);
+        version->m_root    = root;
+        version->m_size    = size;
+        version->m_retired = 0;
+        version->m_next    = nullptr;
+
+        // Publish first, then close the epoch, readers that pin a later epoch see the new version
+        version_t* old = m_current.exchange(version, std::memory_order_seq_cst);
+        old->m_retired = m_epoch.fetch_add(1, std::memory_order_seq_cst);
+
+        if (m_retired_tail != nullptr)
+            m_retired_tail->m_next = old;
+        else
+            m_retired_head = old;
+        m_retired_tail = old;
+
+        reclaim();
+    }
+
+    template <typename K, typename V>
+    typename pmap_t<K, V>::node_t const* pmap_t<K, V>::s_find(node_t const* node, K const& key)
+    {
+        while (node != nullptr)
+        {
+            if (key < node->m_key)
+                node = node->m_child[0];
+            else if (node->m_key < key)
+                node = node->m_child[1];
+            else
+                return node;
+        }
+        return nullptr;
+    }
+
+    template <typename K, typename V>
+    typename pmap_t<K, V>::node_t* pmap_t<K, V>::make(K const& key, V const& value, node_t* left, node_t* right)
+    {
+        node_t* node = m_nodes.allocate();
+        ASSERT(node != nullptr);
+        m_num_nodes += 1;
+
+        s32 const hl     = s_height(left);
+        s32 const hr     = s_height(right);
+        node->m_child[0] = left;
+        node->m_child[1] = right;
+        node->m_refs     = 1;
+        node->m_height   = 1 + (hl > hr ? hl : hr);
+        node->m_key      = key;
+        node->m_value    = value;
+        return node;
+    }
+
+    template <typename K, typename V>
+    void pmap_t<K, V>::release(node_t* node)
+    {
+        // Recurses on the left child and loops on the right child, the depth is bounded by the height
+        while (node != nullptr && --node->m_refs == 0)
+        {
+            release(node->m_child[0]);
+            node_t* right = node->m_child[1];
+            m_nodes.deallocate(node);
+            m_num_nodes -= 1;
+            node = right;
+        }
+    }
+
+    // Creates the node (key, value, left, right) and restores the AVL property when the heights of
+    // 'left' and 'right' differ by 2. The nodes that a rotation changes are copied and released.
+    template <typename K, typename V>
+    typename pmap_t<K, V>::node_t* pmap_t<K, V>::balance(K const& key, V const& value, node_t* left, node_t* right)
+    {
+        s32 const hl = s_height(left);
+        s32 const hr = s_height(right);
+        if (hl > (hr + 1))
+        {
+            node_t* ll = left->m_child[0];
+            node_t* lr = left->m_child[1];
+            node_t* node;
+            if (s_height(ll) >= s_height(lr))
+            {
+                node = make(left->m_key, left->m_value, s_retain(ll), make(key, value, s_retain(lr), right));
+            }
+            else
+            {
+                node_t* a = make(left->m_key, left->m_value, s_retain(ll), s_retain(lr->m_child[0]));
+                node_t* b = make(key, value, s_retain(lr->m_child[1]), right);
+                node      = make(lr->m_key, lr->m_value, a, b);
+            }
+            release(left);
+            return node;
+        }
+        if (hr > (hl + 1))
+        {
+            node_t* rl = right->m_child[0];
+            node_t* rr = right->m_child[1];
+            node_t* node;
+            if (s_height(rr) >= s_height(rl))
+            {
+                node = make(right->m_key, right->m_value, make(key, value, left, s_retain(rl)), s_retain(rr));
+            }
+            else
+            {
+                node_t* a = make(key, value, left, s_retain(rl->m_child[0]));
+                node_t* b = make(right->m_key, right->m_value, s_retain(rl->m_child[1]), s_retain(rr));
+                node      = make(rl->m_key, rl->m_value, a, b);
+            }
+            release(right);
+            return node;
+        }
+        return make(key, value, left, right);
+    }
+
+    // Returns a new subtree that holds the items of 'node' plus (key, value), 'node' itself is not
+    // modified, the key must not be present
+    template <typename K, typename V>
+    typename pmap_t<K, V>::node_t* pmap_t<K, V>::insert(node_t const* node, K const& key, V const& value)
+    {
+        if (node == nullptr)
+            return make(key, value, nullptr, nullptr);
+        if (key < node->m_key)
+            return balance(node->m_key, node->m_value, insert(node->m_child[0], key, value), s_retain(node->m_child[1]));
+        return balance(node->m_key, node->m_value, s_retain(node->m_child[0]), insert(node->m_child[1], key, value));
+    }
+
+    // Returns a new subtree that holds the items of 'node' without 'key', the key must be present
+    template <typename K, typename V>
+    typename pmap_t<K, V>::node_t* pmap_t<K, V>::remove(node_t const* node, K const& key)
+    {
+        if (key < node->m_key)
+            return balance(node->m_key, node->m_value, remove(node->m_child[0], key), s_retain(node->m_child[1]));
+        if (node->m_key < key)
+            return balance(node->m_key, node->m_value, s_retain(node->m_child[0]), remove(node->m_child[1], key));
+
+        if (node->m_child[0] == nullptr)
+            return s_retain(node->m_child[1]);
+        if (node->m_child[1] == nullptr)
+            return s_retain(node->m_child[0]);
+
+        // Replace by the smallest item of the right subtree
+        node_t const* min = node->m_child[1];
+        while (min->m_child[0] != nullptr)
+            min = min->m_child[0];
+        return balance(min->m_key, min->m_value, s_retain(node->m_child[0]), remove_min(node->m_child[1]));
+    }
+
+    template <typename K, typename V>
+    typename pmap_t<K, V>::node_t* pmap_t<K, V>::remove_min(node_t const* node)
+    {
+        if (node->m_child[0] == nullptr)
+            return s_retain(node->m_child[1]);
+        return balance(node->m_key, node->m_value, remove_min(node->m_child[0]), s_retain(node->m_child[1]));
+    }
+
+};  // namespace ncore
+
+#endif  // __CBASE_PMAP_H__
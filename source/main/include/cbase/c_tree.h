@@ -51,6 +51,11 @@ namespace ncore
             bool              preorder(node_t const* root, s32 d, node_t const*& node);
             bool              sortorder(node_t const* root, s32 d, node_t const*& node);
             bool              postorder(node_t const* root, s32 d, node_t const*& node);
+
+            // Positions the iterator so that 'sortorder' (called with the same 'd') continues from the first
+            // node at or beyond 'key': d == LEFT walks ascending from the first node >= key (> key when not
+            // 'inclusive'), d == RIGHT walks descending from the last node <= key (< key when not 'inclusive').
+            void              seek(node_t const* root, void const* key, compare_key_and_node_fn comparer, s32 d, bool inclusive = true);
             static inline s32 getdir(s32 compare) { return (compare + 1) >> 1; }
 
             node_t const* m_it;
@@ -61,8 +66,20 @@ namespace ncore
         bool clear(node_t*& root, node_t*& n);  // Repeatedly call 'clear' until true is returned
         bool find(node_t* root, void const* key, compare_key_and_node_fn comparer, node_t*& found);
         bool insert(node_t*& root, node_t* temp, void const* key, compare_key_and_node_fn comparer, new_node_fn new_node, void* user_data, node_t*& _inserted);
-        bool remove(node_t*& root, node_t* temp, void const* key, compare_key_and_node_fn comparer, node_t*& removed_node);
+        bool remove(node_t*& root, node_t* temp, void const* key, compare_key_and_node_fn comparer, node_t*& removed_node);  // false and 'removed_node' = nullptr when 'key' is not in the tree
         bool validate(node_t const* root, const char*& error_str, compare_node_and_node_fn comparer);
+
+        // Ordered searches, O(log n), 'found' is nullptr and false is returned when there is no such node
+        bool lower_bound(node_t* root, void const* key, compare_key_and_node_fn comparer, node_t*& found);  // first node >= key
+        bool upper_bound(node_t* root, void const* key, compare_key_and_node_fn comparer, node_t*& found);  // first node > key
+        bool floor(node_t* root, void const* key, compare_key_and_node_fn comparer, node_t*& found);        // last node <= key
+        bool ceil(node_t* root, void const* key, compare_key_and_node_fn comparer, node_t*& found);         // first node >= key
+
+        // Builds a valid red-black tree of 'count' nodes in O(n) without any comparisons, 'new_node' is called
+        // 'count' times in sorted order (the caller fills in the next smallest key), returns the root.
+        // When 'new_node' returns nullptr the build stops, the returned tree then holds the nodes created
+        // so far (not balanced) and 'new_node' must keep returning nullptr.
+        node_t* build_from_sorted(s32 count, new_node_fn new_node, void* user_data);
     }  // namespace ntree
 
 }  // namespace ncore
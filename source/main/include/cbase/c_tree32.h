@@ -6,6 +6,7 @@
 #endif
 
 #include "cbase/c_allocator.h"
+#include "cbase/c_memory.h"
 
 namespace ncore
 {
@@ -38,6 +39,10 @@ namespace ncore
             node_t m_child[2];
         };
 
+        // When 'm_sizes' is not nullptr (an array with the same length as 'm_nodes') the tree maintains the
+        // size of every subtree, this enables the order-statistic functions 'rank' and 'select'.
+        const u32 c_size_dirty = 0x80000000;  // subtree size needs to be recomputed
+
         struct tree_t
         {
             void   reset();
@@ -47,10 +52,13 @@ namespace ncore
             void   set_node(node_t node, s8 ne, node_t set);
             node_t new_node();
             void   del_node(node_t node);
+            void   mark(node_t node);  // marks the subtree size of 'node' as dirty
+            u32    get_size(node_t node) const;
 
             static inline s8 getdir(s8 compare) { return (compare + 1) >> 1; }
 
             nnode_t* m_nodes;
+            u32*     m_sizes;
             u32      m_free_index;
             u32      m_free_head;
         };
@@ -71,13 +79,18 @@ namespace ncore
             bool sortorder(tree_t& tree, s32 d, node_t& node);
             bool postorder(tree_t& tree, s32 d, node_t& node);
 
+            // Positions the iterator so that 'sortorder' (called with the same 'd') continues from the first
+            // node at or beyond 'key': d == LEFT walks ascending from the first node >= key (> key when not
+            // 'inclusive'), d == RIGHT walks descending from the last node <= key (< key when not 'inclusive').
+            void seek(tree_t const& tree, index_t key, compare_fn comparer, void const* user_data, s32 d, bool inclusive = true);
+
             node_t m_root;
             node_t m_it;
             node_t m_stack_array[32];
             s32    m_stack;
         };
 
-        void setup_tree(tree_t& c, nnode_t* nodes);
+        void setup_tree(tree_t& c, nnode_t* nodes, u32* sizes = nullptr);
         void teardown_tree(tree_t& c);
 
         bool       clear(tree_t& c, node_t& root, node_t& n);  // Repeatedly call 'clear' until true is returned
@@ -87,6 +100,36 @@ namespace ncore
         bool       validate(tree_t& c, node_t root, const char*& error_str, compare_fn comparer, void const* user_data);
         iterator_t iterate(tree_t& c, node_t root);
 
+        // Ordered searches, O(log n), 'found' is c_invalid_node and false is returned when there is no such node
+        bool lower_bound(tree_t const& c, node_t root, index_t key, compare_fn comparer, void const* user_data, node_t& found);  // first node >= key
+        bool upper_bound(tree_t const& c, node_t root, index_t key, compare_fn comparer, void const* user_data, node_t& found);  // first node > key
+        bool floor(tree_t const& c, node_t root, index_t key, compare_fn comparer, void const* user_data, node_t& found);        // last node <= key
+        bool ceil(tree_t const& c, node_t root, index_t key, compare_fn comparer, void const* user_data, node_t& found);         // first node >= key
+
+        // Order statistics, O(log n), these need the subtree sizes ('m_sizes')
+        u32  size(tree_t const& c, node_t root);                                                        // number of nodes in the tree
+        u32  rank(tree_t const& c, node_t root, index_t key, compare_fn comparer, void const* user_data);  // number of nodes less than 'key'
+        bool select(tree_t const& c, node_t root, u32 index, node_t& found);                            // the 'index'-th smallest node (0-based)
+
+        // Searches with a comparer functor, the compare is inlined instead of being an indirect call:
+        // - find:      'cmp(node)' compares the key with 'node' and returns -1, 0 or 1
+        // - find_many: 'cmp(i, node)' compares key 'i' with 'node', 'cmp.prefetch(node)' may prefetch the key
+        //              data of 'node'. Up to c_find_lanes searches descend in lockstep and the next node of every
+        //              lane is prefetched, so the cache misses of the lanes overlap. 'found[i]' is c_invalid_node
+        //              when key 'i' is not present, returns the number of keys that were found.
+        const s32 c_find_lanes = 8;
+        template <typename C>
+        bool find(tree_t const& c, node_t root, C const& cmp, node_t& found);
+        template <typename C>
+        u32 find_many(tree_t const& c, node_t root, u32 count, C const& cmp, node_t* found);
+
+        // Batched 'find' for keys given as indices, see the templated 'find_many'
+        u32 find_many(tree_t const& c, node_t root, index_t const* keys, u32 count, compare_fn comparer, void const* user_data, node_t* found);
+
+        // Builds a valid red-black tree in O(n) without any comparisons from the nodes [first, first + count),
+        // the keys of these nodes are in sorted order, returns the root.
+        node_t build_from_sorted(tree_t& c, node_t first, u32 count);
+
     }  // namespace ntree32
 
 }  // namespace ncore
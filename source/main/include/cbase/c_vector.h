@@ -21,6 +21,8 @@ namespace ncore
     }  // namespace nvector
 
     // Simple vector_t<> template class that uses a virtual memory arena for storage.
+    // Note: The reservation is rounded up to whole pages, and with huge pages enabled (see g_set_huge_pages)
+    //       of 2 MB or more to 2 MB plus one extra huge page; reserved() returns at least 'items_reserved'.
     template <typename T>
     class vector_t
     {
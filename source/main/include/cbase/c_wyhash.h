@@ -6,12 +6,84 @@
 #endif
 
 #include "cbase/c_allocator.h"
+#include "cbase/c_hash.h"
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#    include <intrin.h>
+#endif
 
 namespace ncore
 {
+    class cbuffer_t;
+
     namespace nhash
     {
-        // A basic (wyhash based) registry implementation
+        extern const u64 g_wysecret[4];  // the default wyhash secret, used by wyhasher_t and hash_many
+
+        void wymake_secret(u64 seed, u64* secret);                                 // makes the 4 u64 secret parameters for wyhash
+        u64  wyhash_bytes(void const* key, s32 size, u64 seed, u64 const* secret);  // wyhash of 'size' bytes
+
+        // The wyhash mix, the low and high half of the 128-bit product of 'a' and 'b' xor-ed together
+        inline u64 wymix(u64 a, u64 b)
+        {
+#if defined(__SIZEOF_INT128__)
+            __uint128_t const r = (__uint128_t)a * b;
+            return (u64)r ^ (u64)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            u64       hi;
+            u64 const lo = _umul128(a, b, &hi);
+            return lo ^ hi;
+#else
+            u64 ha = a >> 32, hb = b >> 32, la = (u32)a, lb = (u32)b;
+            u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+            u64 lo = t + (rm1 << 32);
+            c += lo < t;
+            return lo ^ (rh + (rm0 >> 32) + (rm1 >> 32) + c);
+#endif
+        }
+
+        // wyhash of a key of at most 8 bytes that is given as an integer, 'len' is the size of the key.
+        // Inline so that hash maps with small keys do not pay for a call.
+        inline u64 wyhash64(u64 key, u64 len, u64 const* secret) { return wymix(secret[1] ^ len, wymix(key ^ secret[1], secret[0])); }
+
+        // wyhash of 'n' keys into 'out', the keys are hashed in interleaved lanes so that the multiplies of
+        // independent keys overlap. Gives the same hashes as wyhash_bytes.
+        void wyhash_batch(void const* const* keys, s32 const* lens, s32 n, u64 seed, u64 const* secret, u64* out);
+        void wyhash_batch(void const* keys, s32 key_size, s32 n, u64 seed, u64 const* secret, u64* out);  // 'n' keys of 'key_size' bytes back to back (u32, u64, guid)
+
+        // Streaming wyhash with the default secret, feeding the data in any number of pieces gives the
+        // same hash as wyhash_bytes(data, size, seed, g_wysecret). The class is final so that calls
+        // through a wyhasher_t (not a hasher_t) are not virtual.
+        class wyhasher_t final : public hasher_t
+        {
+        public:
+            wyhasher_t(u64 seed = 0);
+
+            s32  size() const override { return 8; }
+            void reset() override;
+            void begin() override;
+            void hash(const u8* begin, const u8* end) override;
+            void end(u8* out_hash, s32 size) override;  // little-endian
+            u64  digest() const;                        // the hash of the data so far
+
+        private:
+            u64  m_seed;
+            u64  m_state[3];
+            u64  m_length;
+            u64  m_pending;
+            u8   m_buffer[64];  // last 16 bytes of the previous block + the pending bytes
+        };
+
+        // Hashes 'n' buffers into 'out', two buffers at a time with their block loops interleaved.
+        // Gives the same hashes as wyhash_bytes(.., seed, g_wysecret) and wyhasher_t.
+        void hash_many(cbuffer_t const* buffers, s32 n, u64* out, u64 seed = 0);
+
+        // Number of keys hashed (and prefetched) at a time by the insert_many/find_many functions
+        const s32 c_batch_size = 32;
+
+        // A basic (wyhash based) registry implementation.
+        // Note: Only a 64-bit signature of a key is stored, two keys with the same signature are the same
+        //       entry, and the size is fixed at 'init'. Use table_t (wymap_t/wyset_t) when that matters.
         class registry_t
         {
         public:
@@ -25,6 +97,11 @@ namespace ncore
             bool find(void* key, s32 keysize, s32& pos) const;
             bool remove(void* key, s32 keysize, s32& pos);
 
+            // Batched versions, 'pos[i]' is 'size()' for a key that was not found (or did not fit).
+            // Return the number of keys that have a position.
+            s32 insert_many(void const* const* keys, s32 const* keysizes, s32 count, s32* pos);
+            s32 find_many(void const* const* keys, s32 const* keysizes, s32 count, s32* pos) const;
+
             alloc_t* m_allocator;
             s32      m_size;
             s32      m_count;
@@ -32,36 +109,100 @@ namespace ncore
             u64      m_secret[4];
         };
 
+        // A (wyhash based) open addressing hash table that stores the full key.
+        // An item is 'item_size' bytes that start with the key ('key_size' bytes), keys are compared
+        // byte-wise so they should not contain padding. Slots are probed linearly, every slot also
+        // holds the 64-bit hash so most mismatches are rejected without touching the key.
+        // When the load exceeds 3/4 the table doubles, the items are moved to the new table a few
+        // slots at a time by every insert and remove (incremental rehashing), so there is no single
+        // operation that pays for the whole rehash. During rehashing a lookup checks both tables.
+        // Note: An item pointer is valid until the next insert or remove.
+        class table_t
+        {
+        public:
+            table_t();
+            ~table_t();
+
+            void  init(alloc_t* allocator, s32 item_size, s32 item_align, s32 key_size, s32 capacity, u64 seed = 0);
+            void  release();
+            s32   size() const { return (s32)m_cur.m_mask + 1; }  // number of slots
+            s32   count() const { return m_cur.m_count + m_old.m_count; }
+            bool  rehashing() const { return m_old.m_hashes != nullptr; }
+            void* insert(void const* key, bool& inserted);  // returns the new or existing item, nullptr when out of memory
+            void* find(void const* key) const;
+            bool  remove(void const* key);
+
+            // For batches, the hashes of 'count' keys stored back to back are computed in one go, the home
+            // slots are prefetched and then every key is inserted or looked up with its hash.
+            void  hash_many(void const* keys, s32 count, u64* hashes) const;
+            void  prefetch(u64 hash) const;
+            void* insert(void const* key, u64 hash, bool& inserted);
+            void* find(void const* key, u64 hash) const;
+            bool  remove(void const* key, u64 hash);
+
+            struct array_t
+            {
+                u64* m_hashes;  // 0 = empty, 1 = removed (only in a table that is being rehashed)
+                u8*  m_items;
+                u32  m_mask;
+                s32  m_count;
+            };
+
+            alloc_t* m_allocator;
+            array_t  m_cur;     // the table that receives new items
+            array_t  m_old;     // the table that is being rehashed into 'm_cur'
+            u32      m_cursor;  // slots of 'm_old' below the cursor have been moved
+            s32      m_item_size;
+            s32      m_item_align;
+            s32      m_key_size;
+            u64      m_secret[4];
+
+        private:
+            u64  hash(void const* key) const;
+            bool alloc_array(array_t& a, u32 slots);
+            void free_array(array_t& a);
+            void grow();
+            void migrate(u32 slots);
+        };
+
         template <typename K, typename V>
         class wymap_t
         {
         public:
             void init(alloc_t* allocator, s32 size, u64 seed = 0);
-            s32  size() const { return m_reg.m_size; }
-            s32  count() const { return m_reg.m_count; }
-            bool insert(K const& key, V const& value);
+            s32  size() const { return m_table.size(); }
+            s32  count() const { return m_table.count(); }
+            bool insert(K const& key, V const& value);  // false when the key already exists
             bool find(K const& key, V& value) const;
             bool contains(K const& key) const;
             bool remove(K const& key);
 
-            registry_t m_reg;
-            V*         m_values;
+            s32 insert_many(K const* keys, V const* values, s32 count);                     // returns the number of keys inserted
+            s32 find_many(K const* keys, s32 count, V* values, bool* found = nullptr) const;  // returns the number of keys found
+
+            struct item_t
+            {
+                K m_key;
+                V m_value;
+            };
+
+            table_t m_table;
         };
 
         template <typename K, typename V>
         void wymap_t<K, V>::init(alloc_t* allocator, s32 size, u64 seed)
         {
-            m_reg.init(allocator, size, seed);
-            m_values = (V*)allocator->allocate(sizeof(V) * m_reg.m_size);
+            m_table.init(allocator, (s32)sizeof(item_t), (s32)alignof(item_t), (s32)sizeof(K), size, seed);
         }
 
         template <typename K, typename V>
         bool wymap_t<K, V>::insert(K const& key, V const& value)
         {
-            s32 pos;
-            if (m_reg.insert((void*)&key, (s32)sizeof(key), pos))
+            bool    inserted;
+            item_t* item = (item_t*)m_table.insert(&key, inserted);
+            if (item != nullptr && inserted)
             {
-                m_values[pos] = value;
+                item->m_value = value;
                 return true;
             }
             return false;
@@ -70,10 +211,10 @@ namespace ncore
         template <typename K, typename V>
         bool wymap_t<K, V>::find(K const& key, V& value) const
         {
-            s32 pos;
-            if (m_reg.find((void*)&key, (s32)sizeof(key), pos))
+            item_t const* item = (item_t const*)m_table.find(&key);
+            if (item != nullptr)
             {
-                value = m_values[pos];
+                value = item->m_value;
                 return true;
             }
             return false;
@@ -82,20 +223,64 @@ namespace ncore
         template <typename K, typename V>
         bool wymap_t<K, V>::contains(K const& key) const
         {
-            s32 pos;
-            return m_reg.find((void*)&key, (s32)sizeof(key), pos);
+            return m_table.find(&key) != nullptr;
         }
 
         template <typename K, typename V>
         bool wymap_t<K, V>::remove(K const& key)
         {
-            s32 pos;
-            if (m_reg.remove((void*)&key, (s32)sizeof(key), pos))
+            return m_table.remove(&key);
+        }
+
+        template <typename K, typename V>
+        s32 wymap_t<K, V>::insert_many(K const* keys, V const* values, s32 count)
+        {
+            u64 hashes[c_batch_size];
+            s32 num = 0;
+            for (s32 i = 0; i < count; i += c_batch_size)
             {
-                m_values[pos] = V();
-                return true;
+                s32 const n = (count - i) < c_batch_size ? (count - i) : c_batch_size;
+                m_table.hash_many(keys + i, n, hashes);
+                for (s32 j = 0; j < n; ++j)
+                    m_table.prefetch(hashes[j]);
+                for (s32 j = 0; j < n; ++j)
+                {
+                    bool    inserted;
+                    item_t* item = (item_t*)m_table.insert(&keys[i + j], hashes[j], inserted);
+                    if (item != nullptr && inserted)
+                    {
+                        item->m_value = values[i + j];
+                        num++;
+                    }
+                }
             }
-            return false;
+            return num;
+        }
+
+        template <typename K, typename V>
+        s32 wymap_t<K, V>::find_many(K const* keys, s32 count, V* values, bool* found) const
+        {
+            u64 hashes[c_batch_size];
+            s32 num = 0;
+            for (s32 i = 0; i < count; i += c_batch_size)
+            {
+                s32 const n = (count - i) < c_batch_size ? (count - i) : c_batch_size;
+                m_table.hash_many(keys + i, n, hashes);
+                for (s32 j = 0; j < n; ++j)
+                    m_table.prefetch(hashes[j]);
+                for (s32 j = 0; j < n; ++j)
+                {
+                    item_t const* item = (item_t const*)m_table.find(&keys[i + j], hashes[j]);
+                    if (item != nullptr)
+                    {
+                        values[i + j] = item->m_value;
+                        num++;
+                    }
+                    if (found != nullptr)
+                        found[i + j] = item != nullptr;
+                }
+            }
+            return num;
         }
 
         template <typename T>
@@ -103,48 +288,38 @@ namespace ncore
         {
         public:
             void init(alloc_t* allocator, s32 size, u64 seed = 0);
-            s32  size() const { return m_reg.m_size; }
-            s32  count() const { return m_reg.m_count; }
-            bool insert(T const& item);
+            s32  size() const { return m_table.size(); }
+            s32  count() const { return m_table.count(); }
+            bool insert(T const& item);  // false when the item already exists
             bool contains(T const& item) const;
             bool remove(T const& item);
 
-            registry_t m_reg;
+            table_t m_table;
         };
 
         template <typename T>
         void wyset_t<T>::init(alloc_t* allocator, s32 size, u64 seed)
         {
-            m_reg.init(allocator, size, seed);
+            m_table.init(allocator, (s32)sizeof(T), (s32)alignof(T), (s32)sizeof(T), size, seed);
         }
 
         template <typename T>
         bool wyset_t<T>::insert(T const& item)
         {
-            s32 pos;
-            if (m_reg.insert((void*)&item, (s32)sizeof(item), pos))
-            {
-                return true;
-            }
-            return false;
+            bool inserted;
+            return m_table.insert(&item, inserted) != nullptr && inserted;
         }
 
         template <typename T>
         bool wyset_t<T>::contains(T const& item) const
         {
-            s32 pos;
-            return m_reg.find((void*)&item, (s32)sizeof(item), pos);
+            return m_table.find(&item) != nullptr;
         }
 
         template <typename T>
         bool wyset_t<T>::remove(T const& item)
         {
-            s32 pos;
-            if (m_reg.remove((void*)&item, (s32)sizeof(item), pos))
-            {
-                return true;
-            }
-            return false;
+            return m_table.remove(&item);
         }
 
     }  // namespace nhash
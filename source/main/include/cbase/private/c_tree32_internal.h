@@ -5,6 +5,7 @@ namespace ncore
         inline void g_init(tree_t& tree)
         {
             tree.m_nodes      = nullptr;
+            tree.m_sizes      = nullptr;
             tree.m_free_index = 0;
             tree.m_free_head  = c_invalid_node;
         }
@@ -40,9 +41,19 @@ namespace ncore
         inline void tree_t::set_node(node_t node, s8 ne, node_t set)
         {
             ASSERT(node != c_invalid_index);
-            m_nodes[node].m_child[ne] = (m_nodes[node].m_child[ne] & 0x80000000) | set;
+            // The color bit is kept, c_invalid_node is stored as 0x7FFFFFFF (see get_node)
+            m_nodes[node].m_child[ne] = (m_nodes[node].m_child[ne] & 0x80000000) | (set & 0x7FFFFFFF);
+            mark(node);
         }
 
+        inline void tree_t::mark(node_t node)
+        {
+            if (m_sizes != nullptr && node != c_invalid_node)
+                m_sizes[node] |= c_size_dirty;
+        }
+
+        inline u32 tree_t::get_size(node_t node) const { return node == c_invalid_node ? 0 : (m_sizes[node] & ~c_size_dirty); }
+
         inline node_t tree_t::new_node()
         {
             node_t node = m_free_head;
@@ -58,6 +69,8 @@ namespace ncore
             m_nodes[node].m_child[0] = c_invalid_node;
             m_nodes[node].m_child[1] = c_invalid_node;
             set_color(node, RED);
+            if (m_sizes != nullptr)
+                m_sizes[node] = 1;
             return node;
         }
 
@@ -69,5 +82,82 @@ namespace ncore
             m_free_head                  = node;
         }
 
+        template <typename C>
+        bool find(tree_t const& c, node_t root, C const& cmp, node_t& found)
+        {
+            node_t node = root;
+            while (node != c_invalid_node)
+            {
+                s8 const r = cmp(node);
+                if (r == 0)
+                {
+                    found = node;
+                    return true;
+                }
+                node = c.get_node(node, (r + 1) >> 1);
+            }
+            found = c_invalid_node;
+            return false;
+        }
+
+        template <typename C>
+        u32 find_many(tree_t const& c, node_t root, u32 count, C const& cmp, node_t* found)
+        {
+            if (root == c_invalid_node)
+            {
+                for (u32 i = 0; i < count; ++i)
+                    found[i] = c_invalid_node;
+                return 0;
+            }
+
+            // Every lane holds a key and the node it is currently at, a lane that finishes takes the next key
+            // and restarts at the root (which stays in the cache).
+            u32    lane_key[c_find_lanes];
+            node_t lane_node[c_find_lanes];
+            s32    lanes = 0;
+            u32    next  = 0;
+            while (lanes < c_find_lanes && next < count)
+            {
+                lane_key[lanes]  = next++;
+                lane_node[lanes] = root;
+                lanes++;
+            }
+
+            u32 num_found = 0;
+            while (lanes > 0)
+            {
+                s32 i = 0;
+                while (i < lanes)
+                {
+                    node_t const node  = lane_node[i];
+                    s8 const     r     = cmp(lane_key[i], node);
+                    node_t const child = (r == 0) ? c_invalid_node : c.get_node(node, (r + 1) >> 1);
+                    if (child != c_invalid_node)
+                    {
+                        nmem::prefetch(&c.m_nodes[child]);
+                        cmp.prefetch(child);
+                        lane_node[i++] = child;
+                        continue;
+                    }
+
+                    found[lane_key[i]] = (r == 0) ? node : c_invalid_node;
+                    num_found += (r == 0) ? 1 : 0;
+                    if (next < count)
+                    {
+                        lane_key[i]    = next++;
+                        lane_node[i++] = root;
+                    }
+                    else
+                    {
+                        // retire the lane, the last lane takes its place and is processed next
+                        lanes -= 1;
+                        lane_key[i]  = lane_key[lanes];
+                        lane_node[i] = lane_node[lanes];
+                    }
+                }
+            }
+            return num_found;
+        }
+
     }  // namespace ntree32
 }  // namespace ncore
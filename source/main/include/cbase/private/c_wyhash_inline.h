@@ -0,0 +1,59 @@
+#ifndef __CBASE_WYHASH_INLINE_H__
+#define __CBASE_WYHASH_INLINE_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#if defined(_MSC_VER) && defined(_M_X64)
+#    include <intrin.h>
+#endif
+
+namespace ncore
+{
+    namespace nhash
+    {
+// protections that produce different results:
+// 1: normal valid behavior
+// 2: extra protection against entropy loss (probability=2^-63), aka. "blind multiplication"
+#define WYHASH_PROTECTION 1
+
+        // 128bit multiply function
+        inline u64 _wyrot(u64 x) { return (x >> 32) | (x << 32); }
+
+        inline void _wymum(u64* A, u64* B)
+        {
+            u64 hi, lo;
+#if defined(__SIZEOF_INT128__)
+            __uint128_t const r = (__uint128_t)*A * *B;
+            lo                  = (u64)r;
+            hi                  = (u64)(r >> 64);
+#elif defined(_MSC_VER) && defined(_M_X64)
+            lo = _umul128(*A, *B, &hi);
+#else
+            u64 ha = *A >> 32, hb = *B >> 32, la = (u32)*A, lb = (u32)*B;
+            u64 rh = ha * hb, rm0 = ha * lb, rm1 = hb * la, rl = la * lb, t = rl + (rm0 << 32), c = t < rl;
+            lo = t + (rm1 << 32);
+            c += lo < t;
+            hi = rh + (rm0 >> 32) + (rm1 >> 32) + c;
+#endif
+#if (WYHASH_PROTECTION > 1)
+            *A ^= lo;
+            *B ^= hi;
+#else
+            *A = lo;
+            *B = hi;
+#endif
+        }
+
+        // multiply and xor mix function, aka MUM
+        inline u64 _wymix(u64 A, u64 B)
+        {
+            _wymum(&A, &B);
+            return A ^ B;
+        }
+
+    }  // namespace nhash
+}  // namespace ncore
+
+#endif  // __CBASE_WYHASH_INLINE_H__
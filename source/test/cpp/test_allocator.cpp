@@ -1,6 +1,7 @@
 #include "cbase/c_allocator.h"
 #include "ccore/c_debug.h"
 #include "cbase/c_buffer.h"
+#include "ccore/c_arena.h"
 
 #include "cunittest/cunittest.h"
 
@@ -143,6 +144,35 @@ UNITTEST_SUITE_BEGIN(allocator)
             CHECK_TRUE(p != nullptr);
             ncore::g_delete(p);
         }
+
+        UNITTEST_TEST(huge_pages)
+        {
+            CHECK_FALSE(g_get_huge_pages());
+            g_set_huge_pages(true);
+
+            // Whether the advice is accepted depends on the platform and the kernel configuration
+            arena_t* arena   = narena::new_arena(16 * cMB, 0);
+            bool     advised = g_advise_huge_pages(arena);
+            if (advised)
+            {
+                CHECK_TRUE(g_huge_pages_advised() >= 14 * cMB);
+            }
+
+            // Touch the memory so that the kernel can back it with huge pages
+            narena::commit(arena, 16 * cMB);
+            byte* mem = (byte*)narena::alloc(arena, 12 * cMB, 64);
+            for (s32 i = 0; i < 12 * cMB; i += 4096)
+                mem[i] = 1;
+            int_t const resident = g_huge_pages_resident(arena);
+            CHECK_TRUE(resident >= 0 && resident <= 16 * cMB);
+            if (!advised)
+            {
+                CHECK_EQUAL(0, resident);
+            }
+            narena::destroy(arena);
+
+            g_set_huge_pages(false);
+        }
     }
 }
 UNITTEST_SUITE_END
@@ -0,0 +1,107 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_frame.h"
+
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(allocator_frame)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(init_exit)
+        {
+            frame_alloc_t frame;
+            frame.init(3, 1 * cMB);
+            CHECK_EQUAL(3, frame.num_frames());
+            CHECK_EQUAL(0, frame.frame());
+            frame.exit();
+        }
+
+        UNITTEST_TEST(allocate)
+        {
+            frame_alloc_t frame;
+            frame.init(2, 1 * cMB);
+
+            frame.begin_frame();
+            void* a = frame.allocate(100, 16);
+            void* b = frame.allocate(200, 64);
+            CHECK_NOT_NULL(a);
+            CHECK_NOT_NULL(b);
+            CHECK_EQUAL(0, (ptr_t)a & 15);
+            CHECK_EQUAL(0, (ptr_t)b & 63);
+            CHECK_TRUE((byte*)b >= (byte*)a + 100);
+            frame.deallocate(a);
+            frame.deallocate(b);
+            frame.end_frame();
+
+            // Requests that do not fit in a region fail
+            frame.begin_frame();
+            CHECK_NULL(frame.allocate(2 * cMB, 8));
+            frame.end_frame();
+
+            frame.exit();
+        }
+
+        UNITTEST_TEST(rotation_and_lifetime)
+        {
+            frame_alloc_t frame;
+            frame.init(2, 1 * cMB);
+
+            u32   tag0 = frame.begin_frame();
+            void* a    = frame.allocate(64, 8);
+            frame.end_frame();
+
+            u32   tag1 = frame.begin_frame();
+            void* b    = frame.allocate(64, 8);
+            frame.end_frame();
+            CHECK_NOT_EQUAL(a, b);
+            CHECK_TRUE(frame.is_alive(tag0));
+            CHECK_TRUE(frame.is_alive(tag1));
+
+            // Frame 0's region is reused (and reset) by frame 2
+            u32   tag2 = frame.begin_frame();
+            void* c    = frame.allocate(64, 8);
+            frame.end_frame();
+            CHECK_EQUAL(a, c);
+            CHECK_FALSE(frame.is_alive(tag0));
+            CHECK_TRUE(frame.is_alive(tag1));
+            CHECK_TRUE(frame.is_alive(tag2));
+
+            frame.exit();
+        }
+
+        UNITTEST_TEST(high_water)
+        {
+            frame_alloc_t frame;
+            frame.init(2, 4 * cMB);
+
+            u32 const sizes[] = {1000, 300000, 5000, 20};
+            for (s32 i = 0; i < 4; ++i)
+            {
+                frame.begin_frame();
+                frame.allocate(sizes[i], 8);
+                frame.end_frame();
+            }
+
+            frame_alloc_t::stats_t stats;
+            frame.stats(0, stats);  // served frames 2 and 4
+            CHECK_EQUAL(4, stats.m_frame);
+            CHECK_EQUAL(20, stats.m_used);
+            CHECK_EQUAL(300000, stats.m_high_water);
+            frame.stats(1, stats);  // served frames 1 and 3
+            CHECK_EQUAL(3, stats.m_frame);
+            CHECK_EQUAL(5000, stats.m_used);
+            CHECK_EQUAL(5000, stats.m_high_water);
+
+            frame.exit();
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,227 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_heap.h"
+#include "cbase/c_memory.h"
+
+#include "cunittest/cunittest.h"
+
+#include <thread>
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(allocator_heap)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(create_destroy)
+        {
+            heap_alloc_t* heap = g_create_heap_alloc(64 * cMB);
+            CHECK_NOT_NULL(heap);
+            g_destroy_heap_alloc(heap);
+            CHECK_NULL(heap);
+        }
+
+        UNITTEST_TEST(size_classes)
+        {
+            heap_alloc_t* heap = g_create_heap_alloc(64 * cMB);
+
+            void* ptrs[64];
+            for (u32 i = 0; i < 64; ++i)
+            {
+                u32 const size = 1 + i * 131;
+                ptrs[i]        = heap->allocate(size);
+                CHECK_NOT_NULL(ptrs[i]);
+                CHECK_EQUAL(0, (ptr_t)ptrs[i] & 15);
+                g_memset(ptrs[i], (u8)i, size);
+            }
+            for (u32 i = 0; i < 64; ++i)
+            {
+                u8 const* bytes = (u8 const*)ptrs[i];
+                CHECK_EQUAL((u8)i, bytes[0]);
+                CHECK_EQUAL((u8)i, bytes[i * 131]);
+                heap->deallocate(ptrs[i]);
+            }
+
+            g_destroy_heap_alloc(heap);
+        }
+
+        UNITTEST_TEST(alignment)
+        {
+            heap_alloc_t* heap = g_create_heap_alloc(64 * cMB);
+            for (u32 align = 1; align <= 8192; align <<= 1)
+            {
+                void* a = heap->allocate(24, align);
+                void* b = heap->allocate(3000, align);
+                CHECK_EQUAL(0, (ptr_t)a & (align - 1));
+                CHECK_EQUAL(0, (ptr_t)b & (align - 1));
+                heap->deallocate(a);
+                heap->deallocate(b);
+            }
+            g_destroy_heap_alloc(heap);
+        }
+
+        UNITTEST_TEST(reuse)
+        {
+            heap_alloc_t* heap = g_create_heap_alloc(64 * cMB);
+
+            void* a = heap->allocate(40);
+            heap->deallocate(a);
+            void* b = heap->allocate(40);
+            CHECK_EQUAL(a, b);
+            heap->deallocate(b);
+
+            // Fill many slabs, free them all, and allocate again
+            const s32 count = 10000;
+            void**    ptrs  = (void**)Allocator->allocate(sizeof(void*) * count);
+            for (s32 i = 0; i < count; ++i)
+                ptrs[i] = heap->allocate(64);
+            for (s32 i = 0; i < count; ++i)
+                heap->deallocate(ptrs[i]);
+            for (s32 i = 0; i < count; ++i)
+            {
+                ptrs[i] = heap->allocate(32);
+                CHECK_NOT_NULL(ptrs[i]);
+            }
+            for (s32 i = 0; i < count; ++i)
+                heap->deallocate(ptrs[i]);
+            Allocator->deallocate(ptrs);
+
+            g_destroy_heap_alloc(heap);
+        }
+
+        UNITTEST_TEST(large)
+        {
+            heap_alloc_t* heap = g_create_heap_alloc(64 * cMB);
+
+            u8* a = (u8*)heap->allocate(1 * cMB);
+            CHECK_NOT_NULL(a);
+            a[0]           = 1;
+            a[1 * cMB - 1] = 2;
+            u8* b          = (u8*)heap->allocate(100000, 32768);
+            CHECK_EQUAL(0, (ptr_t)b & (32768 - 1));
+            heap->deallocate(a);
+            heap->deallocate(b);
+            g_destroy_heap_alloc(heap);
+        }
+
+        UNITTEST_TEST(large_alignment)
+        {
+            heap_alloc_t* heap = g_create_heap_alloc(64 * cMB);
+
+            // Alignments of 64 KB and more put the pointer on a slab boundary
+            const u32 alignments[] = {32768, 65536, 1 * cMB};
+            for (u32 i = 0; i < 3; ++i)
+            {
+                u32 const align = alignments[i];
+                u8*       a     = (u8*)heap->allocate(100, align);
+                u8*       b     = (u8*)heap->allocate(3 * align + 17, align);
+                CHECK_NOT_NULL(a);
+                CHECK_NOT_NULL(b);
+                CHECK_EQUAL(0, (ptr_t)a & (align - 1));
+                CHECK_EQUAL(0, (ptr_t)b & (align - 1));
+                a[0]              = 1;
+                a[99]             = 2;
+                b[0]              = 3;
+                b[3 * align + 16] = 4;
+                heap->deallocate(a);
+                heap->deallocate(b);
+            }
+
+            // Small blocks still work after that
+            void* c = heap->allocate(64);
+            CHECK_NOT_NULL(c);
+            heap->deallocate(c);
+
+            g_destroy_heap_alloc(heap);
+        }
+
+        UNITTEST_TEST(remote_free)
+        {
+            heap_alloc_t* owner = g_create_heap_alloc(64 * cMB);
+            heap_alloc_t* other = g_create_heap_alloc(64 * cMB);
+
+            const s32 count = 4096;
+            void**    ptrs  = (void**)Allocator->allocate(sizeof(void*) * count);
+            for (s32 i = 0; i < count; ++i)
+                ptrs[i] = owner->allocate(48 + (i & 7) * 16);
+
+            // Another thread frees all the blocks through its own heap
+            std::thread worker([&]() {
+                for (s32 i = 0; i < count; ++i)
+                    other->deallocate(ptrs[i]);
+            });
+            worker.join();
+
+            // The owner picks up the remotely freed blocks and reuses them
+            owner->collect();
+            void* a = owner->allocate(48);
+            bool  reused = false;
+            for (s32 i = 0; i < count && !reused; ++i)
+                reused = (ptrs[i] == a);
+            CHECK_TRUE(reused);
+            owner->deallocate(a);
+
+            Allocator->deallocate(ptrs);
+            g_destroy_heap_alloc(other);
+            g_destroy_heap_alloc(owner);
+        }
+
+        UNITTEST_TEST(destroy_with_live_blocks)
+        {
+            CHECK_EQUAL(0, g_collect_orphan_heaps());
+
+            heap_alloc_t* owner = g_create_heap_alloc(64 * cMB);
+            heap_alloc_t* other = g_create_heap_alloc(64 * cMB);
+
+            const s32 count = 1000;
+            void**    ptrs  = (void**)Allocator->allocate(sizeof(void*) * count);
+            for (s32 i = 0; i < count; ++i)
+                ptrs[i] = owner->allocate(32 + (i & 3) * 1000);
+            void* large = owner->allocate(100000);
+
+            // The owner goes away while its blocks are still in use, its memory must stay valid
+            g_destroy_heap_alloc(owner);
+            CHECK_EQUAL(1, g_collect_orphan_heaps());
+
+            std::thread worker([&]() {
+                for (s32 i = 0; i < count; ++i)
+                    other->deallocate(ptrs[i]);
+                other->deallocate(large);
+            });
+            worker.join();
+
+            // All blocks are back, the orphan is released
+            CHECK_EQUAL(0, g_collect_orphan_heaps());
+
+            Allocator->deallocate(ptrs);
+            g_destroy_heap_alloc(other);
+        }
+
+        UNITTEST_TEST(adopt_orphan)
+        {
+            heap_alloc_t* first = g_create_heap_alloc(64 * cMB);
+            heap_t*       heap  = first->m_heap;
+            void*         a     = first->allocate(100);
+            g_destroy_heap_alloc(first);
+            CHECK_EQUAL(1, g_collect_orphan_heaps());
+
+            // The next heap takes over the orphan, including the block that is still in use
+            heap_alloc_t* second = g_create_heap_alloc(64 * cMB);
+            CHECK_EQUAL(heap, second->m_heap);
+            CHECK_EQUAL(0, g_collect_orphan_heaps());
+            second->deallocate(a);
+            void* b = second->allocate(100);
+            CHECK_EQUAL(a, b);
+            second->deallocate(b);
+
+            g_destroy_heap_alloc(second);
+            CHECK_EQUAL(0, g_collect_orphan_heaps());
+        }
+    }
+}
+UNITTEST_SUITE_END
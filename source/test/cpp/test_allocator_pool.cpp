@@ -0,0 +1,354 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_pool.h"
+#include "cbase/c_console.h"
+
+#include "cunittest/cunittest.h"
+
+#include <chrono>
+#include <mutex>
+#include <thread>
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(allocator_pool)
+{
+    UNITTEST_FIXTURE(fixed)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        struct object_t
+        {
+            u32 m_a;
+            u32 m_b;
+            u64 m_c;
+        };
+
+        UNITTEST_TEST(allocate_deallocate)
+        {
+            fixed_pool_t<object_t> pool;
+            pool.setup(Allocator, 16);
+
+            object_t* objects[16];
+            for (s32 i = 0; i < 16; ++i)
+            {
+                objects[i] = pool.allocate();
+                CHECK_NOT_NULL(objects[i]);
+                CHECK_EQUAL((u32)i, pool.obj2idx(objects[i]));
+                CHECK_EQUAL(0, objects[i]->m_c);
+                objects[i]->m_c = 0xFFFFFFFFFFFFFFFFull;
+            }
+            CHECK_NULL(pool.allocate());
+
+            pool.deallocate(objects[3]);
+            pool.deallocate(objects[7]);
+            CHECK_EQUAL(objects[7], pool.allocate());
+            CHECK_EQUAL(objects[3], pool.allocate());
+            CHECK_EQUAL(0, objects[3]->m_c);
+
+            pool.teardown(Allocator);
+        }
+
+        UNITTEST_TEST(allocate_n_deallocate_n)
+        {
+            fixed_pool_t<object_t> pool;
+            pool.setup(Allocator, 64);
+
+            object_t* objects[64];
+            CHECK_EQUAL(40, pool.allocate_n(objects, 40));
+            for (s32 i = 0; i < 40; ++i)
+                objects[i]->m_c = (u64)i + 1;
+
+            // Return a segment and take it back together with new objects
+            pool.deallocate_n(objects + 10, 20);
+            object_t* more[64];
+            CHECK_EQUAL(44, pool.allocate_n(more, 64));
+            for (s32 i = 0; i < 20; ++i)
+            {
+                CHECK_EQUAL(objects[10 + i], more[i]);
+                CHECK_EQUAL(0, more[i]->m_c);
+            }
+            for (s32 i = 20; i < 44; ++i)
+                CHECK_EQUAL((u32)(40 + i - 20), pool.obj2idx(more[i]));
+            CHECK_NULL(pool.allocate());
+
+            pool.deallocate_n(more, 44);
+            pool.deallocate_n(objects, 10);
+            pool.deallocate_n(objects + 30, 10);
+            CHECK_EQUAL(64, pool.allocate_n(more, 64));
+
+            pool.teardown(Allocator);
+        }
+
+        UNITTEST_TEST(zero_none)
+        {
+            fixed_pool_t<object_t, npool::c_zero_none> pool;
+            pool.setup(Allocator, 4);
+
+            object_t* a = pool.allocate();
+            a->m_b      = 0xABCD;
+            a->m_c      = 0x12345678;
+            pool.deallocate(a);
+
+            // The object is handed out as-is, only the free-list link (first 4 bytes) was written
+            object_t* b = pool.allocate();
+            CHECK_EQUAL(a, b);
+            CHECK_EQUAL(0xABCD, b->m_b);
+            CHECK_EQUAL(0x12345678, b->m_c);
+
+            pool.teardown(Allocator);
+        }
+    }
+
+    UNITTEST_FIXTURE(growable)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        struct object_t
+        {
+            u64 m_key;
+            u64 m_value;
+        };
+
+        UNITTEST_TEST(grow_on_demand)
+        {
+            growable_pool_t<object_t> pool;
+            pool.setup(1024 * 1024);
+            CHECK_EQUAL(0, pool.capacity());
+            CHECK_EQUAL(1024 * 1024, pool.reserved());
+
+            object_t* first = pool.allocate();
+            CHECK_NOT_NULL(first);
+            CHECK_TRUE(pool.capacity() > 0);
+            first->m_key = 1;
+
+            // Objects do not move while the pool grows
+            const s32 count = 100000;
+            for (s32 i = 1; i < count; ++i)
+            {
+                object_t* obj = pool.allocate();
+                CHECK_EQUAL((u32)i, pool.obj2idx(obj));
+                CHECK_EQUAL(0, obj->m_key);
+                obj->m_key = (u64)i + 1;
+            }
+            CHECK_TRUE(pool.capacity() >= count);
+            CHECK_TRUE(pool.capacity() < pool.reserved());
+            CHECK_EQUAL(first, pool.idx2obj(0));
+            CHECK_EQUAL(1, first->m_key);
+            CHECK_EQUAL((u64)count, pool.idx2obj(count - 1)->m_key);
+
+            // Freed objects are reused before the pool grows again
+            s32 const capacity = pool.capacity();
+            pool.deallocate(pool.idx2obj(10));
+            pool.deallocate(pool.idx2obj(20));
+            CHECK_EQUAL(pool.idx2obj(20), pool.allocate());
+            CHECK_EQUAL(pool.idx2obj(10), pool.allocate());
+            CHECK_EQUAL(capacity, pool.capacity());
+
+            pool.teardown();
+        }
+
+        UNITTEST_TEST(allocate_n)
+        {
+            growable_pool_t<object_t> pool;
+            pool.setup(100000);
+
+            object_t** objects = (object_t**)Allocator->allocate(sizeof(object_t*) * 100000);
+            CHECK_EQUAL(50000, pool.allocate_n(objects, 50000));
+            CHECK_TRUE(pool.capacity() >= 50000);
+            for (s32 i = 0; i < 50000; ++i)
+                CHECK_EQUAL((u32)i, pool.obj2idx(objects[i]));
+
+            pool.deallocate_n(objects, 50000);
+            CHECK_EQUAL(100000, pool.allocate_n(objects, 100000));
+            CHECK_EQUAL(0, pool.allocate_n(objects, 1));
+            Allocator->deallocate(objects);
+
+            pool.teardown();
+        }
+
+        UNITTEST_TEST(exhaust_reserved)
+        {
+            growable_pool_t<object_t> pool;
+            pool.setup(100, 10);
+            CHECK_EQUAL(10, pool.capacity());
+            for (s32 i = 0; i < 100; ++i)
+                CHECK_NOT_NULL(pool.allocate());
+            CHECK_EQUAL(100, pool.capacity());
+            CHECK_NULL(pool.allocate());
+            pool.teardown();
+        }
+    }
+
+    UNITTEST_FIXTURE(concurrent)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        struct node_t
+        {
+            u32 m_owner;
+            u32 m_sequence;
+        };
+
+        UNITTEST_TEST(allocate_deallocate)
+        {
+            concurrent_fixed_pool_t<node_t> pool;
+            pool.setup(Allocator, 8);
+
+            node_t* nodes[8];
+            for (s32 i = 0; i < 8; ++i)
+            {
+                nodes[i] = pool.allocate();
+                CHECK_NOT_NULL(nodes[i]);
+                CHECK_EQUAL(pool.idx2obj((u32)i), nodes[i]);
+            }
+            CHECK_NULL(pool.allocate());
+
+            pool.deallocate(nodes[5]);
+            pool.deallocate(nodes[2]);
+            CHECK_EQUAL(nodes[2], pool.allocate());
+            CHECK_EQUAL(nodes[5], pool.allocate());
+            CHECK_NULL(pool.allocate());
+
+            pool.teardown(Allocator);
+        }
+
+        // Every thread keeps a window of live nodes, stamps them and verifies that no other
+        // thread has been handed the same node while it was live.
+        UNITTEST_TEST(stress)
+        {
+            const s32 c_num_threads = 8;
+            const s32 c_window      = 64;
+            const s32 c_iterations  = 20000;
+
+            concurrent_fixed_pool_t<node_t> pool;
+            pool.setup(Allocator, c_num_threads * c_window);
+
+            std::atomic<s32> errors(0);
+            std::thread      threads[c_num_threads];
+            for (s32 t = 0; t < c_num_threads; ++t)
+            {
+                threads[t] = std::thread([&pool, &errors, t]() {
+                    node_t* live[c_window];
+                    for (s32 i = 0; i < c_window; ++i)
+                        live[i] = nullptr;
+                    for (s32 i = 0; i < c_iterations; ++i)
+                    {
+                        s32 const slot = (i * 7) % c_window;
+                        if (live[slot] != nullptr)
+                        {
+                            if (live[slot]->m_owner != (u32)t || live[slot]->m_sequence != (u32)i - 1)
+                                errors++;
+                            pool.deallocate(live[slot]);
+                        }
+                        node_t* node = pool.allocate();
+                        if (node == nullptr || node->m_owner != 0 || node->m_sequence != 0)
+                        {
+                            errors++;
+                            live[slot] = nullptr;
+                            continue;
+                        }
+                        node->m_owner    = (u32)t;
+                        node->m_sequence = (u32)i;
+                        live[slot]       = node;
+
+                        // restamp the whole window so that a duplicate hand-out is detected
+                        for (s32 j = 0; j < c_window; ++j)
+                            if (live[j] != nullptr)
+                                live[j]->m_sequence = (u32)i;
+                    }
+                    for (s32 i = 0; i < c_window; ++i)
+                        if (live[i] != nullptr)
+                            pool.deallocate(live[i]);
+                });
+            }
+            for (s32 t = 0; t < c_num_threads; ++t)
+                threads[t].join();
+
+            CHECK_EQUAL(0, errors.load());
+
+            // Everything has been returned, the full capacity is available again
+            s32 count = 0;
+            while (pool.allocate() != nullptr)
+                count++;
+            CHECK_EQUAL(c_num_threads * c_window, count);
+
+            pool.teardown(Allocator);
+        }
+
+        template <typename P>
+        static u64 s_bench(P& pool, s32 num_threads, s32 iterations)
+        {
+            std::thread threads[16];
+            auto        start = std::chrono::high_resolution_clock::now();
+            for (s32 t = 0; t < num_threads; ++t)
+            {
+                threads[t] = std::thread([&pool, iterations]() {
+                    node_t* live[16];
+                    for (s32 i = 0; i < iterations; ++i)
+                    {
+                        for (s32 j = 0; j < 16; ++j)
+                            live[j] = pool.allocate();
+                        for (s32 j = 0; j < 16; ++j)
+                            if (live[j] != nullptr)
+                                pool.deallocate(live[j]);
+                    }
+                });
+            }
+            for (s32 t = 0; t < num_threads; ++t)
+                threads[t].join();
+            auto end = std::chrono::high_resolution_clock::now();
+            return (u64)std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        }
+
+        struct mutex_pool_t
+        {
+            fixed_pool_t<node_t> m_pool;
+            std::mutex           m_mutex;
+
+            node_t* allocate()
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                return m_pool.allocate();
+            }
+            void deallocate(node_t* node)
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_pool.deallocate(node);
+            }
+        };
+
+        UNITTEST_TEST(benchmark_contention)
+        {
+            const s32 c_num_threads = 4;
+            const s32 c_iterations  = 20000;
+
+            concurrent_fixed_pool_t<node_t> lockfree;
+            lockfree.setup(Allocator, c_num_threads * 16);
+            mutex_pool_t locked;
+            locked.m_pool.setup(Allocator, c_num_threads * 16);
+
+            u64 const us_lockfree = s_bench(lockfree, c_num_threads, c_iterations);
+            u64 const us_locked   = s_bench(locked, c_num_threads, c_iterations);
+
+            console->write("concurrent_fixed_pool_t: ");
+            console->write(us_lockfree);
+            console->write(" us, mutex + fixed_pool_t: ");
+            console->write(us_locked);
+            console->writeLine(" us");
+
+            locked.m_pool.teardown(Allocator);
+            lockfree.teardown(Allocator);
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,81 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_slab.h"
+
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(allocator_slab)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(setup_teardown)
+        {
+            slab_alloc_t slab;
+            slab.setup(Allocator, 96, 1024, 64);
+            CHECK_EQUAL(96, slab.slot_size());
+            CHECK_EQUAL(32, slab.slot_alignment());
+            CHECK_EQUAL(0, slab.num_slabs());
+            slab.teardown();
+        }
+
+        UNITTEST_TEST(allocate_deallocate)
+        {
+            slab_alloc_t slab;
+            slab.setup(Allocator, 256, 64, 100);
+
+            // Fill 3 slabs
+            void* ptrs[64 * 3];
+            for (s32 i = 0; i < 64 * 3; ++i)
+            {
+                ptrs[i] = slab.allocate(200);
+                CHECK_NOT_NULL(ptrs[i]);
+                CHECK_EQUAL(0, (ptr_t)ptrs[i] & 63);
+                if (i > 0)
+                    CHECK_EQUAL((byte*)ptrs[i - 1] + 256, (byte*)ptrs[i]);
+            }
+            CHECK_EQUAL(3, slab.num_slabs());
+            CHECK_EQUAL(64 * 3, slab.num_used());
+
+            // Too large, or too strictly aligned
+            CHECK_NULL(slab.allocate(300));
+            CHECK_NULL(slab.allocate(64, 128));
+
+            // Free a slot in the middle slab, it is the first to be reused
+            slab.deallocate(ptrs[100]);
+            slab.deallocate(ptrs[170]);
+            CHECK_EQUAL(ptrs[100], slab.allocate(256));
+            CHECK_EQUAL(ptrs[170], slab.allocate(256));
+            CHECK_EQUAL(3, slab.num_slabs());
+
+            for (s32 i = 0; i < 64 * 3; ++i)
+                slab.deallocate(ptrs[i]);
+            CHECK_EQUAL(0, slab.num_used());
+
+            // The first slab is used again
+            CHECK_EQUAL(ptrs[0], slab.allocate(1));
+            slab.teardown();
+        }
+
+        UNITTEST_TEST(exhaust)
+        {
+            slab_alloc_t slab;
+            slab.setup(Allocator, 1024, 100, 40);
+
+            s32 count = 0;
+            while (slab.allocate(1024) != nullptr)
+                count++;
+            CHECK_EQUAL(100 * 40, count);
+            CHECK_EQUAL(40, slab.num_slabs());
+
+            slab.teardown();
+        }
+    }
+}
+UNITTEST_SUITE_END
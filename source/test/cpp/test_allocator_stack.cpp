@@ -0,0 +1,103 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_stack.h"
+
+#include "cunittest/cunittest.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(allocator_stack)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        static byte s_buffer[4096];
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(allocate_and_pop)
+        {
+            stack_alloc_t stack;
+            stack.setup(s_buffer, sizeof(s_buffer), Allocator);
+
+            void* a = stack.allocate(100, 8);
+            void* b = stack.allocate(100, 64);
+            CHECK_NOT_NULL(a);
+            CHECK_NOT_NULL(b);
+            CHECK_EQUAL(0, (ptr_t)b & 63);
+
+            // Deallocating the last allocation releases it
+            int_t const used = stack.used();
+            stack.deallocate(b);
+            CHECK_TRUE(stack.used() < used);
+            void* c = stack.allocate(100, 64);
+            CHECK_EQUAL(b, c);
+
+            // Deallocating an allocation that is not the last does nothing
+            int_t const used2 = stack.used();
+            stack.deallocate(a);
+            CHECK_EQUAL(used2, stack.used());
+
+            stack.teardown();
+            CHECK_EQUAL(0, stack.used());
+        }
+
+        UNITTEST_TEST(scope)
+        {
+            stack_alloc_t stack;
+            stack.setup(s_buffer, sizeof(s_buffer), Allocator);
+
+            void* outer = stack.allocate(64);
+            int_t used  = stack.used();
+            {
+                stack_alloc_t::scope_t scope(&stack);
+                void*                  a = scope->allocate(1000);
+                void*                  b = scope->allocate(1000);
+                CHECK_NOT_NULL(a);
+                CHECK_NOT_NULL(b);
+                CHECK_TRUE(stack.used() > used);
+                {
+                    stack_alloc_t::scope_t inner(&stack);
+                    inner->allocate(500);
+                }
+                CHECK_TRUE(stack.used() < used + 2100);
+            }
+            CHECK_EQUAL(used, stack.used());
+            CHECK_TRUE(stack.high_water() >= used + 2500);
+            CHECK_NOT_NULL(outer);
+
+            stack.teardown();
+        }
+
+        UNITTEST_TEST(fallback)
+        {
+            stack_alloc_t stack;
+            stack.setup(s_buffer, sizeof(s_buffer), Allocator);
+
+            {
+                stack_alloc_t::scope_t scope(&stack);
+                byte*                  a = (byte*)scope->allocate(8000, 32);  // does not fit, comes from the fallback
+                CHECK_NOT_NULL(a);
+                CHECK_EQUAL(0, (ptr_t)a & 31);
+                a[0]    = 1;
+                a[7999] = 2;
+                void* b = scope->allocate(10000);
+                void* c = scope->allocate(20000);
+                scope->deallocate(b);  // fallback allocations can be released in any order
+                CHECK_NOT_NULL(c);
+                void* d = scope->allocate(16);  // still fits in the buffer
+                CHECK_TRUE((byte*)d >= s_buffer && (byte*)d < s_buffer + sizeof(s_buffer));
+            }
+            // Leaving the scope released the fallback allocations, the unittest allocator checks for leaks
+            CHECK_EQUAL(0, stack.used());
+
+            // Without a fallback oversized requests fail
+            stack.setup(s_buffer, sizeof(s_buffer), nullptr);
+            CHECK_NULL(stack.allocate(8000));
+            stack.teardown();
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,150 @@
+#include "ccore/c_target.h"
+#include "cbase/c_allocator.h"
+#include "cbase/c_allocator_tracking.h"
+#include "cbase/c_console.h"
+
+#include "cunittest/cunittest.h"
+
+#include <thread>
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(allocator_tracking)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(counts)
+        {
+            tracking_alloc_t tracker;
+            tracker.setup(Allocator);
+
+            alloc_t* names = tracker.tag("names");
+            alloc_t* nodes = tracker.tag("nodes");
+            CHECK_EQUAL(names, tracker.tag("names"));
+            CHECK_EQUAL(3, tracker.num_tags());
+
+            void* a = names->allocate(10);
+            void* b = names->allocate(100);
+            void* c = nodes->allocate(5000, 64);
+            CHECK_EQUAL(0, (ptr_t)c & 63);
+            void* d = tracker.allocate(32);
+
+            names->deallocate(a);
+            nodes->deallocate(c);
+
+            tracking_alloc_t::stats_t s;
+            tracker.stats(1, s);
+            CHECK_EQUAL(2, s.m_allocs);
+            CHECK_EQUAL(1, s.m_deallocs);
+            CHECK_EQUAL(110, s.m_bytes);
+            CHECK_EQUAL(100, s.m_live);
+            CHECK_EQUAL(110, s.m_peak);
+            CHECK_EQUAL(1, s.m_histogram[0]);
+            CHECK_EQUAL(1, s.m_histogram[2]);
+
+            tracker.stats(2, s);
+            CHECK_EQUAL(0, s.m_live);
+            CHECK_EQUAL(5000, s.m_peak);
+            CHECK_EQUAL(1, s.m_histogram[5]);
+
+            tracker.stats(0, s);
+            CHECK_EQUAL(32, s.m_live);
+
+            CHECK_TRUE(tracker.has_leaks());
+            tracker.report(console);
+
+            // Memory can be returned through any of the tracker allocators
+            nodes->deallocate(b);
+            tracker.deallocate(d);
+            tracker.stats(1, s);
+            CHECK_EQUAL(0, s.m_live);
+            CHECK_FALSE(tracker.has_leaks());
+
+            tracker.teardown();
+        }
+
+        UNITTEST_TEST(threads)
+        {
+            tracking_alloc_t tracker;
+            tracker.setup(Allocator);
+            alloc_t* tagged = tracker.tag("threads");
+
+            std::thread threads[4];
+            for (s32 t = 0; t < 4; ++t)
+            {
+                threads[t] = std::thread([tagged]() {
+                    for (s32 i = 0; i < 1000; ++i)
+                    {
+                        void* p = tagged->allocate(64);
+                        tagged->deallocate(p);
+                    }
+                });
+            }
+            for (s32 t = 0; t < 4; ++t)
+                threads[t].join();
+
+            tracking_alloc_t::stats_t s;
+            tracker.stats(1, s);
+            CHECK_EQUAL(4000, s.m_allocs);
+            CHECK_EQUAL(4000, s.m_deallocs);
+            CHECK_EQUAL(0, s.m_live);
+            CHECK_TRUE(s.m_peak >= 64 && s.m_peak <= 4 * 64);
+
+            tracker.teardown();
+        }
+
+        UNITTEST_TEST(large_alignment)
+        {
+            tracking_alloc_t tracker;
+            tracker.setup(Allocator);
+            alloc_t* tagged = tracker.tag("aligned");
+
+            // The header offset equals the alignment, which must not be truncated
+            void* a = tagged->allocate(100, 64 * 1024);
+            void* b = tagged->allocate(200, 1024 * 1024);
+            CHECK_NOT_NULL(a);
+            CHECK_NOT_NULL(b);
+            CHECK_EQUAL(0, (ptr_t)a & (64 * 1024 - 1));
+            CHECK_EQUAL(0, (ptr_t)b & (1024 * 1024 - 1));
+
+            tracking_alloc_t::stats_t s;
+            tracker.stats(1, s);
+            CHECK_EQUAL(300, s.m_live);
+
+            tagged->deallocate(a);
+            tagged->deallocate(b);
+            tracker.stats(1, s);
+            CHECK_EQUAL(0, s.m_live);
+            CHECK_EQUAL(300, s.m_peak);
+
+            tracker.teardown();
+        }
+
+        UNITTEST_TEST(peak_across_flush)
+        {
+            tracking_alloc_t tracker;
+            tracker.setup(Allocator);
+            alloc_t* tagged = tracker.tag("big");
+
+            // Allocations larger than the flush threshold go to the shared counter right away
+            void* a = tagged->allocate(100 * 1024);
+            void* b = tagged->allocate(10);
+            tagged->deallocate(a);
+
+            tracking_alloc_t::stats_t s;
+            tracker.stats(1, s);
+            CHECK_EQUAL(10, s.m_live);
+            CHECK_EQUAL(100 * 1024 + 10, s.m_peak);
+
+            tagged->deallocate(b);
+            CHECK_FALSE(tracker.has_leaks());
+            tracker.teardown();
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,275 @@
+#include "cbase/c_allocator.h"
+#include "ccore/c_random.h"
+#include "cbase/c_btree.h"
+#include "cbase/c_map.h"
+#include "cbase/c_map32.h"
+#include "cbase/c_wyhash.h"
+
+#include "cbase/c_console.h"
+
+#include "cunittest/cunittest.h"
+#include "test_benchmark.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(btree)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+
+        // Random inserts and removes, checked against a presence table, after every round the
+        // in-order walk must produce exactly the present keys
+        template <s32 N>
+        static void s_random_ops(alloc_t* allocator, s32 key_range, s32 rounds)
+        {
+            btree_map_t<s32, s32, N> map(key_range);
+            bool*                    present = g_allocate_array_and_clear<bool>(allocator, key_range);
+            s32                      count   = 0;
+
+            xor_random_t random;
+            random.reset(12345);
+
+            for (s32 round = 0; round < rounds; ++round)
+            {
+                for (s32 i = 0; i < key_range; ++i)
+                {
+                    s32 const key = (s32)(random.rand32() % (u32)key_range);
+                    if ((random.rand32() & 3) != 0)
+                    {
+                        CHECK_EQUAL(!present[key], map.insert(key, key * 3));
+                        count += present[key] ? 0 : 1;
+                        present[key] = true;
+                    }
+                    else
+                    {
+                        CHECK_EQUAL(present[key], map.remove(key));
+                        count -= present[key] ? 1 : 0;
+                        present[key] = false;
+                    }
+                }
+                CHECK_EQUAL(count, map.size());
+
+                typename btree_map_t<s32, s32, N>::iterator_t iter = map.iterate();
+                s32                                           prev = -1;
+                s32                                           n    = 0;
+                while (iter.order())
+                {
+                    CHECK_TRUE(iter.key() > prev);
+                    CHECK_TRUE(present[iter.key()]);
+                    CHECK_EQUAL(iter.key() * 3, iter.value());
+                    prev = iter.key();
+                    n++;
+                }
+                CHECK_EQUAL(count, n);
+
+                for (s32 key = 0; key < key_range; ++key)
+                {
+                    s32 value = -1;
+                    CHECK_EQUAL(present[key], map.find(key, value));
+                    if (present[key])
+                        CHECK_EQUAL(key * 3, value);
+                }
+            }
+
+            // Remove everything, the tree collapses back to an empty root
+            for (s32 key = 0; key < key_range; ++key)
+                CHECK_EQUAL(present[key], map.remove(key));
+            CHECK_EQUAL(0, map.size());
+            CHECK_EQUAL(0, map.height());
+            CHECK_FALSE(map.iterate().order());
+
+            g_deallocate_array(allocator, present);
+        }
+
+        UNITTEST_TEST(insert_find_remove)
+        {
+            btree_map_t<s32, s32> map(1024);
+            CHECK_TRUE(map.empty());
+
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_TRUE(map.insert(i * 7 % 1000, i));
+            CHECK_FALSE(map.insert(0, 5));
+            CHECK_EQUAL(1000, map.size());
+            CHECK_TRUE(map.height() >= 1);
+
+            for (s32 i = 0; i < 1000; ++i)
+            {
+                s32 value = -1;
+                CHECK_TRUE(map.find(i * 7 % 1000, value));
+                CHECK_EQUAL(i, value);
+            }
+            CHECK_FALSE(map.contains(1000));
+            CHECK_FALSE(map.contains(-1));
+
+            for (s32 i = 0; i < 1000; i += 2)
+                CHECK_TRUE(map.remove(i));
+            CHECK_FALSE(map.remove(0));
+            CHECK_EQUAL(500, map.size());
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_EQUAL((i & 1) == 1, map.contains(i));
+
+            map.clear();
+            CHECK_EQUAL(0, map.size());
+            CHECK_FALSE(map.contains(1));
+            CHECK_TRUE(map.insert(1, 1));
+        }
+
+        UNITTEST_TEST(random_small_nodes)
+        {
+            s_random_ops<4>(Allocator, 2000, 8);
+            s_random_ops<5>(Allocator, 2000, 8);
+        }
+
+        UNITTEST_TEST(random_wide_nodes) { s_random_ops<32>(Allocator, 20000, 4); }
+
+        UNITTEST_TEST(full)
+        {
+            // The reservation holds at least 'max_items', an insert that needs a node beyond it fails
+            // and leaves the tree intact
+            btree_map_t<s32, s32, 4> map(64);
+            s32                      count = 0;
+            while (map.insert(count * 2, count))
+                count++;
+            CHECK_TRUE(count >= 64);
+            CHECK_EQUAL(count, map.size());
+            CHECK_FALSE(map.insert(count * 2, count));
+            CHECK_FALSE(map.contains(count * 2));
+
+            // Keys in between land in leaves that are not full
+            s32 extra = 0;
+            for (s32 i = 0; i < count; ++i)
+                extra += map.insert(i * 2 + 1, -i) ? 1 : 0;
+            CHECK_EQUAL(count + extra, map.size());
+
+            btree_map_t<s32, s32, 4>::iterator_t iter = map.iterate();
+            s32                                  prev = -1;
+            s32                                  n    = 0;
+            while (iter.order())
+            {
+                CHECK_TRUE(iter.key() > prev);
+                prev = iter.key();
+                n++;
+            }
+            CHECK_EQUAL(map.size(), n);
+            for (s32 i = 0; i < count; ++i)
+            {
+                s32 value = -1;
+                CHECK_TRUE(map.find(i * 2, value));
+                CHECK_EQUAL(i, value);
+            }
+
+            // Removing frees nodes for new inserts
+            for (s32 i = 0; i < count; ++i)
+                CHECK_TRUE(map.remove(i * 2));
+            CHECK_TRUE(map.insert(count * 2, count));
+        }
+
+        UNITTEST_TEST(range)
+        {
+            btree_map_t<s32, s32, 8> map(1024);
+            for (s32 i = 0; i < 500; ++i)
+                CHECK_TRUE(map.insert(i * 2, i));
+
+            btree_map_t<s32, s32, 8>::iterator_t iter = map.range(101, 301);
+            s32                                  k    = 102;
+            while (iter.order())
+            {
+                CHECK_EQUAL(k, iter.key());
+                CHECK_EQUAL(k / 2, iter.value());
+                k += 2;
+            }
+            CHECK_EQUAL(302, k);
+            CHECK_FALSE(iter.order());
+
+            iter = map.range(998, 5000);
+            CHECK_TRUE(iter.order());
+            CHECK_EQUAL(998, iter.key());
+            CHECK_FALSE(iter.order());
+
+            iter = map.range(999, 5000);
+            CHECK_FALSE(iter.order());
+        }
+
+        template <typename M>
+        static void s_bench(M& map, s32 const* keys, s32 count, u64& insert_us, u64& find_us)
+        {
+            auto t0 = ntest::now();
+            for (s32 i = 0; i < count; ++i)
+                map.insert(keys[i], i);
+            insert_us = ntest::elapsed_us(t0);
+
+            u32 sum = 0;
+            t0      = ntest::now();
+            for (s32 i = 0; i < count; ++i)
+            {
+                s32 value = 0;
+                map.find(keys[count - 1 - i], value);
+                sum += (u32)value;
+            }
+            find_us = ntest::elapsed_us(t0);
+            CHECK_EQUAL((u32)((u64)count * (u64)(count - 1) / 2), sum);
+        }
+
+        UNITTEST_TEST(benchmark)
+        {
+#if defined(TARGET_DEBUG)
+            s32 const sizes[] = {1000, 100000};
+#elif defined(CBASE_BENCHMARK_LARGE)
+            s32 const sizes[] = {1000, 1000000, 10000000};
+#else
+            s32 const sizes[] = {1000, 1000000};
+#endif
+            for (s32 const count : sizes)
+            {
+                // Unique keys in random order
+                s32* keys = g_allocate_array<s32>(Allocator, count);
+                xor_random_t random;
+                random.reset(777);
+                for (s32 i = 0; i < count; ++i)
+                    keys[i] = i;
+                for (s32 i = count - 1; i > 0; --i)
+                {
+                    s32 const j = (s32)(random.rand32() % (u32)(i + 1));
+                    s32 const t = keys[i];
+                    keys[i]     = keys[j];
+                    keys[j]     = t;
+                }
+
+                u64 insert_us, find_us;
+                {
+                    btree_map_t<s32, s32>* map = g_construct<btree_map_t<s32, s32>>(Allocator, count);
+                    s_bench(*map, keys, count, insert_us, find_us);
+                    ntest::print_times("btree_map_t:", count, "insert", insert_us, "find", find_us);
+                    g_destruct(Allocator, map);
+                }
+                {
+                    map_t<s32, s32>* map = g_construct<map_t<s32, s32>>(Allocator, Allocator, 4096);
+                    s_bench(*map, keys, count, insert_us, find_us);
+                    ntest::print_times("map_t:", count, "insert", insert_us, "find", find_us);
+                    g_destruct(Allocator, map);
+                }
+                {
+                    map32_t<s32, s32>* map = g_construct<map32_t<s32, s32>>(Allocator, Allocator, (u32)count);
+                    s_bench(*map, keys, count, insert_us, find_us);
+                    ntest::print_times("map32_t:", count, "insert", insert_us, "find", find_us);
+                    g_destruct(Allocator, map);
+                }
+                {
+                    nhash::wymap_t<s32, s32>* map = g_construct<nhash::wymap_t<s32, s32>>(Allocator);
+                    map->init(Allocator, count * 2);
+                    s_bench(*map, keys, count, insert_us, find_us);
+                    ntest::print_times("wymap_t:", count, "insert", insert_us, "find", find_us);
+                    g_destruct(Allocator, map);
+                }
+
+                g_deallocate_array(Allocator, keys);
+            }
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,350 @@
+#include "cbase/c_allocator.h"
+#include "ccore/c_random.h"
+#include "cbase/c_concurrent_hash_map.h"
+#include "cbase/c_wyhash.h"
+
+#include "cbase/c_console.h"
+
+#include "cunittest/cunittest.h"
+#include "test_benchmark.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(concurrent_hash_map)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        typedef concurrent_hash_map_t<u32, u32> map_t;
+
+
+        struct key_t
+        {
+            u64 m_a;
+            u64 m_b;
+            u32 m_c;
+            u32 m_d;
+            bool operator==(key_t const& other) const { return m_a == other.m_a && m_b == other.m_b && m_c == other.m_c && m_d == other.m_d; }
+        };
+
+        // Segments grow on different threads at the same time, so the map needs a thread-safe allocator
+        class locked_alloc_t : public alloc_t
+        {
+        public:
+            locked_alloc_t(alloc_t* allocator)
+                : m_allocator(allocator)
+            {
+            }
+
+            alloc_t*         m_allocator;
+            std::atomic_flag m_lock = ATOMIC_FLAG_INIT;
+
+        protected:
+            virtual void* v_allocate(u32 size, u32 alignment)
+            {
+                while (m_lock.test_and_set(std::memory_order_acquire))
+                    std::this_thread::yield();
+                void* ptr = m_allocator->allocate(size, alignment);
+                m_lock.clear(std::memory_order_release);
+                return ptr;
+            }
+            virtual void v_deallocate(void* ptr)
+            {
+                while (m_lock.test_and_set(std::memory_order_acquire))
+                    std::this_thread::yield();
+                m_allocator->deallocate(ptr);
+                m_lock.clear(std::memory_order_release);
+            }
+        };
+
+        UNITTEST_TEST(insert_find_remove)
+        {
+            map_t map(Allocator, 0, 4);
+            CHECK_EQUAL(4, map.segments());
+
+            for (u32 i = 0; i < 2000; ++i)
+                CHECK_TRUE(map.insert(i * 3, i));
+            CHECK_FALSE(map.insert(0, 1));
+            CHECK_EQUAL(2000, map.size());
+
+            for (u32 i = 0; i < 2000; ++i)
+            {
+                u32 value = 0;
+                CHECK_TRUE(map.find(i * 3, value));
+                CHECK_EQUAL(i, value);
+                CHECK_FALSE(map.contains(i * 3 + 1));
+            }
+
+            CHECK_FALSE(map.assign(3, 100));
+            u32 value = 0;
+            CHECK_TRUE(map.find(3, value));
+            CHECK_EQUAL(100, value);
+            CHECK_TRUE(map.assign(1, 7));
+            CHECK_TRUE(map.remove(1));
+
+            for (u32 i = 0; i < 2000; i += 2)
+                CHECK_TRUE(map.remove(i * 3));
+            CHECK_FALSE(map.remove(0));
+            CHECK_EQUAL(1000, map.size());
+            for (u32 i = 0; i < 2000; ++i)
+                CHECK_EQUAL((i & 1) == 1, map.contains(i * 3));
+
+            map.reclaim();
+            CHECK_TRUE(map.contains(3));
+        }
+
+        UNITTEST_TEST(retired_memory_bound)
+        {
+            // Growing retires the old tables, together they stay below the size of the live tables
+            map_t map(Allocator, 0, 4);
+            int_t live, retired;
+            map.memory(live, retired);
+            CHECK_TRUE(live > 0);
+            CHECK_EQUAL(0, retired);
+
+            for (u32 i = 0; i < 20000; ++i)
+            {
+                CHECK_TRUE(map.insert(i, i));
+                if ((i & 1023) == 0)
+                {
+                    map.memory(live, retired);
+                    CHECK_TRUE(retired < live);
+                }
+            }
+            map.memory(live, retired);
+            CHECK_TRUE(retired > 0);
+            CHECK_TRUE(retired < live);
+
+            map.reclaim();
+            map.memory(live, retired);
+            CHECK_EQUAL(0, retired);
+            CHECK_TRUE(map.contains(19999));
+        }
+
+        UNITTEST_TEST(wide_keys)
+        {
+            concurrent_hash_map_t<key_t, key_t> map(Allocator, 500);
+            for (u32 i = 0; i < 500; ++i)
+            {
+                key_t const key = {(u64)i, ~(u64)i, i * 5, i};
+                CHECK_TRUE(map.insert(key, key));
+            }
+            for (u32 i = 0; i < 500; ++i)
+            {
+                key_t const key   = {(u64)i, ~(u64)i, i * 5, i};
+                key_t const other = {(u64)i, ~(u64)i, i * 5 + 1, i};
+                key_t       value = {0, 0, 0, 0};
+                CHECK_TRUE(map.find(key, value));
+                CHECK_TRUE(value == key);
+                CHECK_FALSE(map.contains(other));
+            }
+        }
+
+        // Every writer owns the keys k where (k % c_num_writers) == writer, so it knows exactly which of
+        // its keys are present. The readers check that a found key always has the value that belongs to it.
+        UNITTEST_TEST(concurrent_writers_and_readers)
+        {
+            const s32      c_num_writers = 4;
+            const s32      c_num_readers = 4;
+            const u32      c_key_range   = 1 << 14;
+            locked_alloc_t allocator(Allocator);
+            map_t          map(&allocator, 0, 16);
+
+            std::atomic<bool> done(false);
+            std::atomic<s32>  errors(0);
+            std::thread       readers[c_num_readers];
+            for (s32 r = 0; r < c_num_readers; ++r)
+            {
+                readers[r] = std::thread([&map, &done, &errors, r]() {
+                    xor_random_t random;
+                    random.reset(1000 + r);
+                    while (!done.load(std::memory_order_relaxed))
+                    {
+                        u32 const key   = random.rand32() % c_key_range;
+                        u32       value = 0;
+                        if (map.find(key, value) && value != key * 7 + 1)
+                            errors.fetch_add(1);
+                    }
+                });
+            }
+
+            bool*       present = g_allocate_array_and_clear<bool>(Allocator, (s32)c_key_range);
+            std::thread writers[c_num_writers];
+            for (s32 w = 0; w < c_num_writers; ++w)
+            {
+                writers[w] = std::thread([&map, &errors, present, w]() {
+                    xor_random_t random;
+                    random.reset(77 + w);
+                    for (s32 i = 0; i < 50000; ++i)
+                    {
+                        u32 const key = (random.rand32() % (c_key_range / c_num_writers)) * c_num_writers + (u32)w;
+                        if ((random.rand32() % 3) != 0)
+                        {
+                            if (map.insert(key, key * 7 + 1) == present[key])
+                                errors.fetch_add(1);
+                            present[key] = true;
+                        }
+                        else
+                        {
+                            if (map.remove(key) != present[key])
+                                errors.fetch_add(1);
+                            present[key] = false;
+                        }
+                    }
+                });
+            }
+            for (s32 w = 0; w < c_num_writers; ++w)
+                writers[w].join();
+            done.store(true);
+            for (s32 r = 0; r < c_num_readers; ++r)
+                readers[r].join();
+            CHECK_EQUAL(0, errors.load());
+
+            s32 count = 0;
+            for (u32 key = 0; key < c_key_range; ++key)
+            {
+                u32 value = 0;
+                CHECK_EQUAL(present[key], map.find(key, value));
+                if (present[key])
+                    CHECK_EQUAL(key * 7 + 1, value);
+                count += present[key] ? 1 : 0;
+            }
+            CHECK_EQUAL(count, map.size());
+            g_deallocate_array(Allocator, present);
+        }
+
+        // The baseline, a single threaded map behind one lock
+        struct locked_map_t
+        {
+            locked_map_t(alloc_t* allocator) { m_map.init(allocator, 16); }
+
+            bool find(u32 key, u32& value)
+            {
+                lock();
+                bool const found = m_map.find(key, value);
+                unlock();
+                return found;
+            }
+            bool assign(u32 key, u32 value)
+            {
+                lock();
+                bool const inserted = m_map.insert(key, value);
+                unlock();
+                return inserted;
+            }
+            bool remove(u32 key)
+            {
+                lock();
+                bool const removed = m_map.remove(key);
+                unlock();
+                return removed;
+            }
+
+            void lock()
+            {
+                while (m_lock.test_and_set(std::memory_order_acquire))
+                    std::this_thread::yield();
+            }
+            void unlock() { m_lock.clear(std::memory_order_release); }
+
+            nhash::wymap_t<u32, u32> m_map;
+            std::atomic_flag         m_lock = ATOMIC_FLAG_INIT;
+        };
+
+        // Every thread does 'ops' operations on keys in [0, key_range), 'write_pct' out of every 200 are
+        // assigns and as many are removes, the rest are finds. Returns the elapsed time in microseconds.
+        template <typename M>
+        static u64 s_run(M & map, s32 num_threads, s32 ops, u32 key_range, u32 write_pct)
+        {
+            std::thread threads[16];
+            auto        t0 = ntest::now();
+            for (s32 t = 0; t < num_threads; ++t)
+            {
+                threads[t] = std::thread([&map, ops, key_range, write_pct, t]() {
+                    xor_random_t random;
+                    random.reset(12345 + t);
+                    u32 sum = 0;
+                    for (s32 i = 0; i < ops; ++i)
+                    {
+                        u32 const key = random.rand32() % key_range;
+                        u32 const op  = random.rand32() % 200;
+                        if (op < write_pct)
+                            map.assign(key, key);
+                        else if (op < write_pct * 2)
+                            map.remove(key);
+                        else
+                        {
+                            u32 value = 0;
+                            map.find(key, value);
+                            sum += value;
+                        }
+                    }
+                    (void)sum;
+                });
+            }
+            for (s32 t = 0; t < num_threads; ++t)
+                threads[t].join();
+            return ntest::elapsed_us(t0);
+        }
+
+        static void s_print(const char* name, const char* mix, s32 num_threads, s32 ops, u64 us)
+        {
+            console->write(name);
+            console->write(" ");
+            console->write(mix);
+            console->write(", threads: ");
+            console->write((s64)num_threads);
+            console->write(", ops: ");
+            console->write((s64)(ops * num_threads));
+            console->write(", time: ");
+            console->write((s64)us);
+            console->writeLine(" us");
+        }
+
+        UNITTEST_TEST(benchmark)
+        {
+#ifdef TARGET_DEBUG
+            const s32 c_ops       = 20000;
+            const u32 c_key_range = 1 << 14;
+#else
+            const s32 c_ops       = 1000000;
+            const u32 c_key_range = 1 << 20;
+#endif
+            const char* mixes[]     = {"read-heavy (95% find)", "write-heavy (50% find)"};
+            u32 const   write_pct[] = {5, 50};  // per 200, for assign and for remove each
+            s32 const   threads[]   = {1, 2, 4, 8};
+
+            for (s32 m = 0; m < 2; ++m)
+            {
+                for (s32 const num_threads : threads)
+                {
+                    {
+                        locked_alloc_t allocator(Allocator);
+                        map_t*         map = g_construct<map_t>(Allocator, &allocator, (s32)c_key_range);
+                        for (u32 k = 0; k < c_key_range; k += 2)
+                            map->insert(k, k);
+                        u64 const us = s_run(*map, num_threads, c_ops, c_key_range, write_pct[m]);
+                        s_print("concurrent_hash_map_t", mixes[m], num_threads, c_ops, us);
+                        g_destruct(Allocator, map);
+                    }
+                    {
+                        locked_map_t* map = g_construct<locked_map_t>(Allocator, Allocator);
+                        for (u32 k = 0; k < c_key_range; k += 2)
+                            map->assign(k, k);
+                        u64 const us = s_run(*map, num_threads, c_ops, c_key_range, write_pct[m]);
+                        s_print("wymap_t + lock       ", mixes[m], num_threads, c_ops, us);
+                        g_destruct(Allocator, map);
+                    }
+                }
+            }
+        }
+    }
+}
+UNITTEST_SUITE_END
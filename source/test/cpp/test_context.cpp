@@ -1,7 +1,10 @@
 #include "cbase/c_context.h"
+#include "cbase/c_allocator_stack.h"
 
 #include "cunittest/cunittest.h"
 
+#include <thread>
+
 using namespace ncore;
 
 UNITTEST_SUITE_BEGIN(context)
@@ -34,6 +37,56 @@ UNITTEST_SUITE_BEGIN(context)
 			CHECK_EQUAL(2.0f, obj->mFloat);
 		}
 
+        UNITTEST_TEST(recycle)
+        {
+            context_data_t* data   = nullptr;
+            alloc_t*        system = nullptr;
+
+            std::thread first([&]() {
+                context_t context = g_current_context();
+                data              = context.m_data;
+                system            = context.system_alloc();
+                context.set_slot0((void*)&gInstance);
+                context.set_system_alloc(nullptr);
+                context.stack_alloc()->allocate(1024);
+                g_release_context();
+            });
+            first.join();
+
+            // A new thread adopts the released context, which is back in its initial state
+            bool reused = false;
+            std::thread second([&]() {
+                context_t context = g_current_context();
+                reused            = (context.m_data == data);
+                CHECK_NULL(context.slot0());
+                CHECK_EQUAL(system, context.system_alloc());
+                CHECK_EQUAL(0, context.stack_alloc()->used());
+                g_release_context();
+            });
+            second.join();
+            CHECK_TRUE(reused);
+        }
+
+        UNITTEST_TEST(prewarm)
+        {
+            CHECK_EQUAL(4, g_prewarm_contexts(4));
+
+            std::thread threads[4];
+            for (s32 i = 0; i < 4; ++i)
+            {
+                threads[i] = std::thread([]() {
+                    context_t context = g_current_context();
+                    void*     mem     = context.system_alloc()->allocate(256);
+                    CHECK_NOT_NULL(mem);
+                    g_release_context();
+                });
+            }
+            for (s32 i = 0; i < 4; ++i)
+                threads[i].join();
+
+            g_release_context_pool();
+        }
+
 	}
 }
 UNITTEST_SUITE_END
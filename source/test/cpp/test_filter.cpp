@@ -0,0 +1,258 @@
+#include "cbase/c_allocator.h"
+#include "cbase/c_buffer.h"
+#include "cbase/c_filter.h"
+
+#include "cbase/c_console.h"
+
+#include "cunittest/cunittest.h"
+#include "test_benchmark.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(filter)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        // Keys [0, n) are inserted, keys [n, 2n) are used to measure the false positive rate
+        static u64 s_key(s32 i) { return (u64)i * 0x9E3779B97F4A7C15ull + 12345; }
+
+        static void s_print_rate(const char* name, s32 count, s32 false_positives)
+        {
+            console->write(name);
+            console->write(" keys: ");
+            console->write((s64)count);
+            console->write(", false positives: ");
+            console->write((s64)false_positives);
+            console->write(" (");
+            console->write((f64)false_positives * 100.0 / (f64)count);
+            console->writeLine("%)");
+        }
+
+        UNITTEST_TEST(bloom_false_positive_rate)
+        {
+            const s32      c_num_keys = 100000;
+            bloom_filter_t filter;
+            CHECK_TRUE(filter.init(Allocator, c_num_keys, 10, 7));
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                u64 const key = s_key(i);
+                filter.insert(&key, sizeof(key));
+            }
+            CHECK_EQUAL((u64)c_num_keys, filter.count());
+
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                u64 const key = s_key(i);
+                CHECK_TRUE(filter.contains(&key, sizeof(key)));
+            }
+
+            s32 false_positives = 0;
+            for (s32 i = c_num_keys; i < 2 * c_num_keys; ++i)
+            {
+                u64 const key = s_key(i);
+                false_positives += filter.contains(&key, sizeof(key)) ? 1 : 0;
+            }
+            s_print_rate("bloom_filter_t (10 bits/key)", c_num_keys, false_positives);
+            CHECK_TRUE(false_positives < c_num_keys / 50);  // < 2%
+
+            filter.clear();
+            u64 const key = s_key(0);
+            CHECK_FALSE(filter.contains(&key, sizeof(key)));
+        }
+
+        UNITTEST_TEST(cuckoo_false_positive_rate)
+        {
+            const s32       c_num_keys = 100000;
+            cuckoo_filter_t filter;
+            CHECK_TRUE(filter.init(Allocator, c_num_keys, 7));
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                u64 const key = s_key(i);
+                CHECK_TRUE(filter.insert(&key, sizeof(key)));
+            }
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                u64 const key = s_key(i);
+                CHECK_TRUE(filter.contains(&key, sizeof(key)));
+            }
+
+            s32 false_positives = 0;
+            for (s32 i = c_num_keys; i < 2 * c_num_keys; ++i)
+            {
+                u64 const key = s_key(i);
+                false_positives += filter.contains(&key, sizeof(key)) ? 1 : 0;
+            }
+            s_print_rate("cuckoo_filter_t (16-bit fingerprints)", c_num_keys, false_positives);
+            CHECK_TRUE(false_positives < c_num_keys / 5000);  // < 0.02%, the bound is 8 / 65535 ~ 0.012%
+        }
+
+        UNITTEST_TEST(cuckoo_remove_and_full)
+        {
+            cuckoo_filter_t filter;
+            CHECK_TRUE(filter.init(Allocator, 1000));
+
+            // Fill the filter until it refuses, the table has 4 slots per bucket
+            s32 inserted = 0;
+            while (true)
+            {
+                u64 const key = s_key(inserted);
+                if (!filter.insert(&key, sizeof(key)))
+                    break;
+                inserted++;
+            }
+            CHECK_TRUE(inserted >= 1000);
+            CHECK_TRUE(inserted <= (s32)(filter.size() / 2));
+            CHECK_EQUAL((u64)inserted, filter.count());
+
+            // Every inserted key is still there, including the one that did not fit anymore
+            for (s32 i = 0; i < inserted; ++i)
+            {
+                u64 const key = s_key(i);
+                CHECK_TRUE(filter.contains(&key, sizeof(key)));
+            }
+
+            // Removing makes room again
+            for (s32 i = 0; i < inserted; i += 2)
+            {
+                u64 const key = s_key(i);
+                CHECK_TRUE(filter.remove(&key, sizeof(key)));
+            }
+            CHECK_EQUAL((u64)(inserted / 2), filter.count());
+            for (s32 i = 1; i < inserted; i += 2)
+            {
+                u64 const key = s_key(i);
+                CHECK_TRUE(filter.contains(&key, sizeof(key)));
+            }
+            u64 const key = s_key(inserted);
+            CHECK_TRUE(filter.insert(&key, sizeof(key)));
+            CHECK_TRUE(filter.remove(&key, sizeof(key)));
+
+            for (s32 i = 1; i < inserted; i += 2)
+            {
+                u64 const k = s_key(i);
+                CHECK_TRUE(filter.remove(&k, sizeof(k)));
+            }
+            CHECK_EQUAL((u64)0, filter.count());
+            CHECK_FALSE(filter.remove(&key, sizeof(key)));
+        }
+
+        UNITTEST_TEST(serialize)
+        {
+            const s32       c_num_keys = 5000;
+            bloom_filter_t  bloom;
+            cuckoo_filter_t cuckoo;
+            CHECK_TRUE(bloom.init(Allocator, c_num_keys, 12, 99));
+            CHECK_TRUE(cuckoo.init(Allocator, c_num_keys, 99));
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                u64 const key = s_key(i);
+                bloom.insert(&key, sizeof(key));
+                cuckoo.insert(&key, sizeof(key));
+            }
+
+            // A too small buffer is refused
+            u8*      data = (u8*)Allocator->allocate((u32)bloom.serialized_size(), 64);
+            buffer_t small(data, data + 32);
+            CHECK_FALSE(bloom.serialize(small));
+
+            buffer_t bloom_data(data, data + bloom.serialized_size());
+            CHECK_TRUE(bloom.serialize(bloom_data));
+            u8*      cdata = (u8*)Allocator->allocate((u32)cuckoo.serialized_size(), 64);
+            buffer_t cuckoo_data(cdata, cdata + cuckoo.serialized_size());
+            CHECK_TRUE(cuckoo.serialize(cuckoo_data));
+
+            // The wrong kind of filter is refused
+            bloom_filter_t wrong;
+            CHECK_FALSE(wrong.view(cbuffer_t(cuckoo_data)));
+
+            // A view uses the serialized table in place, a deserialized filter has its own copy
+            bloom_filter_t  bloom_view, bloom_copy;
+            cuckoo_filter_t cuckoo_view, cuckoo_copy;
+            CHECK_TRUE(bloom_view.view(cbuffer_t(bloom_data)));
+            CHECK_TRUE(bloom_copy.deserialize(Allocator, cbuffer_t(bloom_data)));
+            CHECK_TRUE(cuckoo_view.view(cbuffer_t(cuckoo_data)));
+            CHECK_TRUE(cuckoo_copy.deserialize(Allocator, cbuffer_t(cuckoo_data)));
+            CHECK_EQUAL(bloom.count(), bloom_view.count());
+            CHECK_EQUAL(cuckoo.count(), cuckoo_copy.count());
+
+            for (s32 i = 0; i < 2 * c_num_keys; ++i)
+            {
+                u64 const key = s_key(i);
+                bool const b  = bloom.contains(&key, sizeof(key));
+                bool const c  = cuckoo.contains(&key, sizeof(key));
+                CHECK_EQUAL(b, bloom_view.contains(&key, sizeof(key)));
+                CHECK_EQUAL(b, bloom_copy.contains(&key, sizeof(key)));
+                CHECK_EQUAL(c, cuckoo_view.contains(&key, sizeof(key)));
+                CHECK_EQUAL(c, cuckoo_copy.contains(&key, sizeof(key)));
+            }
+
+            // The copy can still be changed
+            u64 const key = s_key(0);
+            CHECK_TRUE(cuckoo_copy.remove(&key, sizeof(key)));
+            CHECK_TRUE(cuckoo_view.contains(&key, sizeof(key)));
+
+            bloom_view.release();
+            cuckoo_view.release();
+            Allocator->deallocate(cdata);
+            Allocator->deallocate(data);
+        }
+
+        template <typename F>
+        static void s_bench(F & filter, const char* name, s32 count)
+        {
+            auto t0 = ntest::now();
+            for (s32 i = 0; i < count; ++i)
+            {
+                u64 const key = s_key(i);
+                filter.insert(&key, sizeof(key));
+            }
+            u64 const insert_us = ntest::elapsed_us(t0);
+
+            s32 hits = 0;
+            t0       = ntest::now();
+            for (s32 i = 0; i < count; ++i)
+            {
+                u64 const key = s_key(i);
+                hits += filter.contains(&key, sizeof(key)) ? 1 : 0;
+            }
+            u64 const hit_us = ntest::elapsed_us(t0);
+            CHECK_EQUAL(count, hits);
+
+            t0 = ntest::now();
+            for (s32 i = count; i < 2 * count; ++i)
+            {
+                u64 const key = s_key(i);
+                hits += filter.contains(&key, sizeof(key)) ? 1 : 0;
+            }
+            u64 const miss_us = ntest::elapsed_us(t0);
+            ntest::print_times(name, count, "insert", insert_us, "contains hit", hit_us, "contains miss", miss_us);
+        }
+
+        UNITTEST_TEST(benchmark)
+        {
+#if defined(TARGET_DEBUG)
+            const s32 c_num_keys = 200000;
+#elif defined(CBASE_BENCHMARK_LARGE)
+            const s32 c_num_keys = 10000000;
+#else
+            const s32 c_num_keys = 1000000;
+#endif
+            {
+                bloom_filter_t filter;
+                filter.init(Allocator, c_num_keys, 10);
+                s_bench(filter, "bloom_filter_t:", c_num_keys);
+            }
+            {
+                cuckoo_filter_t filter;
+                filter.init(Allocator, c_num_keys);
+                s_bench(filter, "cuckoo_filter_t:", c_num_keys);
+            }
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -0,0 +1,277 @@
+#include "cbase/c_allocator.h"
+#include "ccore/c_random.h"
+#include "cbase/c_flat_hash_map.h"
+#include "cbase/c_map.h"
+#include "cbase/c_map32.h"
+#include "cbase/c_wyhash.h"
+
+#include "cbase/c_console.h"
+
+#include "cunittest/cunittest.h"
+#include "test_benchmark.h"
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(flat_hash_map)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+
+        struct key_t
+        {
+            u64 m_a;
+            u64 m_b;
+            bool operator==(key_t const& other) const { return m_a == other.m_a && m_b == other.m_b; }
+        };
+
+        UNITTEST_TEST(insert_find_remove)
+        {
+            flat_hash_map_t<s32, s32> map(Allocator);
+            CHECK_TRUE(map.empty());
+            CHECK_EQUAL(16, map.capacity());
+
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_TRUE(map.insert(i * 7, i));
+            CHECK_FALSE(map.insert(0, 5));
+            CHECK_EQUAL(1000, map.size());
+
+            for (s32 i = 0; i < 1000; ++i)
+            {
+                s32 value = -1;
+                CHECK_TRUE(map.find(i * 7, value));
+                CHECK_EQUAL(i, value);
+                CHECK_FALSE(map.contains(i * 7 + 1));
+            }
+
+            for (s32 i = 0; i < 1000; i += 2)
+                CHECK_TRUE(map.remove(i * 7));
+            CHECK_FALSE(map.remove(0));
+            CHECK_EQUAL(500, map.size());
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_EQUAL((i & 1) == 1, map.contains(i * 7));
+
+            map.clear();
+            CHECK_EQUAL(0, map.size());
+            CHECK_FALSE(map.contains(7));
+            CHECK_TRUE(map.insert(7, 1));
+        }
+
+        // Forwards to another allocator, or fails every allocation while 'm_fail' is set
+        class failing_alloc_t : public alloc_t
+        {
+        public:
+            failing_alloc_t(alloc_t* allocator)
+                : m_allocator(allocator)
+                , m_fail(true)
+            {
+            }
+
+            alloc_t* m_allocator;
+            bool     m_fail;
+
+        protected:
+            virtual void* v_allocate(u32 size, u32 alignment) { return m_fail ? nullptr : m_allocator->allocate(size, alignment); }
+            virtual void  v_deallocate(void* ptr) { m_allocator->deallocate(ptr); }
+        };
+
+        UNITTEST_TEST(allocation_failure)
+        {
+            // Without slots the map is empty and usable, the first insert that can allocate succeeds
+            failing_alloc_t           failing(Allocator);
+            flat_hash_map_t<s32, s32> map(&failing, 100);
+            CHECK_EQUAL(0, map.capacity());
+            CHECK_FALSE(map.contains(1));
+            CHECK_FALSE(map.remove(1));
+            CHECK_FALSE(map.insert(1, 1));
+            CHECK_FALSE(map.reserve(10));
+            map.clear();
+            CHECK_TRUE(map.empty());
+
+            failing.m_fail = false;
+            CHECK_TRUE(map.insert(1, 10));
+            CHECK_TRUE(map.capacity() > 0);
+            s32 value = 0;
+            CHECK_TRUE(map.find(1, value));
+            CHECK_EQUAL(10, value);
+
+            // A failed grow keeps the items
+            failing.m_fail = true;
+            s32 i          = 2;
+            while (map.insert(i, i * 10))
+                i++;
+            CHECK_EQUAL(i - 1, map.size());
+            for (s32 k = 2; k < i; ++k)
+                CHECK_TRUE(map.contains(k));
+            CHECK_FALSE(map.contains(i));
+        }
+
+        UNITTEST_TEST(wide_keys)
+        {
+            // Keys larger than 8 bytes are hashed with wyhash over their bytes
+            flat_hash_map_t<key_t, s32> map(Allocator, 100);
+            s32 const                   capacity = map.capacity();
+            for (s32 i = 0; i < 100; ++i)
+            {
+                key_t const key = {(u64)i, (u64)(100 - i)};
+                CHECK_TRUE(map.insert(key, i));
+            }
+            CHECK_EQUAL(capacity, map.capacity());  // sized up front, no rehash
+
+            for (s32 i = 0; i < 100; ++i)
+            {
+                key_t const key   = {(u64)i, (u64)(100 - i)};
+                key_t const other = {(u64)i, (u64)(101 - i)};
+                s32         value = -1;
+                CHECK_TRUE(map.find(key, value));
+                CHECK_EQUAL(i, value);
+                CHECK_FALSE(map.contains(other));
+            }
+        }
+
+        // A working set that stays the same size while keys come and go, this leaves deleted markers
+        // behind in full groups and exercises the in-place rehash
+        UNITTEST_TEST(churn)
+        {
+            const s32                 c_key_range = 1 << 16;
+            bool*                     present     = g_allocate_array_and_clear<bool>(Allocator, c_key_range);
+            flat_hash_map_t<u32, u32> map(Allocator, 2000);
+            s32 const                 capacity = map.capacity();
+
+            xor_random_t random;
+            random.reset(11);
+            s32 count = 0;
+            for (s32 op = 0; op < 400000; ++op)
+            {
+                u32 const key = random.rand32() % (u32)c_key_range;
+                if (count < 1500 || (random.rand32() & 1) == 0)
+                {
+                    CHECK_EQUAL(!present[key], map.insert(key, key ^ 0x5555));
+                    count += present[key] ? 0 : 1;
+                    present[key] = true;
+                }
+                else
+                {
+                    // remove a present key, to keep the size around 1500
+                    u32 k = key;
+                    while (!present[k])
+                        k = (k + 1) % (u32)c_key_range;
+                    CHECK_TRUE(map.remove(k));
+                    present[k] = false;
+                    count -= 1;
+                }
+                if (count > 1700)
+                {
+                    u32 k = key;
+                    while (!present[k])
+                        k = (k + 1) % (u32)c_key_range;
+                    CHECK_TRUE(map.remove(k));
+                    present[k] = false;
+                    count -= 1;
+                }
+            }
+            CHECK_EQUAL(count, map.size());
+            CHECK_TRUE(map.capacity() <= capacity * 2);
+
+            for (s32 k = 0; k < c_key_range; ++k)
+            {
+                u32 value = 0;
+                CHECK_EQUAL(present[k], map.find((u32)k, value));
+                if (present[k])
+                    CHECK_EQUAL((u32)k ^ 0x5555, value);
+            }
+            g_deallocate_array(Allocator, present);
+        }
+
+        // Keys [0, count) are inserted in a random order, the misses use keys [count, 2 * count)
+        template <typename M>
+        static void s_bench(M& map, s32 const* keys, s32 count, u64& insert_us, u64& hit_us, u64& miss_us)
+        {
+            auto t0 = ntest::now();
+            for (s32 i = 0; i < count; ++i)
+                map.insert(keys[i], i);
+            insert_us = ntest::elapsed_us(t0);
+
+            u32 sum = 0;
+            t0      = ntest::now();
+            for (s32 i = 0; i < count; ++i)
+            {
+                s32 value = 0;
+                map.find(keys[count - 1 - i], value);
+                sum += (u32)value;
+            }
+            hit_us = ntest::elapsed_us(t0);
+            CHECK_EQUAL((u32)((u64)count * (u64)(count - 1) / 2), sum);
+
+            s32 found = 0;
+            t0        = ntest::now();
+            for (s32 i = 0; i < count; ++i)
+            {
+                s32 value = 0;
+                found += map.find(keys[i] + count, value) ? 1 : 0;
+            }
+            miss_us = ntest::elapsed_us(t0);
+            CHECK_EQUAL(0, found);
+        }
+
+        UNITTEST_TEST(benchmark)
+        {
+#if defined(TARGET_DEBUG)
+            s32 const sizes[] = {1000, 100000};
+#elif defined(CBASE_BENCHMARK_LARGE)
+            s32 const sizes[] = {1000, 1000000, 10000000};
+#else
+            s32 const sizes[] = {1000, 1000000};
+#endif
+            for (s32 const count : sizes)
+            {
+                s32* keys = g_allocate_array<s32>(Allocator, count);
+                xor_random_t random;
+                random.reset(31337);
+                for (s32 i = 0; i < count; ++i)
+                    keys[i] = i;
+                for (s32 i = count - 1; i > 0; --i)
+                {
+                    s32 const j = (s32)(random.rand32() % (u32)(i + 1));
+                    s32 const t = keys[i];
+                    keys[i]     = keys[j];
+                    keys[j]     = t;
+                }
+
+                u64 insert_us, hit_us, miss_us;
+                {
+                    flat_hash_map_t<s32, s32>* map = g_construct<flat_hash_map_t<s32, s32>>(Allocator, Allocator);
+                    s_bench(*map, keys, count, insert_us, hit_us, miss_us);
+                    ntest::print_times("flat_hash_map_t:", count, "insert", insert_us, "find hit", hit_us, "find miss", miss_us);
+                    g_destruct(Allocator, map);
+                }
+                {
+                    nhash::wymap_t<s32, s32>* map = g_construct<nhash::wymap_t<s32, s32>>(Allocator);
+                    map->init(Allocator, 16);
+                    s_bench(*map, keys, count, insert_us, hit_us, miss_us);
+                    ntest::print_times("wymap_t:", count, "insert", insert_us, "find hit", hit_us, "find miss", miss_us);
+                    g_destruct(Allocator, map);
+                }
+                {
+                    map_t<s32, s32>* map = g_construct<map_t<s32, s32>>(Allocator, Allocator, 4096);
+                    s_bench(*map, keys, count, insert_us, hit_us, miss_us);
+                    ntest::print_times("map_t:", count, "insert", insert_us, "find hit", hit_us, "find miss", miss_us);
+                    g_destruct(Allocator, map);
+                }
+                {
+                    map32_t<s32, s32>* map = g_construct<map32_t<s32, s32>>(Allocator, Allocator, (u32)count);
+                    s_bench(*map, keys, count, insert_us, hit_us, miss_us);
+                    ntest::print_times("map32_t:", count, "insert", insert_us, "find hit", hit_us, "find miss", miss_us);
+                    g_destruct(Allocator, map);
+                }
+
+                g_deallocate_array(Allocator, keys);
+            }
+        }
+    }
+}
+UNITTEST_SUITE_END
@@ -1,6 +1,12 @@
+#include "cbase/c_buffer.h"
 #include "cbase/c_hash.h"
+#include "cbase/c_runes.h"
+#include "cbase/c_wyhash.h"
+
+#include "cbase/c_console.h"
 
 #include "cunittest/cunittest.h"
+#include "test_benchmark.h"
 
 using namespace ncore;
 
@@ -44,5 +50,429 @@ UNITTEST_SUITE_BEGIN(hash)
         }
 
     }
+
+    UNITTEST_FIXTURE(streaming)
+    {
+        UNITTEST_ALLOCATOR;
+
+        static const s32 c_data_size = 300;
+        static u8        s_data[c_data_size];
+
+        UNITTEST_FIXTURE_SETUP()
+        {
+            u64 x = 0x0123456789ABCDEFull;
+            for (s32 i = 0; i < c_data_size; i++)
+            {
+                x ^= x << 13;
+                x ^= x >> 7;
+                x ^= x << 17;
+                s_data[i] = (u8)x;
+            }
+        }
+
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        // Feeding the data in two pieces gives the same hash for every split point
+        UNITTEST_TEST(wyhasher_split)
+        {
+            for (s32 len = 0; len <= 200; ++len)
+            {
+                u64 const expected = nhash::wyhash_bytes(s_data, len, 7, nhash::g_wysecret);
+                for (s32 split = 0; split <= len; ++split)
+                {
+                    nhash::wyhasher_t hasher(7);
+                    hasher.hash(s_data, s_data + split);
+                    hasher.hash(s_data + split, s_data + len);
+                    CHECK_EQUAL(expected, hasher.digest());
+                }
+            }
+
+            // Byte by byte, and reused after begin()
+            nhash::wyhasher_t hasher(7);
+            for (s32 i = 0; i < c_data_size; ++i)
+                hasher.hash(s_data + i, s_data + i + 1);
+            CHECK_EQUAL(nhash::wyhash_bytes(s_data, c_data_size, 7, nhash::g_wysecret), hasher.digest());
+            hasher.begin();
+            hasher.hash(s_data, s_data + 10);
+            CHECK_EQUAL(nhash::wyhash_bytes(s_data, 10, 7, nhash::g_wysecret), hasher.digest());
+
+            u8 out[8];
+            hasher.end(out, 8);
+            u64 const h = hasher.digest();
+            for (s32 i = 0; i < 8; ++i)
+                CHECK_EQUAL((u8)(h >> (i * 8)), out[i]);
+        }
+
+        UNITTEST_TEST(xxh3_split)
+        {
+            for (s32 len = 0; len <= c_data_size; len += (len < 140 ? 1 : 7))
+            {
+                nhash::xxh3_hasher_t one(128, 3);
+                one.hash(s_data, s_data + len);
+                u64 lo, hi;
+                one.digest128(lo, hi);
+                CHECK_EQUAL(one.digest(), lo);
+                for (s32 split = 0; split <= len; ++split)
+                {
+                    nhash::xxh3_hasher_t hasher(128, 3);
+                    hasher.hash(s_data, s_data + split);
+                    hasher.hash(s_data + split, s_data + len);
+                    u64 lo2, hi2;
+                    hasher.digest128(lo2, hi2);
+                    CHECK_EQUAL(lo, lo2);
+                    CHECK_EQUAL(hi, hi2);
+                }
+            }
+
+            // Long enough to pass several scrambles, fed in odd sized pieces
+            const s32 c_long = 64 * 16 * 3 + 5;
+            u8*       data   = (u8*)Allocator->allocate(c_long, 8);
+            for (s32 i = 0; i < c_long; ++i)
+                data[i] = s_data[i % c_data_size] ^ (u8)(i >> 8);
+            nhash::xxh3_hasher_t one(64, 3);
+            one.hash(data, data + c_long);
+            nhash::xxh3_hasher_t pieces(64, 3);
+            for (s32 i = 0; i < c_long; i += 37)
+                pieces.hash(data + i, data + (i + 37 < c_long ? i + 37 : c_long));
+            CHECK_EQUAL(one.digest(), pieces.digest());
+            Allocator->deallocate(data);
+
+            // The seed, the length and the content all change the hash
+            nhash::xxh3_hasher_t a(64, 1), b(64, 2), c(64, 1), d(64, 1);
+            a.hash(s_data, s_data + 16);
+            b.hash(s_data, s_data + 16);
+            c.hash(s_data, s_data + 17);
+            u8 const zero = 0;
+            d.hash(s_data, s_data + 16);
+            d.hash(&zero, &zero + 1);
+            CHECK_NOT_EQUAL(a.digest(), b.digest());
+            CHECK_NOT_EQUAL(a.digest(), c.digest());
+            CHECK_NOT_EQUAL(a.digest(), d.digest());
+            CHECK_EQUAL(8, a.size());
+        }
+
+        UNITTEST_TEST(crc32c)
+        {
+            const char* check = "123456789";
+            CHECK_EQUAL((u32)0xE3069283, nhash::crc32c(check, 9));
+            CHECK_EQUAL((u32)0, nhash::crc32c(check, 0));
+
+            nhash::crc32c_hasher_t hasher;
+            hasher.hash((const u8*)check, (const u8*)check + 4);
+            hasher.hash((const u8*)check + 4, (const u8*)check + 9);
+            CHECK_EQUAL((u32)0xE3069283, hasher.digest());
+
+            // 32 bytes of zeros, a test vector from RFC 3720
+            u8 zeros[32] = {0};
+            CHECK_EQUAL((u32)0x8A9136AA, nhash::crc32c(zeros, 32));
+
+            for (s32 len = 0; len <= 100; ++len)
+            {
+                u32 const expected = nhash::crc32c(s_data, len);
+                for (s32 split = 0; split <= len; ++split)
+                    CHECK_EQUAL(expected, nhash::crc32c(s_data + split, len - split, nhash::crc32c(s_data, split)));
+            }
+        }
+
+        // The slicing-by-8 fallback, crc32c() only uses it on hosts without the crc32 instruction
+        UNITTEST_TEST(crc32c_sw)
+        {
+            const char* check = "123456789";
+            CHECK_EQUAL((u32)0xE3069283, nhash::crc32c_sw(check, 9));
+            CHECK_EQUAL((u32)0, nhash::crc32c_sw(check, 0));
+            u8 zeros[32] = {0};
+            CHECK_EQUAL((u32)0x8A9136AA, nhash::crc32c_sw(zeros, 32));
+
+            // Every alignment and tail length, continued from a previous result, same as crc32c()
+            for (s32 offset = 0; offset < 8; ++offset)
+            {
+                for (s32 len = 0; len <= 100; ++len)
+                {
+                    u32 const expected = nhash::crc32c(s_data + offset, len);
+                    CHECK_EQUAL(expected, nhash::crc32c_sw(s_data + offset, len));
+                    CHECK_EQUAL(expected, nhash::crc32c_sw(s_data + offset + len / 3, len - len / 3, nhash::crc32c_sw(s_data + offset, len / 3)));
+                }
+            }
+            CHECK_EQUAL(nhash::crc32c(s_data, c_data_size), nhash::crc32c_sw(s_data, c_data_size));
+        }
+
+        UNITTEST_TEST(hash_many)
+        {
+            const s32 c_count = 23;
+            cbuffer_t buffers[c_count];
+            for (s32 i = 0; i < c_count; ++i)
+            {
+                // A mix of short and long buffers at different offsets
+                s32 const len = (i * 37) % 250;
+                buffers[i]    = cbuffer_t(s_data + (i % 11), s_data + (i % 11) + len);
+            }
+
+            u64 hashes[c_count];
+            u32 crcs[c_count];
+            nhash::hash_many(buffers, c_count, hashes, 5);
+            nhash::crc32c_many(buffers, c_count, crcs);
+            for (s32 i = 0; i < c_count; ++i)
+            {
+                CHECK_EQUAL(nhash::wyhash_bytes(buffers[i].m_begin, (s32)buffers[i].size(), 5, nhash::g_wysecret), hashes[i]);
+                CHECK_EQUAL(nhash::crc32c(buffers[i].m_begin, buffers[i].size()), crcs[i]);
+            }
+        }
+
+        static void s_print_speed(const char* name, u64 bytes, u64 us, u64 hash)
+        {
+            console->write(name);
+            console->write(" ");
+            console->write((f64)bytes / (us > 0 ? (f64)us : 1.0));
+            console->write(" MB/s (");
+            console->write((s64)(hash & 0xFF));
+            console->writeLine(")");
+        }
+
+        template <typename H>
+        static void s_bench_hasher(H & hasher, const char* name, const u8* data, s32 size, s32 rounds)
+        {
+            u64  h  = 0;
+            auto t0 = ntest::now();
+            for (s32 r = 0; r < rounds; ++r)
+            {
+                hasher.begin();
+                hasher.hash(data, data + size);
+                h += hasher.digest();
+            }
+            s_print_speed(name, (u64)size * rounds, ntest::elapsed_us(t0), h);
+        }
+
+        UNITTEST_TEST(benchmark)
+        {
+#ifdef TARGET_DEBUG
+            const s32 c_rounds = 20;
+#else
+            const s32 c_rounds = 500;
+#endif
+            const s32 c_size = 1024 * 1024;
+            u8*       data   = (u8*)Allocator->allocate(c_size, 64);
+            for (s32 i = 0; i < c_size; ++i)
+                data[i] = s_data[i % c_data_size] ^ (u8)(i >> 8);
+
+            nhash::wyhasher_t    wy;
+            nhash::xxh3_hasher_t xx;
+            nhash::crc32c_hasher_t crc;
+            s_bench_hasher(wy, "wyhasher_t:", data, c_size, c_rounds);
+            s_bench_hasher(xx, "xxh3_hasher_t:", data, c_size, c_rounds);
+            s_bench_hasher(crc, "crc32c_hasher_t:", data, c_size, c_rounds);
+
+            // Many small buffers (100 to 300 bytes), one at a time versus hash_many / crc32c_many
+            const s32  c_count   = 4096;
+            const s32  c_len     = 200;  // on average
+            cbuffer_t* buffers   = (cbuffer_t*)Allocator->allocate(sizeof(cbuffer_t) * c_count, 8);
+            u64*       hashes    = (u64*)Allocator->allocate(sizeof(u64) * c_count, 8);
+            u32*       crcs      = (u32*)Allocator->allocate(sizeof(u32) * c_count, 8);
+            for (s32 i = 0; i < c_count; ++i)
+                buffers[i] = cbuffer_t(data + i * c_len, data + i * c_len + 100 + (i * 37) % 200);
+
+            u64  h  = 0;
+            auto t0 = ntest::now();
+            for (s32 r = 0; r < c_rounds; ++r)
+                for (s32 i = 0; i < c_count; ++i)
+                    h += nhash::wyhash_bytes(buffers[i].m_begin, (s32)buffers[i].size(), 0, nhash::g_wysecret);
+            s_print_speed("wyhash_bytes, small buffers:", (u64)c_count * c_len * c_rounds, ntest::elapsed_us(t0), h);
+
+            t0 = ntest::now();
+            for (s32 r = 0; r < c_rounds; ++r)
+            {
+                nhash::hash_many(buffers, c_count, hashes);
+                h += hashes[r];
+            }
+            s_print_speed("hash_many, small buffers:", (u64)c_count * c_len * c_rounds, ntest::elapsed_us(t0), h);
+
+            t0 = ntest::now();
+            for (s32 r = 0; r < c_rounds; ++r)
+                for (s32 i = 0; i < c_count; ++i)
+                    h += nhash::crc32c(buffers[i].m_begin, buffers[i].size());
+            s_print_speed("crc32c, small buffers:", (u64)c_count * c_len * c_rounds, ntest::elapsed_us(t0), h);
+
+            t0 = ntest::now();
+            for (s32 r = 0; r < c_rounds; ++r)
+            {
+                nhash::crc32c_many(buffers, c_count, crcs);
+                h += crcs[r];
+            }
+            s_print_speed("crc32c_many, small buffers:", (u64)c_count * c_len * c_rounds, ntest::elapsed_us(t0), h);
+
+            Allocator->deallocate(crcs);
+            Allocator->deallocate(hashes);
+            Allocator->deallocate(buffers);
+            Allocator->deallocate(data);
+        }
+    }
+
+    UNITTEST_FIXTURE(strhash)
+    {
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        // The same text in every encoding, 'runes' are code points
+        struct text_t
+        {
+            s32          m_ascii_len;  // 0 when the text is not Latin-1
+            ascii::rune  m_ascii[1024];
+            s32          m_ucs2_len;  // 0 when the text is not in the BMP
+            ucs2::rune   m_ucs2[1024];
+            s32          m_utf8_len;
+            utf8::rune   m_utf8[2048];
+            s32          m_utf16_len;
+            utf16::rune  m_utf16[1024];
+            s32          m_utf32_len;
+            utf32::rune  m_utf32[1024];
+
+            void set(const u32* runes, s32 n)
+            {
+                m_ascii_len = m_ucs2_len = m_utf8_len = m_utf16_len = m_utf32_len = 0;
+                bool latin1 = true;
+                bool bmp    = true;
+                for (s32 i = 0; i < n; ++i)
+                {
+                    u32 const c = runes[i];
+                    latin1      = latin1 && c < 0x100;
+                    bmp         = bmp && c < 0x10000;
+                    m_ascii[i]  = (ascii::rune)c;
+                    m_ucs2[i]   = (ucs2::rune)c;
+                    m_utf32[m_utf32_len++] = c;
+                    if (c < 0x80)
+                        m_utf8[m_utf8_len++] = (utf8::rune)c;
+                    else if (c < 0x800)
+                    {
+                        m_utf8[m_utf8_len++] = (utf8::rune)(0xC0 | (c >> 6));
+                        m_utf8[m_utf8_len++] = (utf8::rune)(0x80 | (c & 0x3F));
+                    }
+                    else if (c < 0x10000)
+                    {
+                        m_utf8[m_utf8_len++] = (utf8::rune)(0xE0 | (c >> 12));
+                        m_utf8[m_utf8_len++] = (utf8::rune)(0x80 | ((c >> 6) & 0x3F));
+                        m_utf8[m_utf8_len++] = (utf8::rune)(0x80 | (c & 0x3F));
+                    }
+                    else
+                    {
+                        m_utf8[m_utf8_len++] = (utf8::rune)(0xF0 | (c >> 18));
+                        m_utf8[m_utf8_len++] = (utf8::rune)(0x80 | ((c >> 12) & 0x3F));
+                        m_utf8[m_utf8_len++] = (utf8::rune)(0x80 | ((c >> 6) & 0x3F));
+                        m_utf8[m_utf8_len++] = (utf8::rune)(0x80 | (c & 0x3F));
+                    }
+                    if (c < 0x10000)
+                        m_utf16[m_utf16_len++] = (utf16::rune)c;
+                    else
+                    {
+                        m_utf16[m_utf16_len++] = (utf16::rune)(0xD800 + ((c - 0x10000) >> 10));
+                        m_utf16[m_utf16_len++] = (utf16::rune)(0xDC00 + ((c - 0x10000) & 0x3FF));
+                    }
+                }
+                m_ascii_len = latin1 ? n : 0;
+                m_ucs2_len  = bmp ? n : 0;
+            }
+
+            void check_same(u64 expected, bool lowercase)
+            {
+                u64 (*hash)(crunes_t const&, u64) = lowercase ? nhash::strhash_lowercase : nhash::strhash;
+                if (m_ascii_len > 0 || m_utf32_len == 0)
+                    CHECK_EQUAL(expected, hash(ascii::make_crunes(m_ascii, m_ascii + m_ascii_len), 3));
+                if (m_ucs2_len > 0 || m_utf32_len == 0)
+                    CHECK_EQUAL(expected, hash(ucs2::make_crunes(m_ucs2, m_ucs2 + m_ucs2_len), 3));
+                CHECK_EQUAL(expected, hash(utf8::make_crunes(m_utf8, m_utf8 + m_utf8_len), 3));
+                CHECK_EQUAL(expected, hash(utf16::make_crunes(m_utf16, m_utf16 + m_utf16_len), 3));
+                CHECK_EQUAL(expected, hash(utf32::make_crunes(m_utf32, m_utf32 + m_utf32_len), 3));
+            }
+        };
+
+        static text_t s_text, s_lower;
+
+        static u64 s_utf32_hash(text_t & text, bool lowercase)
+        {
+            crunes_t const str = utf32::make_crunes(text.m_utf32, text.m_utf32 + text.m_utf32_len);
+            return lowercase ? nhash::strhash_lowercase(str, 3) : nhash::strhash(str, 3);
+        }
+
+        UNITTEST_TEST(same_hash_in_every_encoding)
+        {
+            // ASCII, Latin-1, 3 byte UTF-8 and a surrogate pair in UTF-16
+            const u32 texts[][12] = {
+                {'H', 'e', 'l', 'l', 'o', ',', ' ', 'W', 'o', 'r', 'l', 'd'},
+                {'G', 'r', 0xFC, 0xDF, 'e', ' ', 'A', 'B', 'C', 'D', 'E', 'F'},
+                {0x65E5, 0x672C, ' ', 'N', 'i', 'h', 'o', 'n', 0x20AC, 0x1F600, '!', 'x'},
+            };
+            for (s32 t = 0; t < 3; ++t)
+            {
+                for (s32 n = 0; n <= 12; ++n)
+                {
+                    s_text.set(texts[t], n);
+                    s_text.check_same(s_utf32_hash(s_text, false), false);
+                    s_text.check_same(s_utf32_hash(s_text, true), true);
+                }
+            }
+
+            // UCS-2 has no surrogate pairs, the two halves are hashed as two (invalid) code points
+            s_text.set(texts[2], 12);
+            CHECK_EQUAL(0, s_text.m_ucs2_len);
+            crunes_t const pair = ucs2::make_crunes((ucs2::pcrune)s_text.m_utf16, (ucs2::pcrune)s_text.m_utf16 + s_text.m_utf16_len);
+            CHECK_NOT_EQUAL(s_utf32_hash(s_text, false), nhash::strhash(pair, 3));
+
+            // The UTF-8 form is what is hashed
+            u64 const bytes = nhash::wyhash_bytes(s_text.m_utf8, s_text.m_utf8_len, 3, nhash::g_wysecret);
+            CHECK_EQUAL(bytes, s_utf32_hash(s_text, false));
+        }
+
+        UNITTEST_TEST(long_mixed_text)
+        {
+            // Longer than the chunk, ASCII runs mixed with other runes at every alignment, once with
+            // only Latin-1 (so the ascii encoding is included) and once with wider runes
+            u32 runes[1000], lower[1000];
+            for (s32 k = 0; k < 2 * 11; ++k)
+            {
+                s32 const n = 990 + (k % 11);
+                if ((k % 11) == 0)
+                {
+                    for (s32 i = 0; i < 1000; ++i)
+                    {
+                        u32 c = 'A' + (u32)(i * 7) % 58;  // A-Z, [\]^_` and a-z
+                        if ((i % 37) == 36)
+                            c = 0xC0 + (u32)(i % 31);
+                        else if (k > 0 && (i % 101) == 100)
+                            c = 0x4E00 + (u32)i;
+                        else if (k > 0 && (i % 211) == 210)
+                            c = 0x1F300 + (u32)i;
+                        runes[i] = c;
+                        lower[i] = (c >= 'A' && c <= 'Z') ? c + 32 : c;
+                    }
+                }
+                s_text.set(runes, n);
+                s_lower.set(lower, n);
+                u64 const h  = s_utf32_hash(s_text, false);
+                u64 const hl = s_utf32_hash(s_lower, false);
+                s_text.check_same(h, false);
+                s_lower.check_same(hl, false);
+                CHECK_NOT_EQUAL(h, hl);
+                s_text.check_same(hl, true);
+                s_lower.check_same(hl, true);
+                CHECK_EQUAL(k < 11, s_text.m_ascii_len > 0);
+                CHECK_EQUAL(k < 11, s_text.m_ucs2_len > 0);
+            }
+        }
+
+        UNITTEST_TEST(substring_and_32_bit)
+        {
+            const char* str = "prefix/Some/Path/File.txt";
+            crunes_t    sub = ascii::make_crunes(str, 7, 16, 25);  // "Some/Path"
+            crunes_t    all = ascii::make_crunes(str, str + 25);
+            crunes_t    exp = ascii::make_crunes(str + 7, str + 16);
+            CHECK_EQUAL(nhash::strhash(exp), nhash::strhash(sub));
+            CHECK_NOT_EQUAL(nhash::strhash(all), nhash::strhash(sub));
+            CHECK_NOT_EQUAL(nhash::strhash(exp, 1), nhash::strhash(exp, 2));
+
+            const char* lower = "some/path";
+            crunes_t    low   = ascii::make_crunes(lower, lower + 9);
+            CHECK_EQUAL(nhash::strhash_lowercase(sub), nhash::strhash(low));
+            CHECK_EQUAL(nhash::strhash32_lowercase(sub, 5), nhash::strhash32(low, 5));
+            CHECK_NOT_EQUAL(nhash::strhash32(sub, 5), nhash::strhash32(low, 5));
+        }
+    }
 }
 UNITTEST_SUITE_END
@@ -1,8 +1,12 @@
 #include "cbase/c_allocator.h"
 #include "cbase/c_map32.h"
 
+#include "cbase/c_console.h"
+
 #include "cunittest/cunittest.h"
 
+#include <chrono>
+
 using namespace ncore;
 
 UNITTEST_SUITE_BEGIN(map32_and_set32)
@@ -43,6 +47,157 @@ UNITTEST_SUITE_BEGIN(map32_and_set32)
                 CHECK_TRUE(map.remove(k));
             }
         }
+        UNITTEST_TEST(map32_s32_build_from_sorted)
+        {
+            const u32 c_num_keys = 1000;
+            s32       keys[c_num_keys];
+            s32       values[c_num_keys];
+            for (u32 i = 0; i < c_num_keys; ++i)
+            {
+                keys[i]   = (s32)i * 2;
+                values[i] = (s32)i;
+            }
+
+            map32_t<s32, s32> map(Allocator, 4096);
+            CHECK_TRUE(map.build_from_sorted(keys, values, c_num_keys));
+            CHECK_FALSE(map.build_from_sorted(keys, values, c_num_keys));
+
+            for (u32 i = 0; i < c_num_keys; ++i)
+            {
+                s32 f = -1;
+                CHECK_TRUE(map.find(keys[i], f));
+                CHECK_EQUAL(values[i], f);
+                CHECK_FALSE(map.find(keys[i] + 1, f));
+            }
+
+            // New nodes are taken from the slots after the bulk built ones
+            for (u32 i = 0; i < c_num_keys; ++i)
+                CHECK_TRUE(map.insert(keys[i] + 1, -(s32)i));
+            for (u32 i = 0; i < c_num_keys; ++i)
+            {
+                s32 f = 0;
+                CHECK_TRUE(map.find(keys[i], f));
+                CHECK_EQUAL(values[i], f);
+                CHECK_TRUE(map.remove(keys[i]));
+                CHECK_TRUE(map.find(keys[i] + 1, f));
+                CHECK_EQUAL(-(s32)i, f);
+                CHECK_TRUE(map.remove(keys[i] + 1));
+            }
+        }
+        UNITTEST_TEST(map32_s32_range)
+        {
+            map32_t<s32, s32> map(Allocator, 1024);
+            for (s32 v = 0; v < 100; ++v)
+                CHECK_TRUE(map.insert(v * 4, v));
+
+            s32 k, v;
+            CHECK_TRUE(map.lower_bound(7, k, v));
+            CHECK_EQUAL(8, k);
+            CHECK_EQUAL(2, v);
+            CHECK_TRUE(map.upper_bound(8, k, v));
+            CHECK_EQUAL(12, k);
+            CHECK_TRUE(map.floor(7, k, v));
+            CHECK_EQUAL(4, k);
+            CHECK_TRUE(map.ceil(8, k, v));
+            CHECK_EQUAL(8, k);
+            CHECK_FALSE(map.floor(-1, k, v));
+            CHECK_FALSE(map.lower_bound(397, k, v));
+
+            map32_t<s32, s32>::iterator_t iter = map.range(21, 61);
+            k                                  = 24;
+            while (iter.order())
+            {
+                CHECK_EQUAL(k, iter.key());
+                CHECK_EQUAL(k / 4, iter.value());
+                k += 4;
+            }
+            CHECK_EQUAL(64, k);
+
+            iter  = map.iterate();
+            s32 n = 0;
+            while (iter.order())
+                CHECK_EQUAL(4 * n++, iter.key());
+            CHECK_EQUAL(100, n);
+        }
+        UNITTEST_TEST(map32_s32_grow)
+        {
+            // Starts with room for 16 items and grows in place
+            map32_t<s32, s32> map(Allocator, 16, 200000);
+            CHECK_EQUAL(16, map.capacity());
+            CHECK_EQUAL(200000, map.reserved());
+
+            const s32 c_num_keys = 100000;
+            for (s32 i = 0; i < c_num_keys; ++i)
+                CHECK_TRUE(map.insert(i * 3, i));
+            CHECK_EQUAL(c_num_keys, map.size());
+            CHECK_TRUE(map.capacity() >= (u32)c_num_keys);
+
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                s32 f = -1;
+                CHECK_TRUE(map.find(i * 3, f));
+                CHECK_EQUAL(i, f);
+            }
+
+            // Remove most items and give the memory back
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                if ((i % 10) != 0)
+                    CHECK_TRUE(map.remove(i * 3));
+            }
+            CHECK_EQUAL(c_num_keys / 10, map.size());
+            CHECK_TRUE(map.shrink_to_fit());
+            CHECK_EQUAL(c_num_keys / 10, map.capacity());
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                s32 f = -1;
+                CHECK_EQUAL((i % 10) == 0, map.find(i * 3, f));
+                if ((i % 10) == 0)
+                    CHECK_EQUAL(i, f);
+            }
+
+            // And the map grows again after shrinking
+            CHECK_TRUE(map.insert(1, 1));
+            CHECK_TRUE(map.reserve(150000));
+            CHECK_TRUE(map.capacity() >= 150000);
+            CHECK_FALSE(map.reserve(300000));
+        }
+
+        UNITTEST_TEST(map32_s32_full)
+        {
+            map32_t<s32, s32> map(Allocator, 8, 100);
+            for (s32 i = 0; i < 100; ++i)
+                CHECK_TRUE(map.insert(i, i));
+            CHECK_FALSE(map.insert(100, 100));
+            CHECK_TRUE(map.remove(50));
+            CHECK_TRUE(map.insert(100, 100));
+        }
+
+        UNITTEST_TEST(map32_s32_default_reservation)
+        {
+            // The reservation follows the capacity, a small map does not reserve a large range
+            map32_t<s32, s32> small(Allocator, 4);
+            CHECK_TRUE(small.valid());
+            CHECK_EQUAL(nmap32::c_min_default_reserve, small.reserved());
+            map32_t<s32, s32> large(Allocator, 100000);
+            CHECK_EQUAL(100000 * nmap32::c_reserve_factor, large.reserved());
+        }
+
+        UNITTEST_TEST(map32_s32_setup_failure)
+        {
+            // A capacity above the reservation cannot be set up, the map is empty and stays empty
+            map32_t<s32, s32> map(Allocator, 200, 100);
+            CHECK_FALSE(map.valid());
+            CHECK_FALSE(map.insert(1, 1));
+            CHECK_FALSE(map.remove(1));
+            CHECK_FALSE(map.reserve(10));
+            s32 k, v;
+            CHECK_FALSE(map.find(1, v));
+            CHECK_FALSE(map.lower_bound(1, k, v));
+            map32_t<s32, s32>::iterator_t iter = map.range(0, 10);
+            CHECK_FALSE(iter.order());
+            CHECK_EQUAL(0, map.size());
+        }
     }
 
     UNITTEST_FIXTURE(set)
@@ -77,6 +232,172 @@ UNITTEST_SUITE_BEGIN(map32_and_set32)
                 CHECK_TRUE(set.remove(k));
             }
         }
+
+        UNITTEST_TEST(set32_s32_grow)
+        {
+            set32_t<s32> set(Allocator, 4);
+
+            const s32 c_num_keys = 50000;
+            for (s32 i = 0; i < c_num_keys; ++i)
+                CHECK_TRUE(set.insert(c_num_keys - i));
+            CHECK_EQUAL(c_num_keys, set.size());
+            for (s32 i = 1; i <= c_num_keys; ++i)
+                CHECK_TRUE(set.contains(i));
+
+            for (s32 i = 1; i <= c_num_keys; i += 2)
+                CHECK_TRUE(set.remove(i));
+            CHECK_TRUE(set.shrink_to_fit());
+            CHECK_EQUAL(c_num_keys / 2, set.capacity());
+            for (s32 i = 1; i <= c_num_keys; ++i)
+                CHECK_EQUAL((i & 1) == 0, set.contains(i));
+        }
+
+        UNITTEST_TEST(map32_s32_rank_select)
+        {
+            map32_t<s32, s32> map(Allocator, 16, 0, true);
+
+            // Keys 0, 2, 4, ... inserted in a scrambled order
+            const s32 c_num_keys = 5000;
+            for (s32 i = 0; i < c_num_keys; ++i)
+                CHECK_TRUE(map.insert(((i * 7919) % c_num_keys) * 2, i));
+            CHECK_FALSE(map.remove(1));
+
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                CHECK_EQUAL((u32)i, map.rank(i * 2));
+                CHECK_EQUAL((u32)(i + 1), map.rank(i * 2 + 1));
+
+                s32 k = -1, v = -1;
+                CHECK_TRUE(map.select((u32)i, k, v));
+                CHECK_EQUAL(i * 2, k);
+            }
+            s32 k, v;
+            CHECK_FALSE(map.select((u32)c_num_keys, k, v));
+
+            // Remove the lower half, ranks shift down
+            for (s32 i = 0; i < c_num_keys / 2; ++i)
+                CHECK_TRUE(map.remove(i * 2));
+            CHECK_EQUAL(0, map.rank(c_num_keys));
+            CHECK_TRUE(map.select(0, k, v));
+            CHECK_EQUAL(c_num_keys, k);
+            CHECK_EQUAL((u32)(c_num_keys / 2), map.rank(c_num_keys * 2));
+
+            // The sizes survive shrinking (rebuilt with build_from_sorted)
+            CHECK_TRUE(map.shrink_to_fit());
+            for (s32 i = 0; i < c_num_keys / 2; ++i)
+            {
+                CHECK_TRUE(map.select((u32)i, k, v));
+                CHECK_EQUAL(c_num_keys + i * 2, k);
+                CHECK_EQUAL((u32)i, map.rank(k));
+            }
+        }
+
+        UNITTEST_TEST(set32_s32_rank_select)
+        {
+            set32_t<s32> set(Allocator, 4, 0, true);
+            for (s32 i = 100; i > 0; --i)
+                CHECK_TRUE(set.insert(i * 10));
+
+            CHECK_EQUAL(0, set.rank(5));
+            CHECK_EQUAL(0, set.rank(10));
+            CHECK_EQUAL(50, set.rank(505));
+            CHECK_EQUAL(100, set.rank(5000));
+
+            s32 key = 0;
+            CHECK_TRUE(set.select(49, key));
+            CHECK_EQUAL(500, key);
+            CHECK_FALSE(set.select(100, key));
+        }
+
+        UNITTEST_TEST(map32_s32_find_many)
+        {
+            map32_t<s32, s32> map(Allocator, 1024);
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_TRUE(map.insert(i * 3, i));
+
+            // More keys than one internal batch, a third of them are present
+            const s32 c_num_queries = 250;
+            s32       queries[c_num_queries];
+            s32       values[c_num_queries];
+            bool      found[c_num_queries];
+            for (s32 i = 0; i < c_num_queries; ++i)
+            {
+                queries[i] = (i * 7) % 900;
+                values[i]  = -1;
+            }
+
+            u32 expected = 0;
+            for (s32 i = 0; i < c_num_queries; ++i)
+                expected += (queries[i] % 3) == 0 ? 1 : 0;
+            CHECK_EQUAL(expected, map.find_many(queries, c_num_queries, values, found));
+            for (s32 i = 0; i < c_num_queries; ++i)
+            {
+                CHECK_EQUAL((queries[i] % 3) == 0, found[i]);
+                CHECK_EQUAL(found[i] ? queries[i] / 3 : -1, values[i]);
+            }
+
+            set32_t<s32> set(Allocator, 1024);
+            for (s32 i = 0; i < 1000; ++i)
+                CHECK_TRUE(set.insert(i * 3));
+            CHECK_EQUAL(expected, set.contains_many(queries, c_num_queries, found));
+            for (s32 i = 0; i < c_num_queries; ++i)
+                CHECK_EQUAL((queries[i] % 3) == 0, found[i]);
+            CHECK_EQUAL(expected, set.contains_many(queries, c_num_queries));
+        }
+
+        static u64 s_elapsed_us(std::chrono::high_resolution_clock::time_point t0)
+        {
+            return (u64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t0).count();
+        }
+
+        UNITTEST_TEST(map32_s32_find_many_benchmark)
+        {
+#ifdef TARGET_DEBUG
+            const s32 c_num_keys = 100000;
+#else
+            const s32 c_num_keys = 4000000;
+#endif
+            map32_t<s32, s32>* map = g_construct<map32_t<s32, s32>>(Allocator, Allocator, (u32)c_num_keys);
+
+            // Insert and query in a scrambled order, so that the searches miss the cache
+            s32* keys   = g_allocate_array<s32>(Allocator, c_num_keys);
+            s32* values = g_allocate_array<s32>(Allocator, c_num_keys);
+            for (s32 i = 0; i < c_num_keys; ++i)
+                keys[i] = (s32)(((u32)i * 2654435761u) % (u32)c_num_keys);
+            for (s32 i = 0; i < c_num_keys; ++i)
+                map->insert(keys[i], i);
+
+            auto t0  = std::chrono::high_resolution_clock::now();
+            u32  sum = 0;
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                s32 v = 0;
+                map->find(keys[c_num_keys - 1 - i], v);
+                sum += (u32)v;
+            }
+            u64 const find_us = s_elapsed_us(t0);
+
+            t0 = std::chrono::high_resolution_clock::now();
+            CHECK_EQUAL((u32)c_num_keys, map->find_many(keys, (u32)c_num_keys, values));
+            u64 const find_many_us = s_elapsed_us(t0);
+
+            u32 sum_many = 0;
+            for (s32 i = 0; i < c_num_keys; ++i)
+                sum_many += (u32)values[i];
+            CHECK_EQUAL(sum, sum_many);
+
+            console->write("map32_t keys: ");
+            console->write((s64)c_num_keys);
+            console->write(", find: ");
+            console->write((s64)find_us);
+            console->write(" us, find_many: ");
+            console->write((s64)find_many_us);
+            console->writeLine(" us");
+
+            g_deallocate_array(Allocator, values);
+            g_deallocate_array(Allocator, keys);
+            g_destruct(Allocator, map);
+        }
     }
 }
 UNITTEST_SUITE_END
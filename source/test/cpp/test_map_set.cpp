@@ -2,10 +2,40 @@
 #include "cbase/c_slice.h"
 #include "cbase/c_map.h"
 
+#include "cbase/c_console.h"
+
 #include "cunittest/cunittest.h"
 
+#include <chrono>
+
 using namespace ncore;
 
+namespace ncore
+{
+    // Forwards to another allocator until 'budget' allocations have been made, then fails
+    class budget_alloc_t : public alloc_t
+    {
+        alloc_t* m_allocator;
+        s32      m_budget;
+
+    public:
+        budget_alloc_t(alloc_t* allocator, s32 budget)
+            : m_allocator(allocator)
+            , m_budget(budget)
+        {
+        }
+
+        virtual void* v_allocate(u32 size, u32 alignment)
+        {
+            if (m_budget == 0)
+                return nullptr;
+            m_budget -= 1;
+            return m_allocator->allocate(size, alignment);
+        }
+        virtual void v_deallocate(void* mem) { m_allocator->deallocate(mem); }
+    };
+}  // namespace ncore
+
 UNITTEST_SUITE_BEGIN(map_and_set)
 {
     static const s32 c_num_keys = 100;
@@ -56,6 +86,74 @@ UNITTEST_SUITE_BEGIN(map_and_set)
                 CHECK_TRUE(map.remove(k));
             }
         }
+        UNITTEST_TEST(map_s32_build_from_sorted)
+        {
+            s32 keys[c_num_keys];
+            s32 values[c_num_keys];
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                keys[i]   = i * 2 + 65536;
+                values[i] = i;
+            }
+
+            map_t<s32, s32> map(Allocator);
+            CHECK_TRUE(map.build_from_sorted(keys, values, c_num_keys));
+            CHECK_EQUAL(c_num_keys, map.size());
+            CHECK_FALSE(map.build_from_sorted(keys, values, c_num_keys));
+
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                s32 f = -1;
+                CHECK_TRUE(map.find(keys[i], f));
+                CHECK_EQUAL(values[i], f);
+                CHECK_FALSE(map.find(keys[i] + 1, f));
+            }
+
+            // Insert the odd keys in between, iteration gives all keys in order
+            for (s32 i = 0; i < c_num_keys; ++i)
+                CHECK_TRUE(map.insert(keys[i] + 1, -i));
+
+            map_t<s32, s32>::iterator_t iter = map.iterate();
+            s32                         i    = 0;
+            while (iter.order())
+            {
+                CHECK_EQUAL(i + 65536, iter.item()->key);
+                i++;
+            }
+            CHECK_EQUAL(c_num_keys * 2, i);
+
+            map.clear();
+            CHECK_EQUAL(0, map.size());
+        }
+        UNITTEST_TEST(map_s32_range)
+        {
+            map_t<s32, s32> map(Allocator);
+            for (s32 v = 0; v < c_num_keys; ++v)
+                CHECK_TRUE(map.insert(v * 4, v));
+
+            CHECK_EQUAL(8, map.lower_bound(7)->key);
+            CHECK_EQUAL(8, map.lower_bound(8)->key);
+            CHECK_EQUAL(12, map.upper_bound(8)->key);
+            CHECK_EQUAL(4, map.floor(7)->key);
+            CHECK_EQUAL(8, map.floor(8)->key);
+            CHECK_EQUAL(8, map.ceil(5)->key);
+            CHECK_NULL(map.floor(-1));
+            CHECK_NULL(map.upper_bound((c_num_keys - 1) * 4));
+
+            map_t<s32, s32>::iterator_t iter = map.range(21, 61);
+            s32                         k    = 24;
+            while (iter.order())
+            {
+                CHECK_EQUAL(k, iter.item()->key);
+                CHECK_EQUAL(k / 4, iter.item()->value);
+                k += 4;
+            }
+            CHECK_EQUAL(64, k);
+            CHECK_FALSE(iter.order());
+
+            iter = map.range(1000000, 2000000);
+            CHECK_FALSE(iter.order());
+        }
     }
 
     UNITTEST_FIXTURE(set)
@@ -98,6 +196,153 @@ UNITTEST_SUITE_BEGIN(map_and_set)
                 CHECK_TRUE(set.contains(k));
                 CHECK_TRUE(set.remove(k));
             }
+            CHECK_EQUAL(0, set.size());
+        }
+
+        UNITTEST_TEST(set_s32_pooled)
+        {
+            set_t<s32> set(Allocator, 16);
+
+            for (s32 v = 0; v < c_num_keys; ++v)
+                CHECK_TRUE(set.insert(v * 3));
+            CHECK_EQUAL(c_num_keys, set.size());
+            for (s32 v = 0; v < c_num_keys; v += 2)
+                CHECK_TRUE(set.remove(v * 3));
+            for (s32 v = 0; v < c_num_keys; ++v)
+                CHECK_EQUAL((v & 1) == 1, set.contains(v * 3));
+
+            set.clear();
+            CHECK_EQUAL(0, set.size());
+            CHECK_FALSE(set.contains(3));
+            CHECK_TRUE(set.insert(3));
+        }
+    }
+
+    UNITTEST_FIXTURE(pooled)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(map_s32)
+        {
+            map_t<s32, s32> map(Allocator, 32);
+
+            for (s32 v = 0; v < c_num_keys; ++v)
+                CHECK_TRUE(map.insert(v + 65536, v));
+
+            // Removed nodes are reused
+            for (s32 v = 0; v < c_num_keys; v += 3)
+                CHECK_TRUE(map.remove(v + 65536));
+            for (s32 v = 0; v < c_num_keys; v += 3)
+                CHECK_TRUE(map.insert(v + 65536, -v));
+
+            map_t<s32, s32>::iterator_t iter = map.iterate();
+            s32                         i    = 0;
+            while (iter.order())
+            {
+                CHECK_EQUAL(i + 65536, iter.item()->key);
+                CHECK_EQUAL((i % 3) == 0 ? -i : i, iter.item()->value);
+                i++;
+            }
+            CHECK_EQUAL(c_num_keys, i);
+
+            // Clear releases all chunks, the map is usable afterwards
+            map.clear();
+            CHECK_TRUE(map.empty());
+            s32 f = 0;
+            CHECK_FALSE(map.find(65536, f));
+            CHECK_TRUE(map.insert(1, 2));
+            CHECK_TRUE(map.find(1, f));
+            CHECK_EQUAL(2, f);
+        }
+
+        UNITTEST_TEST(out_of_memory)
+        {
+            // Two chunks of 16 nodes, the 33rd node cannot be allocated
+            budget_alloc_t  budget(Allocator, 2);
+            map_t<s32, s32> map(&budget, 16);
+            s32             inserted = 0;
+            while (map.insert(inserted, inserted))
+                inserted++;
+            CHECK_EQUAL(32, inserted);
+            CHECK_EQUAL(32, map.size());
+            s32 f = 0;
+            CHECK_TRUE(map.find(31, f));
+            CHECK_FALSE(map.find(32, f));
+
+            // Removed nodes are reused without a new chunk
+            CHECK_TRUE(map.remove(5));
+            CHECK_TRUE(map.insert(100, 100));
+            CHECK_FALSE(map.insert(101, 101));
+            map.clear();
+
+            // A build that runs out of nodes leaves the set empty
+            s32 keys[c_num_keys];
+            for (s32 i = 0; i < c_num_keys; ++i)
+                keys[i] = i;
+            budget_alloc_t none(Allocator, 0);
+            set_t<s32>     set(&none, 16);
+            CHECK_FALSE(set.insert(1));
+            CHECK_FALSE(set.build_from_sorted(keys, c_num_keys));
+            CHECK_EQUAL(0, set.size());
+
+            budget_alloc_t some(Allocator, 3);
+            set_t<s32>     partial(&some, 16);
+            CHECK_FALSE(partial.build_from_sorted(keys, c_num_keys));
+            CHECK_EQUAL(0, partial.size());
+            CHECK_FALSE(partial.contains(0));
+        }
+
+        template <typename M>
+        static void s_bench(M& map, s32 count, u64& insert_us, u64& erase_us)
+        {
+            auto t0 = std::chrono::high_resolution_clock::now();
+            for (s32 i = 0; i < count; ++i)
+                map.insert((i * 7919) % count, i);
+            auto t1 = std::chrono::high_resolution_clock::now();
+            for (s32 i = 0; i < count; i += 2)
+                map.remove((i * 7919) % count);
+            auto t2 = std::chrono::high_resolution_clock::now();
+
+            insert_us = (u64)std::chrono::duration_cast<std::chrono::microseconds>(t1 - t0).count();
+            erase_us  = (u64)std::chrono::duration_cast<std::chrono::microseconds>(t2 - t1).count();
+        }
+
+        static void s_print(const char* name, u64 insert_us, u64 erase_us, u64 destroy_us)
+        {
+            console->write(name);
+            console->write(" insert: ");
+            console->write(insert_us);
+            console->write(" us, erase: ");
+            console->write(erase_us);
+            console->write(" us, destroy: ");
+            console->write(destroy_us);
+            console->writeLine(" us");
+        }
+
+        UNITTEST_TEST(benchmark)
+        {
+            const s32 count = 50000;
+
+            u64 insert_us, erase_us, destroy_us;
+            {
+                map_t<s32, s32>* map = g_construct<map_t<s32, s32>>(Allocator, Allocator);
+                s_bench(*map, count, insert_us, erase_us);
+                auto t0 = std::chrono::high_resolution_clock::now();
+                g_destruct(Allocator, map);
+                destroy_us = (u64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t0).count();
+                s_print("map_t (allocator):", insert_us, erase_us, destroy_us);
+            }
+            {
+                map_t<s32, s32>* map = g_construct<map_t<s32, s32>>(Allocator, Allocator, 1024);
+                s_bench(*map, count, insert_us, erase_us);
+                auto t0 = std::chrono::high_resolution_clock::now();
+                g_destruct(Allocator, map);
+                destroy_us = (u64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t0).count();
+                s_print("map_t (node pool):", insert_us, erase_us, destroy_us);
+            }
         }
     }
 }
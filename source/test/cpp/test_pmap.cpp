@@ -0,0 +1,248 @@
+#include "cbase/c_allocator.h"
+#include "ccore/c_random.h"
+#include "cbase/c_pmap.h"
+
+#include "cunittest/cunittest.h"
+
+#include <atomic>
+#include <thread>
+
+using namespace ncore;
+
+UNITTEST_SUITE_BEGIN(pmap)
+{
+    UNITTEST_FIXTURE(main)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        typedef pmap_t<s32, s32> map_t;
+
+
+        // Returns the height of the subtree, 'ok' becomes false when the AVL or search tree property is broken
+        static s32 s_validate(map_t::node_t const* node, s32 lo, s32 hi, bool& ok)
+        {
+            if (node == nullptr)
+                return 0;
+            if (node->m_key < lo || node->m_key > hi || node->m_refs == 0)
+                ok = false;
+            s32 const hl = s_validate(node->m_child[0], lo, node->m_key - 1, ok);
+            s32 const hr = s_validate(node->m_child[1], node->m_key + 1, hi, ok);
+            if ((hl - hr) > 1 || (hr - hl) > 1)
+                ok = false;
+            s32 const h = 1 + (hl > hr ? hl : hr);
+            if (h != node->m_height)
+                ok = false;
+            return h;
+        }
+
+        UNITTEST_TEST(insert_find_remove)
+        {
+            map_t map(Allocator, 4, 4096);
+
+            map_t::snapshot_t empty = map.pin(0);
+            CHECK_TRUE(empty.empty());
+            map.unpin(0);
+
+            for (s32 i = 0; i < 500; ++i)
+                CHECK_TRUE(map.insert((i * 7) % 500, i));
+            CHECK_FALSE(map.insert(0, 1));
+            CHECK_EQUAL(500, map.size());
+
+            for (s32 i = 0; i < 500; ++i)
+            {
+                s32 value = -1;
+                CHECK_TRUE(map.find((i * 7) % 500, value));
+                CHECK_EQUAL(i, value);
+            }
+
+            for (s32 i = 0; i < 500; i += 2)
+                CHECK_TRUE(map.remove(i));
+            CHECK_FALSE(map.remove(0));
+            CHECK_EQUAL(250, map.size());
+
+            // Nothing is pinned, every retired version has been freed
+            CHECK_EQUAL(250, map.nodes_in_use());
+
+            map_t::snapshot_t snapshot = map.pin(1);
+            bool              ok       = true;
+            s_validate(snapshot.m_root, 0, 1000, ok);
+            CHECK_TRUE(ok);
+
+            map_t::iterator_t iter = snapshot.iterate();
+            s32               k    = 1;
+            while (iter.order())
+            {
+                CHECK_EQUAL(k, iter.key());
+                k += 2;
+            }
+            CHECK_EQUAL(501, k);
+            map.unpin(1);
+
+            while (map.size() > 0)
+            {
+                map_t::snapshot_t s  = map.pin(0);
+                map_t::iterator_t it = s.iterate();
+                CHECK_TRUE(it.order());
+                s32 const key = it.key();
+                map.unpin(0);
+                CHECK_TRUE(map.remove(key));
+            }
+            CHECK_EQUAL(0, map.nodes_in_use());
+        }
+
+        UNITTEST_TEST(snapshot_isolation)
+        {
+            map_t map(Allocator, 4, 1 << 16);
+            for (s32 i = 0; i < 100; ++i)
+                CHECK_TRUE(map.insert(i, i));
+
+            // A pinned snapshot does not see later writes and its nodes stay alive
+            map_t::snapshot_t old = map.pin(2);
+            for (s32 i = 0; i < 100; i += 3)
+                CHECK_TRUE(map.remove(i));
+            for (s32 i = 100; i < 200; ++i)
+                CHECK_TRUE(map.insert(i, i));
+            CHECK_TRUE(map.nodes_in_use() > (s32)map.size());
+
+            CHECK_EQUAL(100, old.size());
+            for (s32 i = 0; i < 200; ++i)
+            {
+                s32 value = -1;
+                CHECK_EQUAL(i < 100, old.find(i, value));
+                if (i < 100)
+                    CHECK_EQUAL(i, value);
+            }
+
+            map_t::snapshot_t now = map.pin(3);
+            CHECK_EQUAL(166, now.size());
+            CHECK_FALSE(now.contains(0));
+            CHECK_TRUE(now.contains(1));
+            CHECK_TRUE(now.contains(199));
+            map.unpin(3);
+
+            // Once the old snapshot is released the shared nodes that it kept alive are freed
+            map.unpin(2);
+            map.reclaim();
+            CHECK_EQUAL(166, map.nodes_in_use());
+        }
+
+        UNITTEST_TEST(random_ops)
+        {
+            const s32 c_key_range = 2000;
+            map_t     map(Allocator, 4, 1 << 16);
+            bool*     present = g_allocate_array_and_clear<bool>(Allocator, c_key_range);
+            u32       count   = 0;
+
+            xor_random_t random;
+            random.reset(4321);
+
+            for (s32 round = 0; round < 8; ++round)
+            {
+                // Keep one snapshot pinned during the round and check that it did not change
+                map_t::snapshot_t before       = map.pin(0);
+                u32 const         before_count = before.size();
+
+                for (s32 i = 0; i < c_key_range; ++i)
+                {
+                    s32 const key = (s32)(random.rand32() % (u32)c_key_range);
+                    if ((random.rand32() & 3) != 0)
+                    {
+                        CHECK_EQUAL(!present[key], map.insert(key, key * 5));
+                        count += present[key] ? 0 : 1;
+                        present[key] = true;
+                    }
+                    else
+                    {
+                        CHECK_EQUAL(present[key], map.remove(key));
+                        count -= present[key] ? 1 : 0;
+                        present[key] = false;
+                    }
+                }
+                CHECK_EQUAL(count, map.size());
+
+                u32               n    = 0;
+                map_t::iterator_t iter = before.iterate();
+                while (iter.order())
+                    n++;
+                CHECK_EQUAL(before_count, n);
+                map.unpin(0);
+
+                map_t::snapshot_t after = map.pin(1);
+                bool              ok    = true;
+                s_validate(after.m_root, 0, c_key_range, ok);
+                CHECK_TRUE(ok);
+                for (s32 key = 0; key < c_key_range; ++key)
+                {
+                    s32 value = -1;
+                    CHECK_EQUAL(present[key], after.find(key, value));
+                    if (present[key])
+                        CHECK_EQUAL(key * 5, value);
+                }
+                map.unpin(1);
+
+                map.reclaim();
+                CHECK_EQUAL((s32)count, map.nodes_in_use());
+            }
+
+            g_deallocate_array(Allocator, present);
+        }
+
+        // Readers continuously pin snapshots and verify them while one writer keeps changing the map.
+        // Every version holds keys with value == key * 2, and exactly 'size()' of them.
+        UNITTEST_TEST(concurrent_readers)
+        {
+            const s32 c_num_readers = 4;
+            const s32 c_key_range   = 1024;
+            map_t     map(Allocator, c_num_readers, 1 << 18);
+
+            std::atomic<bool> done(false);
+            std::atomic<s32>  errors(0);
+            std::thread       readers[c_num_readers];
+            for (s32 r = 0; r < c_num_readers; ++r)
+            {
+                readers[r] = std::thread([&map, &done, &errors, r]() {
+                    while (!done.load(std::memory_order_relaxed))
+                    {
+                        map_t::snapshot_t snapshot = map.pin(r);
+                        map_t::iterator_t iter     = snapshot.iterate();
+                        u32               n        = 0;
+                        s32               prev     = -1;
+                        while (iter.order())
+                        {
+                            if (iter.key() <= prev || iter.value() != iter.key() * 2)
+                                errors.fetch_add(1);
+                            prev = iter.key();
+                            n++;
+                        }
+                        if (n != snapshot.size())
+                            errors.fetch_add(1);
+                        map.unpin(r);
+                    }
+                });
+            }
+
+            xor_random_t random;
+            random.reset(99);
+            for (s32 i = 0; i < 20000; ++i)
+            {
+                s32 const key = (s32)(random.rand32() % (u32)c_key_range);
+                if ((random.rand32() & 1) != 0)
+                    map.insert(key, key * 2);
+                else
+                    map.remove(key);
+            }
+
+            done.store(true);
+            for (s32 r = 0; r < c_num_readers; ++r)
+                readers[r].join();
+            CHECK_EQUAL(0, errors.load());
+
+            map.reclaim();
+            CHECK_EQUAL((s32)map.size(), map.nodes_in_use());
+        }
+    }
+}
+UNITTEST_SUITE_END
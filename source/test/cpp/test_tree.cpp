@@ -199,6 +199,45 @@ UNITTEST_SUITE_BEGIN(tree)
             CHECK_EQUAL(0, s_tree.size());
         }
 
+        UNITTEST_TEST(remove_missing_key)
+        {
+            item_t temp;
+            temp.set_child(0, nullptr);
+            temp.set_child(1, nullptr);
+
+            // Removing from an empty tree or removing a key that is not in the tree returns false and no node
+            ntree::node_t* removed = (ntree::node_t*)&temp;
+            CHECK_FALSE(ntree::remove(s_tree.m_root, &temp, a, compare_key_with_node, removed));
+            CHECK_NULL(removed);
+
+            for (s32 k = 0; k < all_size; k += 2)
+            {
+                ntree::node_t* inserted_node;
+                CHECK_TRUE(ntree::insert(s_tree.m_root, &temp, all[k], compare_key_with_node, s_allocate_node, &s_tree, inserted_node));
+                s_tree.set_key(inserted_node, all[k]);
+            }
+
+            for (s32 k = 1; k < all_size; k += 2)
+            {
+                removed = (ntree::node_t*)&temp;
+                CHECK_FALSE(ntree::remove(s_tree.m_root, &temp, all[k], compare_key_with_node, removed));
+                CHECK_NULL(removed);
+            }
+            CHECK_FALSE(ntree::remove(s_tree.m_root, &temp, x, compare_key_with_node, removed));
+
+            const char* result = nullptr;
+            CHECK_TRUE(ntree::validate(s_tree.m_root, result, compare_node_with_node));
+
+            for (s32 k = 0; k < all_size; k += 2)
+            {
+                CHECK_TRUE(ntree::remove(s_tree.m_root, &temp, all[k], compare_key_with_node, removed));
+                CHECK_EQUAL(all[k], s_tree.get_key(removed));
+                s_tree.deallocate_node(removed);
+            }
+            CHECK_NULL(s_tree.m_root);
+            CHECK_EQUAL(0, s_tree.size());
+        }
+
         UNITTEST_TEST(void_tree)
         {
             const char* result = nullptr;
@@ -440,5 +479,143 @@ UNITTEST_SUITE_BEGIN(tree)
             CHECK_EQUAL(0, s_tree.size());
         }
     }
+
+    UNITTEST_FIXTURE(build)
+    {
+        UNITTEST_ALLOCATOR;
+
+        struct item_t : public ntree::node_t
+        {
+            s32 key;
+            DCORE_CLASS_PLACEMENT_NEW_DELETE
+        };
+
+        struct build_t
+        {
+            alloc_t* m_allocator;
+            s32      m_next;
+        };
+
+        static ntree::node_t* s_build_node(void* user_data)
+        {
+            build_t* build = (build_t*)user_data;
+            item_t*  item  = g_construct<item_t>(build->m_allocator);
+            item->key      = build->m_next++ * 10;
+            item->set_child(ntree::LEFT, nullptr);
+            item->set_child(ntree::RIGHT, nullptr);
+            return item;
+        }
+
+        static s8 s_compare_key_with_node(void const* key, ntree::node_t const* node)
+        {
+            s32 const k = *(s32 const*)key;
+            s32 const n = ((item_t const*)node)->key;
+            return k < n ? -1 : (k > n ? 1 : 0);
+        }
+
+        static s8 s_compare_node_with_node(ntree::node_t const* a, ntree::node_t const* b)
+        {
+            s32 const ka = ((item_t const*)a)->key;
+            s32 const kb = ((item_t const*)b)->key;
+            return ka < kb ? -1 : (ka > kb ? 1 : 0);
+        }
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(bounds_and_range)
+        {
+            // keys are 0, 10, 20, ...
+            const s32      count = 100;
+            build_t        build = {Allocator, 0};
+            ntree::node_t* root  = ntree::build_from_sorted(count, s_build_node, &build);
+
+            ntree::node_t* found;
+            for (s32 k = -5; k < count * 10 + 5; ++k)
+            {
+                s32 const ge = k <= 0 ? 0 : ((k + 9) / 10) * 10;
+                s32 const gt = k < 0 ? 0 : (k / 10 + 1) * 10;
+                s32 const le = k < 0 ? -1 : (k / 10) * 10;
+
+                CHECK_EQUAL(ge < count * 10, ntree::lower_bound(root, &k, s_compare_key_with_node, found));
+                if (found != nullptr)
+                    CHECK_EQUAL(ge, ((item_t*)found)->key);
+                CHECK_EQUAL(ge < count * 10, ntree::ceil(root, &k, s_compare_key_with_node, found));
+                CHECK_EQUAL(gt < count * 10, ntree::upper_bound(root, &k, s_compare_key_with_node, found));
+                if (found != nullptr)
+                    CHECK_EQUAL(gt, ((item_t*)found)->key);
+                CHECK_EQUAL(le >= 0, ntree::floor(root, &k, s_compare_key_with_node, found));
+                if (found != nullptr)
+                    CHECK_EQUAL(le < count * 10 ? le : (count - 1) * 10, ((item_t*)found)->key);
+            }
+
+            // Walk [250, 420] ascending and (420, 250] descending
+            s32                  from = 250, to = 420;
+            ntree::iterator_t    iter;
+            ntree::node_t const* node;
+            iter.seek(root, &from, s_compare_key_with_node, ntree::LEFT);
+            s32 expect = from;
+            while (iter.sortorder(root, ntree::LEFT, node) && ((item_t const*)node)->key <= to)
+            {
+                CHECK_EQUAL(expect, ((item_t const*)node)->key);
+                expect += 10;
+            }
+            CHECK_EQUAL(to + 10, expect);
+
+            ntree::iterator_t riter;
+            riter.seek(root, &to, s_compare_key_with_node, ntree::RIGHT, false);
+            expect = to - 10;
+            while (riter.sortorder(root, ntree::RIGHT, node) && ((item_t const*)node)->key >= from)
+            {
+                CHECK_EQUAL(expect, ((item_t const*)node)->key);
+                expect -= 10;
+            }
+            CHECK_EQUAL(from - 10, expect);
+
+            ntree::node_t* n;
+            while (!ntree::clear(root, n))
+                g_destruct(Allocator, (item_t*)n);
+        }
+
+        UNITTEST_TEST(build_from_sorted)
+        {
+            for (s32 count = 0; count < 300; count += (count < 40 ? 1 : 17))
+            {
+                build_t        build = {Allocator, 0};
+                ntree::node_t* root  = ntree::build_from_sorted(count, s_build_node, &build);
+                CHECK_EQUAL(count, build.m_next);
+
+                const char* result = nullptr;
+                CHECK_TRUE(ntree::validate(root, result, s_compare_node_with_node));
+                CHECK_NULL(result);
+
+                ntree::iterator_t    iter;
+                ntree::node_t const* node = nullptr;
+                s32                  i    = 0;
+                while (iter.sortorder(root, ntree::LEFT, node))
+                {
+                    CHECK_EQUAL(i * 10, ((item_t const*)node)->key);
+                    i++;
+                }
+                CHECK_EQUAL(count, i);
+
+                // Insert a key in between every pair, the tree stays valid
+                item_t temp;
+                for (s32 k = 0; k < count; ++k)
+                {
+                    s32            key = k * 10 + 5;
+                    ntree::node_t* inserted;
+                    build.m_next = 0;
+                    CHECK_TRUE(ntree::insert(root, &temp, &key, s_compare_key_with_node, s_build_node, &build, inserted));
+                    ((item_t*)inserted)->key = key;
+                }
+                CHECK_TRUE(ntree::validate(root, result, s_compare_node_with_node));
+
+                ntree::node_t* n;
+                while (!ntree::clear(root, n))
+                    g_destruct(Allocator, (item_t*)n);
+            }
+        }
+    }
 }
 UNITTEST_SUITE_END
@@ -980,6 +980,100 @@ UNITTEST_SUITE_BEGIN(tree32)
             ntree32::teardown_tree(tree);
         }
 
+        UNITTEST_TEST(bounds_and_seek)
+        {
+            ntree32::tree_t tree;
+            ntree32::setup_tree(tree, m_nodes);
+            s_init_keys();
+
+            // keys are 33, 66, 99, ...
+            for (u32 i = 0; i < (u32)c_num_keys; ++i)
+                s_keys[i] = s_find[i];
+            tree.m_free_index    = c_num_keys;
+            ntree32::node_t root = ntree32::build_from_sorted(tree, 0, c_num_keys);
+
+            ntree32::node_t found;
+            for (s32 k = 0; k < 33 * (c_num_keys + 2); ++k)
+            {
+                s32 const first_ge = k == 0 ? 0 : (k + 32) / 33 - 1;                      // index of the first key >= k
+                s32 const first_gt = k / 33;                                                // index of the first key > k
+                s32 const last_le  = k / 33 - 1 < c_num_keys ? k / 33 - 1 : c_num_keys - 1;  // index of the last key <= k
+
+                s_keys[c_find_slot] = k;
+                CHECK_EQUAL(first_ge < c_num_keys, ntree32::lower_bound(tree, root, c_find_slot, s_compare_key_and_node, &s_keys, found));
+                if (first_ge < c_num_keys)
+                    CHECK_EQUAL((ntree32::node_t)first_ge, found);
+                CHECK_EQUAL(first_ge < c_num_keys, ntree32::ceil(tree, root, c_find_slot, s_compare_key_and_node, &s_keys, found));
+                CHECK_EQUAL(first_gt < c_num_keys, ntree32::upper_bound(tree, root, c_find_slot, s_compare_key_and_node, &s_keys, found));
+                if (first_gt < c_num_keys)
+                    CHECK_EQUAL((ntree32::node_t)first_gt, found);
+                CHECK_EQUAL(last_le >= 0, ntree32::floor(tree, root, c_find_slot, s_compare_key_and_node, &s_keys, found));
+                if (last_le >= 0)
+                    CHECK_EQUAL((ntree32::node_t)last_le, found);
+
+                // Ascending from the lower bound
+                ntree32::iterator_t iter = ntree32::iterate(tree, root);
+                iter.seek(tree, c_find_slot, s_compare_key_and_node, &s_keys, ntree32::LEFT);
+                ntree32::node_t node;
+                s32             expect = first_ge;
+                while (iter.sortorder(tree, ntree32::LEFT, node))
+                    CHECK_EQUAL((ntree32::node_t)expect++, node);
+                CHECK_EQUAL(first_ge < c_num_keys ? c_num_keys : first_ge, expect);
+
+                // Descending from the last key < k
+                iter = ntree32::iterate(tree, root);
+                iter.seek(tree, c_find_slot, s_compare_key_and_node, &s_keys, ntree32::RIGHT, false);
+                expect = first_ge - 1;
+                if (expect >= c_num_keys)
+                    expect = c_num_keys - 1;
+                while (iter.sortorder(tree, ntree32::RIGHT, node))
+                    CHECK_EQUAL((ntree32::node_t)expect--, node);
+                CHECK_EQUAL(-1, expect);
+            }
+
+            ntree32::teardown_tree(tree);
+        }
+
+        UNITTEST_TEST(build_from_sorted)
+        {
+            for (u32 count = 0; count <= (u32)c_num_keys; ++count)
+            {
+                ntree32::tree_t tree;
+                ntree32::setup_tree(tree, m_nodes);
+                s_init_keys();
+
+                for (u32 i = 0; i < count; ++i)
+                    s_keys[i] = s_find[i];
+                tree.m_free_index    = count;
+                ntree32::node_t root = ntree32::build_from_sorted(tree, 0, count);
+
+                const char *result = nullptr;
+                CHECK_TRUE(ntree32::validate(tree, root, result, s_compare_key_and_node, &s_keys));
+                CHECK_NULL(result);
+
+                for (u32 i = 0; i < count; ++i)
+                {
+                    ntree32::node_t node = ntree32::c_invalid_node;
+                    s_keys[c_find_slot]  = s_find[i];
+                    CHECK_TRUE(ntree32::find(tree, root, c_find_slot, s_compare_key_and_node, &s_keys, node));
+                    CHECK_EQUAL((ntree32::node_t)i, node);
+                }
+
+                // The tree is a regular red-black tree, removing all nodes keeps it valid
+                for (u32 i = 0; i < count; ++i)
+                {
+                    s_keys[c_find_slot] = s_find[i];
+                    ntree32::node_t removed;
+                    CHECK_TRUE(ntree32::remove(tree, root, c_temp_slot, c_find_slot, s_compare_key_and_node, &s_keys, removed));
+                    tree.del_node(removed);
+                    CHECK_TRUE(ntree32::validate(tree, root, result, s_compare_key_and_node, &s_keys));
+                }
+                CHECK_EQUAL(ntree32::c_invalid_node, root);
+
+                ntree32::teardown_tree(tree);
+            }
+        }
+
         UNITTEST_TEST(s32_tree)
         {
             ntree32::node_t root = ntree32::c_invalid_node;
@@ -1013,5 +1107,217 @@ UNITTEST_SUITE_BEGIN(tree32)
             ntree32::teardown_tree(tree);
         }
     }
+
+    UNITTEST_FIXTURE(order_statistics)
+    {
+        UNITTEST_ALLOCATOR;
+
+        // slot 0 is the 'find' slot, slot 1 the 'temp' slot, items use the slot of their node
+        const u32 c_find_slot = 0;
+        const u32 c_temp_slot = 1;
+        const s32 c_max_keys  = 2000;
+
+        static s8 s_compare(u32 _key, u32 _item, void const *user_data)
+        {
+            s32 const *keys = (s32 const *)user_data;
+            return keys[_key] < keys[_item] ? -1 : (keys[_key] > keys[_item] ? 1 : 0);
+        }
+
+        // Returns the subtree size, 'ok' becomes false when a stored size is wrong or still dirty
+        static u32 s_check_sizes(ntree32::tree_t &tree, ntree32::node_t node, bool &ok)
+        {
+            if (node == ntree32::c_invalid_node)
+                return 0;
+            u32 const size = s_check_sizes(tree, tree.get_node(node, ntree32::LEFT), ok) + s_check_sizes(tree, tree.get_node(node, ntree32::RIGHT), ok) + 1;
+            if (tree.m_sizes[node] != size)
+                ok = false;
+            return size;
+        }
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(rank_select)
+        {
+            ntree32::nnode_t *nodes   = g_allocate_array<ntree32::nnode_t>(Allocator, c_max_keys + 2);
+            u32              *sizes   = g_allocate_array<u32>(Allocator, c_max_keys + 2);
+            s32              *keys    = g_allocate_array<s32>(Allocator, c_max_keys + 2);
+            bool             *present = g_allocate_array_and_clear<bool>(Allocator, c_max_keys);
+
+            ntree32::tree_t tree;
+            ntree32::setup_tree(tree, nodes, sizes);
+            tree.m_free_index    = 2;
+            ntree32::node_t root = ntree32::c_invalid_node;
+
+            xor_random_t random;
+            random.reset(1);
+            s32 count = 0;
+            for (s32 op = 0; op < 6000; ++op)
+            {
+                u32 const r       = random.rand32();
+                s32 const k       = (s32)(r % (u32)c_max_keys);
+                keys[c_find_slot] = k;
+                if ((r & 0x30000000) != 0)
+                {
+                    ntree32::node_t inserted;
+                    bool const      added = ntree32::insert(tree, root, c_temp_slot, c_find_slot, s_compare, keys, inserted);
+                    CHECK_EQUAL(!present[k], added);
+                    keys[inserted] = k;
+                    count += added ? 1 : 0;
+                    present[k] = true;
+                }
+                else
+                {
+                    ntree32::node_t removed;
+                    bool const      gone = ntree32::remove(tree, root, c_temp_slot, c_find_slot, s_compare, keys, removed);
+                    CHECK_EQUAL(present[k], gone);
+                    if (gone)
+                        tree.del_node(removed);
+                    count -= gone ? 1 : 0;
+                    present[k] = false;
+                }
+
+                if ((op % 500) == 0 || op == 5999)
+                {
+                    bool ok = true;
+                    CHECK_EQUAL((u32)count, s_check_sizes(tree, root, ok));
+                    CHECK_TRUE(ok);
+                    CHECK_EQUAL((u32)count, ntree32::size(tree, root));
+
+                    u32 less = 0;
+                    for (s32 key = 0; key < c_max_keys; ++key)
+                    {
+                        keys[c_find_slot] = key;
+                        CHECK_EQUAL(less, ntree32::rank(tree, root, c_find_slot, s_compare, keys));
+                        if (present[key])
+                        {
+                            ntree32::node_t found;
+                            CHECK_TRUE(ntree32::select(tree, root, less, found));
+                            CHECK_EQUAL(key, keys[found]);
+                            less++;
+                        }
+                    }
+                    ntree32::node_t found;
+                    CHECK_FALSE(ntree32::select(tree, root, (u32)count, found));
+                }
+            }
+
+            // Bulk build also produces the sizes
+            for (s32 i = 0; i < 1000; ++i)
+                keys[2 + i] = i * 2;
+            tree.reset();
+            tree.m_free_index = 2 + 1000;
+            root              = ntree32::build_from_sorted(tree, 2, 1000);
+            bool ok           = true;
+            CHECK_EQUAL(1000, s_check_sizes(tree, root, ok));
+            CHECK_TRUE(ok);
+            keys[c_find_slot] = 501;
+            CHECK_EQUAL(251, ntree32::rank(tree, root, c_find_slot, s_compare, keys));
+
+            ntree32::teardown_tree(tree);
+            g_deallocate_array(Allocator, present);
+            g_deallocate_array(Allocator, keys);
+            g_deallocate_array(Allocator, sizes);
+            g_deallocate_array(Allocator, nodes);
+        }
+    }
+
+    UNITTEST_FIXTURE(find_many)
+    {
+        UNITTEST_ALLOCATOR;
+
+        // Items are the even numbers 0, 2, .., 2 * (c_num_items - 1) in slots [0, c_num_items), the queries
+        // follow in slots [c_num_items, c_num_items + c_num_queries)
+        const s32 c_num_items   = 1000;
+        const s32 c_num_queries = 300;
+
+        static s8 s_compare(u32 _key, u32 _item, void const *user_data)
+        {
+            s32 const *keys = (s32 const *)user_data;
+            return keys[_key] < keys[_item] ? -1 : (keys[_key] > keys[_item] ? 1 : 0);
+        }
+
+        struct query_compare_t
+        {
+            s32 const *m_keys;
+            s32 const *m_queries;
+
+            inline s8   operator()(u32 i, ntree32::node_t node) const { return m_queries[i] < m_keys[node] ? -1 : (m_queries[i] > m_keys[node] ? 1 : 0); }
+            inline void prefetch(ntree32::node_t) const {}
+        };
+
+        struct key_compare_t
+        {
+            s32        m_key;
+            s32 const *m_keys;
+
+            inline s8 operator()(ntree32::node_t node) const { return m_key < m_keys[node] ? -1 : (m_key > m_keys[node] ? 1 : 0); }
+        };
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(lockstep)
+        {
+            ntree32::nnode_t *nodes = g_allocate_array<ntree32::nnode_t>(Allocator, c_num_items);
+            s32              *keys  = g_allocate_array<s32>(Allocator, c_num_items + c_num_queries);
+            ntree32::index_t *index = g_allocate_array<ntree32::index_t>(Allocator, c_num_queries);
+            ntree32::node_t  *found = g_allocate_array<ntree32::node_t>(Allocator, c_num_queries);
+
+            ntree32::tree_t tree;
+            ntree32::setup_tree(tree, nodes);
+
+            // An empty tree finds nothing
+            for (s32 i = 0; i < c_num_queries; ++i)
+            {
+                keys[c_num_items + i] = (i * 37) % (c_num_items * 2 + 10);
+                index[i]              = (ntree32::index_t)(c_num_items + i);
+            }
+            CHECK_EQUAL(0, ntree32::find_many(tree, ntree32::c_invalid_node, index, c_num_queries, s_compare, keys, found));
+            CHECK_EQUAL(ntree32::c_invalid_node, found[0]);
+
+            for (s32 i = 0; i < c_num_items; ++i)
+                keys[i] = i * 2;
+            tree.m_free_index    = c_num_items;
+            ntree32::node_t root = ntree32::build_from_sorted(tree, 0, c_num_items);
+
+            // Every batch size, including the ones smaller than and not a multiple of c_find_lanes
+            for (s32 count = 0; count <= c_num_queries; count += (count < 20) ? 1 : 31)
+            {
+                u32 expected = 0;
+                for (s32 i = 0; i < count; ++i)
+                {
+                    s32 const q = keys[c_num_items + i];
+                    expected += ((q & 1) == 0 && q < c_num_items * 2) ? 1 : 0;
+                }
+
+                CHECK_EQUAL(expected, ntree32::find_many(tree, root, index, count, s_compare, keys, found));
+                for (s32 i = 0; i < count; ++i)
+                {
+                    ntree32::node_t       single;
+                    key_compare_t const   cmp = {keys[c_num_items + i], keys};
+                    bool const            has = ntree32::find(tree, root, cmp, single);
+                    CHECK_EQUAL(single, found[i]);
+                    CHECK_EQUAL(has, found[i] != ntree32::c_invalid_node);
+                    if (has)
+                        CHECK_EQUAL(keys[c_num_items + i], keys[found[i]]);
+                }
+
+                query_compare_t const cmp = {keys, keys + c_num_items};
+                CHECK_EQUAL(expected, ntree32::find_many(tree, root, count, cmp, found));
+                for (s32 i = 0; i < count; ++i)
+                {
+                    if (found[i] != ntree32::c_invalid_node)
+                        CHECK_EQUAL(keys[c_num_items + i], keys[found[i]]);
+                }
+            }
+
+            ntree32::teardown_tree(tree);
+            g_deallocate_array(Allocator, found);
+            g_deallocate_array(Allocator, index);
+            g_deallocate_array(Allocator, keys);
+            g_deallocate_array(Allocator, nodes);
+        }
+    }
 }
 UNITTEST_SUITE_END
@@ -40,6 +40,20 @@ UNITTEST_SUITE_BEGIN(vector_t)
 				darray.add_item(i);
 			CHECK_EQUAL(1024, darray.size());
 		}
+
+		UNITTEST_TEST(huge_pages_reserved)
+		{
+			// With huge pages the reservation is rounded up, the vector reserves at least what was asked
+			g_set_huge_pages(true);
+			{
+				vector_t<s32> darray(1000, 1000000);
+				CHECK_EQUAL(1000, darray.capacity());
+				CHECK_TRUE(darray.reserved() >= 1000000);
+				CHECK_TRUE(darray.set_capacity(1000000));
+				CHECK_TRUE(darray.capacity() >= 1000000);
+			}
+			g_set_huge_pages(false);
+		}
 	}
 }
 UNITTEST_SUITE_END
@@ -1,7 +1,12 @@
 #include "cbase/c_wyhash.h"
+#include "ccore/c_random.h"
+
+#include "cbase/c_console.h"
 
 #include "cunittest/cunittest.h"
 
+#include <chrono>
+
 using namespace ncore;
 
 UNITTEST_SUITE_BEGIN(wyhash)
@@ -53,6 +58,390 @@ UNITTEST_SUITE_BEGIN(wyhash)
             }
         }
 
+        UNITTEST_TEST(insert_many_find_many)
+        {
+            nhash::registry_t reg;
+            reg.init(Allocator, 1024, prime);
+
+            // Keys of 1 to 40 bytes, so that both the short and the long hash path are used
+            const s32   c_num_keys = 100;
+            char        text[c_num_keys + 40];
+            void const* keys[c_num_keys];
+            s32         sizes[c_num_keys];
+            s32         pos[c_num_keys];
+            for (s32 i = 0; i < c_num_keys + 40; ++i)
+                text[i] = (char)('a' + (i * 7) % 26);
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                keys[i]  = &text[i];
+                sizes[i] = 1 + (i % 40);
+            }
+
+            CHECK_EQUAL(c_num_keys, reg.insert_many(keys, sizes, c_num_keys, pos));
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                s32 p = -1;
+                CHECK_TRUE(reg.find((void*)keys[i], sizes[i], p));
+                CHECK_EQUAL(pos[i], p);
+            }
+
+            s32 found[c_num_keys];
+            CHECK_EQUAL(c_num_keys, reg.find_many(keys, sizes, c_num_keys, found));
+            for (s32 i = 0; i < c_num_keys; ++i)
+                CHECK_EQUAL(pos[i], found[i]);
+
+            s32 p;
+            CHECK_TRUE(reg.remove((void*)keys[3], sizes[3], p));
+            CHECK_EQUAL(c_num_keys - 1, reg.find_many(keys, sizes, c_num_keys, found));
+            CHECK_EQUAL(reg.size(), found[3]);
+        }
+    }
+
+    UNITTEST_FIXTURE(wybatch)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+        UNITTEST_TEST(same_as_wyhash_bytes)
+        {
+            u64 secret[4];
+            nhash::wymake_secret(42, secret);
+
+            u8 data[64 * 41];
+            for (s32 i = 0; i < (s32)sizeof(data); ++i)
+                data[i] = (u8)(i * 131 + (i >> 5));
+
+            // Every key size from 0 to 40 bytes and a count that is not a multiple of the lane count
+            u64 out[64];
+            for (s32 size = 0; size <= 40; ++size)
+            {
+                nhash::wyhash_batch(data, size, 63, 7, secret, out);
+                for (s32 i = 0; i < 63; ++i)
+                    CHECK_EQUAL(nhash::wyhash_bytes(data + i * size, size, 7, secret), out[i]);
+            }
+
+            void const* keys[64];
+            s32         lens[64];
+            for (s32 i = 0; i < 64; ++i)
+            {
+                keys[i] = data + i * 13;
+                lens[i] = (i * 11) % 41;
+            }
+            nhash::wyhash_batch(keys, lens, 64, 3, secret, out);
+            for (s32 i = 0; i < 64; ++i)
+                CHECK_EQUAL(nhash::wyhash_bytes(keys[i], lens[i], 3, secret), out[i]);
+        }
+
+        static u64 s_elapsed_us(std::chrono::high_resolution_clock::time_point t0)
+        {
+            return (u64)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - t0).count();
+        }
+
+        static void s_print(const char* name, s32 count, u64 one_us, u64 many_us)
+        {
+            console->write(name);
+            console->write(" keys: ");
+            console->write((s64)count);
+            console->write(", one by one: ");
+            console->write((s64)one_us);
+            console->write(" us, batched: ");
+            console->write((s64)many_us);
+            console->writeLine(" us");
+        }
+
+        UNITTEST_TEST(benchmark)
+        {
+#ifdef TARGET_DEBUG
+            const s32 c_num_keys = 100000;
+#else
+            const s32 c_num_keys = 4000000;
+#endif
+            u64* keys   = g_allocate_array<u64>(Allocator, c_num_keys);
+            u64* hashes = g_allocate_array_and_clear<u64>(Allocator, c_num_keys);  // touched, no page faults while timing
+            s32* values = g_allocate_array<s32>(Allocator, c_num_keys);
+            xor_random_t random;
+            random.reset(42);
+            for (s32 i = 0; i < c_num_keys; ++i)
+                keys[i] = random.rand64();
+
+            u64 secret[4];
+            nhash::wymake_secret(1, secret);
+
+            u64  sum = 0;
+            auto t0  = std::chrono::high_resolution_clock::now();
+            for (s32 i = 0; i < c_num_keys; ++i)
+                sum += nhash::wyhash_bytes(&keys[i], 8, 0, secret);
+            u64 const one_us = s_elapsed_us(t0);
+
+            t0 = std::chrono::high_resolution_clock::now();
+            nhash::wyhash_batch(keys, 8, c_num_keys, 0, secret, hashes);
+            u64 const many_us = s_elapsed_us(t0);
+            for (s32 i = 0; i < c_num_keys; ++i)
+                sum -= hashes[i];
+            CHECK_EQUAL(0, sum);
+            s_print("wyhash u64:", c_num_keys, one_us, many_us);
+
+            nhash::wymap_t<u64, s32> a;
+            a.init(Allocator, c_num_keys);
+            t0 = std::chrono::high_resolution_clock::now();
+            for (s32 i = 0; i < c_num_keys; ++i)
+                a.insert(keys[i], i);
+            u64 const insert_one_us = s_elapsed_us(t0);
+
+            for (s32 i = 0; i < c_num_keys; ++i)
+                values[i] = i;
+            nhash::wymap_t<u64, s32> b;
+            b.init(Allocator, c_num_keys);
+            t0 = std::chrono::high_resolution_clock::now();
+            b.insert_many(keys, values, c_num_keys);
+            u64 const insert_many_us = s_elapsed_us(t0);
+            s_print("wymap_t insert:", c_num_keys, insert_one_us, insert_many_us);
+
+            // Look the keys up in the reverse order of inserting them
+            for (s32 i = 0; i < c_num_keys / 2; ++i)
+            {
+                u64 const t              = keys[i];
+                keys[i]                  = keys[c_num_keys - 1 - i];
+                keys[c_num_keys - 1 - i] = t;
+            }
+            s64 total = 0;
+            t0        = std::chrono::high_resolution_clock::now();
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                s32 value = 0;
+                a.find(keys[i], value);
+                total += value;
+            }
+            u64 const find_one_us = s_elapsed_us(t0);
+
+            t0 = std::chrono::high_resolution_clock::now();
+            CHECK_EQUAL(c_num_keys, b.find_many(keys, c_num_keys, values));
+            u64 const find_many_us = s_elapsed_us(t0);
+            for (s32 i = 0; i < c_num_keys; ++i)
+                total -= values[i];
+            CHECK_EQUAL(0, total);
+            s_print("wymap_t find:", c_num_keys, find_one_us, find_many_us);
+
+            g_deallocate_array(Allocator, values);
+            g_deallocate_array(Allocator, hashes);
+            g_deallocate_array(Allocator, keys);
+        }
+    }
+
+    UNITTEST_FIXTURE(wytable)
+    {
+        UNITTEST_ALLOCATOR;
+
+        UNITTEST_FIXTURE_SETUP() {}
+        UNITTEST_FIXTURE_TEARDOWN() {}
+
+
+        struct key_t
+        {
+            u32 m_a;
+            u32 m_b;
+        };
+
+        UNITTEST_TEST(full_key)
+        {
+            // Keys are compared in full, an existing key is not inserted again
+            nhash::wymap_t<key_t, s32> map;
+            map.init(Allocator, 16);
+
+            key_t const a = {1, 2};
+            key_t const b = {2, 1};
+            CHECK_TRUE(map.insert(a, 10));
+            CHECK_TRUE(map.insert(b, 20));
+            CHECK_FALSE(map.insert(a, 30));
+            CHECK_EQUAL(2, map.count());
+
+            s32 value = 0;
+            CHECK_TRUE(map.find(a, value));
+            CHECK_EQUAL(10, value);
+            CHECK_TRUE(map.find(b, value));
+            CHECK_EQUAL(20, value);
+
+            key_t const c = {1, 3};
+            CHECK_FALSE(map.contains(c));
+            CHECK_FALSE(map.remove(c));
+            CHECK_TRUE(map.remove(a));
+            CHECK_FALSE(map.contains(a));
+            CHECK_TRUE(map.contains(b));
+        }
+
+        UNITTEST_TEST(hash_collisions)
+        {
+            // Every key gets the same hash, keys must still be told apart by comparing them in full,
+            // also across growing (rehashing) and the backward shift of remove
+            nhash::table_t table;
+            table.init(Allocator, sizeof(key_t), alignof(key_t), sizeof(key_t), 8);
+            u64 const c_hash = 0x123456789abcdef0ull;
+
+            const s32 c_num_keys = 64;
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                key_t const key      = {(u32)i, (u32)(c_num_keys - i)};
+                bool        inserted = false;
+                key_t*      item     = (key_t*)table.insert(&key, c_hash, inserted);
+                CHECK_NOT_NULL(item);
+                CHECK_TRUE(inserted);
+                CHECK_EQUAL(key.m_a, item->m_a);
+                CHECK_EQUAL(key.m_b, item->m_b);
+
+                inserted = true;
+                item     = (key_t*)table.insert(&key, c_hash, inserted);
+                CHECK_FALSE(inserted);
+                CHECK_EQUAL(key.m_b, item->m_b);
+            }
+            CHECK_EQUAL(c_num_keys, table.count());
+
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                key_t const  key  = {(u32)i, (u32)(c_num_keys - i)};
+                key_t const* item = (key_t const*)table.find(&key, c_hash);
+                CHECK_NOT_NULL(item);
+                CHECK_EQUAL(key.m_b, item->m_b);
+                key_t const other = {(u32)i, (u32)(c_num_keys - i + 1)};
+                CHECK_NULL(table.find(&other, c_hash));
+            }
+
+            for (s32 i = 0; i < c_num_keys; i += 2)
+            {
+                key_t const key = {(u32)i, (u32)(c_num_keys - i)};
+                CHECK_TRUE(table.remove(&key, c_hash));
+                CHECK_FALSE(table.remove(&key, c_hash));
+            }
+            CHECK_EQUAL(c_num_keys / 2, table.count());
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                key_t const key = {(u32)i, (u32)(c_num_keys - i)};
+                CHECK_EQUAL((i & 1) == 1, table.find(&key, c_hash) != nullptr);
+            }
+
+            table.release();
+        }
+
+        UNITTEST_TEST(grow_incrementally)
+        {
+            nhash::wymap_t<s32, s32> map;
+            map.init(Allocator, 8);
+            s32 const initial = map.size();
+
+            // The table starts rehashing when it is full, one insert only moves a few slots
+            s32 i = 0;
+            while (!map.m_table.rehashing())
+            {
+                CHECK_TRUE(map.insert(i, i * 2));
+                i++;
+            }
+            CHECK_EQUAL(initial * 2, map.size());
+
+            const s32 c_num_keys = 100000;
+            for (; i < c_num_keys; ++i)
+            {
+                CHECK_TRUE(map.insert(i, i * 2));
+
+                // Lookups see every item whether it has been moved yet or not
+                if ((i & 1023) == 0)
+                {
+                    for (s32 j = 0; j <= i; j += 97)
+                        CHECK_TRUE(map.contains(j));
+                }
+            }
+            CHECK_EQUAL(c_num_keys, map.count());
+
+            for (s32 j = 0; j < c_num_keys; ++j)
+            {
+                s32 value = -1;
+                CHECK_TRUE(map.find(j, value));
+                CHECK_EQUAL(j * 2, value);
+            }
+            CHECK_FALSE(map.contains(c_num_keys));
+            CHECK_FALSE(map.contains(-1));
+        }
+
+        UNITTEST_TEST(insert_many_find_many)
+        {
+            const s32 c_num_keys = 5000;
+            s32       keys[c_num_keys];
+            s32       values[c_num_keys];
+            bool      found[c_num_keys];
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                keys[i]   = i * 3;
+                values[i] = i;
+            }
+
+            // The table grows (and rehashes) in the middle of the batches
+            nhash::wymap_t<s32, s32> map;
+            map.init(Allocator, 8);
+            CHECK_EQUAL(c_num_keys, map.insert_many(keys, values, c_num_keys));
+            CHECK_EQUAL(0, map.insert_many(keys, values, 100));
+            CHECK_EQUAL(c_num_keys, map.count());
+
+            for (s32 i = 0; i < c_num_keys; i += 2)
+                map.remove(keys[i]);
+            for (s32 i = 0; i < c_num_keys; ++i)
+                values[i] = -1;
+            CHECK_EQUAL(c_num_keys / 2, map.find_many(keys, c_num_keys, values, found));
+            for (s32 i = 0; i < c_num_keys; ++i)
+            {
+                CHECK_EQUAL((i & 1) == 1, found[i]);
+                CHECK_EQUAL((i & 1) == 1 ? i : -1, values[i]);
+            }
+        }
+
+        UNITTEST_TEST(random_ops)
+        {
+            const s32 c_key_range = 4096;
+            bool*     present     = g_allocate_array_and_clear<bool>(Allocator, c_key_range);
+
+            nhash::wymap_t<s32, s32> map;
+            map.init(Allocator, 4);
+            nhash::wyset_t<s32> set;
+            set.init(Allocator, 4);
+
+            xor_random_t random;
+            random.reset(7);
+            s32 count = 0;
+            for (s32 op = 0; op < 200000; ++op)
+            {
+                s32 const key = (s32)(random.rand32() % (u32)c_key_range);
+                // Mostly inserts at the start, more removes later, so the tables grow while items are removed
+                if ((random.rand32() % 100) < (op < 100000 ? 70u : 45u))
+                {
+                    CHECK_EQUAL(!present[key], map.insert(key, key + 1));
+                    CHECK_EQUAL(!present[key], set.insert(key));
+                    count += present[key] ? 0 : 1;
+                    present[key] = true;
+                }
+                else
+                {
+                    CHECK_EQUAL(present[key], map.remove(key));
+                    CHECK_EQUAL(present[key], set.remove(key));
+                    count -= present[key] ? 1 : 0;
+                    present[key] = false;
+                }
+
+                if ((op % 10007) == 0)
+                {
+                    for (s32 k = 0; k < c_key_range; ++k)
+                    {
+                        s32 value = -1;
+                        CHECK_EQUAL(present[k], map.find(k, value));
+                        if (present[k])
+                            CHECK_EQUAL(k + 1, value);
+                        CHECK_EQUAL(present[k], set.contains(k));
+                    }
+                }
+            }
+            CHECK_EQUAL(count, map.count());
+            CHECK_EQUAL(count, set.count());
+
+            g_deallocate_array(Allocator, present);
+        }
     }
 }
 UNITTEST_SUITE_END
@@ -0,0 +1,45 @@
+#ifndef __CBASE_TEST_BENCHMARK_H__
+#define __CBASE_TEST_BENCHMARK_H__
+#include "ccore/c_target.h"
+#ifdef USE_PRAGMA_ONCE
+#    pragma once
+#endif
+
+#include "cbase/c_console.h"
+
+#include <chrono>
+
+// Timing and printing helpers shared by the benchmark tests.
+// The benchmarks stay at 1M keys or less, define CBASE_BENCHMARK_LARGE to also run 10M keys.
+
+namespace ncore
+{
+    namespace ntest
+    {
+        typedef std::chrono::high_resolution_clock::time_point timepoint_t;
+
+        inline timepoint_t now() { return std::chrono::high_resolution_clock::now(); }
+        inline u64         elapsed_us(timepoint_t t0) { return (u64)std::chrono::duration_cast<std::chrono::microseconds>(now() - t0).count(); }
+
+        // Prints "<name> keys: <count>, <label>: <us> us, ..." for up to three timings, the unused labels are null
+        inline void print_times(const char* name, s32 count, const char* label0, u64 us0, const char* label1 = nullptr, u64 us1 = 0, const char* label2 = nullptr, u64 us2 = 0)
+        {
+            const char* const labels[] = {label0, label1, label2};
+            u64 const         times[]  = {us0, us1, us2};
+            console->write(name);
+            console->write(" keys: ");
+            console->write((s64)count);
+            for (s32 i = 0; i < 3 && labels[i] != nullptr; ++i)
+            {
+                console->write(", ");
+                console->write(labels[i]);
+                console->write(": ");
+                console->write((s64)times[i]);
+                console->write(" us");
+            }
+            console->writeLine();
+        }
+    }  // namespace ntest
+}  // namespace ncore
+
+#endif  // __CBASE_TEST_BENCHMARK_H__